@@ -265,7 +265,187 @@ class SourceAudioHalAsrc::ClockRecovery : public ClockHandler {
   }
 };
 
+//
+// Resampler Filtering
+//
+// The transfer coefficients `h` are corrected by linear interpolation, given
+// fraction position `mu` weigthed by `d` values. The corrected coefficients
+// are shared by all the channels, and applied to the window of each one.
+// The last of the `2 * KERNEL_A` coefficients of the tables is 0, vector
+// implementations process it to work on full registers.
+//
+
+static const int FILTER_LEN = 2 * asrc::ResamplerTables::KERNEL_A;
+
+struct GenericFilter {
+  __attribute__((no_sanitize("integer"))) static void Interpolate(
+      const int32_t* h, int16_t mu, const int16_t* d, int32_t* hc) {
+    for (int i = 0; i < FILTER_LEN - 1; i++)
+      hc[i] = h[i] + ((mu * d[i] + (1 << 6)) >> 7);
+  }
+
+  static int64_t Convolve(const int32_t* in, const int32_t* hc) {
+    int64_t s = 0;
+    for (int i = 0; i < FILTER_LEN - 1; i++) s += int64_t(in[i]) * hc[i];
+
+    return s;
+  }
+};
+
+//
+// ARM AArch 64 Neon Resampler Filtering
+//
+
+#if __ARM_NEON && __ARM_ARCH_ISA_A64
+
+#include <arm_neon.h>
+
+#define ASRC_NEON_FILTER 1
+
+static inline int32x4_t vmull_low_s16(int16x8_t a, int16x8_t b) {
+  return vmull_s16(vget_low_s16(a), vget_low_s16(b));
+}
+
+static inline int64x2_t vmlal_low_s32(int64x2_t r, int32x4_t a, int32x4_t b) {
+  return vmlal_s32(r, vget_low_s32(a), vget_low_s32(b));
+}
+
+struct NeonFilter {
+  static void Interpolate(const int32_t* h, int16_t _mu, const int16_t* d,
+                          int32_t* hc) {
+    int16x8_t mu = vdupq_n_s16(_mu);
+
+    for (int i = 0; i < FILTER_LEN; i += 8) {
+      int16x8_t d8 = vld1q_s16(d + i);
+      int32x4_t h0 = vld1q_s32(h + i), h4 = vld1q_s32(h + i + 4);
+
+      vst1q_s32(hc + i, vaddq_s32(h0, vrshrq_n_s32(vmull_low_s16(d8, mu), 7)));
+      vst1q_s32(hc + i + 4,
+                vaddq_s32(h4, vrshrq_n_s32(vmull_high_s16(d8, mu), 7)));
+    }
+  }
+
+  static int64_t Convolve(const int32_t* x, const int32_t* hc) {
+    int64x2_t sx = vdupq_n_s64(0);
+
+    for (int i = 0; i < FILTER_LEN; i += 8) {
+      int32x4_t h0 = vld1q_s32(hc + i), h4 = vld1q_s32(hc + i + 4);
+      int32x4_t x0 = vld1q_s32(x + i), x4 = vld1q_s32(x + i + 4);
+
+      sx = vmlal_low_s32(sx, x0, h0);
+      sx = vmlal_high_s32(sx, x0, h0);
+      sx = vmlal_low_s32(sx, x4, h4);
+      sx = vmlal_high_s32(sx, x4, h4);
+    }
+
+    return vaddvq_s64(sx);
+  }
+};
+
+#endif
+
+//
+// x86 AVX2 and SSE4.1 Resampler Filtering,
+// selected at runtime according to the CPU features.
+//
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#define ASRC_X86_FILTER 1
+
+struct Sse41Filter {
+  __attribute__((target("sse4.1"))) static void Interpolate(const int32_t* h,
+                                                            int16_t _mu,
+                                                            const int16_t* d,
+                                                            int32_t* hc) {
+    __m128i mu = _mm_set1_epi32(_mu);
+    __m128i rnd = _mm_set1_epi32(1 << 6);
+
+    for (int i = 0; i < FILTER_LEN; i += 4) {
+      __m128i d4 = _mm_cvtepi16_epi32(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i*>(d + i)));
+      __m128i h4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i));
+
+      d4 = _mm_srai_epi32(_mm_add_epi32(_mm_mullo_epi32(d4, mu), rnd), 7);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(hc + i),
+                       _mm_add_epi32(h4, d4));
+    }
+  }
+
+  // `_mm_mul_epi32()` multiplies the even 32 bits lanes,
+  // the odd lanes are shifted down to be multiplied in a second step.
+
+  __attribute__((target("sse4.1"))) static int64_t Convolve(
+      const int32_t* x, const int32_t* hc) {
+    __m128i sx = _mm_setzero_si128();
+
+    for (int i = 0; i < FILTER_LEN; i += 4) {
+      __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+      __m128i h4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hc + i));
+
+      sx = _mm_add_epi64(sx, _mm_mul_epi32(x4, h4));
+      sx = _mm_add_epi64(sx, _mm_mul_epi32(_mm_srli_epi64(x4, 32),
+                                           _mm_srli_epi64(h4, 32)));
+    }
+
+    int64_t s[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(s), sx);
+    return s[0] + s[1];
+  }
+};
+
+struct Avx2Filter {
+  __attribute__((target("avx2"))) static void Interpolate(const int32_t* h,
+                                                          int16_t _mu,
+                                                          const int16_t* d,
+                                                          int32_t* hc) {
+    __m256i mu = _mm256_set1_epi32(_mu);
+    __m256i rnd = _mm256_set1_epi32(1 << 6);
+
+    for (int i = 0; i < FILTER_LEN; i += 8) {
+      __m256i d8 = _mm256_cvtepi16_epi32(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(d + i)));
+      __m256i h8 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + i));
+
+      d8 = _mm256_srai_epi32(
+          _mm256_add_epi32(_mm256_mullo_epi32(d8, mu), rnd), 7);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(hc + i),
+                          _mm256_add_epi32(h8, d8));
+    }
+  }
+
+  __attribute__((target("avx2"))) static int64_t Convolve(const int32_t* x,
+                                                          const int32_t* hc) {
+    __m256i sx = _mm256_setzero_si256();
+
+    for (int i = 0; i < FILTER_LEN; i += 8) {
+      __m256i x8 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+      __m256i h8 =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hc + i));
+
+      sx = _mm256_add_epi64(sx, _mm256_mul_epi32(x8, h8));
+      sx = _mm256_add_epi64(sx, _mm256_mul_epi32(_mm256_srli_epi64(x8, 32),
+                                                 _mm256_srli_epi64(h8, 32)));
+    }
+
+    __m128i s2 = _mm_add_epi64(_mm256_castsi256_si128(sx),
+                               _mm256_extracti128_si256(sx, 1));
+
+    int64_t s[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(s), s2);
+    return s[0] + s[1];
+  }
+};
+
+#endif
+
 class SourceAudioHalAsrc::Resampler {
+ public:
+  enum class Implementation { GENERIC, NEON, SSE4_1, AVX2 };
+
+ private:
   static const int KERNEL_Q = asrc::ResamplerTables::KERNEL_Q;
   static const int KERNEL_A = asrc::ResamplerTables::KERNEL_A;
 
@@ -277,45 +457,62 @@ class SourceAudioHalAsrc::Resampler {
   int32_t win_[2][WSIZE];
   unsigned out_pos_, in_pos_;
   const int32_t pcm_min_, pcm_max_;
+  Implementation implementation_;
 
-  // Apply the transfer coefficients `h`, corrected by linear interpolation,
-  // given fraction position `mu` weigthed by `d` values.
+  // Round and saturate the result of the filter to the PCM range.
 
-  inline int32_t Filter(const int32_t* in, const int32_t* h, int16_t mu,
-                        const int16_t* d);
+  inline int32_t Output(int64_t s) const {
+    s = (s + (1 << 30)) >> 31;
+    return std::clamp(s, int64_t(pcm_min_), int64_t(pcm_max_));
+  }
 
   // Upsampling loop, the ratio is less than 1.0 in Q26 format,
   // more output samples are produced compared to input.
-
-  template <typename T>
-  __attribute__((no_sanitize("integer"))) void Upsample(
-      unsigned ratio, const T* in, int in_stride, size_t in_len,
-      size_t* in_count, T* out, int out_stride, size_t out_len,
-      size_t* out_count) {
+  // The resamplers of the channels are kept at the same position,
+  // the first one drives the loop.
+
+  template <typename T, typename F>
+  __attribute__((no_sanitize("integer"))) static void Upsample(
+      Resampler* rs, size_t channels, unsigned ratio, const T* in,
+      int in_stride, size_t in_len, size_t* in_count, T* out, int out_stride,
+      size_t out_len, size_t* out_count) {
+    auto& r0 = rs[0];
     int nin = in_len, nout = out_len;
+    int32_t hc[FILTER_LEN];
 
     while (nin > 0 && nout > 0) {
-      unsigned idx = (in_pos_ >> 26);
-      unsigned phy = (in_pos_ >> 17) & 0x1ff;
-      int16_t mu = (in_pos_ >> 2) & 0x7fff;
+      unsigned idx = (r0.in_pos_ >> 26);
+      unsigned phy = (r0.in_pos_ >> 17) & 0x1ff;
+      int16_t mu = (r0.in_pos_ >> 2) & 0x7fff;
 
       unsigned wbuf = idx < WSIZE / 2 || idx >= WSIZE + WSIZE / 2;
-      auto w = win_[wbuf] + ((idx + wbuf * WSIZE / 2) % WSIZE) - WSIZE / 2;
+      unsigned woff = (idx + wbuf * WSIZE / 2) % WSIZE;
 
-      *out = Filter(w, h_[phy], mu, d_[phy]);
+      F::Interpolate(r0.h_[phy], mu, r0.d_[phy], hc);
+      for (size_t c = 0; c < channels; c++) {
+        auto w = rs[c].win_[wbuf] + woff - WSIZE / 2;
+        out[c] = rs[c].Output(F::Convolve(w, hc));
+      }
       out += out_stride;
       nout--;
-      in_pos_ += ratio;
+      r0.in_pos_ += ratio;
 
-      if (in_pos_ - (out_pos_ << 26) >= (1u << 26)) {
-        win_[0][(out_pos_ + WSIZE / 2) % WSIZE] = win_[1][(out_pos_)] = *in;
+      if (r0.in_pos_ - (r0.out_pos_ << 26) >= (1u << 26)) {
+        for (size_t c = 0; c < channels; c++)
+          rs[c].win_[0][(r0.out_pos_ + WSIZE / 2) % WSIZE] =
+              rs[c].win_[1][(r0.out_pos_)] = in[c];
 
         in += in_stride;
         nin--;
-        out_pos_ = (out_pos_ + 1) % WSIZE;
+        r0.out_pos_ = (r0.out_pos_ + 1) % WSIZE;
       }
     }
 
+    for (size_t c = 1; c < channels; c++) {
+      rs[c].in_pos_ = r0.in_pos_;
+      rs[c].out_pos_ = r0.out_pos_;
+    }
+
     *in_count = in_len - nin;
     *out_count = out_len - nout;
   }
@@ -323,39 +520,64 @@ class SourceAudioHalAsrc::Resampler {
   // Downsample loop, the ratio is greater than 1.0 in Q26 format,
   // less output samples are produced compared to input.
 
-  template <typename T>
-  __attribute__((no_sanitize("integer"))) void Downsample(
-      unsigned ratio, const T* in, int in_stride, size_t in_len,
-      size_t* in_count, T* out, int out_stride, size_t out_len,
-      size_t* out_count) {
+  template <typename T, typename F>
+  __attribute__((no_sanitize("integer"))) static void Downsample(
+      Resampler* rs, size_t channels, unsigned ratio, const T* in,
+      int in_stride, size_t in_len, size_t* in_count, T* out, int out_stride,
+      size_t out_len, size_t* out_count) {
+    auto& r0 = rs[0];
     size_t nin = in_len, nout = out_len;
+    int32_t hc[FILTER_LEN];
 
     while (nin > 0 && nout > 0) {
-      if (in_pos_ - (out_pos_ << 26) < (1u << 26)) {
-        unsigned idx = (in_pos_ >> 26);
-        unsigned phy = (in_pos_ >> 17) & 0x1ff;
-        int16_t mu = (in_pos_ >> 2) & 0x7fff;
+      if (r0.in_pos_ - (r0.out_pos_ << 26) < (1u << 26)) {
+        unsigned idx = (r0.in_pos_ >> 26);
+        unsigned phy = (r0.in_pos_ >> 17) & 0x1ff;
+        int16_t mu = (r0.in_pos_ >> 2) & 0x7fff;
 
         unsigned wbuf = idx < WSIZE / 2 || idx >= WSIZE + WSIZE / 2;
-        auto w = win_[wbuf] + ((idx + wbuf * WSIZE / 2) % WSIZE) - WSIZE / 2;
+        unsigned woff = (idx + wbuf * WSIZE / 2) % WSIZE;
 
-        *out = Filter(w, h_[phy], mu, d_[phy]);
+        F::Interpolate(r0.h_[phy], mu, r0.d_[phy], hc);
+        for (size_t c = 0; c < channels; c++) {
+          auto w = rs[c].win_[wbuf] + woff - WSIZE / 2;
+          out[c] = rs[c].Output(F::Convolve(w, hc));
+        }
         out += out_stride;
         nout--;
-        in_pos_ += ratio;
+        r0.in_pos_ += ratio;
       }
 
-      win_[0][(out_pos_ + WSIZE / 2) % WSIZE] = win_[1][(out_pos_)] = *in;
+      for (size_t c = 0; c < channels; c++)
+        rs[c].win_[0][(r0.out_pos_ + WSIZE / 2) % WSIZE] =
+            rs[c].win_[1][(r0.out_pos_)] = in[c];
 
       in += in_stride;
       nin--;
-      out_pos_ = (out_pos_ + 1) % WSIZE;
+      r0.out_pos_ = (r0.out_pos_ + 1) % WSIZE;
+    }
+
+    for (size_t c = 1; c < channels; c++) {
+      rs[c].in_pos_ = r0.in_pos_;
+      rs[c].out_pos_ = r0.out_pos_;
     }
 
     *in_count = in_len - nin;
     *out_count = out_len - nout;
   }
 
+  template <typename T, typename F>
+  static void Process(Resampler* rs, size_t channels, unsigned ratio_q26,
+                      const T* in, int in_stride, size_t in_len,
+                      size_t* in_count, T* out, int out_stride, size_t out_len,
+                      size_t* out_count) {
+    auto fn = ratio_q26 < (1u << 26) ? &Resampler::Upsample<T, F>
+                                     : &Resampler::Downsample<T, F>;
+
+    fn(rs, channels, ratio_q26, in, in_stride, in_len, in_count, out,
+       out_stride, out_len, out_count);
+  }
+
  public:
   Resampler(int bit_depth)
       : h_(asrc::resampler_tables.h),
@@ -364,105 +586,94 @@ class SourceAudioHalAsrc::Resampler {
         out_pos_(0),
         in_pos_(0),
         pcm_min_(-(int32_t(1) << (bit_depth - 1))),
-        pcm_max_((int32_t(1) << (bit_depth - 1)) - 1) {}
+        pcm_max_((int32_t(1) << (bit_depth - 1)) - 1),
+        implementation_(DefaultImplementation()) {}
+
+  // Return if the filtering implementation can run on this CPU,
+  // and the fastest one, used by default.
+
+  static bool IsSupported(Implementation implementation) {
+    switch (implementation) {
+      case Implementation::GENERIC:
+        return true;
+#if ASRC_NEON_FILTER
+      case Implementation::NEON:
+        return true;
+#endif
+#if ASRC_X86_FILTER
+      case Implementation::SSE4_1:
+        return __builtin_cpu_supports("sse4.1");
+      case Implementation::AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+      default:
+        return false;
+    }
+  }
+
+  static Implementation DefaultImplementation() {
+    static const Implementation implementation = []() {
+      for (auto i : {Implementation::AVX2, Implementation::SSE4_1,
+                     Implementation::NEON})
+        if (IsSupported(i)) return i;
+      return Implementation::GENERIC;
+    }();
+
+    return implementation;
+  }
+
+  bool SetImplementation(Implementation implementation) {
+    if (!IsSupported(implementation)) return false;
+
+    implementation_ = implementation;
+    return true;
+  }
 
   // Resample from `in` buffer to `out` buffer, until the end of any of
   // the two buffers. `in_count` returns the number of consumed samples,
   // and `out_count` the number produced. `in_sub` returns the phase in
   // the input stream, in Q26 format.
+  //
+  // The `channels` resamplers `rs` run together, the samples of
+  // channel `c` are read from `in + c` and written to `out + c`.
+  // The filter coefficients are computed once for all the channels,
+  // using the implementation selected for the first resampler.
 
   template <typename T>
-  void Resample(unsigned ratio_q26, const T* in, int in_stride, size_t in_len,
-                size_t* in_count, T* out, int out_stride, size_t out_len,
-                size_t* out_count, unsigned* in_sub_q26) {
-    auto fn = ratio_q26 < (1u << 26) ? &Resampler::Upsample<T>
-                                     : &Resampler::Downsample<T>;
-
-    (this->*fn)(ratio_q26, in, in_stride, in_len, in_count, out, out_stride,
-                out_len, out_count);
+  static void Resample(Resampler* rs, size_t channels, unsigned ratio_q26,
+                       const T* in, int in_stride, size_t in_len,
+                       size_t* in_count, T* out, int out_stride,
+                       size_t out_len, size_t* out_count,
+                       unsigned* in_sub_q26) {
+    switch (rs[0].implementation_) {
+#if ASRC_NEON_FILTER
+      case Implementation::NEON:
+        Process<T, NeonFilter>(rs, channels, ratio_q26, in, in_stride, in_len,
+                               in_count, out, out_stride, out_len, out_count);
+        break;
+#endif
+#if ASRC_X86_FILTER
+      case Implementation::SSE4_1:
+        Process<T, Sse41Filter>(rs, channels, ratio_q26, in, in_stride,
+                                in_len, in_count, out, out_stride, out_len,
+                                out_count);
+        break;
+      case Implementation::AVX2:
+        Process<T, Avx2Filter>(rs, channels, ratio_q26, in, in_stride, in_len,
+                               in_count, out, out_stride, out_len, out_count);
+        break;
+#endif
+      default:
+        Process<T, GenericFilter>(rs, channels, ratio_q26, in, in_stride,
+                                  in_len, in_count, out, out_stride, out_len,
+                                  out_count);
+        break;
+    }
 
-    *in_sub_q26 = in_pos_ & ((1u << 26) - 1);
+    *in_sub_q26 = rs[0].in_pos_ & ((1u << 26) - 1);
   }
 };
 
-//
-// ARM AArch 64 Neon Resampler Filtering
-//
-
-#if __ARM_NEON && __ARM_ARCH_ISA_A64
-
-#include <arm_neon.h>
-
-static inline int32x4_t vmull_low_s16(int16x8_t a, int16x8_t b) {
-  return vmull_s16(vget_low_s16(a), vget_low_s16(b));
-}
-
-static inline int64x2_t vmull_low_s32(int32x4_t a, int32x4_t b) {
-  return vmull_s32(vget_low_s32(a), vget_low_s32(b));
-}
-
-static inline int64x2_t vmlal_low_s32(int64x2_t r, int32x4_t a, int32x4_t b) {
-  return vmlal_s32(r, vget_low_s32(a), vget_low_s32(b));
-}
-
-inline int32_t SourceAudioHalAsrc::Resampler::Filter(const int32_t* x,
-                                                     const int32_t* h,
-                                                     int16_t _mu,
-                                                     const int16_t* d) {
-  int64x2_t sx;
-
-  int16x8_t mu = vdupq_n_s16(_mu);
-
-  int16x8_t d0 = vld1q_s16(d + 0);
-  int32x4_t h0 = vld1q_s32(h + 0), h4 = vld1q_s32(h + 4);
-  int32x4_t x0 = vld1q_s32(x + 0), x4 = vld1q_s32(x + 4);
-
-  h0 = vaddq_s32(h0, vrshrq_n_s32(vmull_low_s16(d0, mu), 7));
-  h4 = vaddq_s32(h4, vrshrq_n_s32(vmull_high_s16(d0, mu), 7));
-
-  sx = vmull_low_s32(x0, h0);
-  sx = vmlal_high_s32(sx, x0, h0);
-  sx = vmlal_low_s32(sx, x4, h4);
-  sx = vmlal_high_s32(sx, x4, h4);
-
-  for (int i = 8; i < 32; i += 8) {
-    int16x8_t d8 = vld1q_s16(d + i);
-    int32x4_t h8 = vld1q_s32(h + i), h12 = vld1q_s32(h + i + 4);
-    int32x4_t x8 = vld1q_s32(x + i), x12 = vld1q_s32(x + i + 4);
-
-    h8 = vaddq_s32(h8, vrshrq_n_s32(vmull_low_s16(d8, mu), 7));
-    h12 = vaddq_s32(h12, vrshrq_n_s32(vmull_high_s16(d8, mu), 7));
-
-    sx = vmlal_low_s32(sx, x8, h8);
-    sx = vmlal_high_s32(sx, x8, h8);
-    sx = vmlal_low_s32(sx, x12, h12);
-    sx = vmlal_high_s32(sx, x12, h12);
-  }
-
-  int64_t s = (vaddvq_s64(sx) + (1 << 30)) >> 31;
-  return std::clamp(s, int64_t(pcm_min_), int64_t(pcm_max_));
-}
-
-//
-// Generic Resampler Filtering
-//
-
-#else
-
-inline int32_t SourceAudioHalAsrc::Resampler::Filter(const int32_t* in,
-                                                     const int32_t* h,
-                                                     int16_t mu,
-                                                     const int16_t* d) {
-  int64_t s = 0;
-  for (int i = 0; i < 2 * KERNEL_A - 1; i++)
-    s += int64_t(in[i]) * (h[i] + ((mu * d[i] + (1 << 6)) >> 7));
-
-  s = (s + (1 << 30)) >> 31;
-  return std::clamp(s, int64_t(pcm_min_), int64_t(pcm_max_));
-}
-
-#endif
-
 SourceAudioHalAsrc::SourceAudioHalAsrc(
     std::shared_ptr<ClockSource> clock_source, int channels, int sample_rate,
     int bit_depth, int interval_us, int num_burst_buffers, int burst_delay_ms)
@@ -559,7 +770,8 @@ __attribute__((no_sanitize("integer"))) void SourceAudioHalAsrc::Resample(
 
     // Load from the context the current output buffer, the offset
     // and deduct the remaning size. Let's resample the interleaved
-    // PCM stream, a separate reampler is used for each channel.
+    // PCM stream, a separate reampler is used for each channel,
+    // all of them running together.
 
     auto buffer = &buffers.pool[buffers.index];
     auto out_data = (T*)buffer->data() + buffers.offset;
@@ -568,9 +780,9 @@ __attribute__((no_sanitize("integer"))) void SourceAudioHalAsrc::Resample(
 
     size_t in_count, out_count;
 
-    for (auto& r : resamplers)
-      r.Resample<T>(ratio_q26, in_data++, channels, in_length, &in_count,
-                    out_data++, channels, out_length, &out_count, &sub_q26);
+    Resampler::Resample<T>(resamplers.data(), channels, ratio_q26, in_data,
+                           channels, in_length, &in_count, out_data, channels,
+                           out_length, &out_count, &sub_q26);
 
     in_length -= in_count;
     buffers.offset += out_count * channels;
@@ -16,6 +16,8 @@
 
 #include "asrc_resampler.cc"
 
+#include <chrono>
+#include <cmath>
 #include <cstdio>
 #include <iostream>
 
@@ -31,17 +33,25 @@ class SourceAudioHalAsrcTest : public SourceAudioHalAsrc {
       : SourceAudioHalAsrc(std::make_unique<MockClockSource>(), channels, 48000,
                            bitdepth, 10000) {}
 
+  bool SetImplementation(int implementation) {
+    for (auto& r : *resamplers_)
+      if (!r.SetImplementation(Resampler::Implementation(implementation)))
+        return false;
+
+    return true;
+  }
+
   template <typename T>
   void Resample(double ratio, const T* in, size_t in_length, size_t* in_count,
                 T* out, size_t out_length, size_t* out_count) {
-    auto resamplers = *resamplers_;
+    auto& resamplers = *resamplers_;
     auto channels = resamplers.size();
     unsigned sub_q26;
 
-    for (auto& r : resamplers)
-      r.Resample(round(ldexp(ratio, 26)), in, channels, in_length / channels,
-                 in_count, out, channels, out_length / channels, out_count,
-                 &sub_q26);
+    Resampler::Resample<T>(resamplers.data(), channels,
+                           round(ldexp(ratio, 26)), in, channels,
+                           in_length / channels, in_count, out, channels,
+                           out_length / channels, out_count, &sub_q26);
   }
 };
 
@@ -77,4 +87,76 @@ extern "C" void resample_i32(int channels, int bitdepth, double ratio,
   return;
 }
 
+// Resample with the filter implementation given, `Resampler::Implementation`
+// value, to check bit-exactness. Returns false when the implementation is
+// not supported.
+
+template <typename T>
+static bool ResampleWith(int implementation, int channels, int bitdepth,
+                         double ratio, const T* in, size_t in_length, T* out,
+                         size_t out_length) {
+  size_t in_count, out_count;
+
+  SourceAudioHalAsrcTest asrc(channels, bitdepth);
+  if (!asrc.SetImplementation(implementation)) return false;
+
+  asrc.Resample<T>(ratio, in, in_length, &in_count, out, out_length,
+                   &out_count);
+  return true;
+}
+
+extern "C" bool resample_i16_with(int implementation, int channels,
+                                  int bitdepth, double ratio, const int16_t* in,
+                                  size_t in_length, int16_t* out,
+                                  size_t out_length) {
+  return ResampleWith<int16_t>(implementation, channels, bitdepth, ratio, in,
+                               in_length, out, out_length);
+}
+
+extern "C" bool resample_i32_with(int implementation, int channels,
+                                  int bitdepth, double ratio, const int32_t* in,
+                                  size_t in_length, int32_t* out,
+                                  size_t out_length) {
+  return ResampleWith<int32_t>(implementation, channels, bitdepth, ratio, in,
+                               in_length, out, out_length);
+}
+
+// Benchmark an implementation, on one second of 48 KHz input per round.
+// Returns the number of output samples, all channels included, per second
+// of processing, or 0 when the implementation is not supported.
+
+template <typename T>
+static double MeasureSamplesPerSecond(int implementation, int channels,
+                                      int bitdepth, double ratio, int rounds) {
+  SourceAudioHalAsrcTest asrc(channels, bitdepth);
+  if (!asrc.SetImplementation(implementation)) return 0;
+
+  std::vector<T> in(48000 * channels);
+  std::vector<T> out(ceil(in.size() / ratio) + channels);
+  for (size_t i = 0; i < in.size(); i++)
+    in[i] = ldexp(sin(2 * M_PI * 1000 * (i / channels) / 48000.), bitdepth - 2);
+
+  size_t in_count, out_count, num_samples = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  for (int i = 0; i < rounds; i++) {
+    asrc.Resample<T>(ratio, in.data(), in.size(), &in_count, out.data(),
+                     out.size(), &out_count);
+    num_samples += out_count * channels;
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return num_samples / elapsed.count();
+}
+
+extern "C" double resample_samples_per_second(int implementation, int channels,
+                                              int bitdepth, double ratio,
+                                              int rounds) {
+  return bitdepth <= 16 ? MeasureSamplesPerSecond<int16_t>(
+                              implementation, channels, bitdepth, ratio, rounds)
+                        : MeasureSamplesPerSecond<int32_t>(
+                              implementation, channels, bitdepth, ratio, rounds);
+}
+
 }  // namespace bluetooth::audio::asrc
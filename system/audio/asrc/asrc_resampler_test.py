@@ -19,7 +19,8 @@ import ctypes
 import numpy as np
 from scipy import signal
 from mobly import test_runner, base_test
-from mobly.asserts import assert_greater
+from mobly.asserts import assert_equal, assert_greater
+import logging
 import sys
 import os
 
@@ -32,7 +33,7 @@ class CResampler:
         self.channels = channels
         self.bitdepth = bitdepth
 
-    def resample(self, xs, ratio):
+    def resample(self, xs, ratio, implementation=None):
 
         c_int = ctypes.c_int
         c_size_t = ctypes.c_size_t
@@ -48,17 +49,40 @@ class CResampler:
         xs_int = np.rint(np.clip(np.ldexp(xs, bitdepth-1), xs_min, xs_max)).\
                  astype([np.int16, np.int32][bitdepth > 16], 'C')
 
-        ys_int = np.empty(int(np.ceil(len(xs) / ratio)), dtype=xs_int.dtype)
+        ys_int = np.empty(int(np.ceil(len(xs) / channels / ratio)) * channels, dtype=xs_int.dtype)
 
-        if bitdepth <= 16:
-            lib.resample_i16(c_int(channels), c_int(bitdepth), c_double(ratio), xs_int.ctypes.data_as(c_int16_p),
-                             c_size_t(len(xs_int)), ys_int.ctypes.data_as(c_int16_p), c_size_t(len(ys_int)))
+        if implementation is None:
+            if bitdepth <= 16:
+                lib.resample_i16(c_int(channels), c_int(bitdepth), c_double(ratio), xs_int.ctypes.data_as(c_int16_p),
+                                 c_size_t(len(xs_int)), ys_int.ctypes.data_as(c_int16_p), c_size_t(len(ys_int)))
+            else:
+                lib.resample_i32(c_int(channels), c_int(bitdepth), c_double(ratio), xs_int.ctypes.data_as(c_int32_p),
+                                 c_size_t(len(xs_int)), ys_int.ctypes.data_as(c_int32_p), c_size_t(len(ys_int)))
         else:
-            lib.resample_i32(c_int(channels), c_int(bitdepth), c_double(ratio), xs_int.ctypes.data_as(c_int32_p),
-                             c_size_t(len(xs_int)), ys_int.ctypes.data_as(c_int32_p), c_size_t(len(ys_int)))
+            lib.resample_i16_with.restype = ctypes.c_bool
+            lib.resample_i32_with.restype = ctypes.c_bool
+            if bitdepth <= 16:
+                supported = lib.resample_i16_with(c_int(implementation), c_int(channels), c_int(bitdepth),
+                                                  c_double(ratio), xs_int.ctypes.data_as(c_int16_p),
+                                                  c_size_t(len(xs_int)), ys_int.ctypes.data_as(c_int16_p),
+                                                  c_size_t(len(ys_int)))
+            else:
+                supported = lib.resample_i32_with(c_int(implementation), c_int(channels), c_int(bitdepth),
+                                                  c_double(ratio), xs_int.ctypes.data_as(c_int32_p),
+                                                  c_size_t(len(xs_int)), ys_int.ctypes.data_as(c_int32_p),
+                                                  c_size_t(len(ys_int)))
+            if not supported:
+                return None
 
         return np.ldexp(ys_int, 1 - bitdepth)
 
+    def samples_per_second(self, ratio, implementation, rounds=10):
+
+        lib.resample_samples_per_second.restype = ctypes.c_double
+        return lib.resample_samples_per_second(ctypes.c_int(implementation), ctypes.c_int(self.channels),
+                                               ctypes.c_int(self.bitdepth), ctypes.c_double(ratio),
+                                               ctypes.c_int(rounds))
+
 
 FS = 48e3
 
@@ -114,6 +138,41 @@ class SnrTest(base_test.BaseTestClass):
         assert_greater(mean_snr(cresampler_24, 48.0 / 44.1), 114)
 
 
+# Values of `SourceAudioHalAsrc::Resampler::Implementation`
+IMPLEMENTATIONS = {'generic': 0, 'neon': 1, 'sse4_1': 2, 'avx2': 3}
+
+
+class ImplementationTest(base_test.BaseTestClass):
+
+    def test_bit_exact(self):
+        rng = np.random.default_rng(0)
+
+        for channels in [1, 2, 4]:
+            for bitdepth in [16, 24]:
+                resampler = CResampler(lib, channels, bitdepth)
+                xs = rng.uniform(-1, 1, 4096 * channels)
+
+                for ratio in [44.1 / 48.0, 48.0 / 44.1]:
+                    ys_generic = resampler.resample(xs, ratio, IMPLEMENTATIONS['generic'])
+
+                    for name, implementation in IMPLEMENTATIONS.items():
+                        ys = resampler.resample(xs, ratio, implementation)
+                        if ys is None:
+                            continue
+
+                        assert_equal(np.array_equal(ys, ys_generic), True,
+                                     '%s: %d channels, %d bits, ratio %.4f' % (name, channels, bitdepth, ratio))
+
+    def test_samples_per_second(self):
+        for channels in [1, 2]:
+            resampler = CResampler(lib, channels, 16)
+
+            for name, implementation in IMPLEMENTATIONS.items():
+                rate = resampler.samples_per_second(48.0 / 44.1, implementation)
+                if rate > 0:
+                    logging.info('%s, %d channels: %.1f Msamples/s', name, channels, rate / 1e6)
+
+
 if __name__ == '__main__':
     index = sys.argv.index('--')
     sys.argv = sys.argv[:1] + sys.argv[index + 1:]
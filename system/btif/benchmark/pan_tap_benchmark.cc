@@ -0,0 +1,204 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "btif/include/btif_pan_internal.h"
+#include "osi/include/osi.h"
+#include "stack/include/pan_api.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// Frames forwarded per iteration
+constexpr int kNumFrames = 1000;
+
+// A SOCK_SEQPACKET socketpair stands in for the TAP interface: like the TAP
+// driver it hands over one whole frame per read and takes one per write. The
+// host end is fds_[0], the network end fds_[1].
+class BM_PanTap : public ::benchmark::Fixture {
+ public:
+  void SetUp(State& state) override {
+    ::benchmark::Fixture::SetUp(state);
+    socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds_);
+  }
+
+  void TearDown(State& state) override {
+    close(fds_[0]);
+    close(fds_[1]);
+    ::benchmark::Fixture::TearDown(state);
+  }
+
+ protected:
+  // Network sending kNumFrames Ethernet frames of range(0) bytes
+  std::thread StartNetworkWriter(State& state) {
+    return std::thread([this, size = state.range(0)]() {
+      std::vector<uint8_t> frame(size, 0x5a);
+      for (int i = 0; i < kNumFrames; i++) {
+        ssize_t ret;
+        OSI_NO_INTR(ret = write(fds_[1], frame.data(), frame.size()));
+        if (ret <= 0) return;
+      }
+    });
+  }
+
+  // Network draining kNumFrames frames
+  std::thread StartNetworkReader() {
+    return std::thread([this]() {
+      std::vector<uint8_t> frame(TAP_MAX_PKT_WRITE_LEN + sizeof(tETH_HDR));
+      for (int i = 0; i < kNumFrames; i++) {
+        ssize_t ret;
+        OSI_NO_INTR(ret = read(fds_[1], frame.data(), frame.size()));
+        if (ret <= 0) return;
+      }
+    });
+  }
+
+  static BT_HDR* AllocBuffer() {
+    BT_HDR* buffer = static_cast<BT_HDR*>(malloc(PAN_BUF_SIZE));
+    buffer->offset = PAN_MINIMUM_OFFSET;
+    buffer->len = PAN_BUF_SIZE - sizeof(BT_HDR) - buffer->offset;
+    return buffer;
+  }
+
+  static void SetCounters(State& state) {
+    state.SetItemsProcessed(static_cast<int_fast64_t>(state.iterations()) *
+                            kNumFrames);
+    state.SetBytesProcessed(static_cast<int_fast64_t>(state.iterations()) *
+                            kNumFrames * state.range(0));
+  }
+
+  int fds_[2];
+};
+
+}  // namespace
+
+// What btu_exec_tap_fd_read() does by default: read into congest_packet, copy
+// into the buffer handed to PAN and poll the fd before the next frame
+BENCHMARK_DEFINE_F(BM_PanTap, receive_copy)(State& state) {
+  unsigned char congest_packet[1600];
+  for (auto _ : state) {
+    std::thread network = StartNetworkWriter(state);
+    for (int i = 0; i < kNumFrames; i++) {
+      BT_HDR* buffer = AllocBuffer();
+      ssize_t ret;
+      OSI_NO_INTR(ret = read(fds_[0], congest_packet, sizeof(congest_packet)));
+      if (ret <= 0) {
+        free(buffer);
+        break;
+      }
+      buffer->len = std::min<uint16_t>(ret, buffer->len);
+      memcpy(buffer->data + buffer->offset, congest_packet, buffer->len);
+      benchmark::DoNotOptimize(buffer->data[buffer->offset]);
+      free(buffer);
+
+      struct pollfd ufd = {.fd = fds_[0], .events = POLLIN, .revents = 0};
+      OSI_NO_INTR(ret = poll(&ufd, 1, 0));
+      benchmark::DoNotOptimize(ret);
+    }
+    network.join();
+  }
+  SetCounters(state);
+}
+BENCHMARK_REGISTER_F(BM_PanTap, receive_copy)
+    ->Arg(64)
+    ->Arg(576)
+    ->Arg(1514)
+    ->UseRealTime();
+
+BENCHMARK_DEFINE_F(BM_PanTap, receive_zero_copy)(State& state) {
+  for (auto _ : state) {
+    std::thread network = StartNetworkWriter(state);
+    for (int i = 0; i < kNumFrames; i++) {
+      BT_HDR* buffer = AllocBuffer();
+      if (btpan_tap_read(fds_[0], buffer) <= 0) {
+        free(buffer);
+        break;
+      }
+      benchmark::DoNotOptimize(buffer->data[buffer->offset]);
+      free(buffer);
+    }
+    network.join();
+  }
+  SetCounters(state);
+}
+BENCHMARK_REGISTER_F(BM_PanTap, receive_zero_copy)
+    ->Arg(64)
+    ->Arg(576)
+    ->Arg(1514)
+    ->UseRealTime();
+
+// What btpan_tap_send() did: copy the header and the payload together
+BENCHMARK_DEFINE_F(BM_PanTap, transmit_copy)(State& state) {
+  tETH_HDR eth_hdr = {};
+  std::vector<uint8_t> payload(state.range(0) - sizeof(tETH_HDR), 0x5a);
+  for (auto _ : state) {
+    std::thread network = StartNetworkReader();
+    for (int i = 0; i < kNumFrames; i++) {
+      char packet[TAP_MAX_PKT_WRITE_LEN + sizeof(tETH_HDR)];
+      memcpy(packet, &eth_hdr, sizeof(tETH_HDR));
+      memcpy(packet + sizeof(tETH_HDR), payload.data(), payload.size());
+      ssize_t ret;
+      OSI_NO_INTR(ret = write(fds_[0], packet,
+                              payload.size() + sizeof(tETH_HDR)));
+      benchmark::DoNotOptimize(ret);
+    }
+    network.join();
+  }
+  SetCounters(state);
+}
+BENCHMARK_REGISTER_F(BM_PanTap, transmit_copy)
+    ->Arg(64)
+    ->Arg(576)
+    ->Arg(1514)
+    ->UseRealTime();
+
+BENCHMARK_DEFINE_F(BM_PanTap, transmit_writev)(State& state) {
+  tETH_HDR eth_hdr = {};
+  std::vector<uint8_t> payload(state.range(0) - sizeof(tETH_HDR), 0x5a);
+  for (auto _ : state) {
+    std::thread network = StartNetworkReader();
+    for (int i = 0; i < kNumFrames; i++) {
+      benchmark::DoNotOptimize(
+          btpan_tap_write(fds_[0], eth_hdr, payload.data(), payload.size()));
+    }
+    network.join();
+  }
+  SetCounters(state);
+}
+BENCHMARK_REGISTER_F(BM_PanTap, transmit_writev)
+    ->Arg(64)
+    ->Arg(576)
+    ->Arg(1514)
+    ->UseRealTime();
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+#include "stack/include/bt_hdr.h"
+
+// Encoded media packets of the A2DP source waiting for the BTA AV data path.
+//
+// The slots are preallocated: the overflow handling of the A2DP source never
+// lets more than TxQueuePolicy::MaxDepth() packets pile up. Each packet is
+// stamped with its enqueue time to account for the queueing latency.
+class TxAudioQueue {
+ public:
+  static constexpr size_t kCapacity = UINT8_MAX + 1;
+
+  // Packets freed by DropOldest()
+  struct DropResult {
+    size_t packets = 0;
+    size_t bytes = 0;
+    size_t frames = 0;
+  };
+
+  // Returns false if the queue is full, the caller keeps ownership of |p_buf|
+  bool Enqueue(BT_HDR* p_buf, uint64_t now_us);
+
+  // Returns nullptr if the queue is empty
+  BT_HDR* TryDequeue(uint64_t* p_enqueue_us);
+
+  size_t Length() const;
+
+  // Frees all queued packets, returns how many there were
+  size_t Flush();
+
+  // Frees the |count| oldest packets, or all of them if there are fewer
+  DropResult DropOldest(size_t count);
+
+ private:
+  struct TxAudioPacket {
+    BT_HDR* p_buf;
+    uint64_t enqueue_us;
+  };
+
+  mutable std::mutex mutex_;
+  std::array<TxAudioPacket, kCapacity> slots_{};
+  size_t head_ = 0;
+  size_t length_ = 0;
+};
+
+// Depth of the tx queue of the A2DP source.
+//
+// By default the queue may hold |dynamic_audio_buffer_size| packets, and
+// is flushed completely when it overflows. In pipelined mode it also has to
+// fit in the latency budget, only the oldest packets that do not fit anymore
+// are dropped, and the data path keeps it filled up to a target depth that
+// adapts to the link.
+struct TxQueuePolicy {
+  bool pipelined_encoding = false;
+  uint64_t latency_budget_us = 0;
+  uint64_t encoder_interval_ms = 0;
+  size_t dynamic_audio_buffer_size = 0;
+
+  // Maximum number of packets in the queue, at least 1
+  size_t MaxDepth() const;
+
+  // Number of queued packets to drop before adding a packet of |frames_n|
+  // frames to a queue of |queue_length| packets, std::nullopt if it fits.
+  std::optional<size_t> OverflowDropCount(size_t queue_length,
+                                          size_t frames_n) const;
+
+  // Target depth after the link read from the queue. |buffer_available| is
+  // false if the queue was empty, |encoder_late| true if the last encoding
+  // pass is more than one interval old, and |queueing_us| is the time the
+  // packet read spent in the queue.
+  size_t NextTargetDepth(size_t target_depth, bool buffer_available,
+                         bool encoder_late, uint64_t queueing_us) const;
+};
@@ -27,7 +27,11 @@
 #ifndef BTIF_PAN_INTERNAL_H
 #define BTIF_PAN_INTERNAL_H
 
+#include <sys/types.h>
+
+#include "bta/include/bta_pan_api.h"
 #include "internal_include/bt_target.h"
+#include "stack/include/bt_hdr.h"
 #include "types/raw_address.h"
 
 /*******************************************************************************
@@ -75,6 +79,10 @@ typedef struct {
   btpan_conn_t conns[MAX_PAN_CONNS];
   int congest_packet_size;
   unsigned char congest_packet[1600];  // max ethernet packet size
+  // Frames are read from the TAP interface straight into the buffers handed
+  // to PAN, without going through congest_packet. A frame refused because the
+  // BNEP transmit queue is full is dropped instead of being retried.
+  bool zero_copy_forwarding;
 } btpan_cb_t;
 
 /*******************************************************************************
@@ -96,6 +104,17 @@ int btpan_tap_send(int tap_fd, const RawAddress& src, const RawAddress& dst,
                    uint16_t protocol, const char* buff, uint16_t size, bool ext,
                    bool forward);
 
+/* Frame I/O on the TAP interface, in btif_pan_tap_io.cc */
+
+/* Reads one Ethernet frame into the data of |p_buf|, which has room for
+ * |p_buf->len| bytes at |p_buf->offset|, and sets |p_buf->len| to the frame
+ * length. Returns the result of read(). */
+ssize_t btpan_tap_read(int tap_fd, BT_HDR* p_buf);
+/* Writes an Ethernet frame made of |eth_hdr| followed by |len| bytes of
+ * |payload| without copying them together. Returns the result of writev(). */
+ssize_t btpan_tap_write(int tap_fd, const tETH_HDR& eth_hdr,
+                        const uint8_t* payload, uint16_t len);
+
 static inline int is_empty_eth_addr(const RawAddress& addr) {
   return addr == RawAddress::kEmpty;
 }
@@ -32,13 +32,17 @@
 #include <string.h>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <future>
+#include <optional>
 
 #include "audio_a2dp_hw/include/audio_a2dp_hw.h"
 #include "audio_hal_interface/a2dp_encoding.h"
 #include "bta_av_ci.h"
 #include "btif_a2dp_control.h"
 #include "btif_a2dp_source.h"
+#include "btif_a2dp_source_tx_queue.h"
 #include "btif_av.h"
 #include "btif_av_co.h"
 #include "btif_metrics_logging.h"
@@ -49,7 +53,7 @@
 #include "include/check.h"
 #include "os/log.h"
 #include "osi/include/allocator.h"
-#include "osi/include/fixed_queue.h"
+#include "osi/include/properties.h"
 #include "osi/include/wakelock.h"
 #include "stack/include/acl_api.h"
 #include "stack/include/acl_api_types.h"
@@ -71,10 +75,27 @@ extern std::unique_ptr<tUIPC_STATE> a2dp_uipc;
  */
 #define MAX_OUTPUT_A2DP_FRAME_QUEUE_SZ (MAX_PCM_FRAME_NUM_PER_TICK * 2)
 
+/**
+ * In pipelined mode encoding passes are also pulled in by the BTA AV data
+ * path when the tx queue runs below its target depth, and the depth adapts
+ * to keep packets from waiting longer than the latency budget.
+ */
+#define A2DP_SOURCE_PIPELINED_ENCODING_PROPERTY \
+  "persist.bluetooth.a2dp_source.pipelined_encoding"
+#define A2DP_SOURCE_LATENCY_BUDGET_MS_PROPERTY \
+  "persist.bluetooth.a2dp_source.latency_budget_ms"
+#define A2DP_SOURCE_DEFAULT_LATENCY_BUDGET_MS 100
+
+// Upper bounds (in us) of the scheduling jitter histogram buckets. The last
+// bucket of the histogram collects everything above.
+static constexpr std::array<uint64_t, 7> kSchedulingJitterBucketsUs = {
+    250, 500, 1000, 2000, 4000, 8000, 16000};
+
 class SchedulingStats {
  public:
   SchedulingStats() { Reset(); }
   void Reset() {
+    jitter_histogram.fill(0);
     total_updates = 0;
     last_update_us = 0;
     overdue_scheduling_count = 0;
@@ -116,6 +137,10 @@ class SchedulingStats {
 
   // Accumulated and counted scheduling time (in us)
   uint64_t total_scheduling_time_us;
+
+  // Distribution of the deviation from the expected schedule, outliers
+  // included
+  std::array<size_t, kSchedulingJitterBucketsUs.size() + 1> jitter_histogram;
 };
 
 class BtifMediaStats {
@@ -141,6 +166,11 @@ class BtifMediaStats {
     media_read_total_underflow_bytes = 0;
     media_read_total_underflow_count = 0;
     media_read_last_underflow_us = 0;
+    encode_timer_passes = 0;
+    encode_link_passes = 0;
+    encode_skipped_timer_passes = 0;
+    tx_queue_link_underruns = 0;
+    tx_queue_max_target_depth = 0;
     codec_index = -1;
   }
 
@@ -171,6 +201,13 @@ class BtifMediaStats {
   size_t media_read_total_underflow_count;
   uint64_t media_read_last_underflow_us;
 
+  // Pipelined mode only
+  size_t encode_timer_passes;
+  size_t encode_link_passes;
+  size_t encode_skipped_timer_passes;
+  size_t tx_queue_link_underruns;
+  size_t tx_queue_max_target_depth;
+
   int codec_index = -1;
 };
 
@@ -184,21 +221,24 @@ class BtifA2dpSource {
   };
 
   BtifA2dpSource()
-      : tx_audio_queue(nullptr),
-        tx_flush(false),
+      : tx_flush(false),
         sw_audio_is_encoding(false),
         encoder_interface(nullptr),
         encoder_interval_ms(0),
         state_(kStateOff) {}
 
   void Reset() {
-    fixed_queue_free(tx_audio_queue, nullptr);
-    tx_audio_queue = nullptr;
+    tx_audio_queue.Flush();
     tx_flush = false;
     media_alarm.CancelAndWait();
     wakelock_release();
     encoder_interface = nullptr;
     encoder_interval_ms = 0;
+    pipelined_encoding = false;
+    latency_budget_us = 0;
+    tx_queue_target_depth = 1;
+    link_pass_pending = false;
+    last_encode_us = 0;
     stats.Reset();
     accumulated_stats.Reset();
     state_ = kStateOff;
@@ -220,12 +260,19 @@ class BtifA2dpSource {
 
   void SetState(BtifA2dpSource::RunState state) { state_ = state; }
 
-  fixed_queue_t* tx_audio_queue;
+  TxAudioQueue tx_audio_queue;
   bool tx_flush; /* Discards any outgoing data when true */
   bool sw_audio_is_encoding;
   RepeatingTimer media_alarm;
   const tA2DP_ENCODER_INTERFACE* encoder_interface;
   uint64_t encoder_interval_ms; /* Local copy of the encoder interval */
+  bool pipelined_encoding = false;
+  uint64_t latency_budget_us = 0;
+  /* Depth below which the data path pulls in an encoding pass */
+  std::atomic<size_t> tx_queue_target_depth = 1;
+  std::atomic_bool link_pass_pending = false;
+  /* Boot time of the last encoding pass */
+  std::atomic<uint64_t> last_encode_us = 0;
   BtifMediaStats stats;
   BtifMediaStats accumulated_stats;
 
@@ -267,10 +314,18 @@ static void btif_a2dp_source_audio_feeding_update_event(
     const btav_a2dp_codec_config_t& codec_audio_config);
 static bool btif_a2dp_source_audio_tx_flush_req(void);
 static void btif_a2dp_source_audio_handle_timer(void);
+static void btif_a2dp_source_audio_encode(uint64_t timestamp_us);
+static void btif_a2dp_source_audio_link_ready_event(void);
+static void btif_a2dp_source_audio_pipeline_feedback(bool buffer_available,
+                                                     uint64_t queueing_us);
+static TxQueuePolicy btif_a2dp_source_tx_queue_policy(void);
+static size_t btif_a2dp_source_max_tx_queue_depth(void);
 static uint32_t btif_a2dp_source_read_callback(uint8_t* p_buf, uint32_t len);
 static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n,
                                               uint32_t bytes_read);
 static void log_tstamps_us(const char* comment, uint64_t timestamp_us);
+static void dump_scheduling_jitter_histogram(int fd, const char* name,
+                                             const SchedulingStats& stats);
 static void update_scheduling_stats(SchedulingStats* stats, uint64_t now_us,
                                     uint64_t expected_delta);
 // Update the A2DP Source related metrics.
@@ -298,6 +353,9 @@ void btif_a2dp_source_accumulate_scheduling_stats(SchedulingStats* src,
                src->max_premature_scheduling_delta_us);
   dst->exact_scheduling_count += src->exact_scheduling_count;
   dst->total_scheduling_time_us += src->total_scheduling_time_us;
+  for (size_t i = 0; i < dst->jitter_histogram.size(); i++) {
+    dst->jitter_histogram[i] += src->jitter_histogram[i];
+  }
 }
 
 void btif_a2dp_source_accumulate_stats(BtifMediaStats* src,
@@ -322,6 +380,12 @@ void btif_a2dp_source_accumulate_stats(BtifMediaStats* src,
   dst->media_read_total_underflow_count +=
       src->media_read_total_underflow_count;
   dst->media_read_last_underflow_us = src->media_read_last_underflow_us;
+  dst->encode_timer_passes += src->encode_timer_passes;
+  dst->encode_link_passes += src->encode_link_passes;
+  dst->encode_skipped_timer_passes += src->encode_skipped_timer_passes;
+  dst->tx_queue_link_underruns += src->tx_queue_link_underruns;
+  dst->tx_queue_max_target_depth = std::max(dst->tx_queue_max_target_depth,
+                                            src->tx_queue_max_target_depth);
   if (dst->codec_index < 0) dst->codec_index = src->codec_index;
   btif_a2dp_source_accumulate_scheduling_stats(&src->tx_queue_enqueue_stats,
                                                &dst->tx_queue_enqueue_stats);
@@ -361,7 +425,15 @@ bool btif_a2dp_source_startup(void) {
 
   btif_a2dp_source_cb.Reset();
   btif_a2dp_source_cb.SetState(BtifA2dpSource::kStateStartingUp);
-  btif_a2dp_source_cb.tx_audio_queue = fixed_queue_new(SIZE_MAX);
+  btif_a2dp_source_cb.pipelined_encoding =
+      osi_property_get_bool(A2DP_SOURCE_PIPELINED_ENCODING_PROPERTY, false);
+  btif_a2dp_source_cb.latency_budget_us =
+      std::max(1, osi_property_get_int32(A2DP_SOURCE_LATENCY_BUDGET_MS_PROPERTY,
+                                         A2DP_SOURCE_DEFAULT_LATENCY_BUDGET_MS)) *
+      1000;
+  log::info("pipelined_encoding={} latency_budget_us={}",
+            btif_a2dp_source_cb.pipelined_encoding,
+            btif_a2dp_source_cb.latency_budget_us);
 
   // Schedule the rest of the operations
   btif_a2dp_source_thread.DoInThread(
@@ -517,8 +589,7 @@ static void btif_a2dp_source_shutdown_delayed(
   } else {
     btif_a2dp_control_cleanup();
   }
-  fixed_queue_free(btif_a2dp_source_cb.tx_audio_queue, nullptr);
-  btif_a2dp_source_cb.tx_audio_queue = nullptr;
+  btif_a2dp_source_cb.tx_audio_queue.Flush();
 
   btif_a2dp_source_cb.SetState(BtifA2dpSource::kStateOff);
 
@@ -813,6 +884,12 @@ static void btif_a2dp_source_audio_tx_start_event(void) {
   /* audio engine starting, reset tx suspended flag */
   btif_a2dp_source_cb.tx_flush = false;
 
+  // Start shallow, the depth grows if the link finds the queue empty
+  btif_a2dp_source_cb.tx_queue_target_depth =
+      std::min<size_t>(2, btif_a2dp_source_max_tx_queue_depth());
+  btif_a2dp_source_cb.link_pass_pending = false;
+  btif_a2dp_source_cb.last_encode_us = 0;
+
   wakelock_acquire();
   btif_a2dp_source_cb.media_alarm.SchedulePeriodic(
       btif_a2dp_source_thread.GetWeakPtr(), FROM_HERE,
@@ -912,9 +989,29 @@ static void btif_a2dp_source_audio_handle_timer(void) {
     log::error("ERROR Media task Scheduled after Suspend");
     return;
   }
+
+  // Skip the tick if the data path already pulled in a pass during the second
+  // half of this interval. The encoders account for the elapsed time, so the
+  // next pass catches up without bursting.
+  uint64_t last_encode_us = btif_a2dp_source_cb.last_encode_us;
+  if (btif_a2dp_source_cb.pipelined_encoding && last_encode_us != 0 &&
+      stats_timestamp_us - last_encode_us <
+          btif_a2dp_source_cb.encoder_interval_ms * 1000 / 2) {
+    btif_a2dp_source_cb.stats.encode_skipped_timer_passes++;
+  } else {
+    btif_a2dp_source_cb.stats.encode_timer_passes++;
+    btif_a2dp_source_audio_encode(timestamp_us);
+  }
+  update_scheduling_stats(&btif_a2dp_source_cb.stats.tx_queue_enqueue_stats,
+                          stats_timestamp_us,
+                          btif_a2dp_source_cb.encoder_interval_ms * 1000);
+}
+
+static void btif_a2dp_source_audio_encode(uint64_t timestamp_us) {
   CHECK(btif_a2dp_source_cb.encoder_interface != nullptr);
-  size_t transmit_queue_length =
-      fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue);
+  btif_a2dp_source_cb.last_encode_us =
+      bluetooth::common::time_get_os_boottime_us();
+  size_t transmit_queue_length = btif_a2dp_source_cb.tx_audio_queue.Length();
 #ifdef __ANDROID__
   ATRACE_INT("btif TX queue", transmit_queue_length);
 #endif
@@ -925,9 +1022,68 @@ static void btif_a2dp_source_audio_handle_timer(void) {
   }
   btif_a2dp_source_cb.encoder_interface->send_frames(timestamp_us);
   bta_av_ci_src_data_ready(BTA_AV_CHNL_AUDIO);
-  update_scheduling_stats(&btif_a2dp_source_cb.stats.tx_queue_enqueue_stats,
-                          stats_timestamp_us,
-                          btif_a2dp_source_cb.encoder_interval_ms * 1000);
+}
+
+// Encoding pass pulled in by the data path in pipelined mode.
+static void btif_a2dp_source_audio_link_ready_event(void) {
+  btif_a2dp_source_cb.link_pass_pending = false;
+  if (btif_av_is_a2dp_offload_running()) return;
+  if (!btif_a2dp_source_is_streaming()) return;
+
+  // Do not split the output into packets much smaller than a timer tick
+  uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+  if (now_us - btif_a2dp_source_cb.last_encode_us <
+      btif_a2dp_source_cb.encoder_interval_ms * 1000 / 2) {
+    return;
+  }
+  btif_a2dp_source_cb.stats.encode_link_passes++;
+#ifndef TARGET_FLOSS
+  btif_a2dp_source_audio_encode(now_us);
+#else
+  btif_a2dp_source_audio_encode(
+      bluetooth::common::time_get_os_monotonic_raw_us());
+#endif
+}
+
+static TxQueuePolicy btif_a2dp_source_tx_queue_policy(void) {
+  return TxQueuePolicy{
+      .pipelined_encoding = btif_a2dp_source_cb.pipelined_encoding,
+      .latency_budget_us = btif_a2dp_source_cb.latency_budget_us,
+      .encoder_interval_ms = btif_a2dp_source_cb.encoder_interval_ms,
+      .dynamic_audio_buffer_size = btif_a2dp_source_dynamic_audio_buffer_size,
+  };
+}
+
+static size_t btif_a2dp_source_max_tx_queue_depth(void) {
+  return btif_a2dp_source_tx_queue_policy().MaxDepth();
+}
+
+// Called by the data path each time the link can take a packet. An empty
+// queue while the last encoding pass is more than one interval old means the
+// depth is too shallow to absorb the scheduling jitter, and packets waiting
+// longer than the latency budget mean it is too deep.
+static void btif_a2dp_source_audio_pipeline_feedback(bool buffer_available,
+                                                     uint64_t queueing_us) {
+  uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
+  uint64_t last_encode_us = btif_a2dp_source_cb.last_encode_us;
+  bool encoder_late =
+      last_encode_us != 0 && now_us - last_encode_us >
+                                 btif_a2dp_source_cb.encoder_interval_ms * 1000;
+  if (!buffer_available && encoder_late) {
+    btif_a2dp_source_cb.stats.tx_queue_link_underruns++;
+  }
+  size_t target_depth = btif_a2dp_source_tx_queue_policy().NextTargetDepth(
+      btif_a2dp_source_cb.tx_queue_target_depth, buffer_available,
+      encoder_late, queueing_us);
+  btif_a2dp_source_cb.tx_queue_target_depth = target_depth;
+  btif_a2dp_source_cb.stats.tx_queue_max_target_depth = std::max(
+      target_depth, btif_a2dp_source_cb.stats.tx_queue_max_target_depth);
+
+  if (btif_a2dp_source_cb.tx_audio_queue.Length() < target_depth &&
+      !btif_a2dp_source_cb.link_pass_pending.exchange(true)) {
+    btif_a2dp_source_thread.DoInThread(
+        FROM_HERE, base::BindOnce(&btif_a2dp_source_audio_link_ready_event));
+  }
 }
 
 static uint32_t btif_a2dp_source_read_callback(uint8_t* p_buf, uint32_t len) {
@@ -970,45 +1126,37 @@ static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n,
     log::verbose("tx suspended, discarded frame");
 
     btif_a2dp_source_cb.stats.tx_queue_total_flushed_messages +=
-        fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue);
+        btif_a2dp_source_cb.tx_audio_queue.Flush();
     btif_a2dp_source_cb.stats.tx_queue_last_flushed_us = now_us;
-    fixed_queue_flush(btif_a2dp_source_cb.tx_audio_queue, osi_free);
 
     osi_free(p_buf);
     return false;
   }
 
   // Check for TX queue overflow
-  // TODO: Using frames_n here is probably wrong: should be "+ 1" instead.
-  if (fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue) + frames_n >
-      btif_a2dp_source_dynamic_audio_buffer_size) {
+  TxQueuePolicy policy = btif_a2dp_source_tx_queue_policy();
+  size_t queue_length = btif_a2dp_source_cb.tx_audio_queue.Length();
+  std::optional<size_t> drop_n =
+      policy.OverflowDropCount(queue_length, frames_n);
+  if (drop_n.has_value()) {
     log::warn("TX queue buffer size now={} adding={} max={}",
-              (uint32_t)fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue),
-              (uint32_t)frames_n, btif_a2dp_source_dynamic_audio_buffer_size);
+              (uint32_t)queue_length, (uint32_t)frames_n,
+              (uint32_t)policy.MaxDepth());
     // Keep track of drop-outs
     btif_a2dp_source_cb.stats.tx_queue_dropouts++;
     btif_a2dp_source_cb.stats.tx_queue_last_dropouts_us = now_us;
 
-    // Flush all queued buffers
-    size_t drop_n = fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue);
+    // Flush all queued buffers, or in pipelined mode only the oldest ones
+    // that do not fit in the latency budget anymore
     btif_a2dp_source_cb.stats.tx_queue_max_dropped_messages = std::max(
-        drop_n, btif_a2dp_source_cb.stats.tx_queue_max_dropped_messages);
-    int num_dropped_encoded_bytes = 0;
-    int num_dropped_encoded_frames = 0;
-    while (fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue)) {
-      btif_a2dp_source_cb.stats.tx_queue_total_dropped_messages++;
-      void* p_data =
-          fixed_queue_try_dequeue(btif_a2dp_source_cb.tx_audio_queue);
-      if (p_data != nullptr) {
-        auto p_dropped_buf = static_cast<BT_HDR*>(p_data);
-        num_dropped_encoded_bytes += p_dropped_buf->len;
-        num_dropped_encoded_frames += p_dropped_buf->layer_specific;
-        osi_free(p_data);
-      }
-    }
+        *drop_n, btif_a2dp_source_cb.stats.tx_queue_max_dropped_messages);
+    TxAudioQueue::DropResult dropped =
+        btif_a2dp_source_cb.tx_audio_queue.DropOldest(*drop_n);
+    btif_a2dp_source_cb.stats.tx_queue_total_dropped_messages +=
+        dropped.packets;
     log_a2dp_audio_overrun_event(
         btif_av_source_active_peer(), btif_a2dp_source_cb.encoder_interval_ms,
-        drop_n, num_dropped_encoded_frames, num_dropped_encoded_bytes);
+        dropped.packets, dropped.frames, dropped.bytes);
 
     // Request additional debug info if we had to flush buffers
     RawAddress peer_bda = btif_av_source_active_peer();
@@ -1044,7 +1192,12 @@ static bool btif_a2dp_source_enqueue_callback(BT_HDR* p_buf, size_t frames_n,
       frames_n, btif_a2dp_source_cb.stats.tx_queue_max_frames_per_packet);
   CHECK(btif_a2dp_source_cb.encoder_interface != nullptr);
 
-  fixed_queue_enqueue(btif_a2dp_source_cb.tx_audio_queue, p_buf);
+  if (!btif_a2dp_source_cb.tx_audio_queue.Enqueue(p_buf, now_us)) {
+    log::error("TX queue full, dropping frame");
+    btif_a2dp_source_cb.stats.tx_queue_total_dropped_messages++;
+    osi_free(p_buf);
+    return false;
+  }
 
   return true;
 }
@@ -1058,10 +1211,9 @@ static void btif_a2dp_source_audio_tx_flush_event(void) {
     btif_a2dp_source_cb.encoder_interface->feeding_flush();
 
   btif_a2dp_source_cb.stats.tx_queue_total_flushed_messages +=
-      fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue);
+      btif_a2dp_source_cb.tx_audio_queue.Flush();
   btif_a2dp_source_cb.stats.tx_queue_last_flushed_us =
       bluetooth::common::time_get_os_boottime_us();
-  fixed_queue_flush(btif_a2dp_source_cb.tx_audio_queue, osi_free);
 
   if (!bluetooth::audio::a2dp::is_hal_enabled() && a2dp_uipc != nullptr) {
     UIPC_Ioctl(*a2dp_uipc, UIPC_CH_ID_AV_AUDIO, UIPC_REQ_RX_FLUSH, nullptr);
@@ -1078,8 +1230,9 @@ static bool btif_a2dp_source_audio_tx_flush_req(void) {
 
 BT_HDR* btif_a2dp_source_audio_readbuf(void) {
   uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
-  BT_HDR* p_buf =
-      (BT_HDR*)fixed_queue_try_dequeue(btif_a2dp_source_cb.tx_audio_queue);
+  uint64_t enqueue_us = now_us;
+  BT_HDR* p_buf = btif_a2dp_source_cb.tx_audio_queue.TryDequeue(&enqueue_us);
+  uint64_t queueing_us = now_us > enqueue_us ? now_us - enqueue_us : 0;
 
   btif_a2dp_source_cb.stats.tx_queue_total_readbuf_calls++;
   btif_a2dp_source_cb.stats.tx_queue_last_readbuf_us = now_us;
@@ -1088,6 +1241,14 @@ BT_HDR* btif_a2dp_source_audio_readbuf(void) {
     update_scheduling_stats(&btif_a2dp_source_cb.stats.tx_queue_dequeue_stats,
                             now_us,
                             btif_a2dp_source_cb.encoder_interval_ms * 1000);
+    btif_a2dp_source_cb.stats.tx_queue_total_queueing_time_us += queueing_us;
+    btif_a2dp_source_cb.stats.tx_queue_max_queueing_time_us = std::max(
+        queueing_us, btif_a2dp_source_cb.stats.tx_queue_max_queueing_time_us);
+  }
+
+  if (btif_a2dp_source_cb.pipelined_encoding &&
+      btif_a2dp_source_is_streaming()) {
+    btif_a2dp_source_audio_pipeline_feedback(p_buf != nullptr, queueing_us);
   }
 
   return p_buf;
@@ -1097,7 +1258,7 @@ static void log_tstamps_us(const char* comment, uint64_t timestamp_us) {
   static uint64_t prev_us = 0;
   log::verbose("[{}] ts {:08}, diff : {:08}, queue sz {}", comment,
                timestamp_us, timestamp_us - prev_us,
-               fixed_queue_length(btif_a2dp_source_cb.tx_audio_queue));
+               btif_a2dp_source_cb.tx_audio_queue.Length());
   prev_us = timestamp_us;
 }
 
@@ -1111,6 +1272,14 @@ static void update_scheduling_stats(SchedulingStats* stats, uint64_t now_us,
   if (last_us == 0) return;  // First update: expected delta doesn't apply
 
   uint64_t deadline_us = last_us + expected_delta;
+  uint64_t jitter_us =
+      (deadline_us > now_us) ? deadline_us - now_us : now_us - deadline_us;
+  size_t bucket = std::lower_bound(kSchedulingJitterBucketsUs.begin(),
+                                   kSchedulingJitterBucketsUs.end(),
+                                   jitter_us) -
+                  kSchedulingJitterBucketsUs.begin();
+  stats->jitter_histogram[bucket]++;
+
   if (deadline_us < now_us) {
     // Overdue scheduling
     uint64_t delta_us = now_us - deadline_us;
@@ -1303,6 +1472,63 @@ void btif_a2dp_source_debug_dump(int fd) {
       (unsigned long long)dequeue_stats->max_premature_scheduling_delta_us /
           1000,
       (unsigned long long)ave_time_us / 1000);
+
+  ave_time_us = 0;
+  if (dequeue_stats->total_updates != 0) {
+    ave_time_us = accumulated_stats->tx_queue_total_queueing_time_us /
+                  dequeue_stats->total_updates;
+  }
+  dprintf(
+      fd,
+      "  Queueing time in ms (total/max/ave)                     : %llu / %llu "
+      "/ %llu\n",
+      (unsigned long long)accumulated_stats->tx_queue_total_queueing_time_us /
+          1000,
+      (unsigned long long)accumulated_stats->tx_queue_max_queueing_time_us /
+          1000,
+      (unsigned long long)ave_time_us / 1000);
+
+  dump_scheduling_jitter_histogram(fd, "Enqueue", *enqueue_stats);
+  dump_scheduling_jitter_histogram(fd, "Dequeue", *dequeue_stats);
+
+  if (!btif_a2dp_source_cb.pipelined_encoding) return;
+
+  dprintf(fd, "  Pipelined encoding:\n");
+  dprintf(fd,
+          "  Encoding passes (timer/link/skipped timer)              : %zu / "
+          "%zu / %zu\n",
+          accumulated_stats->encode_timer_passes,
+          accumulated_stats->encode_link_passes,
+          accumulated_stats->encode_skipped_timer_passes);
+  dprintf(fd,
+          "  Counts (link underruns)                                 : %zu\n",
+          accumulated_stats->tx_queue_link_underruns);
+  dprintf(fd,
+          "  Queue depth (target/max target/limit)                   : %zu / "
+          "%zu / %zu\n",
+          btif_a2dp_source_cb.tx_queue_target_depth.load(),
+          accumulated_stats->tx_queue_max_target_depth,
+          btif_a2dp_source_max_tx_queue_depth());
+  dprintf(fd,
+          "  Latency budget in ms                                    : %llu\n",
+          (unsigned long long)btif_a2dp_source_cb.latency_budget_us / 1000);
+}
+
+static void dump_scheduling_jitter_histogram(int fd, const char* name,
+                                             const SchedulingStats& stats) {
+  dprintf(fd, "  %s scheduling jitter in us (count per bucket)      :", name);
+  for (size_t i = 0; i < stats.jitter_histogram.size(); i++) {
+    if (i < kSchedulingJitterBucketsUs.size()) {
+      dprintf(fd, " <=%llu:%zu",
+              (unsigned long long)kSchedulingJitterBucketsUs[i],
+              stats.jitter_histogram[i]);
+    } else {
+      dprintf(fd, " >%llu:%zu",
+              (unsigned long long)kSchedulingJitterBucketsUs.back(),
+              stats.jitter_histogram[i]);
+    }
+  }
+  dprintf(fd, "\n");
 }
 
 static void btif_a2dp_source_update_metrics(void) {
@@ -1427,3 +1653,23 @@ static void btm_read_tx_power_cb(void* data) {
   log::warn("device: {}, Tx Power: {}",
             ADDRESS_TO_LOGGABLE_CSTR(result->rem_bda), result->tx_power);
 }
+
+namespace bluetooth {
+namespace legacy {
+namespace testing {
+
+TxAudioQueue& btif_a2dp_source_tx_audio_queue() {
+  return btif_a2dp_source_cb.tx_audio_queue;
+}
+
+TxQueuePolicy btif_a2dp_source_tx_queue_policy() {
+  return ::btif_a2dp_source_tx_queue_policy();
+}
+
+void btif_a2dp_source_audio_tx_flush_event() {
+  ::btif_a2dp_source_audio_tx_flush_event();
+}
+
+}  // namespace testing
+}  // namespace legacy
+}  // namespace bluetooth
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "btif/include/btif_a2dp_source_tx_queue.h"
+
+#include <algorithm>
+
+#include "osi/include/allocator.h"
+
+bool TxAudioQueue::Enqueue(BT_HDR* p_buf, uint64_t now_us) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (length_ == kCapacity) return false;
+  slots_[(head_ + length_) % kCapacity] = {p_buf, now_us};
+  length_++;
+  return true;
+}
+
+BT_HDR* TxAudioQueue::TryDequeue(uint64_t* p_enqueue_us) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (length_ == 0) return nullptr;
+  TxAudioPacket packet = slots_[head_];
+  slots_[head_] = {};
+  head_ = (head_ + 1) % kCapacity;
+  length_--;
+  if (p_enqueue_us != nullptr) *p_enqueue_us = packet.enqueue_us;
+  return packet.p_buf;
+}
+
+size_t TxAudioQueue::Length() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return length_;
+}
+
+size_t TxAudioQueue::Flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t flushed = length_;
+  while (length_ > 0) {
+    osi_free(slots_[head_].p_buf);
+    slots_[head_] = {};
+    head_ = (head_ + 1) % kCapacity;
+    length_--;
+  }
+  head_ = 0;
+  return flushed;
+}
+
+TxAudioQueue::DropResult TxAudioQueue::DropOldest(size_t count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  DropResult result;
+  while (result.packets < count && length_ > 0) {
+    BT_HDR* p_buf = slots_[head_].p_buf;
+    result.packets++;
+    result.bytes += p_buf->len;
+    result.frames += p_buf->layer_specific;
+    osi_free(p_buf);
+    slots_[head_] = {};
+    head_ = (head_ + 1) % kCapacity;
+    length_--;
+  }
+  return result;
+}
+
+size_t TxQueuePolicy::MaxDepth() const {
+  size_t max_depth = dynamic_audio_buffer_size;
+  if (pipelined_encoding && encoder_interval_ms > 0) {
+    max_depth = std::min<size_t>(
+        max_depth, latency_budget_us / (encoder_interval_ms * 1000));
+  }
+  return std::max<size_t>(max_depth, 1);
+}
+
+std::optional<size_t> TxQueuePolicy::OverflowDropCount(size_t queue_length,
+                                                       size_t frames_n) const {
+  size_t max_depth = MaxDepth();
+  if (pipelined_encoding) {
+    if (queue_length + 1 <= max_depth) return std::nullopt;
+    return queue_length + 1 - max_depth;
+  }
+  // TODO: Using frames_n here is probably wrong: should be "+ 1" instead.
+  if (queue_length + frames_n <= max_depth) return std::nullopt;
+  return queue_length;
+}
+
+size_t TxQueuePolicy::NextTargetDepth(size_t target_depth,
+                                      bool buffer_available, bool encoder_late,
+                                      uint64_t queueing_us) const {
+  if (!buffer_available) {
+    if (encoder_late) return std::min(target_depth + 1, MaxDepth());
+  } else if (queueing_us > latency_budget_us && target_depth > 1) {
+    return target_depth - 1;
+  }
+  return target_depth;
+}
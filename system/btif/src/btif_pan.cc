@@ -49,6 +49,7 @@
 #include "include/hardware/bt_pan.h"
 #include "internal_include/bt_target.h"
 #include "os/log.h"
+#include "os/system_properties.h"
 #include "osi/include/allocator.h"
 #include "osi/include/compat.h"
 #include "stack/include/bt_hdr.h"
@@ -72,6 +73,9 @@
 
 #define MIN(x, y) (((x) < (y)) ? (x) : (y))
 
+static constexpr char kZeroCopyForwardingProperty[] =
+    "bluetooth.pan.zero_copy_forwarding.enabled";
+
 using namespace bluetooth;
 
 btpan_cb_t btpan_cb;
@@ -118,6 +122,8 @@ void btif_pan_init() {
     memset(&btpan_cb, 0, sizeof(btpan_cb));
     btpan_cb.tap_fd = INVALID_FD;
     btpan_cb.flow = 1;
+    btpan_cb.zero_copy_forwarding = bluetooth::os::GetSystemPropertyBool(
+        kZeroCopyForwardingProperty, false);
     for (int i = 0; i < MAX_PAN_CONNS; i++)
       btpan_cleanup_conn(&btpan_cb.conns[i]);
     BTA_PanEnable(bta_pan_callback);
@@ -398,17 +404,14 @@ int btpan_tap_send(int tap_fd, const RawAddress& src, const RawAddress& dst,
     eth_hdr.h_dest = dst;
     eth_hdr.h_src = src;
     eth_hdr.h_proto = htons(proto);
-    char packet[TAP_MAX_PKT_WRITE_LEN + sizeof(tETH_HDR)];
-    memcpy(packet, &eth_hdr, sizeof(tETH_HDR));
     if (len > TAP_MAX_PKT_WRITE_LEN) {
       log::error("btpan_tap_send eth packet size:{} is exceeded limit!", len);
       return -1;
     }
-    memcpy(packet + sizeof(tETH_HDR), buf, len);
 
     /* Send data to network interface */
-    ssize_t ret;
-    OSI_NO_INTR(ret = write(tap_fd, packet, len + sizeof(tETH_HDR)));
+    ssize_t ret = btpan_tap_write(tap_fd, eth_hdr,
+                                  reinterpret_cast<const uint8_t*>(buf), len);
     log::verbose("ret:{}", ret);
     return (int)ret;
   }
@@ -641,19 +644,87 @@ static void bta_pan_callback(tBTA_PAN_EVT event, tBTA_PAN* p_data) {
                         sizeof(tBTA_PAN), NULL);
 }
 
+// Forwards the Ethernet frame in |buffer| to the connection it is addressed
+// to. |buffer| is always consumed.
+static int forward_tap_frame(BT_HDR* buffer) {
+  uint8_t* packet = buffer->data + buffer->offset;
+  if (buffer->len > sizeof(tETH_HDR) && should_forward((tETH_HDR*)packet)) {
+    // Extract the ethernet header from the buffer since the PAN_WriteBuf
+    // inside
+    // forward_bnep can't handle two pointers that point inside the same GKI
+    // buffer.
+    tETH_HDR hdr;
+    memcpy(&hdr, packet, sizeof(tETH_HDR));
+
+    // Skip the ethernet header.
+    buffer->len -= sizeof(tETH_HDR);
+    buffer->offset += sizeof(tETH_HDR);
+    return forward_bnep(&hdr, buffer);
+  }
+
+  log::warn("dropping packet of length {}", buffer->len);
+  osi_free(buffer);
+  return FORWARD_IGNORE;
+}
+
+static BT_HDR* alloc_tap_buffer() {
+  BT_HDR* buffer = (BT_HDR*)osi_malloc(PAN_BUF_SIZE);
+  buffer->offset = PAN_MINIMUM_OFFSET;
+  buffer->len = PAN_BUF_SIZE - sizeof(BT_HDR) - buffer->offset;
+  return buffer;
+}
+
+// Reads frames until the TAP driver has none left, each one straight into the
+// buffer handed to PAN. Reading until EAGAIN, rather than polling the fd after
+// every frame, costs one system call per frame.
+static void btu_exec_tap_fd_read_zero_copy(int fd) {
+  for (int i = 0; i < PAN_BUF_MAX && btif_is_enabled() && btpan_cb.flow; i++) {
+    BT_HDR* buffer = alloc_tap_buffer();
+    ssize_t ret = btpan_tap_read(fd, buffer);
+    if (ret <= 0) {
+      int read_errno = errno;
+      osi_free(buffer);
+      if (ret < 0 && (read_errno == EAGAIN || read_errno == EWOULDBLOCK)) {
+        break;
+      }
+      if (ret < 0) {
+        log::error("unable to read from driver: {}", strerror(read_errno));
+      } else {
+        log::warn("end of file reached.");
+      }
+      // add fd back to monitor thread to try it again later, or to process
+      // the exception
+      btsock_thread_add_fd(pan_pth, fd, 0, SOCK_THREAD_FD_RD, 0);
+      return;
+    }
+
+    if (forward_tap_frame(buffer) == FORWARD_CONGEST) {
+      log::warn("dropping packet, BNEP transmit queue is full");
+    }
+  }
+
+  if (btpan_cb.flow) {
+    // add fd back to monitor thread when the flow is on
+    btsock_thread_add_fd(pan_pth, fd, 0, SOCK_THREAD_FD_RD, 0);
+  }
+}
+
 #define IS_EXCEPTION(e) ((e) & (POLLHUP | POLLRDHUP | POLLERR | POLLNVAL))
 static void btu_exec_tap_fd_read(int fd) {
   struct pollfd ufd;
 
   if (fd == INVALID_FD || fd != btpan_cb.tap_fd) return;
 
+  if (btpan_cb.zero_copy_forwarding) {
+    btu_exec_tap_fd_read_zero_copy(fd);
+    return;
+  }
+
   // Don't occupy BTU context too long, avoid buffer overruns and
   // give other profiles a chance to run by limiting the amount of memory
   // PAN can use.
   for (int i = 0; i < PAN_BUF_MAX && btif_is_enabled() && btpan_cb.flow; i++) {
-    BT_HDR* buffer = (BT_HDR*)osi_malloc(PAN_BUF_SIZE);
-    buffer->offset = PAN_MINIMUM_OFFSET;
-    buffer->len = PAN_BUF_SIZE - sizeof(BT_HDR) - buffer->offset;
+    BT_HDR* buffer = alloc_tap_buffer();
 
     uint8_t* packet = (uint8_t*)buffer + sizeof(BT_HDR) + buffer->offset;
 
@@ -689,24 +760,8 @@ static void btu_exec_tap_fd_read(int fd) {
            MIN(btpan_cb.congest_packet_size, buffer->len));
     buffer->len = MIN(btpan_cb.congest_packet_size, buffer->len);
 
-    if (buffer->len > sizeof(tETH_HDR) && should_forward((tETH_HDR*)packet)) {
-      // Extract the ethernet header from the buffer since the PAN_WriteBuf
-      // inside
-      // forward_bnep can't handle two pointers that point inside the same GKI
-      // buffer.
-      tETH_HDR hdr;
-      memcpy(&hdr, packet, sizeof(tETH_HDR));
-
-      // Skip the ethernet header.
-      buffer->len -= sizeof(tETH_HDR);
-      buffer->offset += sizeof(tETH_HDR);
-      if (forward_bnep(&hdr, buffer) != FORWARD_CONGEST)
-        btpan_cb.congest_packet_size = 0;
-    } else {
-      log::warn("dropping packet of length {}", buffer->len);
+    if (forward_tap_frame(buffer) != FORWARD_CONGEST)
       btpan_cb.congest_packet_size = 0;
-      osi_free(buffer);
-    }
 
     // Bail out of the loop if reading from the TAP fd would block.
     ufd.fd = fd;
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Frame I/O on the PAN TAP interface. Kept apart from btif_pan.cc so that it
+// does not depend on the rest of the stack.
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "btif/include/btif_pan_internal.h"
+#include "osi/include/osi.h"
+
+ssize_t btpan_tap_read(int tap_fd, BT_HDR* p_buf) {
+  ssize_t ret;
+  OSI_NO_INTR(ret = read(tap_fd, p_buf->data + p_buf->offset, p_buf->len));
+  p_buf->len = ret > 0 ? static_cast<uint16_t>(ret) : 0;
+  return ret;
+}
+
+ssize_t btpan_tap_write(int tap_fd, const tETH_HDR& eth_hdr,
+                        const uint8_t* payload, uint16_t len) {
+  // The TAP driver takes one frame per write, whichever way it is split.
+  struct iovec iov[2];
+  iov[0].iov_base = const_cast<tETH_HDR*>(&eth_hdr);
+  iov[0].iov_len = sizeof(tETH_HDR);
+  iov[1].iov_base = const_cast<uint8_t*>(payload);
+  iov[1].iov_len = len;
+
+  ssize_t ret;
+  OSI_NO_INTR(ret = writev(tap_fd, iov, 2));
+  return ret;
+}
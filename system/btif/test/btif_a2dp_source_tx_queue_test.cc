@@ -0,0 +1,273 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "btif/include/btif_a2dp_source_tx_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <vector>
+
+#include "osi/include/allocator.h"
+#include "stack/include/bt_hdr.h"
+
+namespace bluetooth {
+namespace legacy {
+namespace testing {
+
+TxAudioQueue& btif_a2dp_source_tx_audio_queue();
+TxQueuePolicy btif_a2dp_source_tx_queue_policy();
+void btif_a2dp_source_audio_tx_flush_event();
+
+}  // namespace testing
+}  // namespace legacy
+}  // namespace bluetooth
+
+namespace {
+
+constexpr size_t kDynamicAudioBufferSize = 18;
+constexpr uint64_t kEncoderIntervalMs = 20;
+constexpr uint64_t kLatencyBudgetUs = 100 * 1000;
+
+BT_HDR* make_packet(uint16_t len, uint16_t frames) {
+  BT_HDR* p_buf = (BT_HDR*)osi_calloc(sizeof(BT_HDR));
+  p_buf->len = len;
+  p_buf->layer_specific = frames;
+  return p_buf;
+}
+
+TxQueuePolicy legacy_policy() {
+  return TxQueuePolicy{
+      .pipelined_encoding = false,
+      .latency_budget_us = kLatencyBudgetUs,
+      .encoder_interval_ms = kEncoderIntervalMs,
+      .dynamic_audio_buffer_size = kDynamicAudioBufferSize,
+  };
+}
+
+TxQueuePolicy pipelined_policy() {
+  TxQueuePolicy policy = legacy_policy();
+  policy.pipelined_encoding = true;
+  return policy;
+}
+
+class TxAudioQueueTest : public ::testing::Test {
+ protected:
+  void TearDown() override { queue_.Flush(); }
+
+  TxAudioQueue queue_;
+};
+
+TEST_F(TxAudioQueueTest, dequeue_empty) {
+  uint64_t enqueue_us = 42;
+  EXPECT_EQ(queue_.Length(), 0u);
+  EXPECT_EQ(queue_.TryDequeue(&enqueue_us), nullptr);
+  EXPECT_EQ(enqueue_us, 42u);
+}
+
+TEST_F(TxAudioQueueTest, fifo_with_enqueue_time) {
+  std::vector<BT_HDR*> packets;
+  for (uint64_t i = 0; i < 5; i++) {
+    packets.push_back(make_packet(100, 1));
+    ASSERT_TRUE(queue_.Enqueue(packets.back(), 1000 + i));
+  }
+  EXPECT_EQ(queue_.Length(), 5u);
+
+  for (uint64_t i = 0; i < 5; i++) {
+    uint64_t enqueue_us = 0;
+    BT_HDR* p_buf = queue_.TryDequeue(&enqueue_us);
+    EXPECT_EQ(p_buf, packets[i]);
+    EXPECT_EQ(enqueue_us, 1000 + i);
+    osi_free(p_buf);
+  }
+  EXPECT_EQ(queue_.Length(), 0u);
+}
+
+TEST_F(TxAudioQueueTest, enqueue_full) {
+  for (size_t i = 0; i < TxAudioQueue::kCapacity; i++) {
+    ASSERT_TRUE(queue_.Enqueue(make_packet(100, 1), i));
+  }
+  EXPECT_EQ(queue_.Length(), TxAudioQueue::kCapacity);
+
+  // The caller keeps ownership of the packet that did not fit
+  BT_HDR* p_buf = make_packet(100, 1);
+  EXPECT_FALSE(queue_.Enqueue(p_buf, 0));
+  EXPECT_EQ(queue_.Length(), TxAudioQueue::kCapacity);
+  osi_free(p_buf);
+
+  // Slots are reused once the head moved
+  osi_free(queue_.TryDequeue(nullptr));
+  EXPECT_TRUE(queue_.Enqueue(make_packet(100, 1), 0));
+  EXPECT_EQ(queue_.Length(), TxAudioQueue::kCapacity);
+}
+
+TEST_F(TxAudioQueueTest, flush) {
+  for (size_t i = 0; i < 7; i++) {
+    ASSERT_TRUE(queue_.Enqueue(make_packet(100, 1), i));
+  }
+  EXPECT_EQ(queue_.Flush(), 7u);
+  EXPECT_EQ(queue_.Length(), 0u);
+  EXPECT_EQ(queue_.TryDequeue(nullptr), nullptr);
+  EXPECT_EQ(queue_.Flush(), 0u);
+}
+
+TEST_F(TxAudioQueueTest, drop_oldest) {
+  std::vector<BT_HDR*> packets;
+  for (uint16_t i = 0; i < 5; i++) {
+    packets.push_back(make_packet(100 + i, 1 + i));
+    ASSERT_TRUE(queue_.Enqueue(packets.back(), i));
+  }
+
+  TxAudioQueue::DropResult dropped = queue_.DropOldest(2);
+  EXPECT_EQ(dropped.packets, 2u);
+  EXPECT_EQ(dropped.bytes, 100u + 101u);
+  EXPECT_EQ(dropped.frames, 1u + 2u);
+  EXPECT_EQ(queue_.Length(), 3u);
+
+  uint64_t enqueue_us = 0;
+  BT_HDR* p_buf = queue_.TryDequeue(&enqueue_us);
+  EXPECT_EQ(p_buf, packets[2]);
+  EXPECT_EQ(enqueue_us, 2u);
+  osi_free(p_buf);
+}
+
+TEST_F(TxAudioQueueTest, drop_oldest_more_than_queued) {
+  for (size_t i = 0; i < 3; i++) {
+    ASSERT_TRUE(queue_.Enqueue(make_packet(10, 2), i));
+  }
+  TxAudioQueue::DropResult dropped = queue_.DropOldest(10);
+  EXPECT_EQ(dropped.packets, 3u);
+  EXPECT_EQ(dropped.bytes, 30u);
+  EXPECT_EQ(dropped.frames, 6u);
+  EXPECT_EQ(queue_.Length(), 0u);
+
+  dropped = queue_.DropOldest(1);
+  EXPECT_EQ(dropped.packets, 0u);
+  EXPECT_EQ(dropped.bytes, 0u);
+  EXPECT_EQ(dropped.frames, 0u);
+}
+
+TEST(TxQueuePolicyTest, pipelined_encoding_default_off) {
+  TxQueuePolicy policy =
+      bluetooth::legacy::testing::btif_a2dp_source_tx_queue_policy();
+  EXPECT_FALSE(policy.pipelined_encoding);
+  EXPECT_FALSE(TxQueuePolicy{}.pipelined_encoding);
+}
+
+TEST(TxQueuePolicyTest, legacy_max_depth) {
+  TxQueuePolicy policy = legacy_policy();
+  EXPECT_EQ(policy.MaxDepth(), kDynamicAudioBufferSize);
+
+  // The latency budget only applies in pipelined mode
+  policy.latency_budget_us = 1000;
+  EXPECT_EQ(policy.MaxDepth(), kDynamicAudioBufferSize);
+
+  policy.dynamic_audio_buffer_size = 0;
+  EXPECT_EQ(policy.MaxDepth(), 1u);
+}
+
+TEST(TxQueuePolicyTest, legacy_overflow_flushes_queue) {
+  TxQueuePolicy policy = legacy_policy();
+  EXPECT_EQ(policy.OverflowDropCount(0, 1), std::nullopt);
+  EXPECT_EQ(policy.OverflowDropCount(kDynamicAudioBufferSize - 1, 1),
+            std::nullopt);
+  EXPECT_EQ(policy.OverflowDropCount(kDynamicAudioBufferSize, 1),
+            kDynamicAudioBufferSize);
+  // Counted in frames rather than packets
+  EXPECT_EQ(policy.OverflowDropCount(kDynamicAudioBufferSize - 3, 4),
+            kDynamicAudioBufferSize - 3);
+}
+
+TEST(TxQueuePolicyTest, pipelined_max_depth) {
+  TxQueuePolicy policy = pipelined_policy();
+  // 100ms of 20ms packets
+  EXPECT_EQ(policy.MaxDepth(), 5u);
+
+  policy.latency_budget_us = 1000 * 1000;
+  EXPECT_EQ(policy.MaxDepth(), kDynamicAudioBufferSize);
+
+  policy.latency_budget_us = 1000;
+  EXPECT_EQ(policy.MaxDepth(), 1u);
+
+  // No encoder interval yet
+  policy.encoder_interval_ms = 0;
+  EXPECT_EQ(policy.MaxDepth(), kDynamicAudioBufferSize);
+}
+
+TEST(TxQueuePolicyTest, pipelined_overflow_drops_oldest) {
+  TxQueuePolicy policy = pipelined_policy();
+  EXPECT_EQ(policy.OverflowDropCount(4, 3), std::nullopt);
+  EXPECT_EQ(policy.OverflowDropCount(5, 1), 1u);
+  EXPECT_EQ(policy.OverflowDropCount(8, 1), 4u);
+}
+
+TEST(TxQueuePolicyTest, pipelined_overflow_with_queue) {
+  TxQueuePolicy policy = pipelined_policy();
+  TxAudioQueue queue;
+  for (size_t i = 0; i < 8; i++) {
+    ASSERT_TRUE(queue.Enqueue(make_packet(100, 2), i));
+  }
+
+  std::optional<size_t> drop_n = policy.OverflowDropCount(queue.Length(), 2);
+  ASSERT_TRUE(drop_n.has_value());
+  TxAudioQueue::DropResult dropped = queue.DropOldest(*drop_n);
+  EXPECT_EQ(dropped.packets, 4u);
+  EXPECT_EQ(dropped.bytes, 400u);
+  EXPECT_EQ(dropped.frames, 8u);
+
+  // The next packet fits in the latency budget
+  EXPECT_EQ(queue.Length() + 1, policy.MaxDepth());
+  EXPECT_EQ(policy.OverflowDropCount(queue.Length(), 2), std::nullopt);
+
+  uint64_t enqueue_us = 0;
+  osi_free(queue.TryDequeue(&enqueue_us));
+  EXPECT_EQ(enqueue_us, 4u);
+  queue.Flush();
+}
+
+TEST(TxQueuePolicyTest, target_depth_grows_on_underrun) {
+  TxQueuePolicy policy = pipelined_policy();
+  EXPECT_EQ(policy.NextTargetDepth(1, false, true, 0), 2u);
+  EXPECT_EQ(policy.NextTargetDepth(4, false, true, 0), 5u);
+  // Bounded by the latency budget
+  EXPECT_EQ(policy.NextTargetDepth(5, false, true, 0), 5u);
+  // Empty queue, but the encoder is on time
+  EXPECT_EQ(policy.NextTargetDepth(3, false, false, 0), 3u);
+}
+
+TEST(TxQueuePolicyTest, target_depth_shrinks_over_budget) {
+  TxQueuePolicy policy = pipelined_policy();
+  EXPECT_EQ(policy.NextTargetDepth(3, true, false, kLatencyBudgetUs + 1), 2u);
+  EXPECT_EQ(policy.NextTargetDepth(3, true, true, kLatencyBudgetUs + 1), 2u);
+  EXPECT_EQ(policy.NextTargetDepth(3, true, false, kLatencyBudgetUs), 3u);
+  // Never below one packet
+  EXPECT_EQ(policy.NextTargetDepth(1, true, false, kLatencyBudgetUs + 1), 1u);
+}
+
+TEST(BtifA2dpSourceTxQueueTest, flush_event_on_stop_or_suspend) {
+  TxAudioQueue& queue =
+      bluetooth::legacy::testing::btif_a2dp_source_tx_audio_queue();
+  for (size_t i = 0; i < 6; i++) {
+    ASSERT_TRUE(queue.Enqueue(make_packet(100, 1), i));
+  }
+  ASSERT_EQ(queue.Length(), 6u);
+
+  bluetooth::legacy::testing::btif_a2dp_source_audio_tx_flush_event();
+  EXPECT_EQ(queue.Length(), 0u);
+  EXPECT_EQ(queue.TryDequeue(nullptr), nullptr);
+}
+
+}  // namespace
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "btcore/include/module.h"
+#include "device/include/interop.h"
+#include "device/include/interop_database.h"
+#include "types/raw_address.h"
+
+using ::benchmark::State;
+
+// Matches devices against a static interop database of range(0) entries,
+// written where host builds of interop.cc look for it. The installed
+// database holds several hundred entries, spread over a few dozen features.
+
+extern const module_t interop_module;
+
+namespace {
+
+const std::filesystem::path kStaticConfigFile =
+    std::filesystem::temp_directory_path() / "interop_database.conf";
+const std::filesystem::path kDynamicConfigFile =
+    std::filesystem::temp_directory_path() / "interop_database_dynamic.conf";
+
+struct feature_t {
+  const char* name;
+  interop_feature_t feature;
+};
+
+const feature_t kFeatures[] = {
+    {"INTEROP_DISABLE_LE_SECURE_CONNECTIONS",
+     INTEROP_DISABLE_LE_SECURE_CONNECTIONS},
+    {"INTEROP_DISABLE_ABSOLUTE_VOLUME", INTEROP_DISABLE_ABSOLUTE_VOLUME},
+    {"INTEROP_DISABLE_AUTO_PAIRING", INTEROP_DISABLE_AUTO_PAIRING},
+    {"INTEROP_REMOVE_HID_DIG_DESCRIPTOR", INTEROP_REMOVE_HID_DIG_DESCRIPTOR},
+    {"INTEROP_DISABLE_SNIFF_DURING_SCO", INTEROP_DISABLE_SNIFF_DURING_SCO},
+    {"INTEROP_DISABLE_AAC_CODEC", INTEROP_DISABLE_AAC_CODEC},
+};
+constexpr size_t kNumFeatures = sizeof(kFeatures) / sizeof(kFeatures[0]);
+
+// A third each of address prefixes, names and vendor/product ids
+void write_database(int num_entries) {
+  FILE* fp = fopen(kStaticConfigFile.c_str(), "w");
+  if (fp == nullptr) return;
+  for (size_t f = 0; f < kNumFeatures; f++) {
+    fprintf(fp, "[%s]\n", kFeatures[f].name);
+    for (int i = f; i < num_entries; i += kNumFeatures) {
+      switch (i % 3) {
+        case 0:
+          fprintf(fp, "%02X:%02X:%02X = Address_Based\n", (i >> 8) & 0xff,
+                  i & 0xff, 0x5a);
+          break;
+        case 1:
+          fprintf(fp, "Headset %d = Name_Based\n", i);
+          break;
+        case 2:
+          fprintf(fp, "0x%04x-0x%04x = Vndr_Prdt_Based\n", 0x1000 + i, i);
+          break;
+      }
+    }
+    fprintf(fp, "\n");
+  }
+  fclose(fp);
+}
+
+class BM_InteropDatabase : public ::benchmark::Fixture {
+ public:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    if (st.thread_index() != 0) return;
+    std::filesystem::remove(kDynamicConfigFile);
+    write_database(st.range(0));
+    module_init(&interop_module);
+  }
+
+  void TearDown(State& st) override {
+    if (st.thread_index() == 0) {
+      module_clean_up(&interop_module);
+      std::filesystem::remove(kStaticConfigFile);
+      std::filesystem::remove(kDynamicConfigFile);
+    }
+    ::benchmark::Fixture::TearDown(st);
+  }
+};
+
+// Devices not in the database, the common case on every connection
+BENCHMARK_DEFINE_F(BM_InteropDatabase, match_addr_miss)(State& state) {
+  RawAddress addr;
+  RawAddress::FromString("c0:ff:ee:12:34:56", addr);
+  for (auto _ : state) {
+    for (const feature_t& feature : kFeatures) {
+      benchmark::DoNotOptimize(interop_match_addr(feature.feature, &addr));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumFeatures);
+}
+
+BENCHMARK_DEFINE_F(BM_InteropDatabase, match_name_miss)(State& state) {
+  for (auto _ : state) {
+    for (const feature_t& feature : kFeatures) {
+      benchmark::DoNotOptimize(
+          interop_match_name(feature.feature, "Headset of somebody"));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumFeatures);
+}
+
+BENCHMARK_DEFINE_F(BM_InteropDatabase, match_vendor_product_ids_miss)
+(State& state) {
+  for (auto _ : state) {
+    for (const feature_t& feature : kFeatures) {
+      benchmark::DoNotOptimize(
+          interop_match_vendor_product_ids(feature.feature, 0x05ac, 0x0255));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumFeatures);
+}
+
+BENCHMARK_DEFINE_F(BM_InteropDatabase, match_addr_hit)(State& state) {
+  RawAddress addr;
+  RawAddress::FromString("00:00:5a:12:34:56", addr);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(interop_match_addr(kFeatures[0].feature, &addr));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_REGISTER_F(BM_InteropDatabase, match_addr_miss)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->ThreadRange(1, 4);
+BENCHMARK_REGISTER_F(BM_InteropDatabase, match_name_miss)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->ThreadRange(1, 4);
+BENCHMARK_REGISTER_F(BM_InteropDatabase, match_vendor_product_ids_miss)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->ThreadRange(1, 4);
+BENCHMARK_REGISTER_F(BM_InteropDatabase, match_addr_hit)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(10000);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -32,10 +32,15 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "btcore/include/module.h"
 #include "btif/include/btif_storage.h"
@@ -92,7 +97,8 @@ static list_t* interop_list = NULL;
 static list_t* media_player_list = NULL;
 
 bool interop_is_initialized = false;
-// protects operations on |interop_list|
+// protects operations on |interop_list|, |interop_db_index| and
+// |interop_db_sources|
 pthread_mutex_t interop_list_lock;
 
 // protects operations on |config|
@@ -186,6 +192,269 @@ typedef struct {
 
 } interop_db_entry_t;
 
+// Compiled form of |interop_list|, so that matching does not walk the list.
+//
+// Entries looked up by an exact key (manufacturer, vendor and product ids,
+// versions, the OUI of SSR and LMP version entries, and address prefixes of
+// each length in use) are hashed together with their type, entry type and
+// feature. Names go into a case insensitive prefix trie per feature and entry
+// type, the handful of address ranges are scanned. When several entries
+// match, the one earliest in |interop_list| wins, as when walking the list.
+//
+// The index only holds copies of the values matched on and reports the
+// position of the entry in the order it was added, never a pointer into
+// |interop_list|: a copy stays valid after entries are removed from the list.
+class InteropDbIndex {
+ public:
+  struct Hit {
+    size_t position;
+    // Address prefix length, SSR max latency or LMP version of the entry
+    uint16_t value;
+    // LMP subversion of the entry
+    uint16_t sub_value;
+  };
+
+  // Appends |entry|, found afterwards at the position it was added at
+  void Add(const interop_db_entry_t* entry) {
+    const size_t position = size_++;
+    const bool dynamic = entry->bl_entry_type == INTEROP_ENTRY_TYPE_DYNAMIC;
+
+    switch (entry->bl_type) {
+      case INTEROP_BL_TYPE_ADDR: {
+        const interop_addr_entry_t& addr = entry->entry_type.addr_entry;
+        addr_prefix_lengths_ |= 1 << addr.length;
+        keys_.emplace(
+            Key(entry->bl_type, dynamic, addr.feature,
+                AddrPrefixPayload(addr.addr, addr.length)),
+            Hit{position, static_cast<uint16_t>(addr.length), 0});
+        break;
+      }
+      case INTEROP_BL_TYPE_NAME: {
+        const interop_name_entry_t& name = entry->entry_type.name_entry;
+        auto root = name_roots_.emplace(Root(dynamic, name.feature),
+                                        name_positions_.size());
+        if (root.second) name_positions_.push_back(kNoPosition);
+        size_t node = root.first->second;
+        for (const char* c = name.name; *c != '\0'; c++) {
+          auto child = name_edges_.emplace(Edge(node, *c),
+                                           name_positions_.size());
+          if (child.second) name_positions_.push_back(kNoPosition);
+          node = child.first->second;
+        }
+        if (name_positions_[node] == kNoPosition) {
+          name_positions_[node] = position;
+        }
+        break;
+      }
+      case INTEROP_BL_TYPE_SSR_MAX_LAT: {
+        const interop_hid_ssr_max_lat_t& ssr =
+            entry->entry_type.ssr_max_lat_entry;
+        keys_.emplace(Key(entry->bl_type, dynamic, ssr.feature,
+                          AddrPrefixPayload(ssr.addr, kOuiLength)),
+                      Hit{position, ssr.max_lat, 0});
+        break;
+      }
+      case INTEROP_BL_TYPE_LMP_VERSION: {
+        const interop_lmp_version_t& lmp = entry->entry_type.lmp_version_entry;
+        keys_.emplace(Key(entry->bl_type, dynamic, lmp.feature,
+                          AddrPrefixPayload(lmp.addr, kOuiLength)),
+                      Hit{position, lmp.lmp_ver, lmp.lmp_sub_ver});
+        break;
+      }
+      case INTEROP_BL_TYPE_ADDR_RANGE: {
+        const interop_addr_range_entry_t& range =
+            entry->entry_type.addr_range_entry;
+        ranges_[Root(dynamic, range.feature)].push_back(
+            Range{position, range.addr_start, range.addr_end});
+        break;
+      }
+      default: {
+        uint64_t payload;
+        if (!ExactPayload(*entry, &payload)) {
+          LOG_ERROR("bl_type: %d not handled", entry->bl_type);
+          break;
+        }
+        keys_.emplace(
+            Key(entry->bl_type, dynamic, FeatureOf(*entry), payload),
+            Hit{position, 0, 0});
+        break;
+      }
+    }
+  }
+
+  bool Match(const interop_db_entry_t& query, interop_entry_type entry_type,
+             Hit* hit) const {
+    Hit best = {kNoPosition, 0, 0};
+    if (entry_type & INTEROP_ENTRY_TYPE_STATIC) MatchType(query, false, &best);
+    if (entry_type & INTEROP_ENTRY_TYPE_DYNAMIC) MatchType(query, true, &best);
+    if (best.position == kNoPosition) return false;
+    if (hit) *hit = best;
+    return true;
+  }
+
+ private:
+  static constexpr size_t kNoPosition = std::numeric_limits<size_t>::max();
+  static constexpr size_t kOuiLength = 3;
+
+  struct Range {
+    size_t position;
+    RawAddress start;
+    RawAddress end;
+  };
+
+  // 4 bits of type, 1 of entry type, 16 of feature and 43 of payload
+  static uint64_t Key(interop_bl_type type, bool dynamic, int feature,
+                      uint64_t payload) {
+    return (uint64_t)type << 60 | (uint64_t)dynamic << 59 |
+           (uint64_t)(feature & 0xffff) << 43 | payload;
+  }
+
+  // Up to 5 bytes of address, the length of a prefix being part of its key
+  static uint64_t AddrPrefixPayload(const RawAddress& addr, size_t length) {
+    uint64_t payload = (uint64_t)length << 40;
+    for (size_t i = 0; i < length && i < 5; i++) {
+      payload |= (uint64_t)addr.address[i] << (8 * (4 - i));
+    }
+    return payload;
+  }
+
+  static bool ExactPayload(const interop_db_entry_t& entry,
+                           uint64_t* payload) {
+    switch (entry.bl_type) {
+      case INTEROP_BL_TYPE_MANUFACTURE:
+        *payload = entry.entry_type.mnfr_entry.manufacturer;
+        return true;
+      case INTEROP_BL_TYPE_VNDR_PRDT:
+        *payload = (uint64_t)entry.entry_type.vnr_pdt_entry.vendor_id << 16 |
+                   entry.entry_type.vnr_pdt_entry.product_id;
+        return true;
+      case INTEROP_BL_TYPE_VERSION:
+        *payload = entry.entry_type.version_entry.version;
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  static int FeatureOf(const interop_db_entry_t& entry) {
+    switch (entry.bl_type) {
+      case INTEROP_BL_TYPE_MANUFACTURE:
+        return entry.entry_type.mnfr_entry.feature;
+      case INTEROP_BL_TYPE_VNDR_PRDT:
+        return entry.entry_type.vnr_pdt_entry.feature;
+      case INTEROP_BL_TYPE_VERSION:
+        return entry.entry_type.version_entry.feature;
+      default:
+        return -1;
+    }
+  }
+
+  static uint32_t Root(bool dynamic, int feature) {
+    return (uint32_t)(feature & 0xffff) << 1 | dynamic;
+  }
+
+  static uint64_t Edge(size_t node, char c) {
+    return (uint64_t)node << 8 | (uint8_t)tolower((unsigned char)c);
+  }
+
+  void FindKey(uint64_t key, Hit* best) const {
+    auto it = keys_.find(key);
+    if (it != keys_.end() && it->second.position < best->position) {
+      *best = it->second;
+    }
+  }
+
+  void MatchType(const interop_db_entry_t& query, bool dynamic,
+                 Hit* best) const {
+    switch (query.bl_type) {
+      case INTEROP_BL_TYPE_ADDR: {
+        const interop_addr_entry_t& addr = query.entry_type.addr_entry;
+        for (size_t length = 1; length < sizeof(RawAddress); length++) {
+          if (!(addr_prefix_lengths_ & (1 << length))) continue;
+          FindKey(Key(query.bl_type, dynamic, addr.feature,
+                      AddrPrefixPayload(addr.addr, length)),
+                  best);
+        }
+        break;
+      }
+      case INTEROP_BL_TYPE_NAME: {
+        const interop_name_entry_t& name = query.entry_type.name_entry;
+        auto root = name_roots_.find(Root(dynamic, name.feature));
+        if (root == name_roots_.end()) break;
+        // Every name on the path is a prefix of the query
+        size_t node = root->second;
+        for (const char* c = name.name;; c++) {
+          size_t position = name_positions_[node];
+          if (position < best->position) *best = Hit{position, 0, 0};
+          if (*c == '\0') break;
+          auto child = name_edges_.find(Edge(node, *c));
+          if (child == name_edges_.end()) break;
+          node = child->second;
+        }
+        break;
+      }
+      case INTEROP_BL_TYPE_SSR_MAX_LAT: {
+        const interop_hid_ssr_max_lat_t& ssr =
+            query.entry_type.ssr_max_lat_entry;
+        FindKey(Key(query.bl_type, dynamic, ssr.feature,
+                    AddrPrefixPayload(ssr.addr, kOuiLength)),
+                best);
+        break;
+      }
+      case INTEROP_BL_TYPE_LMP_VERSION: {
+        const interop_lmp_version_t& lmp = query.entry_type.lmp_version_entry;
+        FindKey(Key(query.bl_type, dynamic, lmp.feature,
+                    AddrPrefixPayload(lmp.addr, kOuiLength)),
+                best);
+        break;
+      }
+      case INTEROP_BL_TYPE_ADDR_RANGE: {
+        const interop_addr_range_entry_t& range =
+            query.entry_type.addr_range_entry;
+        auto ranges = ranges_.find(Root(dynamic, range.feature));
+        if (ranges == ranges_.end()) break;
+        // |addr_start| of the query holds the address to look for
+        for (const Range& cur : ranges->second) {
+          if (cur.position > best->position) break;
+          if (range.addr_start >= cur.start && range.addr_start <= cur.end) {
+            *best = Hit{cur.position, 0, 0};
+            break;
+          }
+        }
+        break;
+      }
+      default: {
+        uint64_t payload;
+        if (ExactPayload(query, &payload)) {
+          FindKey(Key(query.bl_type, dynamic, FeatureOf(query), payload),
+                  best);
+        }
+        break;
+      }
+    }
+  }
+
+  size_t size_ = 0;
+  std::unordered_map<uint64_t, Hit> keys_;
+  // Bit n is set when some address entry is a prefix of n bytes
+  uint32_t addr_prefix_lengths_ = 0;
+  std::unordered_map<uint32_t, size_t> name_roots_;
+  std::unordered_map<uint64_t, size_t> name_edges_;
+  std::vector<size_t> name_positions_;
+  std::unordered_map<uint32_t, std::vector<Range>> ranges_;
+};
+
+// Kept in step with |interop_list|, under |interop_list_lock|
+static std::unique_ptr<InteropDbIndex> interop_db_index;
+// The |interop_list| entries by position in |interop_db_index|, under
+// |interop_list_lock|
+static std::vector<interop_db_entry_t*> interop_db_sources;
+// Immutable copy of |interop_db_index| matched against without any lock. It is
+// replaced, never modified, when entries are added or removed.
+static std::shared_ptr<const InteropDbIndex> interop_db_snapshot;
+// Set while the config files are loaded, to publish a single snapshot
+static bool interop_db_loading = false;
+
 static const char* interop_feature_string_(const interop_feature_t feature);
 static void interop_free_entry_(void* data);
 static void interop_lazy_init_(void);
@@ -203,6 +472,11 @@ static bool interop_database_remove_(interop_db_entry_t* entry);
 static bool interop_database_match(interop_db_entry_t* entry,
                                    interop_db_entry_t** ret_entry,
                                    interop_entry_type entry_type);
+static bool interop_database_lookup(const interop_db_entry_t& entry,
+                                    interop_entry_type entry_type,
+                                    InteropDbIndex::Hit* hit);
+static void interop_database_reindex_(void);
+static void interop_database_publish_(void);
 static void interop_config_flush(void);
 static bool interop_config_remove(const std::string& section,
                                   const std::string& key);
@@ -307,6 +581,9 @@ static future_t* interop_clean_up(void) {
   pthread_mutex_lock(&interop_list_lock);
   list_free(interop_list);
   interop_list = NULL;
+  interop_db_index.reset();
+  interop_db_sources.clear();
+  interop_database_publish_();
   list_free(media_player_list);
   media_player_list = NULL;
   interop_is_initialized = false;
@@ -408,7 +685,13 @@ static void interop_lazy_init_(void) {
   pthread_mutex_init(&interop_list_lock, NULL);
   if (interop_list == NULL) {
     interop_list = list_new(interop_free_entry_);
+    interop_db_index = std::make_unique<InteropDbIndex>();
+    interop_db_loading = true;
     load_config();
+    interop_db_loading = false;
+    pthread_mutex_lock(&interop_list_lock);
+    interop_database_publish_();
+    pthread_mutex_unlock(&interop_list_lock);
   }
 }
 
@@ -618,22 +901,26 @@ static bool interop_config_add_or_remove(interop_db_entry_t* db_entry,
 }
 
 static void interop_database_add_(interop_db_entry_t* db_entry, bool persist) {
-  interop_db_entry_t* ret_entry = NULL;
+  pthread_mutex_lock(&interop_list_lock);
+
   bool match_found =
-      interop_database_match(db_entry, &ret_entry,
+      interop_database_match(db_entry, NULL,
                              (interop_entry_type)(INTEROP_ENTRY_TYPE_STATIC |
                                                   INTEROP_ENTRY_TYPE_DYNAMIC));
 
   if (match_found) {
+    pthread_mutex_unlock(&interop_list_lock);
     // return as the entry is already present
     LOG_DEBUG("Entry is already present in the list");
+    osi_free(db_entry);
     return;
   }
 
-  pthread_mutex_lock(&interop_list_lock);
-
   if (interop_list) {
     list_append(interop_list, db_entry);
+    interop_db_index->Add(db_entry);
+    interop_db_sources.push_back(db_entry);
+    if (!interop_db_loading) interop_database_publish_();
   }
 
   pthread_mutex_unlock(&interop_list_lock);
@@ -646,152 +933,78 @@ static void interop_database_add_(interop_db_entry_t* db_entry, bool persist) {
   interop_config_add_or_remove(db_entry, true);
 }
 
+// Matches against |interop_list|, |interop_list_lock| must be held
 static bool interop_database_match(interop_db_entry_t* entry,
                                    interop_db_entry_t** ret_entry,
                                    interop_entry_type entry_type) {
   CHECK(entry);
-  bool found = false;
-  pthread_mutex_lock(&interop_list_lock);
-  if (interop_list == NULL || list_length(interop_list) == 0) {
-    pthread_mutex_unlock(&interop_list_lock);
+  InteropDbIndex::Hit hit;
+  if (!interop_db_index || !interop_db_index->Match(*entry, entry_type, &hit)) {
     return false;
   }
 
-  const list_node_t* node = list_begin(interop_list);
-
-  while (node != list_end(interop_list)) {
-    interop_db_entry_t* db_entry = (interop_db_entry_t*)list_node(node);
-    CHECK(db_entry);
-
-    if (entry->bl_type != db_entry->bl_type) {
-      node = list_next(node);
-      continue;
-    }
-
-    if ((entry_type == INTEROP_ENTRY_TYPE_STATIC) ||
-        (entry_type == INTEROP_ENTRY_TYPE_DYNAMIC)) {
-      if (entry->bl_entry_type != db_entry->bl_entry_type) {
-        node = list_next(node);
-        continue;
-      }
-    }
-
-    switch (db_entry->bl_type) {
-      case INTEROP_BL_TYPE_ADDR: {
-        interop_addr_entry_t* src = &entry->entry_type.addr_entry;
-        interop_addr_entry_t* cur = &db_entry->entry_type.addr_entry;
-        if ((src->feature == cur->feature) &&
-            (!memcmp(&src->addr, &cur->addr, cur->length))) {
-          /* cur len is used to remove src entry from config file, when
-           * interop_database_remove_addr is called. */
-          src->length = cur->length;
-          found = true;
-        }
-        break;
-      }
-      case INTEROP_BL_TYPE_NAME: {
-        interop_name_entry_t* src = &entry->entry_type.name_entry;
-        interop_name_entry_t* cur = &db_entry->entry_type.name_entry;
-
-        if ((src->feature == cur->feature) &&
-            (strcasestr(src->name, cur->name) == src->name)) {
-          found = true;
-        }
-        break;
-      }
-      case INTEROP_BL_TYPE_MANUFACTURE: {
-        interop_manufacturer_t* src = &entry->entry_type.mnfr_entry;
-        interop_manufacturer_t* cur = &db_entry->entry_type.mnfr_entry;
-
-        if (src->feature == cur->feature &&
-            src->manufacturer == cur->manufacturer) {
-          found = true;
-        }
-        break;
-      }
-      case INTEROP_BL_TYPE_VNDR_PRDT: {
-        interop_hid_multitouch_t* src = &entry->entry_type.vnr_pdt_entry;
-        interop_hid_multitouch_t* cur = &db_entry->entry_type.vnr_pdt_entry;
-
-        if ((src->feature == cur->feature) &&
-            (src->vendor_id == cur->vendor_id) &&
-            (src->product_id == cur->product_id)) {
-          found = true;
-        }
-        break;
-      }
-      case INTEROP_BL_TYPE_SSR_MAX_LAT: {
-        interop_hid_ssr_max_lat_t* src = &entry->entry_type.ssr_max_lat_entry;
-        interop_hid_ssr_max_lat_t* cur =
-            &db_entry->entry_type.ssr_max_lat_entry;
-
-        if ((src->feature == cur->feature) &&
-            !memcmp(&src->addr, &cur->addr, 3)) {
-          found = true;
-        }
-        break;
-      }
-      case INTEROP_BL_TYPE_VERSION: {
-        interop_version_t* src = &entry->entry_type.version_entry;
-        interop_version_t* cur = &db_entry->entry_type.version_entry;
+  if (entry->bl_type == INTEROP_BL_TYPE_ADDR) {
+    /* cur len is used to remove src entry from config file, when
+     * interop_database_remove_addr is called. */
+    entry->entry_type.addr_entry.length = hit.value;
+  }
+  if (ret_entry) {
+    *ret_entry = interop_db_sources[hit.position];
+  }
+  return true;
+}
 
-        if ((src->feature == cur->feature) && (src->version == cur->version)) {
-          found = true;
-        }
-        break;
-      }
-      case INTEROP_BL_TYPE_LMP_VERSION: {
-        interop_lmp_version_t* src = &entry->entry_type.lmp_version_entry;
-        interop_lmp_version_t* cur = &db_entry->entry_type.lmp_version_entry;
+// Matches against the last published snapshot of |interop_list|, without
+// taking |interop_list_lock|
+static bool interop_database_lookup(const interop_db_entry_t& entry,
+                                    interop_entry_type entry_type,
+                                    InteropDbIndex::Hit* hit) {
+  std::shared_ptr<const InteropDbIndex> snapshot = std::atomic_load_explicit(
+      &interop_db_snapshot, std::memory_order_acquire);
+  return snapshot && snapshot->Match(entry, entry_type, hit);
+}
 
-        if ((src->feature == cur->feature) &&
-            (!memcmp(&src->addr, &cur->addr, 3))) {
-          found = true;
-        }
-        break;
-      }
-      case INTEROP_BL_TYPE_ADDR_RANGE: {
-        interop_addr_range_entry_t* src = &entry->entry_type.addr_range_entry;
-        interop_addr_range_entry_t* cur =
-            &db_entry->entry_type.addr_range_entry;
-
-        // src->addr_start has the actual address, which need to be searched in
-        // the range
-        if ((src->feature == cur->feature) &&
-            (src->addr_start >= cur->addr_start) &&
-            (src->addr_start <= cur->addr_end)) {
-          found = true;
-        }
-        break;
-      }
-      default:
-        LOG_ERROR("bl_type: %d not handled", db_entry->bl_type);
-        break;
-    }
+// Rebuilds |interop_db_index| after entries were removed from |interop_list|,
+// |interop_list_lock| must be held
+static void interop_database_reindex_(void) {
+  interop_db_index = std::make_unique<InteropDbIndex>();
+  interop_db_sources.clear();
+  for (const list_node_t* node = list_begin(interop_list);
+       node != list_end(interop_list); node = list_next(node)) {
+    interop_db_entry_t* entry = (interop_db_entry_t*)list_node(node);
+    interop_db_index->Add(entry);
+    interop_db_sources.push_back(entry);
+  }
+}
 
-    if (found && ret_entry) {
-      *ret_entry = db_entry;
-      break;
-    }
-    node = list_next(node);
+// Makes the current |interop_db_index| the one matched against by readers,
+// |interop_list_lock| must be held. Readers still holding the previous
+// snapshot keep it alive until they are done.
+static void interop_database_publish_(void) {
+  std::shared_ptr<const InteropDbIndex> snapshot;
+  if (interop_db_index) {
+    snapshot = std::make_shared<const InteropDbIndex>(*interop_db_index);
   }
-  pthread_mutex_unlock(&interop_list_lock);
-  return found;
+  std::atomic_store_explicit(&interop_db_snapshot, std::move(snapshot),
+                             std::memory_order_release);
 }
 
 static bool interop_database_remove_(interop_db_entry_t* entry) {
   interop_db_entry_t* ret_entry = NULL;
 
+  pthread_mutex_lock(&interop_list_lock);
   if (!interop_database_match(
           entry, &ret_entry,
           (interop_entry_type)(INTEROP_ENTRY_TYPE_DYNAMIC))) {
+    pthread_mutex_unlock(&interop_list_lock);
     LOG_ERROR("Entry not found in the list");
     return false;
   }
 
   // first remove it from linked list
-  pthread_mutex_lock(&interop_list_lock);
   list_remove(interop_list, (void*)ret_entry);
+  interop_database_reindex_();
+  interop_database_publish_();
   pthread_mutex_unlock(&interop_list_lock);
 
   return interop_config_add_or_remove(entry, false);
@@ -1299,10 +1512,11 @@ bool interop_database_match_manufacturer(const interop_feature_t feature,
   entry.entry_type.mnfr_entry.feature = feature;
   entry.entry_type.mnfr_entry.manufacturer = manufacturer;
 
-  if (interop_database_match(
-          &entry, NULL,
+  if (interop_database_lookup(
+          entry,
           (interop_entry_type)(INTEROP_ENTRY_TYPE_STATIC |
-                               INTEROP_ENTRY_TYPE_DYNAMIC))) {
+                               INTEROP_ENTRY_TYPE_DYNAMIC),
+          NULL)) {
     LOG_WARN(
         "Device with manufacturer id: %d is a match for interop workaround %s",
         manufacturer, interop_feature_string_(feature));
@@ -1325,10 +1539,11 @@ bool interop_database_match_name(const interop_feature_t feature,
   entry.entry_type.name_entry.feature = (interop_feature_t)feature;
   entry.entry_type.name_entry.length = strlen(entry.entry_type.name_entry.name);
 
-  if (interop_database_match(
-          &entry, NULL,
+  if (interop_database_lookup(
+          entry,
           (interop_entry_type)(INTEROP_ENTRY_TYPE_STATIC |
-                               INTEROP_ENTRY_TYPE_DYNAMIC))) {
+                               INTEROP_ENTRY_TYPE_DYNAMIC),
+          NULL)) {
     LOG_WARN("Device with name: %s is a match for interop workaround %s", name,
              interop_feature_string_(feature));
     return true;
@@ -1348,10 +1563,11 @@ bool interop_database_match_addr(const interop_feature_t feature,
   entry.entry_type.addr_entry.feature = (interop_feature_t)feature;
   entry.entry_type.addr_entry.length = sizeof(RawAddress);
 
-  if (interop_database_match(
-          &entry, NULL,
+  if (interop_database_lookup(
+          entry,
           (interop_entry_type)(INTEROP_ENTRY_TYPE_STATIC |
-                               INTEROP_ENTRY_TYPE_DYNAMIC))) {
+                               INTEROP_ENTRY_TYPE_DYNAMIC),
+          NULL)) {
     LOG_WARN("Device %s is a match for interop workaround %s.",
              ADDRESS_TO_LOGGABLE_CSTR(*addr), interop_feature_string_(feature));
     return true;
@@ -1362,8 +1578,8 @@ bool interop_database_match_addr(const interop_feature_t feature,
   entry.entry_type.addr_range_entry.addr_start = *addr;
   entry.entry_type.addr_range_entry.feature = (interop_feature_t)feature;
 
-  if (interop_database_match(&entry, NULL,
-                             (interop_entry_type)(INTEROP_ENTRY_TYPE_STATIC))) {
+  if (interop_database_lookup(
+          entry, (interop_entry_type)(INTEROP_ENTRY_TYPE_STATIC), NULL)) {
     LOG_WARN("Device %s is a match for interop workaround %s.",
              ADDRESS_TO_LOGGABLE_CSTR(*addr), interop_feature_string_(feature));
     return true;
@@ -1381,10 +1597,11 @@ bool interop_database_match_vndr_prdt(const interop_feature_t feature,
   entry.entry_type.vnr_pdt_entry.feature = (interop_feature_t)feature;
   entry.entry_type.vnr_pdt_entry.vendor_id = vendor_id;
   entry.entry_type.vnr_pdt_entry.product_id = product_id;
-  if (interop_database_match(
-          &entry, NULL,
+  if (interop_database_lookup(
+          entry,
           (interop_entry_type)(INTEROP_ENTRY_TYPE_STATIC |
-                               INTEROP_ENTRY_TYPE_DYNAMIC))) {
+                               INTEROP_ENTRY_TYPE_DYNAMIC),
+          NULL)) {
     LOG_WARN(
         "Device with vendor_id: %d product_id: %d is a match for interop "
         "workaround %s",
@@ -1399,20 +1616,21 @@ bool interop_database_match_addr_get_max_lat(const interop_feature_t feature,
                                              const RawAddress* addr,
                                              uint16_t* max_lat) {
   interop_db_entry_t entry;
-  interop_db_entry_t* ret_entry = NULL;
+  InteropDbIndex::Hit hit;
 
   entry.bl_type = INTEROP_BL_TYPE_SSR_MAX_LAT;
 
   entry.entry_type.ssr_max_lat_entry.feature = feature;
   entry.entry_type.ssr_max_lat_entry.addr = *addr;
   entry.entry_type.ssr_max_lat_entry.feature = feature;
-  if (interop_database_match(
-          &entry, &ret_entry,
+  if (interop_database_lookup(
+          entry,
           (interop_entry_type)(INTEROP_ENTRY_TYPE_STATIC |
-                               INTEROP_ENTRY_TYPE_DYNAMIC))) {
+                               INTEROP_ENTRY_TYPE_DYNAMIC),
+          &hit)) {
     LOG_WARN("Device %s is a match for interop workaround %s.",
              ADDRESS_TO_LOGGABLE_CSTR(*addr), interop_feature_string_(feature));
-    *max_lat = ret_entry->entry_type.ssr_max_lat_entry.max_lat;
+    *max_lat = hit.value;
     return true;
   }
 
@@ -1427,10 +1645,11 @@ bool interop_database_match_version(const interop_feature_t feature,
 
   entry.entry_type.version_entry.feature = (interop_feature_t)feature;
   entry.entry_type.version_entry.version = version;
-  if (interop_database_match(
-          &entry, NULL,
+  if (interop_database_lookup(
+          entry,
           (interop_entry_type)(INTEROP_ENTRY_TYPE_STATIC |
-                               INTEROP_ENTRY_TYPE_DYNAMIC))) {
+                               INTEROP_ENTRY_TYPE_DYNAMIC),
+          NULL)) {
     LOG_WARN("Device with version: 0x%04x is a match for interop workaround %s",
              version, interop_feature_string_(feature));
     return true;
@@ -1444,21 +1663,22 @@ bool interop_database_match_addr_get_lmp_ver(const interop_feature_t feature,
                                              uint8_t* lmp_ver,
                                              uint16_t* lmp_sub_ver) {
   interop_db_entry_t entry;
-  interop_db_entry_t* ret_entry = NULL;
+  InteropDbIndex::Hit hit;
 
   entry.bl_type = INTEROP_BL_TYPE_LMP_VERSION;
 
   entry.entry_type.lmp_version_entry.feature = feature;
   entry.entry_type.lmp_version_entry.addr = *addr;
   entry.entry_type.lmp_version_entry.feature = feature;
-  if (interop_database_match(
-          &entry, &ret_entry,
+  if (interop_database_lookup(
+          entry,
           (interop_entry_type)(INTEROP_ENTRY_TYPE_STATIC |
-                               INTEROP_ENTRY_TYPE_DYNAMIC))) {
+                               INTEROP_ENTRY_TYPE_DYNAMIC),
+          &hit)) {
     LOG_WARN("Device %s is a match for interop workaround %s.",
              ADDRESS_TO_LOGGABLE_CSTR(*addr), interop_feature_string_(feature));
-    *lmp_ver = ret_entry->entry_type.lmp_version_entry.lmp_ver;
-    *lmp_sub_ver = ret_entry->entry_type.lmp_version_entry.lmp_sub_ver;
+    *lmp_ver = hit.value;
+    *lmp_sub_ver = hit.sub_value;
     return true;
   }
 
@@ -1526,6 +1746,8 @@ bool interop_database_remove_addr(const interop_feature_t feature,
 bool interop_database_remove_feature(const interop_feature_t feature) {
   if (interop_list == NULL || list_length(interop_list) == 0) return false;
 
+  bool removed = false;
+  pthread_mutex_lock(&interop_list_lock);
   list_node_t* node = list_begin(interop_list);
   while (node != list_end(interop_list)) {
     interop_db_entry_t* entry =
@@ -1578,12 +1800,17 @@ bool interop_database_remove_feature(const interop_feature_t feature) {
     node = list_next(node);
 
     if (entry_match) {
-      pthread_mutex_lock(&interop_list_lock);
       list_remove(interop_list, (void*)entry);
-      pthread_mutex_unlock(&interop_list_lock);
+      removed = true;
     }
   }
 
+  if (removed) {
+    interop_database_reindex_();
+    interop_database_publish_();
+  }
+  pthread_mutex_unlock(&interop_list_lock);
+
   for (const section_t& sec : config_dynamic.get()->sections) {
     if (feature == interop_feature_name_to_feature_id(sec.name.c_str())) {
       LOG_WARN("found feature - %s", interop_feature_string_(feature));
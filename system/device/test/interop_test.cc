@@ -703,6 +703,64 @@ TEST_F(InteropTest, test_dynamic_name) {
   module_clean_up(&interop_module);
 }
 
+TEST_F(InteropTest, test_dynamic_name_prefix) {
+  module_init(&interop_module);
+
+  interop_database_add_name(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, "Carkit X");
+  interop_database_add_name(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, "Car");
+
+  // Entries match names they are a case insensitive prefix of
+  EXPECT_TRUE(
+      interop_match_name(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, "CARAMEL"));
+  EXPECT_TRUE(
+      interop_match_name(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, "carkit xl"));
+  EXPECT_FALSE(interop_match_name(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, "Ca"));
+  EXPECT_FALSE(
+      interop_match_name(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, "My Car"));
+  EXPECT_FALSE(interop_match_name(INTEROP_AUTO_RETRY_PAIRING, "Car"));
+
+  interop_database_remove_name(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, "Car");
+  EXPECT_FALSE(
+      interop_match_name(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, "CARAMEL"));
+  EXPECT_TRUE(
+      interop_match_name(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, "carkit xl"));
+
+  interop_database_clear();
+  module_clean_up(&interop_module);
+}
+
+TEST_F(InteropTest, test_dynamic_addr_prefix_lengths) {
+  module_init(&interop_module);
+
+  RawAddress prefix_3;
+  RawAddress prefix_4;
+  RawAddress other;
+  RawAddress::FromString("11:22:33:00:00:00", prefix_3);
+  RawAddress::FromString("aa:bb:cc:dd:00:00", prefix_4);
+  interop_database_add(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, &prefix_3, 3);
+  interop_database_add(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, &prefix_4, 4);
+
+  RawAddress::FromString("11:22:33:44:55:66", other);
+  EXPECT_TRUE(
+      interop_match_addr(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, &other));
+  RawAddress::FromString("aa:bb:cc:dd:ee:ff", other);
+  EXPECT_TRUE(
+      interop_match_addr(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, &other));
+  RawAddress::FromString("aa:bb:cc:de:ee:ff", other);
+  EXPECT_FALSE(
+      interop_match_addr(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, &other));
+  RawAddress::FromString("11:22:34:44:55:66", other);
+  EXPECT_FALSE(
+      interop_match_addr(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, &other));
+
+  interop_database_clear();
+  RawAddress::FromString("aa:bb:cc:dd:ee:ff", other);
+  EXPECT_FALSE(
+      interop_match_addr(INTEROP_DISABLE_LE_SECURE_CONNECTIONS, &other));
+
+  module_clean_up(&interop_module);
+}
+
 TEST_F(InteropTest, test_dynamic_vndr_prdt) {
   module_init(&interop_module);
 
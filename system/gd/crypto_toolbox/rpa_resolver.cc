@@ -0,0 +1,230 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "crypto_toolbox/rpa_resolver.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RPA_RESOLVER_AES_NI
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_AES
+#define HWCAP_AES (1 << 3)
+#endif
+#define RPA_RESOLVER_ARMV8_CRYPTO
+#endif
+
+using bluetooth::hci::Octet16;
+
+namespace crypto_toolbox {
+namespace {
+
+constexpr size_t kRpaLength = 6;
+constexpr size_t kAes128Rounds = 10;
+// Keys processed together, enough to hide the latency of the AES instructions
+constexpr size_t kLanes = 4;
+
+// The hash is the 24 least significant bits of AES-128(irk, prand). In the big endian block handed to AES, prand
+// occupies bytes 13 to 15 of the plaintext and the hash bytes 13 to 15 of the ciphertext.
+void MakePlaintext(const uint8_t* rpa, uint8_t plaintext[N_BLOCK]) {
+  std::memset(plaintext, 0, N_BLOCK);
+  std::memcpy(plaintext + 13, rpa, 3);
+}
+
+bool HashMatches(const uint8_t ciphertext[N_BLOCK], const uint8_t* rpa) {
+  return std::memcmp(ciphertext + 13, rpa + 3, 3) == 0;
+}
+
+size_t FindMatchSoftware(const aes_context* schedules, size_t count, const uint8_t* rpa) {
+  uint8_t plaintext[N_BLOCK];
+  uint8_t ciphertext[N_BLOCK];
+  MakePlaintext(rpa, plaintext);
+  for (size_t i = 0; i < count; i++) {
+    aes_encrypt(plaintext, ciphertext, &schedules[i]);
+    if (HashMatches(ciphertext, rpa)) {
+      return i;
+    }
+  }
+  return count;
+}
+
+#if defined(RPA_RESOLVER_AES_NI)
+
+bool CpuHasAesInstructions() {
+  return __builtin_cpu_supports("aes");
+}
+
+__attribute__((target("aes,sse2"))) __m128i RoundKey(const aes_context& schedule, size_t round) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(schedule.ksch + round * N_BLOCK));
+}
+
+__attribute__((target("aes,sse2"))) size_t FindMatchHardware(
+    const aes_context* schedules, size_t count, const uint8_t* rpa) {
+  uint8_t plaintext_bytes[N_BLOCK];
+  MakePlaintext(rpa, plaintext_bytes);
+  const __m128i plaintext = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plaintext_bytes));
+  uint8_t ciphertext[kLanes][N_BLOCK];
+
+  size_t i = 0;
+  for (; i + kLanes <= count; i += kLanes) {
+    __m128i state[kLanes];
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      state[lane] = _mm_xor_si128(plaintext, RoundKey(schedules[i + lane], 0));
+    }
+    for (size_t round = 1; round < kAes128Rounds; round++) {
+      for (size_t lane = 0; lane < kLanes; lane++) {
+        state[lane] = _mm_aesenc_si128(state[lane], RoundKey(schedules[i + lane], round));
+      }
+    }
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      state[lane] = _mm_aesenclast_si128(state[lane], RoundKey(schedules[i + lane], kAes128Rounds));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(ciphertext[lane]), state[lane]);
+    }
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      if (HashMatches(ciphertext[lane], rpa)) {
+        return i + lane;
+      }
+    }
+  }
+  for (; i < count; i++) {
+    __m128i state = _mm_xor_si128(plaintext, RoundKey(schedules[i], 0));
+    for (size_t round = 1; round < kAes128Rounds; round++) {
+      state = _mm_aesenc_si128(state, RoundKey(schedules[i], round));
+    }
+    state = _mm_aesenclast_si128(state, RoundKey(schedules[i], kAes128Rounds));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(ciphertext[0]), state);
+    if (HashMatches(ciphertext[0], rpa)) {
+      return i;
+    }
+  }
+  return count;
+}
+
+#elif defined(RPA_RESOLVER_ARMV8_CRYPTO)
+
+bool CpuHasAesInstructions() {
+  return (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+}
+
+__attribute__((target("aes"))) uint8x16_t RoundKey(const aes_context& schedule, size_t round) {
+  return vld1q_u8(schedule.ksch + round * N_BLOCK);
+}
+
+// AESE performs AddRoundKey before SubBytes and ShiftRows, so the last round key is added separately
+__attribute__((target("aes"))) uint8x16_t Encrypt(const aes_context& schedule, uint8x16_t state) {
+  for (size_t round = 0; round < kAes128Rounds - 1; round++) {
+    state = vaesmcq_u8(vaeseq_u8(state, RoundKey(schedule, round)));
+  }
+  state = vaeseq_u8(state, RoundKey(schedule, kAes128Rounds - 1));
+  return veorq_u8(state, RoundKey(schedule, kAes128Rounds));
+}
+
+__attribute__((target("aes"))) size_t FindMatchHardware(
+    const aes_context* schedules, size_t count, const uint8_t* rpa) {
+  uint8_t plaintext_bytes[N_BLOCK];
+  MakePlaintext(rpa, plaintext_bytes);
+  const uint8x16_t plaintext = vld1q_u8(plaintext_bytes);
+  uint8_t ciphertext[kLanes][N_BLOCK];
+
+  size_t i = 0;
+  for (; i + kLanes <= count; i += kLanes) {
+    // Independent lanes let the core overlap the AESE/AESMC pairs of different keys
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      vst1q_u8(ciphertext[lane], Encrypt(schedules[i + lane], plaintext));
+    }
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      if (HashMatches(ciphertext[lane], rpa)) {
+        return i + lane;
+      }
+    }
+  }
+  for (; i < count; i++) {
+    vst1q_u8(ciphertext[0], Encrypt(schedules[i], plaintext));
+    if (HashMatches(ciphertext[0], rpa)) {
+      return i;
+    }
+  }
+  return count;
+}
+
+#endif
+
+uint64_t CacheKey(const uint8_t* rpa) {
+  uint64_t key = 0;
+  for (size_t i = 0; i < kRpaLength; i++) {
+    key = (key << 8) | rpa[i];
+  }
+  return key;
+}
+
+}  // namespace
+
+RpaResolver::RpaResolver() : implementation_(Implementation::SOFTWARE) {
+#if defined(RPA_RESOLVER_AES_NI)
+  if (CpuHasAesInstructions()) {
+    implementation_ = Implementation::AES_NI;
+  }
+#elif defined(RPA_RESOLVER_ARMV8_CRYPTO)
+  if (CpuHasAesInstructions()) {
+    implementation_ = Implementation::ARMV8_CRYPTO;
+  }
+#endif
+}
+
+void RpaResolver::SetIrks(const std::vector<Octet16>& irks) {
+  schedules_.resize(irks.size());
+  for (size_t i = 0; i < irks.size(); i++) {
+    // aes.cc takes keys most significant byte first, see aes_128()
+    Octet16 irk_reversed;
+    std::reverse_copy(irks[i].begin(), irks[i].end(), irk_reversed.begin());
+    aes_set_key(irk_reversed.data(), irk_reversed.size(), &schedules_[i]);
+  }
+  cache_.clear();
+}
+
+int RpaResolver::Resolve(const uint8_t* rpa) {
+  uint64_t key = CacheKey(rpa);
+  auto it = cache_.find(key);
+  if (it != cache_.end()) {
+    return it->second;
+  }
+  int result = ResolveUncached(rpa);
+  if (cache_.size() >= kMaxCachedAddresses) {
+    cache_.clear();
+  }
+  cache_.emplace(key, result);
+  return result;
+}
+
+int RpaResolver::ResolveUncached(const uint8_t* rpa) const {
+  size_t match;
+#if defined(RPA_RESOLVER_AES_NI) || defined(RPA_RESOLVER_ARMV8_CRYPTO)
+  if (implementation_ != Implementation::SOFTWARE) {
+    match = FindMatchHardware(schedules_.data(), schedules_.size(), rpa);
+  } else {
+    match = FindMatchSoftware(schedules_.data(), schedules_.size(), rpa);
+  }
+#else
+  match = FindMatchSoftware(schedules_.data(), schedules_.size(), rpa);
+#endif
+  return match == schedules_.size() ? kNoMatch : static_cast<int>(match);
+}
+
+}  // namespace crypto_toolbox
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "crypto_toolbox/aes.h"
+#include "hci/octets.h"
+
+namespace crypto_toolbox {
+
+// Resolves resolvable private addresses against a set of identity resolving keys (Core 5.4 Vol 3, Part H 2.2.2).
+//
+// The AES key schedule of every IRK is expanded once, when the keys are set. The hash of an address is then computed
+// under several keys at a time with AES-NI or the ARMv8 cryptography extension when the CPU has them, or with aes.cc
+// otherwise. Results, matches and misses alike, are cached per address until the keys change.
+class RpaResolver {
+ public:
+  static constexpr int kNoMatch = -1;
+  static constexpr size_t kMaxCachedAddresses = 256;
+
+  enum class Implementation { SOFTWARE, AES_NI, ARMV8_CRYPTO };
+
+  RpaResolver();
+
+  // Replaces the keys. IRKs are in the byte order used by the stack, least significant byte first.
+  void SetIrks(const std::vector<bluetooth::hci::Octet16>& irks);
+
+  size_t GetIrkCount() const {
+    return schedules_.size();
+  }
+
+  // |rpa| is the 6 byte address, most significant byte first as in RawAddress.
+  // Returns the index of the first IRK which resolves it, or kNoMatch.
+  int Resolve(const uint8_t* rpa);
+
+  // Same as Resolve(), always computing the hashes
+  int ResolveUncached(const uint8_t* rpa) const;
+
+  Implementation GetImplementation() const {
+    return implementation_;
+  }
+
+  // Use aes.cc even if the CPU has AES instructions
+  void ForceSoftwareImplementation() {
+    implementation_ = Implementation::SOFTWARE;
+  }
+
+ private:
+  Implementation implementation_;
+  std::vector<aes_context> schedules_;
+  std::unordered_map<uint64_t, int> cache_;
+};
+
+}  // namespace crypto_toolbox
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "crypto_toolbox/crypto_toolbox.h"
+#include "crypto_toolbox/rpa_resolver.h"
+#include "hci/octets.h"
+
+using ::benchmark::State;
+using bluetooth::hci::Octet16;
+
+namespace crypto_toolbox {
+namespace {
+
+// Addresses seen per iteration, none of which resolves: the common case when scanning among strangers
+constexpr int kNumAddresses = 64;
+
+std::vector<Octet16> MakeIrks(int count) {
+  std::vector<Octet16> irks(count);
+  for (int i = 0; i < count; i++) {
+    for (size_t j = 0; j < irks[i].size(); j++) {
+      irks[i][j] = static_cast<uint8_t>(i * 31 + j * 7 + (i >> 8));
+    }
+  }
+  return irks;
+}
+
+std::vector<std::array<uint8_t, 6>> MakeAddresses() {
+  std::vector<std::array<uint8_t, 6>> addresses(kNumAddresses);
+  for (int i = 0; i < kNumAddresses; i++) {
+    addresses[i] = {0x40, 0x12, static_cast<uint8_t>(i), 0xa5, static_cast<uint8_t>(i * 3), 0x5a};
+  }
+  return addresses;
+}
+
+void SetCounters(State& state) {
+  state.SetItemsProcessed(static_cast<int_fast64_t>(state.iterations()) * kNumAddresses * state.range(0));
+  state.counters["irks"] = state.range(0);
+}
+
+}  // namespace
+
+// What btm_ble_resolve_random_addr() did: one aes_128(), key expansion included, per IRK
+static void BM_RpaResolve_aes_128(State& state) {
+  auto irks = MakeIrks(state.range(0));
+  auto addresses = MakeAddresses();
+  for (auto _ : state) {
+    for (const auto& address : addresses) {
+      Octet16 prand{};
+      prand[0] = address[2];
+      prand[1] = address[1];
+      prand[2] = address[0];
+      for (const auto& irk : irks) {
+        Octet16 hash = aes_128(irk, prand);
+        if (hash[0] == address[5] && hash[1] == address[4] && hash[2] == address[3]) {
+          break;
+        }
+      }
+    }
+  }
+  SetCounters(state);
+}
+BENCHMARK(BM_RpaResolve_aes_128)->Arg(10)->Arg(100)->Arg(1000);
+
+static void BM_RpaResolve_software(State& state) {
+  RpaResolver resolver;
+  resolver.ForceSoftwareImplementation();
+  resolver.SetIrks(MakeIrks(state.range(0)));
+  auto addresses = MakeAddresses();
+  for (auto _ : state) {
+    for (const auto& address : addresses) {
+      benchmark::DoNotOptimize(resolver.ResolveUncached(address.data()));
+    }
+  }
+  SetCounters(state);
+}
+BENCHMARK(BM_RpaResolve_software)->Arg(10)->Arg(100)->Arg(1000);
+
+// AES-NI or the ARMv8 cryptography extension, when the CPU has them
+static void BM_RpaResolve_default(State& state) {
+  RpaResolver resolver;
+  resolver.SetIrks(MakeIrks(state.range(0)));
+  auto addresses = MakeAddresses();
+  for (auto _ : state) {
+    for (const auto& address : addresses) {
+      benchmark::DoNotOptimize(resolver.ResolveUncached(address.data()));
+    }
+  }
+  SetCounters(state);
+  state.counters["hardware"] = resolver.GetImplementation() != RpaResolver::Implementation::SOFTWARE;
+}
+BENCHMARK(BM_RpaResolve_default)->Arg(10)->Arg(100)->Arg(1000);
+
+// The same addresses advertised again, as every advertiser does many times per RPA rotation period
+static void BM_RpaResolve_cached(State& state) {
+  RpaResolver resolver;
+  resolver.SetIrks(MakeIrks(state.range(0)));
+  auto addresses = MakeAddresses();
+  for (auto _ : state) {
+    for (const auto& address : addresses) {
+      benchmark::DoNotOptimize(resolver.Resolve(address.data()));
+    }
+  }
+  SetCounters(state);
+}
+BENCHMARK(BM_RpaResolve_cached)->Arg(10)->Arg(100)->Arg(1000);
+
+}  // namespace crypto_toolbox
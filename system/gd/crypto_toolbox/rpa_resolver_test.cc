@@ -0,0 +1,119 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "crypto_toolbox/rpa_resolver.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "crypto_toolbox/crypto_toolbox.h"
+#include "hci/octets.h"
+
+namespace crypto_toolbox {
+namespace {
+
+using bluetooth::hci::Octet16;
+
+// BT Spec 5.0 | Vol 3, Part H D.7, IRK in little endian format
+const Octet16 kSpecIrk{0x9b, 0x7d, 0x39, 0x0a, 0xa6, 0x10, 0x10, 0x34, 0x05, 0xad, 0xc8, 0x57, 0xa3, 0x34, 0x02, 0xec};
+// prand 0x708194, hash 0x0dfbaa
+const std::array<uint8_t, 6> kSpecRpa{0x70, 0x81, 0x94, 0x0d, 0xfb, 0xaa};
+
+Octet16 MakeIrk(uint8_t seed) {
+  Octet16 irk;
+  for (size_t i = 0; i < irk.size(); i++) {
+    irk[i] = static_cast<uint8_t>(seed * 31 + i * 7);
+  }
+  return irk;
+}
+
+// Builds the RPA of |irk| for |prand| with the reference aes_128()
+std::array<uint8_t, 6> MakeRpa(const Octet16& irk, uint32_t prand) {
+  Octet16 r{};
+  r[0] = static_cast<uint8_t>(prand);
+  r[1] = static_cast<uint8_t>(prand >> 8);
+  r[2] = static_cast<uint8_t>(((prand >> 16) & 0x3f) | 0x40);
+  Octet16 p = aes_128(irk, r);
+  return {r[2], r[1], r[0], p[2], p[1], p[0]};
+}
+
+class RpaResolverTest : public ::testing::TestWithParam<bool> {
+ protected:
+  void SetUp() override {
+    if (GetParam()) {
+      resolver_.ForceSoftwareImplementation();
+    }
+  }
+
+  RpaResolver resolver_;
+};
+
+TEST_P(RpaResolverTest, bt_spec_example_d_7) {
+  resolver_.SetIrks({MakeIrk(1), kSpecIrk});
+  EXPECT_EQ(resolver_.Resolve(kSpecRpa.data()), 1);
+
+  std::array<uint8_t, 6> other_rpa = kSpecRpa;
+  other_rpa[5] ^= 0x01;
+  EXPECT_EQ(resolver_.Resolve(other_rpa.data()), RpaResolver::kNoMatch);
+}
+
+TEST_P(RpaResolverTest, finds_every_key_of_a_batch) {
+  // Not a multiple of the number of keys processed together
+  std::vector<Octet16> irks;
+  for (uint8_t i = 0; i < 23; i++) {
+    irks.push_back(MakeIrk(i));
+  }
+  resolver_.SetIrks(irks);
+  for (size_t i = 0; i < irks.size(); i++) {
+    auto rpa = MakeRpa(irks[i], 0x123456 + i);
+    EXPECT_EQ(resolver_.ResolveUncached(rpa.data()), static_cast<int>(i));
+  }
+  auto unknown_rpa = MakeRpa(MakeIrk(100), 0x123456);
+  EXPECT_EQ(resolver_.ResolveUncached(unknown_rpa.data()), RpaResolver::kNoMatch);
+}
+
+TEST_P(RpaResolverTest, first_matching_key_wins) {
+  resolver_.SetIrks({MakeIrk(1), MakeIrk(2), MakeIrk(2)});
+  auto rpa = MakeRpa(MakeIrk(2), 0x00abcd);
+  EXPECT_EQ(resolver_.Resolve(rpa.data()), 1);
+}
+
+TEST_P(RpaResolverTest, cached_results_are_dropped_with_the_keys) {
+  auto rpa = MakeRpa(MakeIrk(5), 0x00beef);
+  resolver_.SetIrks({MakeIrk(1)});
+  EXPECT_EQ(resolver_.Resolve(rpa.data()), RpaResolver::kNoMatch);
+  EXPECT_EQ(resolver_.Resolve(rpa.data()), RpaResolver::kNoMatch);
+
+  resolver_.SetIrks({MakeIrk(1), MakeIrk(5)});
+  EXPECT_EQ(resolver_.Resolve(rpa.data()), 1);
+  EXPECT_EQ(resolver_.Resolve(rpa.data()), 1);
+}
+
+TEST_P(RpaResolverTest, no_keys) {
+  EXPECT_EQ(resolver_.Resolve(kSpecRpa.data()), RpaResolver::kNoMatch);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    RpaResolver,
+    RpaResolverTest,
+    ::testing::Bool(),
+    [](const ::testing::TestParamInfo<bool>& info) { return info.param ? "software" : "default"; });
+
+}  // namespace
+}  // namespace crypto_toolbox
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal/h4_batch_io.h"
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "os/log.h"
+#include "os/utils.h"
+
+namespace bluetooth {
+namespace hal {
+namespace {
+
+constexpr uint8_t kHciCommandHeaderSize = 3;
+
+// Size of the HCI header of an H4 packet of |type|, 0 if |type| is not a known packet indicator
+size_t GetHeaderSize(uint8_t type) {
+  switch (type) {
+    case kH4Command:
+      return kHciCommandHeaderSize;
+    case kH4Acl:
+      return kHciAclHeaderSize;
+    case kH4Sco:
+      return kHciScoHeaderSize;
+    case kH4Event:
+      return kHciEvtHeaderSize;
+    case kH4Iso:
+      return kHciIsoHeaderSize;
+    default:
+      return 0;
+  }
+}
+
+// Payload size of a packet of |type|, from its HCI header
+size_t GetPayloadSize(uint8_t type, const uint8_t* header) {
+  switch (type) {
+    case kH4Command:
+      return header[2];
+    case kH4Acl:
+      return header[2] | (header[3] << 8);
+    case kH4Sco:
+      return header[2];
+    case kH4Event:
+      return header[1];
+    case kH4Iso:
+      return header[2] | ((header[3] & 0x3f) << 8);
+    default:
+      return 0;
+  }
+}
+
+}  // namespace
+
+H4Reader::H4Reader(size_t buffer_size) : buffer_(std::max(buffer_size, kMaxPacketSize)) {}
+
+ssize_t H4Reader::ReadFrom(int fd, size_t max_reads, std::vector<H4Packet>* packets) {
+  ssize_t total_size = 0;
+  for (size_t reads = 0; reads < max_reads && end_ < buffer_.size(); reads++) {
+    // A transport delivering one packet per read truncates a packet larger than the space left, so only read again
+    // while the largest packet still fits
+    if (reads > 0 && buffer_.size() - end_ < kMaxPacketSize) {
+      break;
+    }
+    ssize_t received_size;
+    RUN_NO_INTR(received_size = recv(fd, buffer_.data() + end_, buffer_.size() - end_, reads == 0 ? 0 : MSG_DONTWAIT));
+    if (received_size <= 0) {
+      // Nothing more to read for now. End of file or an error is reported by the next call.
+      if (reads == 0) {
+        return received_size;
+      }
+      break;
+    }
+    end_ += received_size;
+    read_ends_.push_back(end_);
+    total_size += received_size;
+  }
+  ExtractPackets(packets);
+  return total_size;
+}
+
+void H4Reader::Append(const uint8_t* data, size_t size, std::vector<H4Packet>* packets) {
+  while (size > 0) {
+    size_t chunk_size = std::min(size, buffer_.size() - end_);
+    std::memcpy(buffer_.data() + end_, data, chunk_size);
+    end_ += chunk_size;
+    read_ends_.push_back(end_);
+    data += chunk_size;
+    size -= chunk_size;
+    ExtractPackets(packets);
+  }
+}
+
+void H4Reader::ExtractPackets(std::vector<H4Packet>* packets) {
+  while (end_ - begin_ >= kH4HeaderSize) {
+    const uint8_t* packet_begin = buffer_.data() + begin_;
+    uint8_t type = packet_begin[0];
+    size_t header_size = GetHeaderSize(type);
+    if (header_size == 0) {
+      // The packet length is unknown: hand the rest of this read over as one packet of |type| for the caller to
+      // drop, and resynchronize on the next read
+      while (!read_ends_.empty() && read_ends_.front() <= begin_) {
+        read_ends_.pop_front();
+      }
+      size_t read_end = read_ends_.empty() ? end_ : read_ends_.front();
+      packets->push_back({type, HciPacket(packet_begin + kH4HeaderSize, packet_begin + (read_end - begin_))});
+      begin_ = read_end;
+      continue;
+    }
+    if (end_ - begin_ < kH4HeaderSize + header_size) {
+      break;
+    }
+    size_t packet_size = header_size + GetPayloadSize(type, packet_begin + kH4HeaderSize);
+    if (end_ - begin_ < kH4HeaderSize + packet_size) {
+      break;
+    }
+    packets->push_back(
+        {type, HciPacket(packet_begin + kH4HeaderSize, packet_begin + kH4HeaderSize + packet_size)});
+    begin_ += kH4HeaderSize + packet_size;
+  }
+
+  while (!read_ends_.empty() && read_ends_.front() <= begin_) {
+    read_ends_.pop_front();
+  }
+
+  // Keep the partial packet, if any, at the front so the rest of the buffer is free for the next read
+  if (begin_ == end_) {
+    begin_ = 0;
+    end_ = 0;
+  } else if (begin_ > 0) {
+    std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+    for (size_t& read_end : read_ends_) {
+      read_end -= begin_;
+    }
+    end_ -= begin_;
+    begin_ = 0;
+  }
+}
+
+void H4Writer::Enqueue(uint8_t type, HciPacket packet) {
+  queue_.push_back({type, std::move(packet)});
+}
+
+ssize_t H4Writer::WriteTo(int fd, size_t max_packets) {
+  max_packets = std::min({max_packets, kMaxPacketsPerWrite, queue_.size()});
+  if (max_packets == 0) {
+    return 0;
+  }
+
+  iovecs_.clear();
+  for (size_t i = 0; i < max_packets; i++) {
+    H4Packet& h4_packet = queue_[i];
+    iovecs_.push_back({&h4_packet.type, kH4HeaderSize});
+    iovecs_.push_back({h4_packet.packet.data(), h4_packet.packet.size()});
+  }
+  // Skip what a short write already sent of the front packet
+  size_t skip = front_offset_;
+  for (auto& iov : iovecs_) {
+    size_t skipped = std::min(skip, iov.iov_len);
+    iov.iov_base = static_cast<uint8_t*>(iov.iov_base) + skipped;
+    iov.iov_len -= skipped;
+    skip -= skipped;
+    if (skip == 0) {
+      break;
+    }
+  }
+
+  ssize_t bytes_written;
+  RUN_NO_INTR(bytes_written = writev(fd, iovecs_.data(), iovecs_.size()));
+  if (bytes_written <= 0) {
+    return bytes_written;
+  }
+
+  size_t remaining = front_offset_ + bytes_written;
+  while (!queue_.empty() && remaining >= kH4HeaderSize + queue_.front().packet.size()) {
+    remaining -= kH4HeaderSize + queue_.front().packet.size();
+    queue_.pop_front();
+  }
+  front_offset_ = remaining;
+  return bytes_written;
+}
+
+}  // namespace hal
+}  // namespace bluetooth
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "hal/hci_hal.h"
+
+namespace bluetooth {
+namespace hal {
+
+constexpr uint8_t kH4Command = 0x01;
+constexpr uint8_t kH4Acl = 0x02;
+constexpr uint8_t kH4Sco = 0x03;
+constexpr uint8_t kH4Event = 0x04;
+constexpr uint8_t kH4Iso = 0x05;
+
+constexpr uint8_t kH4HeaderSize = 1;
+constexpr uint8_t kHciAclHeaderSize = 4;
+constexpr uint8_t kHciScoHeaderSize = 3;
+constexpr uint8_t kHciEvtHeaderSize = 2;
+constexpr uint8_t kHciIsoHeaderSize = 4;
+
+struct H4Packet {
+  uint8_t type;
+  // HCI packet, without the H4 packet indicator
+  HciPacket packet;
+};
+
+// Splits the bytes read from an H4 transport into HCI packets. A read may carry any number of packets, and a packet
+// may be split across reads. Packets of any size allowed by the HCI length fields are accepted. An unknown packet
+// indicator is reported as a packet of that type holding the rest of the read it came in.
+class H4Reader {
+ public:
+  // Largest H4 packet: an ACL packet with a 16 bit data total length
+  static constexpr size_t kMaxPacketSize = kH4HeaderSize + kHciAclHeaderSize + 0xffff;
+
+  explicit H4Reader(size_t buffer_size = 2 * kMaxPacketSize);
+
+  // Reads from |fd| until it has nothing more to read, the buffer has no room left for a kMaxPacketSize packet, or
+  // |max_reads| reads were made, and appends every complete packet to |packets|. Only the first read may block.
+  // Returns the number of bytes read, 0 on end of file, or -1 if the first read failed.
+  ssize_t ReadFrom(int fd, size_t max_reads, std::vector<H4Packet>* packets);
+
+  // Same as ReadFrom() for bytes that are already in memory
+  void Append(const uint8_t* data, size_t size, std::vector<H4Packet>* packets);
+
+ private:
+  void ExtractPackets(std::vector<H4Packet>* packets);
+
+  std::vector<uint8_t> buffer_;
+  // Unparsed bytes are buffer_[begin_, end_)
+  size_t begin_ = 0;
+  size_t end_ = 0;
+  // Where each read of the unparsed bytes ended in buffer_
+  std::deque<size_t> read_ends_;
+};
+
+// Queues HCI packets for an H4 transport and writes several of them with each writev(). The H4 packet indicator
+// is written from its own iovec, so packets are never copied to prepend it.
+class H4Writer {
+ public:
+  // writev() accepts at most IOV_MAX (1024) iovecs, two per packet
+  static constexpr size_t kMaxPacketsPerWrite = 512;
+
+  void Enqueue(uint8_t type, HciPacket packet);
+
+  bool Empty() const {
+    return queue_.empty();
+  }
+
+  size_t Size() const {
+    return queue_.size();
+  }
+
+  // Writes up to |max_packets| queued packets to |fd| with a single writev(). Use 1 on transports which take one
+  // packet per write, such as the HCI user channel socket.
+  // Returns the writev() result.
+  ssize_t WriteTo(int fd, size_t max_packets = kMaxPacketsPerWrite);
+
+ private:
+  std::deque<H4Packet> queue_;
+  // Bytes of the front packet, counting its packet indicator, written by a previous short write
+  size_t front_offset_ = 0;
+  std::vector<struct iovec> iovecs_;
+};
+
+}  // namespace hal
+}  // namespace bluetooth
@@ -0,0 +1,196 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "hal/h4_batch_io.h"
+#include "os/utils.h"
+
+using ::benchmark::State;
+
+namespace bluetooth {
+namespace hal {
+
+// The host end of a socketpair stands in for the HCI socket, the other end for the controller
+class BM_H4Transport : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds_);
+  }
+
+  void TearDown(State& st) override {
+    close(fds_[0]);
+    close(fds_[1]);
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  // ACL data packet of range(0) bytes of payload, without the H4 packet indicator
+  static HciPacket AclPacket(State& state) {
+    HciPacket packet(state.range(0) + kHciAclHeaderSize, 0x5a);
+    packet[0] = 0x01;
+    packet[1] = 0x20;
+    packet[2] = static_cast<uint8_t>(state.range(0));
+    packet[3] = static_cast<uint8_t>(state.range(0) >> 8);
+    return packet;
+  }
+
+  // Controller sending kNumPackets ACL packets to the host, in large writes
+  std::thread StartControllerWriter(State& state) {
+    std::vector<uint8_t> stream;
+    HciPacket packet = AclPacket(state);
+    for (int i = 0; i < kNumPackets; i++) {
+      stream.push_back(kH4Acl);
+      stream.insert(stream.end(), packet.begin(), packet.end());
+    }
+    return std::thread([this, stream = std::move(stream)]() {
+      size_t offset = 0;
+      while (offset < stream.size()) {
+        ssize_t bytes_written;
+        RUN_NO_INTR(bytes_written = write(fds_[1], stream.data() + offset, stream.size() - offset));
+        if (bytes_written <= 0) {
+          return;
+        }
+        offset += bytes_written;
+      }
+    });
+  }
+
+  // Controller draining everything the host sends
+  std::thread StartControllerReader(size_t expected_size) {
+    return std::thread([this, expected_size]() {
+      std::vector<uint8_t> buf(64 * 1024);
+      size_t received = 0;
+      while (received < expected_size) {
+        ssize_t received_size;
+        RUN_NO_INTR(received_size = read(fds_[1], buf.data(), buf.size()));
+        if (received_size <= 0) {
+          return;
+        }
+        received += received_size;
+      }
+    });
+  }
+
+  // Reads exactly |size| bytes, the way the HAL reads a stream transport one packet at a time
+  bool RecvAll(uint8_t* buf, size_t size) {
+    while (size > 0) {
+      ssize_t received_size;
+      RUN_NO_INTR(received_size = recv(fds_[0], buf, size, 0));
+      if (received_size <= 0) {
+        return false;
+      }
+      buf += received_size;
+      size -= received_size;
+    }
+    return true;
+  }
+
+  void SetCounters(State& state) {
+    state.SetItemsProcessed(static_cast<int_fast64_t>(state.iterations()) * kNumPackets);
+    state.SetBytesProcessed(static_cast<int_fast64_t>(state.iterations()) * kNumPackets * state.range(0));
+  }
+
+  static constexpr int kNumPackets = 10000;
+  int fds_[2];
+};
+
+// One read for the H4 and ACL headers and one for the payload of every packet
+BENCHMARK_DEFINE_F(BM_H4Transport, receive_per_packet)(State& state) {
+  std::vector<uint8_t> buf(H4Reader::kMaxPacketSize);
+  for (auto _ : state) {
+    std::thread controller = StartControllerWriter(state);
+    for (int i = 0; i < kNumPackets; i++) {
+      RecvAll(buf.data(), kH4HeaderSize + kHciAclHeaderSize);
+      size_t payload_size = buf[3] | (buf[4] << 8);
+      RecvAll(buf.data() + kH4HeaderSize + kHciAclHeaderSize, payload_size);
+      HciPacket packet(buf.begin() + kH4HeaderSize, buf.begin() + kH4HeaderSize + kHciAclHeaderSize + payload_size);
+      benchmark::DoNotOptimize(packet);
+    }
+    controller.join();
+  }
+  SetCounters(state);
+}
+
+BENCHMARK_REGISTER_F(BM_H4Transport, receive_per_packet)->Arg(27)->Arg(251)->Arg(1021)->Arg(4096)->UseRealTime();
+
+BENCHMARK_DEFINE_F(BM_H4Transport, receive_batched)(State& state) {
+  H4Reader reader;
+  std::vector<H4Packet> packets;
+  for (auto _ : state) {
+    std::thread controller = StartControllerWriter(state);
+    size_t received = 0;
+    while (received < kNumPackets) {
+      packets.clear();
+      if (reader.ReadFrom(fds_[0], 16, &packets) <= 0) {
+        break;
+      }
+      received += packets.size();
+      benchmark::DoNotOptimize(packets);
+    }
+    controller.join();
+  }
+  SetCounters(state);
+}
+
+BENCHMARK_REGISTER_F(BM_H4Transport, receive_batched)->Arg(27)->Arg(251)->Arg(1021)->Arg(4096)->UseRealTime();
+
+// Prepends the H4 packet indicator to a copy of every packet and writes it on its own
+BENCHMARK_DEFINE_F(BM_H4Transport, transmit_per_packet)(State& state) {
+  HciPacket packet = AclPacket(state);
+  for (auto _ : state) {
+    std::thread controller = StartControllerReader(kNumPackets * (kH4HeaderSize + packet.size()));
+    for (int i = 0; i < kNumPackets; i++) {
+      HciPacket h4_packet = packet;
+      h4_packet.insert(h4_packet.cbegin(), kH4Acl);
+      ssize_t bytes_written;
+      RUN_NO_INTR(bytes_written = write(fds_[0], h4_packet.data(), h4_packet.size()));
+      benchmark::DoNotOptimize(bytes_written);
+    }
+    controller.join();
+  }
+  SetCounters(state);
+}
+
+BENCHMARK_REGISTER_F(BM_H4Transport, transmit_per_packet)->Arg(27)->Arg(251)->Arg(1021)->Arg(4096)->UseRealTime();
+
+BENCHMARK_DEFINE_F(BM_H4Transport, transmit_batched)(State& state) {
+  HciPacket packet = AclPacket(state);
+  H4Writer writer;
+  for (auto _ : state) {
+    std::thread controller = StartControllerReader(kNumPackets * (kH4HeaderSize + packet.size()));
+    for (int i = 0; i < kNumPackets; i++) {
+      writer.Enqueue(kH4Acl, packet);
+    }
+    while (!writer.Empty()) {
+      if (writer.WriteTo(fds_[0]) <= 0) {
+        break;
+      }
+    }
+    controller.join();
+  }
+  SetCounters(state);
+}
+
+BENCHMARK_REGISTER_F(BM_H4Transport, transmit_batched)->Arg(27)->Arg(251)->Arg(1021)->Arg(4096)->UseRealTime();
+
+}  // namespace hal
+}  // namespace bluetooth
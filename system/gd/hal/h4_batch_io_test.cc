@@ -0,0 +1,226 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal/h4_batch_io.h"
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <vector>
+
+namespace bluetooth {
+namespace hal {
+namespace {
+
+// H4 bytes of an ACL packet carrying |payload_size| bytes
+std::vector<uint8_t> AclH4Packet(uint16_t handle, size_t payload_size) {
+  std::vector<uint8_t> packet = {
+      kH4Acl,
+      static_cast<uint8_t>(handle),
+      static_cast<uint8_t>(handle >> 8),
+      static_cast<uint8_t>(payload_size),
+      static_cast<uint8_t>(payload_size >> 8)};
+  for (size_t i = 0; i < payload_size; i++) {
+    packet.push_back(static_cast<uint8_t>(i));
+  }
+  return packet;
+}
+
+// H4 bytes of a Command Complete event
+std::vector<uint8_t> EventH4Packet() {
+  return {kH4Event, 0x0e, 0x04, 0x01, 0x03, 0x0c, 0x00};
+}
+
+class H4BatchIoTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds_), 0);
+  }
+
+  void TearDown() override {
+    close(fds_[0]);
+    if (fds_[1] != -1) {
+      close(fds_[1]);
+    }
+  }
+
+  void WriteAll(const std::vector<uint8_t>& bytes) {
+    ASSERT_EQ(write(fds_[1], bytes.data(), bytes.size()), static_cast<ssize_t>(bytes.size()));
+  }
+
+  int fds_[2];
+};
+
+TEST_F(H4BatchIoTest, read_many_packets_at_once) {
+  std::vector<uint8_t> bytes = EventH4Packet();
+  auto acl = AclH4Packet(0x0001, 27);
+  bytes.insert(bytes.end(), acl.begin(), acl.end());
+  auto event = EventH4Packet();
+  bytes.insert(bytes.end(), event.begin(), event.end());
+  WriteAll(bytes);
+
+  H4Reader reader;
+  std::vector<H4Packet> packets;
+  ASSERT_EQ(reader.ReadFrom(fds_[0], 1, &packets), static_cast<ssize_t>(bytes.size()));
+  ASSERT_EQ(packets.size(), 3u);
+  EXPECT_EQ(packets[0].type, kH4Event);
+  EXPECT_EQ(packets[0].packet, std::vector<uint8_t>(event.begin() + 1, event.end()));
+  EXPECT_EQ(packets[1].type, kH4Acl);
+  EXPECT_EQ(packets[1].packet, std::vector<uint8_t>(acl.begin() + 1, acl.end()));
+  EXPECT_EQ(packets[2].type, kH4Event);
+}
+
+TEST_F(H4BatchIoTest, packet_split_across_reads) {
+  auto acl = AclH4Packet(0x0002, 100);
+  H4Reader reader;
+  std::vector<H4Packet> packets;
+
+  // Split within the HCI header, then within the payload
+  reader.Append(acl.data(), 3, &packets);
+  EXPECT_TRUE(packets.empty());
+  reader.Append(acl.data() + 3, 50, &packets);
+  EXPECT_TRUE(packets.empty());
+  reader.Append(acl.data() + 53, acl.size() - 53, &packets);
+  ASSERT_EQ(packets.size(), 1u);
+  EXPECT_EQ(packets[0].packet, std::vector<uint8_t>(acl.begin() + 1, acl.end()));
+}
+
+TEST_F(H4BatchIoTest, acl_larger_than_1024_bytes) {
+  auto acl = AclH4Packet(0x0003, 0xffff);
+  H4Reader reader(1024);
+  std::vector<H4Packet> packets;
+  reader.Append(acl.data(), acl.size(), &packets);
+  reader.Append(acl.data(), acl.size(), &packets);
+  ASSERT_EQ(packets.size(), 2u);
+  EXPECT_EQ(packets[0].packet.size(), kHciAclHeaderSize + 0xffffu);
+  EXPECT_EQ(packets[1].packet, std::vector<uint8_t>(acl.begin() + 1, acl.end()));
+}
+
+TEST_F(H4BatchIoTest, unknown_packet_type) {
+  int datagram_fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, datagram_fds), 0);
+  auto event = EventH4Packet();
+  std::vector<uint8_t> unknown = {0x42, 0x01, 0x02};
+  auto acl = AclH4Packet(0x0004, 27);
+  for (const auto& datagram : {event, unknown, event, acl}) {
+    ASSERT_EQ(write(datagram_fds[1], datagram.data(), datagram.size()), static_cast<ssize_t>(datagram.size()));
+  }
+
+  // Only the read carrying the unknown indicator is dropped, the packets read after it are still delivered
+  H4Reader reader;
+  std::vector<H4Packet> packets;
+  ASSERT_EQ(
+      reader.ReadFrom(datagram_fds[0], 16, &packets),
+      static_cast<ssize_t>(2 * event.size() + unknown.size() + acl.size()));
+  ASSERT_EQ(packets.size(), 4u);
+  EXPECT_EQ(packets[0].type, kH4Event);
+  EXPECT_EQ(packets[1].type, 0x42);
+  EXPECT_EQ(packets[1].packet, std::vector<uint8_t>(unknown.begin() + 1, unknown.end()));
+  EXPECT_EQ(packets[2].type, kH4Event);
+  EXPECT_EQ(packets[2].packet, std::vector<uint8_t>(event.begin() + 1, event.end()));
+  EXPECT_EQ(packets[3].type, kH4Acl);
+  EXPECT_EQ(packets[3].packet, std::vector<uint8_t>(acl.begin() + 1, acl.end()));
+  close(datagram_fds[0]);
+  close(datagram_fds[1]);
+}
+
+TEST_F(H4BatchIoTest, large_packet_after_buffer_nearly_full) {
+  int datagram_fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, datagram_fds), 0);
+  int sndbuf = 4 * H4Reader::kMaxPacketSize;
+  ASSERT_EQ(setsockopt(datagram_fds[1], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)), 0);
+
+  // The first two packets leave less room than a largest packet in the buffer
+  auto first = AclH4Packet(0x0005, 40000);
+  auto second = AclH4Packet(0x0006, 40000);
+  auto large = AclH4Packet(0x0007, 0xffff);
+  for (const auto& datagram : {first, second, large}) {
+    ASSERT_EQ(write(datagram_fds[1], datagram.data(), datagram.size()), static_cast<ssize_t>(datagram.size()));
+  }
+
+  // The large packet is left for the next call rather than truncated
+  H4Reader reader;
+  std::vector<H4Packet> packets;
+  ASSERT_EQ(reader.ReadFrom(datagram_fds[0], 16, &packets), static_cast<ssize_t>(first.size() + second.size()));
+  ASSERT_EQ(packets.size(), 2u);
+  EXPECT_EQ(packets[1].packet, std::vector<uint8_t>(second.begin() + 1, second.end()));
+
+  packets.clear();
+  ASSERT_EQ(reader.ReadFrom(datagram_fds[0], 16, &packets), static_cast<ssize_t>(large.size()));
+  ASSERT_EQ(packets.size(), 1u);
+  EXPECT_EQ(packets[0].packet, std::vector<uint8_t>(large.begin() + 1, large.end()));
+  close(datagram_fds[0]);
+  close(datagram_fds[1]);
+}
+
+TEST_F(H4BatchIoTest, read_does_not_block_after_first_read) {
+  WriteAll(EventH4Packet());
+  H4Reader reader;
+  std::vector<H4Packet> packets;
+  ASSERT_EQ(reader.ReadFrom(fds_[0], 16, &packets), static_cast<ssize_t>(EventH4Packet().size()));
+  EXPECT_EQ(packets.size(), 1u);
+}
+
+TEST_F(H4BatchIoTest, read_end_of_file) {
+  close(fds_[1]);
+  fds_[1] = -1;
+  H4Reader reader;
+  std::vector<H4Packet> packets;
+  EXPECT_EQ(reader.ReadFrom(fds_[0], 16, &packets), 0);
+}
+
+TEST_F(H4BatchIoTest, write_many_packets_at_once) {
+  H4Writer writer;
+  std::vector<uint8_t> expected;
+  for (uint16_t handle = 0; handle < 10; handle++) {
+    auto acl = AclH4Packet(handle, 27 + handle);
+    expected.insert(expected.end(), acl.begin(), acl.end());
+    writer.Enqueue(kH4Acl, HciPacket(acl.begin() + 1, acl.end()));
+  }
+  ASSERT_EQ(writer.WriteTo(fds_[1]), static_cast<ssize_t>(expected.size()));
+  EXPECT_TRUE(writer.Empty());
+
+  std::vector<uint8_t> received(expected.size());
+  ASSERT_EQ(read(fds_[0], received.data(), received.size()), static_cast<ssize_t>(expected.size()));
+  EXPECT_EQ(received, expected);
+}
+
+TEST_F(H4BatchIoTest, write_one_packet_per_datagram) {
+  int datagram_fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, datagram_fds), 0);
+  H4Writer writer;
+  auto event = EventH4Packet();
+  writer.Enqueue(kH4Event, HciPacket(event.begin() + 1, event.end()));
+  writer.Enqueue(kH4Event, HciPacket(event.begin() + 1, event.end()));
+
+  ASSERT_EQ(writer.WriteTo(datagram_fds[1], 1), static_cast<ssize_t>(event.size()));
+  EXPECT_EQ(writer.Size(), 1u);
+  ASSERT_EQ(writer.WriteTo(datagram_fds[1], 1), static_cast<ssize_t>(event.size()));
+  EXPECT_TRUE(writer.Empty());
+
+  // Each datagram holds exactly one packet, and the reader drains both in one call
+  H4Reader reader;
+  std::vector<H4Packet> packets;
+  ASSERT_EQ(reader.ReadFrom(datagram_fds[0], 16, &packets), static_cast<ssize_t>(2 * event.size()));
+  EXPECT_EQ(packets.size(), 2u);
+  close(datagram_fds[0]);
+  close(datagram_fds[1]);
+}
+
+}  // namespace
+}  // namespace hal
+}  // namespace bluetooth
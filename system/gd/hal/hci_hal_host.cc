@@ -25,10 +25,12 @@
 
 #include <chrono>
 #include <csignal>
+#include <memory>
 #include <mutex>
 #include <queue>
 
 #include "common/init_flags.h"
+#include "hal/h4_batch_io.h"
 #include "hal/hci_hal.h"
 #include "hal/link_clocker.h"
 #include "hal/mgmt.h"
@@ -36,24 +38,19 @@
 #include "metrics/counter_metrics.h"
 #include "os/log.h"
 #include "os/reactor.h"
+#include "os/system_properties.h"
 #include "os/thread.h"
 
 namespace {
 constexpr int INVALID_FD = -1;
 
-constexpr uint8_t kH4Command = 0x01;
-constexpr uint8_t kH4Acl = 0x02;
-constexpr uint8_t kH4Sco = 0x03;
-constexpr uint8_t kH4Event = 0x04;
-constexpr uint8_t kH4Iso = 0x05;
-
-constexpr uint8_t kH4HeaderSize = 1;
-constexpr uint8_t kHciAclHeaderSize = 4;
-constexpr uint8_t kHciScoHeaderSize = 3;
-constexpr uint8_t kHciEvtHeaderSize = 2;
-constexpr uint8_t kHciIsoHeaderSize = 4;
 constexpr int kBufSize = 1024 + 4 + 1;  // DeviceProperties::acl_data_packet_size_ + ACL header + H4 header
 
+constexpr bool kDefaultBatchedIoEnabled = false;
+constexpr char kPropertyBatchedIoEnabled[] = "bluetooth.core.hal.batched_io.enabled";
+// Reads made per reactor wakeup in batched mode. The HCI user channel returns one packet per read.
+constexpr size_t kMaxReadsPerWakeup = 16;
+
 constexpr uint8_t BTPROTO_HCI = 1;
 constexpr uint16_t HCI_CHANNEL_USER = 1;
 constexpr uint16_t HCI_CHANNEL_CONTROL = 3;
@@ -248,8 +245,7 @@ class HciHalHost : public HciHal {
     ASSERT(sock_fd_ != INVALID_FD);
     std::vector<uint8_t> packet = std::move(command);
     btsnoop_logger_->Capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::CMD);
-    packet.insert(packet.cbegin(), kH4Command);
-    write_to_fd(packet);
+    write_to_fd(kH4Command, std::move(packet));
   }
 
   void sendAclData(HciPacket data) override {
@@ -257,8 +253,7 @@ class HciHalHost : public HciHal {
     ASSERT(sock_fd_ != INVALID_FD);
     std::vector<uint8_t> packet = std::move(data);
     btsnoop_logger_->Capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::ACL);
-    packet.insert(packet.cbegin(), kH4Acl);
-    write_to_fd(packet);
+    write_to_fd(kH4Acl, std::move(packet));
   }
 
   void sendScoData(HciPacket data) override {
@@ -266,8 +261,7 @@ class HciHalHost : public HciHal {
     ASSERT(sock_fd_ != INVALID_FD);
     std::vector<uint8_t> packet = std::move(data);
     btsnoop_logger_->Capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::SCO);
-    packet.insert(packet.cbegin(), kH4Sco);
-    write_to_fd(packet);
+    write_to_fd(kH4Sco, std::move(packet));
   }
 
   void sendIsoData(HciPacket data) override {
@@ -275,8 +269,7 @@ class HciHalHost : public HciHal {
     ASSERT(sock_fd_ != INVALID_FD);
     std::vector<uint8_t> packet = std::move(data);
     btsnoop_logger_->Capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::ISO);
-    packet.insert(packet.cbegin(), kH4Iso);
-    write_to_fd(packet);
+    write_to_fd(kH4Iso, std::move(packet));
   }
 
   uint16_t getMsftOpcode() override {
@@ -302,6 +295,16 @@ class HciHalHost : public HciHal {
       return;
     }
 
+    batched_io_enabled_ = os::GetSystemPropertyBool(kPropertyBatchedIoEnabled, kDefaultBatchedIoEnabled);
+    if (batched_io_enabled_) {
+      int socket_type = 0;
+      socklen_t socket_type_size = sizeof(socket_type);
+      getsockopt(sock_fd_, SOL_SOCKET, SO_TYPE, &socket_type, &socket_type_size);
+      // Packets written together on a datagram socket would reach the controller as a single packet
+      max_packets_per_write_ = socket_type == SOCK_STREAM ? H4Writer::kMaxPacketsPerWrite : 1;
+      h4_reader_ = std::make_unique<H4Reader>();
+    }
+
     reactable_ = hci_incoming_thread_.GetReactor()->Register(
         sock_fd_,
         common::Bind(&HciHalHost::incoming_packet_received, common::Unretained(this)),
@@ -350,9 +353,26 @@ class HciHalHost : public HciHal {
   SnoopLogger* btsnoop_logger_ = nullptr;
   LinkClocker* link_clocker_ = nullptr;
 
-  void write_to_fd(HciPacket packet) {
+  // Batched I/O: many packets per syscall, no copies to add or strip the H4 packet indicator, and no limit on the
+  // ACL packet size
+  bool batched_io_enabled_ = false;
+  size_t max_packets_per_write_ = 1;
+  H4Writer h4_writer_;
+  std::unique_ptr<H4Reader> h4_reader_;
+  // Reused across reads so its capacity is kept
+  std::vector<H4Packet> incoming_packets_;
+
+  void write_to_fd(uint8_t type, HciPacket packet) {
+    if (batched_io_enabled_) {
+      h4_writer_.Enqueue(type, std::move(packet));
+      if (h4_writer_.Size() == 1) {
+        hci_incoming_thread_.GetReactor()->ModifyRegistration(reactable_, os::Reactor::REACT_ON_READ_WRITE);
+      }
+      return;
+    }
     // TODO: replace this with new queue when it's ready
-    hci_outgoing_queue_.emplace(packet);
+    packet.insert(packet.cbegin(), type);
+    hci_outgoing_queue_.emplace(std::move(packet));
     if (hci_outgoing_queue_.size() == 1) {
       hci_incoming_thread_.GetReactor()->ModifyRegistration(reactable_, os::Reactor::REACT_ON_READ_WRITE);
     }
@@ -360,6 +380,10 @@ class HciHalHost : public HciHal {
 
   void send_packet_ready() {
     std::lock_guard<std::mutex> lock(api_mutex_);
+    if (batched_io_enabled_) {
+      send_packets_batched();
+      return;
+    }
     if (hci_outgoing_queue_.empty()) return;
     auto packet_to_send = hci_outgoing_queue_.front();
     auto bytes_written = write(sock_fd_, (void*)packet_to_send.data(), packet_to_send.size());
@@ -372,6 +396,80 @@ class HciHalHost : public HciHal {
     }
   }
 
+  void send_packets_batched() {
+    if (h4_writer_.Empty()) return;
+    if (h4_writer_.WriteTo(sock_fd_, max_packets_per_write_) == -1) {
+      abort();
+    }
+    if (h4_writer_.Empty()) {
+      hci_incoming_thread_.GetReactor()->ModifyRegistration(reactable_, os::Reactor::REACT_ON_READ_ONLY);
+    }
+  }
+
+  void incoming_packets_received_batched() {
+    incoming_packets_.clear();
+    ssize_t received_size = h4_reader_->ReadFrom(sock_fd_, kMaxReadsPerWakeup, &incoming_packets_);
+
+    // we don't want crash when the chipset is broken.
+    if (received_size == -1) {
+      LOG_ERROR("Can't receive from socket: %s", strerror(errno));
+      close(sock_fd_);
+      raise(SIGINT);
+      return;
+    }
+
+    if (received_size == 0) {
+      LOG_WARN("Can't read H4 header. EOF received");
+      // First close sock fd before raising sigint
+      close(sock_fd_);
+      raise(SIGINT);
+      return;
+    }
+
+    for (auto& h4_packet : incoming_packets_) {
+      switch (h4_packet.type) {
+        case kH4Event:
+          link_clocker_->OnHciEvent(h4_packet.packet);
+          btsnoop_logger_->Capture(h4_packet.packet, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::EVT);
+          break;
+        case kH4Acl:
+          link_clocker_->OnAclDataReceived(h4_packet.packet);
+          btsnoop_logger_->Capture(h4_packet.packet, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::ACL);
+          break;
+        case kH4Sco:
+          btsnoop_logger_->Capture(h4_packet.packet, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::SCO);
+          break;
+        case kH4Iso:
+          btsnoop_logger_->Capture(h4_packet.packet, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::ISO);
+          break;
+        default:
+          LOG_WARN(
+              "Dropping %zu bytes after unexpected packet type 0x%02hhx", h4_packet.packet.size(), h4_packet.type);
+          continue;
+      }
+
+      std::lock_guard<std::mutex> incoming_packet_callback_lock(incoming_packet_callback_mutex_);
+      if (incoming_packet_callback_ == nullptr) {
+        LOG_INFO("Dropping a packet after processing");
+        return;
+      }
+      switch (h4_packet.type) {
+        case kH4Event:
+          incoming_packet_callback_->hciEventReceived(std::move(h4_packet.packet));
+          break;
+        case kH4Acl:
+          incoming_packet_callback_->aclDataReceived(std::move(h4_packet.packet));
+          break;
+        case kH4Sco:
+          incoming_packet_callback_->scoDataReceived(std::move(h4_packet.packet));
+          break;
+        case kH4Iso:
+          incoming_packet_callback_->isoDataReceived(std::move(h4_packet.packet));
+          break;
+      }
+    }
+  }
+
   void incoming_packet_received() {
     {
       std::lock_guard<std::mutex> incoming_packet_callback_lock(incoming_packet_callback_mutex_);
@@ -380,6 +478,10 @@ class HciHalHost : public HciHal {
         return;
       }
     }
+    if (batched_io_enabled_) {
+      incoming_packets_received_batched();
+      return;
+    }
     uint8_t buf[kBufSize] = {};
 
     ssize_t received_size;
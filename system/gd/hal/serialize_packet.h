@@ -25,10 +25,8 @@ namespace bluetooth {
 namespace hal {
 
 inline std::vector<uint8_t> SerializePacket(std::unique_ptr<packet::BasePacketBuilder> packet) {
-  std::vector<uint8_t> packet_bytes;
-  packet_bytes.reserve(packet->size());
-  packet::BitInserter it(packet_bytes);
-  packet->Serialize(it);
+  std::vector<uint8_t> packet_bytes(packet->size());
+  packet_bytes.resize(packet->SerializeInto(packet_bytes));
   return packet_bytes;
 }
 
@@ -17,11 +17,14 @@
 #include "hal/snoop_logger.h"
 
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <bitset>
 #include <chrono>
+#include <cinttypes>
 #include <sstream>
 
 #include "common/circular_buffer.h"
@@ -301,6 +304,11 @@ constexpr size_t kDefaultBtSnoozMaxPayloadBytesPerPacket =
 using namespace std::chrono_literals;
 constexpr std::chrono::hours kBtSnoozLogLifeTime = 12h;
 constexpr std::chrono::hours kBtSnoozLogDeleteRepeatingAlarmInterval = 1h;
+// Asynchronous capture buffers up to 1 MB of records, enough for several
+// hundred milliseconds of saturated ACL traffic, and writes them out at least
+// every 100 ms.
+constexpr size_t kBtSnoopAsyncRingBytes = 1024 * 1024;
+constexpr std::chrono::milliseconds kBtSnoopAsyncFlushInterval = 100ms;
 
 std::mutex filter_tracker_list_mutex;
 std::unordered_map<uint16_t, FilterTracker> filter_tracker_list;
@@ -437,6 +445,8 @@ const std::string SnoopLogger::kIsDebuggableProperty = "ro.debuggable";
 const std::string SnoopLogger::kBtSnoopLogModeProperty = "persist.bluetooth.btsnooplogmode";
 const std::string SnoopLogger::kBtSnoopDefaultLogModeProperty = "persist.bluetooth.btsnoopdefaultmode";
 const std::string SnoopLogger::kBtSnoopLogPersists = "persist.bluetooth.btsnooplogpersists";
+// Writes btsnoop records from a dedicated thread instead of the capturing one
+const std::string SnoopLogger::kBtSnoopLogAsyncProperty = "persist.bluetooth.btsnooplogasync";
 // Truncates ACL packets (non-fragment) to fixed (MAX_HCI_ACL_LEN) number of bytes
 const std::string SnoopLogger::kBtSnoopLogFilterHeadersProperty =
     "persist.bluetooth.snooplogfilter.headers.enabled";
@@ -486,7 +496,8 @@ SnoopLogger::SnoopLogger(
     bool qualcomm_debug_log_enabled,
     const std::chrono::milliseconds snooz_log_life_time,
     const std::chrono::milliseconds snooz_log_delete_alarm_interval,
-    bool snoop_log_persists)
+    bool snoop_log_persists,
+    bool async_capture_enabled)
     : snoop_log_path_(std::move(snoop_log_path)),
       snooz_log_path_(std::move(snooz_log_path)),
       max_packets_per_file_(max_packets_per_file),
@@ -494,7 +505,8 @@ SnoopLogger::SnoopLogger(
       qualcomm_debug_log_enabled_(qualcomm_debug_log_enabled),
       snooz_log_life_time_(snooz_log_life_time),
       snooz_log_delete_alarm_interval_(snooz_log_delete_alarm_interval),
-      snoop_log_persists(snoop_log_persists) {
+      snoop_log_persists(snoop_log_persists),
+      async_capture_enabled_(async_capture_enabled) {
   btsnoop_mode_ = btsnoop_mode;
 
   if (btsnoop_mode_ == kBtSnoopLogModeFiltered) {
@@ -527,6 +539,12 @@ SnoopLogger::SnoopLogger(
 
 void SnoopLogger::CloseCurrentSnoopLogFile() {
   std::lock_guard<std::recursive_mutex> lock(file_mutex_);
+  if (btsnoop_fd_ >= 0) {
+    // Hand everything still buffered to the file before closing it
+    async_writer_->SetFd(-1);
+    close(btsnoop_fd_);
+    btsnoop_fd_ = -1;
+  }
   if (btsnoop_ostream_.is_open()) {
     btsnoop_ostream_.flush();
     btsnoop_ostream_.close();
@@ -552,6 +570,24 @@ void SnoopLogger::OpenNextSnoopLogFile() {
   }
 
   mode_t prevmask = umask(0);
+  if (async_writer_ != nullptr) {
+    // do not use O_APPEND as we want override the existing file
+    btsnoop_fd_ = open(snoop_log_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+#ifdef USE_FAKE_TIMERS
+    file_creation_time = fake_timerfd_get_clock();
+#endif
+    if (btsnoop_fd_ < 0) {
+      LOG_ALWAYS_FATAL("Unable to open snoop log at \"%s\", error: \"%s\"", snoop_log_path_.c_str(), strerror(errno));
+    }
+    umask(prevmask);
+    if (TEMP_FAILURE_RETRY(write(
+            btsnoop_fd_, &SnoopLoggerCommon::kBtSnoopFileHeader, sizeof(SnoopLoggerCommon::FileHeaderType))) !=
+        sizeof(SnoopLoggerCommon::FileHeaderType)) {
+      LOG_ALWAYS_FATAL("Unable to write file header to \"%s\", error: \"%s\"", snoop_log_path_.c_str(), strerror(errno));
+    }
+    async_writer_->SetFd(btsnoop_fd_);
+    return;
+  }
   // do not use std::ios::app as we want override the existing file
   btsnoop_ostream_.open(snoop_log_path_, std::ios::binary | std::ios::out);
 #ifdef USE_FAKE_TIMERS
@@ -1247,6 +1283,19 @@ void SnoopLogger::Capture(HciPacket& packet, Direction direction, PacketType typ
     if (packet_counter_ > max_packets_per_file_) {
       OpenNextSnoopLogFile();
     }
+
+    if (async_writer_ != nullptr) {
+      // The record is copied and written out by the writer thread, report
+      // the cumulative number of records it had to drop so far.
+      header.dropped_packets = htonl(async_writer_->GetDroppedPackets());
+      async_writer_->Enqueue(&header, sizeof(PacketHeaderType), packet.data(), length - 1);
+      if (socket_ != nullptr) {
+        socket_->Write(&header, sizeof(PacketHeaderType));
+        socket_->Write(packet.data(), (size_t)(length - 1));
+      }
+      return;
+    }
+
     if (!btsnoop_ostream_.write(reinterpret_cast<const char*>(&header), sizeof(PacketHeaderType))) {
       LOG_ERROR("Failed to write packet header for btsnoop, error: \"%s\"", strerror(errno));
     }
@@ -1318,6 +1367,11 @@ void SnoopLogger::ListDependencies(ModuleList* /* list */) const {
 void SnoopLogger::Start() {
   std::lock_guard<std::recursive_mutex> lock(file_mutex_);
   if (btsnoop_mode_ != kBtSnoopLogModeDisabled) {
+    if (async_capture_enabled_) {
+      LOG_INFO("Snoop Logs asynchronous capture enabled");
+      async_writer_ = std::make_unique<SnoopLoggerAsyncWriter>(kBtSnoopAsyncRingBytes, kBtSnoopAsyncFlushInterval);
+      async_writer_->Start(-1);
+    }
     OpenNextSnoopLogFile();
 
     if (btsnoop_mode_ == kBtSnoopLogModeFiltered) {
@@ -1347,6 +1401,11 @@ void SnoopLogger::Stop() {
   LOG_DEBUG("Closing btsnoop log data at %s", snoop_log_path_.c_str());
   CloseCurrentSnoopLogFile();
 
+  if (async_writer_ != nullptr) {
+    async_writer_->Stop();
+    async_writer_.reset();
+  }
+
   if (snoop_logger_socket_thread_ != nullptr) {
     snoop_logger_socket_thread_->Stop();
     snoop_logger_socket_thread_.reset();
@@ -1374,6 +1433,21 @@ DumpsysDataFinisher SnoopLogger::GetDumpsysData(
   return EmptyDumpsysDataFinisher;
 }
 
+void SnoopLogger::GetDumpsysData(int fd) const {
+  std::lock_guard<std::recursive_mutex> lock(file_mutex_);
+  if (async_writer_ == nullptr) {
+    return;
+  }
+  auto stats = async_writer_->GetStats();
+  dprintf(fd, "SnoopLogger asynchronous capture:\n");
+  dprintf(fd, "  packets enqueued: %" PRIu64 "\n", stats.packets_enqueued);
+  dprintf(fd, "  packets dropped: %" PRIu64 "\n", stats.packets_dropped);
+  dprintf(fd, "  bytes written: %" PRIu64 "\n", stats.bytes_written);
+  dprintf(fd, "  write calls: %" PRIu64 " errors: %" PRIu64 "\n", stats.write_calls, stats.write_errors);
+  dprintf(
+      fd, "  ring high water: %zu / %zu bytes\n", stats.ring_high_water_bytes, stats.ring_capacity_bytes);
+}
+
 size_t SnoopLogger::GetMaxPacketsPerFile() {
   // Allow override max packet per file via system property
   auto max_packets_per_file = kDefaultBtSnoopMaxPacketsPerFile;
@@ -1444,6 +1518,10 @@ bool SnoopLogger::IsBtSnoopLogPersisted() {
   return is_debuggable && os::GetSystemPropertyBool(kBtSnoopLogPersists, false);
 }
 
+bool SnoopLogger::IsBtSnoopLogAsyncEnabled() {
+  return os::GetSystemPropertyBool(kBtSnoopLogAsyncProperty, false);
+}
+
 bool SnoopLogger::IsQualcommDebugLogEnabled() {
   // Check system prop if the soc manufacturer is Qualcomm
   bool qualcomm_debug_log_enabled = false;
@@ -1465,7 +1543,8 @@ const ModuleFactory SnoopLogger::Factory = ModuleFactory([]() {
       IsQualcommDebugLogEnabled(),
       kBtSnoozLogLifeTime,
       kBtSnoozLogDeleteRepeatingAlarmInterval,
-      IsBtSnoopLogPersisted());
+      IsBtSnoopLogPersisted(),
+      IsBtSnoopLogAsyncEnabled());
 });
 
 }  // namespace hal
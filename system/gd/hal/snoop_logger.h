@@ -24,6 +24,7 @@
 
 #include "common/circular_buffer.h"
 #include "hal/hci_hal.h"
+#include "hal/snoop_logger_async_writer.h"
 #include "hal/snoop_logger_socket_interface.h"
 #include "hal/snoop_logger_socket_thread.h"
 #include "hal/syscall_wrapper_impl.h"
@@ -145,6 +146,7 @@ class SnoopLogger : public ::bluetooth::Module {
   static const std::string kIsDebuggableProperty;
   static const std::string kBtSnoopLogModeProperty;
   static const std::string kBtSnoopLogPersists;
+  static const std::string kBtSnoopLogAsyncProperty;
   static const std::string kBtSnoopDefaultLogModeProperty;
   static const std::string kBtSnoopLogFilterHeadersProperty;
   static const std::string kBtSnoopLogFilterProfileA2dpProperty;
@@ -207,6 +209,11 @@ class SnoopLogger : public ::bluetooth::Module {
   // Returns whether snoop log persists even after restarting Bluetooth
   static bool IsBtSnoopLogPersisted();
 
+  // Returns whether btsnoop records are written from a dedicated thread
+  // instead of the capturing thread
+  // Changes to this value is only effective after restarting Bluetooth
+  static bool IsBtSnoopLogAsyncEnabled();
+
   // Has to be defined from 1 to 4 per btsnoop format
   enum PacketType {
     CMD = 1,
@@ -275,6 +282,7 @@ class SnoopLogger : public ::bluetooth::Module {
   void Start() override;
   void Stop() override;
   DumpsysDataFinisher GetDumpsysData(flatbuffers::FlatBufferBuilder* builder) const override;
+  void GetDumpsysData(int fd) const override;
   std::string ToString() const override {
     return std::string("SnoopLogger");
   }
@@ -288,7 +296,8 @@ class SnoopLogger : public ::bluetooth::Module {
       bool qualcomm_debug_log_enabled,
       const std::chrono::milliseconds snooz_log_life_time,
       const std::chrono::milliseconds snooz_log_delete_alarm_interval,
-      bool snoop_log_persists);
+      bool snoop_log_persists,
+      bool async_capture_enabled = false);
   void CloseCurrentSnoopLogFile();
   void OpenNextSnoopLogFile();
   void DumpSnoozLogToFile(const std::vector<std::string>& data) const;
@@ -332,12 +341,16 @@ class SnoopLogger : public ::bluetooth::Module {
       PacketHeaderType header);
 
   std::unique_ptr<SnoopLoggerSocketThread> snoop_logger_socket_thread_;
+  // Only set when asynchronous capture is enabled and btsnoop is not disabled
+  std::unique_ptr<SnoopLoggerAsyncWriter> async_writer_;
 
  private:
   static std::string btsnoop_mode_;
   std::string snoop_log_path_;
   std::string snooz_log_path_;
   std::ofstream btsnoop_ostream_;
+  // Output of |async_writer_|, replaces |btsnoop_ostream_| in asynchronous mode
+  int btsnoop_fd_ = -1;
   size_t max_packets_per_file_;
   common::CircularBuffer<std::string> btsnooz_buffer_;
   bool qualcomm_debug_log_enabled_ = false;
@@ -349,6 +362,7 @@ class SnoopLogger : public ::bluetooth::Module {
   SnoopLoggerSocketInterface* socket_;
   SyscallWrapperImpl syscall_if;
   bool snoop_log_persists = false;
+  bool async_capture_enabled_ = false;
 };
 
 }  // namespace hal
@@ -0,0 +1,212 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal/snoop_logger_async_writer.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+
+#include "os/log.h"
+
+namespace bluetooth {
+namespace hal {
+
+SnoopLoggerAsyncWriter::SnoopLoggerAsyncWriter(size_t ring_capacity_bytes, std::chrono::milliseconds flush_interval)
+    : capacity_(ring_capacity_bytes),
+      // Wake up the writer early once the ring is half full, leaving the other
+      // half to absorb bursts while it catches up.
+      high_watermark_(ring_capacity_bytes / 2),
+      flush_interval_(flush_interval),
+      ring_(std::make_unique<uint8_t[]>(ring_capacity_bytes)) {}
+
+SnoopLoggerAsyncWriter::~SnoopLoggerAsyncWriter() {
+  Stop();
+}
+
+void SnoopLoggerAsyncWriter::Start(int fd) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ASSERT(writer_thread_ == nullptr);
+  fd_ = fd;
+  stop_ = false;
+  wakeup_pending_ = false;
+  packets_enqueued_ = 0;
+  packets_dropped_ = 0;
+  bytes_written_ = 0;
+  write_calls_ = 0;
+  write_errors_ = 0;
+  ring_high_water_ = 0;
+  writer_thread_ = std::make_unique<std::thread>(&SnoopLoggerAsyncWriter::Run, this);
+}
+
+void SnoopLoggerAsyncWriter::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (writer_thread_ == nullptr) {
+      return;
+    }
+    stop_ = true;
+    wakeup_cv_.notify_one();
+  }
+  writer_thread_->join();
+  writer_thread_.reset();
+}
+
+void SnoopLoggerAsyncWriter::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (writer_thread_ == nullptr) {
+    Drain(fd_);
+    return;
+  }
+  uint64_t target = ++flush_requested_;
+  wakeup_cv_.notify_one();
+  drained_cv_.wait(lock, [this, target] { return flushed_ >= target; });
+}
+
+void SnoopLoggerAsyncWriter::SetFd(int fd) {
+  Flush();
+  std::lock_guard<std::mutex> lock(mutex_);
+  fd_ = fd;
+}
+
+bool SnoopLoggerAsyncWriter::Enqueue(
+    const void* header, size_t header_length, const void* payload, size_t payload_length) {
+  const size_t length = header_length + payload_length;
+  const uint64_t head = head_.load(std::memory_order_relaxed);
+  const size_t used = head - tail_.load(std::memory_order_acquire);
+  if (length > capacity_ - used) {
+    packets_dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  auto copy = [this](uint64_t position, const void* data, size_t size) {
+    const size_t offset = position % capacity_;
+    const size_t first = std::min(size, capacity_ - offset);
+    memcpy(ring_.get() + offset, data, first);
+    memcpy(ring_.get(), static_cast<const uint8_t*>(data) + first, size - first);
+  };
+  copy(head, header, header_length);
+  copy(head + header_length, payload, payload_length);
+  head_.store(head + length, std::memory_order_release);
+  packets_enqueued_.fetch_add(1, std::memory_order_relaxed);
+
+  const size_t new_used = used + length;
+  if (new_used > ring_high_water_.load(std::memory_order_relaxed)) {
+    ring_high_water_.store(new_used, std::memory_order_relaxed);
+  }
+
+  // Only signal on the transition above the watermark, the periodic flush
+  // takes care of everything else.
+  if (used < high_watermark_ && new_used >= high_watermark_) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wakeup_pending_ = true;
+    wakeup_cv_.notify_one();
+  }
+  return true;
+}
+
+uint32_t SnoopLoggerAsyncWriter::GetDroppedPackets() const {
+  return static_cast<uint32_t>(packets_dropped_.load(std::memory_order_relaxed));
+}
+
+SnoopLoggerAsyncWriter::Stats SnoopLoggerAsyncWriter::GetStats() const {
+  return Stats{
+      .packets_enqueued = packets_enqueued_.load(),
+      .packets_dropped = packets_dropped_.load(),
+      .bytes_written = bytes_written_.load(),
+      .write_calls = write_calls_.load(),
+      .write_errors = write_errors_.load(),
+      .ring_high_water_bytes = ring_high_water_.load(),
+      .ring_capacity_bytes = capacity_,
+  };
+}
+
+void SnoopLoggerAsyncWriter::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    wakeup_cv_.wait_for(
+        lock, flush_interval_, [this] { return wakeup_pending_ || stop_ || flush_requested_ != flushed_; });
+    wakeup_pending_ = false;
+    const uint64_t flush_target = flush_requested_;
+    const int fd = fd_;
+    const bool stop = stop_;
+
+    lock.unlock();
+    Drain(fd);
+    lock.lock();
+
+    flushed_ = flush_target;
+    drained_cv_.notify_all();
+    if (stop) {
+      break;
+    }
+  }
+}
+
+bool SnoopLoggerAsyncWriter::Drain(int fd) {
+  const uint64_t tail = tail_.load(std::memory_order_relaxed);
+  const uint64_t head = head_.load(std::memory_order_acquire);
+  if (head == tail) {
+    return false;
+  }
+
+  // Everything pending is at most two contiguous spans of the ring
+  size_t remaining = head - tail;
+  const size_t offset = tail % capacity_;
+  const size_t first = std::min(remaining, capacity_ - offset);
+  struct iovec iov[2] = {
+      {.iov_base = ring_.get() + offset, .iov_len = first},
+      {.iov_base = ring_.get(), .iov_len = remaining - first},
+  };
+  struct iovec* next = iov;
+  int iovcnt = (remaining > first) ? 2 : 1;
+
+  while (fd >= 0 && remaining > 0) {
+    ssize_t written = writev(fd, next, iovcnt);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG_ERROR("Failed to write snoop log records, error: \"%s\"", strerror(errno));
+      write_errors_.fetch_add(1, std::memory_order_relaxed);
+      break;
+    }
+    write_calls_.fetch_add(1, std::memory_order_relaxed);
+    bytes_written_.fetch_add(written, std::memory_order_relaxed);
+    remaining -= written;
+
+    // Skip over what a partial write consumed
+    while (iovcnt > 0 && static_cast<size_t>(written) >= next->iov_len) {
+      written -= next->iov_len;
+      next++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      next->iov_base = static_cast<uint8_t*>(next->iov_base) + written;
+      next->iov_len -= written;
+    }
+  }
+
+  // Records that could not be written are discarded, the producer must never
+  // be blocked on a broken log file.
+  tail_.store(head, std::memory_order_release);
+  return true;
+}
+
+}  // namespace hal
+}  // namespace bluetooth
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace bluetooth {
+namespace hal {
+
+// Moves btsnoop records off the capture path.
+//
+// Records are copied into a preallocated byte ring and written to the log
+// file by a dedicated thread, which batches everything pending into a single
+// writev() call. The thread is woken up when the ring fills past its high
+// watermark, and otherwise drains it at least once per flush interval.
+//
+// The ring is lock free between one producer and the writer thread: callers
+// of Enqueue() must be serialized externally. Records that do not fit into
+// the ring are dropped and counted rather than blocking the producer.
+class SnoopLoggerAsyncWriter {
+ public:
+  struct Stats {
+    uint64_t packets_enqueued;
+    uint64_t packets_dropped;
+    uint64_t bytes_written;
+    uint64_t write_calls;
+    uint64_t write_errors;
+    size_t ring_high_water_bytes;
+    size_t ring_capacity_bytes;
+  };
+
+  SnoopLoggerAsyncWriter(size_t ring_capacity_bytes, std::chrono::milliseconds flush_interval);
+  SnoopLoggerAsyncWriter(const SnoopLoggerAsyncWriter&) = delete;
+  SnoopLoggerAsyncWriter& operator=(const SnoopLoggerAsyncWriter&) = delete;
+  ~SnoopLoggerAsyncWriter();
+
+  // Starts the writer thread appending to |fd|. Ownership of |fd| stays with
+  // the caller.
+  void Start(int fd);
+
+  // Writes out everything pending and stops the writer thread.
+  void Stop();
+
+  // Blocks until every record enqueued so far has been handed to the kernel.
+  void Flush();
+
+  // Switches the output to |fd| once every pending record has been written to
+  // the previous one.
+  void SetFd(int fd);
+
+  // Appends one record made of |header| followed by |payload|. Returns false
+  // if the record was dropped because the ring is full.
+  bool Enqueue(const void* header, size_t header_length, const void* payload, size_t payload_length);
+
+  // Number of records dropped since Start(), used to fill in the btsnoop
+  // cumulative drops field.
+  uint32_t GetDroppedPackets() const;
+
+  Stats GetStats() const;
+
+ private:
+  void Run();
+  // Writes everything between |tail_| and |head_| to |fd|, returns false if
+  // the ring was empty.
+  bool Drain(int fd);
+
+  const size_t capacity_;
+  const size_t high_watermark_;
+  const std::chrono::milliseconds flush_interval_;
+  std::unique_ptr<uint8_t[]> ring_;
+
+  // Monotonic byte positions, the ring offset is position % capacity_.
+  std::atomic<uint64_t> head_{0};
+  std::atomic<uint64_t> tail_{0};
+
+  std::atomic<uint64_t> packets_enqueued_{0};
+  std::atomic<uint64_t> packets_dropped_{0};
+  std::atomic<uint64_t> bytes_written_{0};
+  std::atomic<uint64_t> write_calls_{0};
+  std::atomic<uint64_t> write_errors_{0};
+  std::atomic<size_t> ring_high_water_{0};
+
+  // Only used to park and wake up the writer thread, never held while
+  // copying records.
+  std::mutex mutex_;
+  std::condition_variable wakeup_cv_;
+  std::condition_variable drained_cv_;
+  bool wakeup_pending_ = false;
+  bool stop_ = false;
+  uint64_t flush_requested_ = 0;
+  uint64_t flushed_ = 0;
+  int fd_ = -1;
+
+  std::unique_ptr<std::thread> writer_thread_;
+};
+
+}  // namespace hal
+}  // namespace bluetooth
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filesystem>
+
+#include "benchmark/benchmark.h"
+#include "hal/snoop_logger.h"
+#include "module.h"
+
+using ::benchmark::State;
+using namespace std::chrono_literals;
+
+namespace bluetooth {
+namespace hal {
+
+// Expose protected constructor for benchmark
+class BenchmarkSnoopLoggerModule : public SnoopLogger {
+ public:
+  BenchmarkSnoopLoggerModule(std::string snoop_log_path, std::string snooz_log_path, bool async_capture_enabled)
+      : SnoopLogger(
+            std::move(snoop_log_path),
+            std::move(snooz_log_path),
+            /* max_packets_per_file */ 1000000,
+            SnoopLogger::GetMaxPacketsPerBuffer(),
+            SnoopLogger::kBtSnoopLogModeFull,
+            false,
+            1h,
+            1h,
+            false,
+            async_capture_enabled) {}
+
+  uint64_t GetDroppedPackets() const {
+    return async_writer_ == nullptr ? 0 : async_writer_->GetStats().packets_dropped;
+  }
+};
+
+class BM_SnoopLoggerCapture : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    const std::filesystem::path temp_dir = std::filesystem::temp_directory_path();
+    snoop_log_path_ = temp_dir / "bm_btsnoop_hci.log";
+    snooz_log_path_ = temp_dir / "bm_btsnooz_hci.log";
+  }
+
+  void TearDown(State& st) override {
+    std::filesystem::remove(snoop_log_path_);
+    std::filesystem::remove(snoop_log_path_.string() + ".last");
+    std::filesystem::remove(snooz_log_path_);
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  void CapturePackets(State& state, bool async_capture_enabled) {
+    // ACL data packet of range(0) bytes of payload
+    HciPacket packet(state.range(0) + 4, 0x5a);
+    packet[0] = 0x01;
+    packet[1] = 0x20;
+    packet[2] = static_cast<uint8_t>(state.range(0));
+    packet[3] = static_cast<uint8_t>(state.range(0) >> 8);
+
+    uint64_t dropped = 0;
+    for (auto _ : state) {
+      TestModuleRegistry registry;
+      auto* snoop_logger =
+          new BenchmarkSnoopLoggerModule(snoop_log_path_.string(), snooz_log_path_.string(), async_capture_enabled);
+      registry.InjectTestModule(&SnoopLogger::Factory, snoop_logger);
+      for (int i = 0; i < kNumPackets; i++) {
+        HciPacket copy = packet;
+        snoop_logger->Capture(copy, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::ACL);
+      }
+      dropped += snoop_logger->GetDroppedPackets();
+      // Includes writing out whatever is still buffered
+      registry.StopAll();
+    }
+
+    // Packets the asynchronous writer could not keep up with
+    state.counters["dropped"] = dropped;
+    state.SetItemsProcessed(static_cast<int_fast64_t>(state.iterations()) * kNumPackets);
+    state.SetBytesProcessed(static_cast<int_fast64_t>(state.iterations()) * kNumPackets * state.range(0));
+  }
+
+  static constexpr int kNumPackets = 10000;
+  std::filesystem::path snoop_log_path_;
+  std::filesystem::path snooz_log_path_;
+};
+
+BENCHMARK_DEFINE_F(BM_SnoopLoggerCapture, capture_sync)(State& state) {
+  CapturePackets(state, false);
+};
+
+BENCHMARK_REGISTER_F(BM_SnoopLoggerCapture, capture_sync)
+    ->Arg(27)
+    ->Arg(251)
+    ->Arg(1021)
+    ->Iterations(10)
+    ->UseRealTime();
+
+BENCHMARK_DEFINE_F(BM_SnoopLoggerCapture, capture_async)(State& state) {
+  CapturePackets(state, true);
+};
+
+BENCHMARK_REGISTER_F(BM_SnoopLoggerCapture, capture_async)
+    ->Arg(27)
+    ->Arg(251)
+    ->Arg(1021)
+    ->Iterations(10)
+    ->UseRealTime();
+
+}  // namespace hal
+}  // namespace bluetooth
@@ -20,6 +20,7 @@
 #include <gtest/gtest.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <unistd.h>
 
 #include <future>
 #include <unordered_map>
@@ -33,6 +34,7 @@
 
 namespace testing {
 
+using bluetooth::hal::SnoopLoggerAsyncWriter;
 using bluetooth::hal::SnoopLoggerCommon;
 using bluetooth::hal::SnoopLoggerSocket;
 using bluetooth::hal::SnoopLoggerSocketInterface;
@@ -127,7 +129,8 @@ class TestSnoopLoggerModule : public SnoopLogger {
       size_t max_packets_per_file,
       const std::string& btsnoop_mode,
       bool qualcomm_debug_log_enabled,
-      bool snoop_log_persists)
+      bool snoop_log_persists,
+      bool async_capture_enabled = false)
       : SnoopLogger(
             std::move(snoop_log_path),
             std::move(snooz_log_path),
@@ -137,7 +140,8 @@ class TestSnoopLoggerModule : public SnoopLogger {
             qualcomm_debug_log_enabled,
             20ms,
             5ms,
-            snoop_log_persists) {}
+            snoop_log_persists,
+            async_capture_enabled) {}
 
   std::string ToString() const override {
     return std::string("TestSnoopLoggerModule");
@@ -147,6 +151,14 @@ class TestSnoopLoggerModule : public SnoopLogger {
     GetDumpsysData(builder);
   }
 
+  void CallGetDumpsysData(int fd) {
+    GetDumpsysData(fd);
+  }
+
+  SnoopLoggerAsyncWriter* GetAsyncWriter() {
+    return async_writer_.get();
+  }
+
   SnoopLoggerSocketThread* GetSocketThread() {
     return snoop_logger_socket_thread_.get();
   }
@@ -301,6 +313,110 @@ TEST_F(SnoopLoggerModuleTest, capture_one_packet_test) {
       sizeof(SnoopLoggerCommon::FileHeaderType) + sizeof(SnoopLogger::PacketHeaderType) + kInformationRequest.size());
 }
 
+TEST_F(SnoopLoggerModuleTest, capture_one_packet_async_test) {
+  // Actual test
+  auto* snoop_logger = new TestSnoopLoggerModule(
+      temp_snoop_log_.string(),
+      temp_snooz_log_.string(),
+      10,
+      SnoopLogger::kBtSnoopLogModeFull,
+      false,
+      false,
+      true);
+  test_registry->InjectTestModule(&SnoopLogger::Factory, snoop_logger);
+  ASSERT_NE(snoop_logger->GetAsyncWriter(), nullptr);
+
+  snoop_logger->Capture(kInformationRequest, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::CMD);
+
+  auto stats = snoop_logger->GetAsyncWriter()->GetStats();
+  ASSERT_EQ(stats.packets_enqueued, 1u);
+  ASSERT_EQ(stats.packets_dropped, 0u);
+
+  test_registry->StopAll();
+
+  // Verify states after test
+  ASSERT_TRUE(std::filesystem::exists(temp_snoop_log_));
+  ASSERT_FALSE(std::filesystem::exists(temp_snoop_log_last_));
+  ASSERT_EQ(
+      std::filesystem::file_size(temp_snoop_log_),
+      sizeof(SnoopLoggerCommon::FileHeaderType) + sizeof(SnoopLogger::PacketHeaderType) + kInformationRequest.size());
+}
+
+TEST_F(SnoopLoggerModuleTest, capture_async_dumpsys_test) {
+  auto* snoop_logger = new TestSnoopLoggerModule(
+      temp_snoop_log_.string(),
+      temp_snooz_log_.string(),
+      10,
+      SnoopLogger::kBtSnoopLogModeFull,
+      false,
+      false,
+      true);
+  test_registry->InjectTestModule(&SnoopLogger::Factory, snoop_logger);
+
+  snoop_logger->Capture(kInformationRequest, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::CMD);
+
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  snoop_logger->CallGetDumpsysData(fds[1]);
+  close(fds[1]);
+  char buffer[512] = {};
+  ASSERT_GT(read(fds[0], buffer, sizeof(buffer) - 1), 0);
+  close(fds[0]);
+  ASSERT_THAT(std::string(buffer), HasSubstr("packets enqueued: 1"));
+  ASSERT_THAT(std::string(buffer), HasSubstr("packets dropped: 0"));
+
+  test_registry->StopAll();
+}
+
+TEST_F(SnoopLoggerModuleTest, async_writer_drops_when_full_test) {
+  const std::vector<uint8_t> header(16, 0xaa);
+  SnoopLoggerAsyncWriter writer(64, 1h);
+
+  // Nothing drains the ring without a writer thread, so the third record
+  // does not fit and must be dropped instead of blocking.
+  ASSERT_TRUE(writer.Enqueue(header.data(), header.size(), kInformationRequest.data(), kInformationRequest.size()));
+  ASSERT_TRUE(writer.Enqueue(header.data(), header.size(), kInformationRequest.data(), 0));
+  ASSERT_FALSE(writer.Enqueue(header.data(), header.size(), kInformationRequest.data(), kInformationRequest.size()));
+  ASSERT_EQ(writer.GetDroppedPackets(), 1u);
+
+  auto stats = writer.GetStats();
+  ASSERT_EQ(stats.packets_enqueued, 2u);
+  ASSERT_EQ(stats.packets_dropped, 1u);
+  ASSERT_EQ(stats.ring_high_water_bytes, 2 * header.size() + kInformationRequest.size());
+  ASSERT_EQ(stats.ring_capacity_bytes, 64u);
+}
+
+TEST_F(SnoopLoggerModuleTest, rotate_file_after_full_async_test) {
+  // Actual test
+  auto* snoop_logger = new TestSnoopLoggerModule(
+      temp_snoop_log_.string(),
+      temp_snooz_log_.string(),
+      10,
+      SnoopLogger::kBtSnoopLogModeFull,
+      false,
+      false,
+      true);
+  test_registry->InjectTestModule(&SnoopLogger::Factory, snoop_logger);
+
+  for (int i = 0; i < 11; i++) {
+    snoop_logger->Capture(kInformationRequest, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::CMD);
+  }
+
+  test_registry->StopAll();
+
+  // Verify states after test
+  ASSERT_TRUE(std::filesystem::exists(temp_snoop_log_));
+  ASSERT_TRUE(std::filesystem::exists(temp_snoop_log_last_));
+  ASSERT_EQ(
+      std::filesystem::file_size(temp_snoop_log_),
+      sizeof(SnoopLoggerCommon::FileHeaderType) +
+          (sizeof(SnoopLogger::PacketHeaderType) + kInformationRequest.size()) * 1);
+  ASSERT_EQ(
+      std::filesystem::file_size(temp_snoop_log_last_),
+      sizeof(SnoopLoggerCommon::FileHeaderType) +
+          (sizeof(SnoopLogger::PacketHeaderType) + kInformationRequest.size()) * 10);
+}
+
 TEST_F(SnoopLoggerModuleTest, capture_hci_cmd_btsnooz_test) {
   // Actual test
   auto* snoop_logger = new TestSnoopLoggerModule(
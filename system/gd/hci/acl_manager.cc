@@ -33,6 +33,7 @@
 #include "hci/hci_layer.h"
 #include "hci/remote_name_request.h"
 #include "hci_acl_manager_generated.h"
+#include "os/system_properties.h"
 #include "security/security_module.h"
 #include "storage/config_keys.h"
 #include "storage/storage_module.h"
@@ -42,6 +43,9 @@ namespace hci {
 
 constexpr uint16_t kQualcommDebugHandle = 0xedc;
 
+constexpr bool kDefaultWeightedAclSchedulerEnabled = false;
+static const std::string kPropertyWeightedAclSchedulerEnabled = "bluetooth.acl.weighted_scheduler.enabled";
+
 using acl_manager::AclConnection;
 using common::Bind;
 using common::BindOnce;
@@ -66,7 +70,6 @@ struct AclManager::impl {
     hci_layer_ = acl_manager_.GetDependency<HciLayer>();
     handler_ = acl_manager_.GetHandler();
     controller_ = acl_manager_.GetDependency<Controller>();
-    round_robin_scheduler_ = new RoundRobinScheduler(handler_, controller_, hci_layer_->GetAclQueueEnd());
     acl_scheduler_ = acl_manager_.GetDependency<AclScheduler>();
 
     remote_name_request_module_ = acl_manager_.GetDependency<RemoteNameRequestModule>();
@@ -74,6 +77,11 @@ struct AclManager::impl {
     bool crash_on_unknown_handle = false;
     {
       const std::lock_guard<std::mutex> lock(dumpsys_mutex_);
+      round_robin_scheduler_ = new RoundRobinScheduler(
+          handler_,
+          controller_,
+          hci_layer_->GetAclQueueEnd(),
+          os::GetSystemPropertyBool(kPropertyWeightedAclSchedulerEnabled, kDefaultWeightedAclSchedulerEnabled));
       classic_impl_ = new classic_impl(
           hci_layer_,
           controller_,
@@ -107,7 +115,11 @@ struct AclManager::impl {
     unknown_acl_alarm_.reset();
     waiting_packets_.clear();
 
-    delete round_robin_scheduler_;
+    {
+      const std::lock_guard<std::mutex> lock(dumpsys_mutex_);
+      delete round_robin_scheduler_;
+      round_robin_scheduler_ = nullptr;
+    }
     hci_queue_end_ = nullptr;
     handler_ = nullptr;
     hci_layer_ = nullptr;
@@ -400,6 +412,10 @@ void AclManager::SetSystemSuspendState(bool suspended) {
   CallOn(pimpl_->le_impl_, &le_impl::set_system_suspend_state, suspended);
 }
 
+void AclManager::SetAclTxWeight(uint16_t handle, uint8_t weight) {
+  CallOn(pimpl_->round_robin_scheduler_, &RoundRobinScheduler::SetLinkWeight, handle, weight);
+}
+
 LeAddressManager* AclManager::GetLeAddressManager() {
   return pimpl_->le_impl_->le_address_manager_;
 }
@@ -485,5 +501,12 @@ DumpsysDataFinisher AclManager::GetDumpsysData(flatbuffers::FlatBufferBuilder* f
   };
 }
 
+void AclManager::GetDumpsysData(int fd) const {
+  const std::lock_guard<std::mutex> lock(pimpl_->dumpsys_mutex_);
+  if (pimpl_->round_robin_scheduler_ != nullptr) {
+    pimpl_->round_robin_scheduler_->Dump(fd);
+  }
+}
+
 }  // namespace hci
 }  // namespace bluetooth
@@ -154,6 +154,10 @@ class AclManager : public Module {
   virtual void OnLeSuspendInitiatedDisconnect(uint16_t handle, ErrorCode reason);
   virtual void SetSystemSuspendState(bool suspended);
 
+  // Relative share of the controller buffers the link gets when the weighted
+  // ACL scheduler is enabled
+  virtual void SetAclTxWeight(uint16_t handle, uint8_t weight);
+
   static const ModuleFactory Factory;
 
  protected:
@@ -167,6 +171,7 @@ class AclManager : public Module {
 
   DumpsysDataFinisher GetDumpsysData(
       flatbuffers::FlatBufferBuilder* builder) const override;  // Module
+  void GetDumpsysData(int fd) const override;  // Module
 
  private:
   virtual uint16_t HACK_GetHandle(const Address address);
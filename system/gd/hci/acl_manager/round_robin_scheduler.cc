@@ -15,6 +15,14 @@
  */
 
 #include "hci/acl_manager/round_robin_scheduler.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
 #include "hci/acl_manager/acl_fragmenter.h"
 
 namespace bluetooth {
@@ -22,8 +30,11 @@ namespace hci {
 namespace acl_manager {
 
 RoundRobinScheduler::RoundRobinScheduler(
-    os::Handler* handler, Controller* controller, common::BidiQueueEnd<AclBuilder, AclView>* hci_queue_end)
-    : handler_(handler), controller_(controller), hci_queue_end_(hci_queue_end) {
+    os::Handler* handler,
+    Controller* controller,
+    common::BidiQueueEnd<AclBuilder, AclView>* hci_queue_end,
+    bool weighted)
+    : handler_(handler), controller_(controller), weighted_(weighted), hci_queue_end_(hci_queue_end) {
   max_acl_packet_credits_ = controller_->GetNumAclPacketBuffers();
   acl_packet_credits_ = max_acl_packet_credits_;
   hci_mtu_ = controller_->GetAclPacketLength();
@@ -43,7 +54,14 @@ void RoundRobinScheduler::Register(ConnectionType connection_type, uint16_t hand
                                    std::shared_ptr<acl_manager::AclConnection::Queue> queue) {
   ASSERT(acl_queue_handlers_.count(handle) == 0);
   acl_queue_handler acl_queue_handler = {connection_type, std::move(queue), false, 0};
-  acl_queue_handlers_.insert(std::pair<uint16_t, RoundRobinScheduler::acl_queue_handler>(handle, acl_queue_handler));
+  acl_queue_handler.stats_.registered_at_ = std::chrono::steady_clock::now();
+  {
+    const std::lock_guard<std::mutex> lock(dumpsys_mutex_);
+    acl_queue_handlers_.emplace(handle, std::move(acl_queue_handler));
+  }
+  if (weighted_) {
+    refill_staged_packet(handle, acl_queue_handlers_.find(handle)->second);
+  }
   if (fragments_to_send_.size() == 0) {
     start_round_robin();
   }
@@ -51,7 +69,7 @@ void RoundRobinScheduler::Register(ConnectionType connection_type, uint16_t hand
 
 void RoundRobinScheduler::Unregister(uint16_t handle) {
   ASSERT(acl_queue_handlers_.count(handle) == 1);
-  auto acl_queue_handler = acl_queue_handlers_.find(handle)->second;
+  auto& acl_queue_handler = acl_queue_handlers_.find(handle)->second;
   // Reclaim outstanding packets
   if (acl_queue_handler.connection_type_ == ConnectionType::CLASSIC) {
     acl_packet_credits_ += acl_queue_handler.number_of_sent_packets_;
@@ -64,7 +82,10 @@ void RoundRobinScheduler::Unregister(uint16_t handle) {
     acl_queue_handler.dequeue_is_registered_ = false;
     acl_queue_handler.queue_->GetDownEnd()->UnregisterDequeue();
   }
-  acl_queue_handlers_.erase(handle);
+  {
+    const std::lock_guard<std::mutex> lock(dumpsys_mutex_);
+    acl_queue_handlers_.erase(handle);
+  }
   starting_point_ = acl_queue_handlers_.begin();
 }
 
@@ -74,9 +95,24 @@ void RoundRobinScheduler::SetLinkPriority(uint16_t handle, bool high_priority) {
     LOG_WARN("handle %d is invalid", handle);
     return;
   }
+  const std::lock_guard<std::mutex> lock(dumpsys_mutex_);
   acl_queue_handler->second.high_priority_ = high_priority;
 }
 
+void RoundRobinScheduler::SetLinkWeight(uint16_t handle, uint8_t weight) {
+  auto acl_queue_handler = acl_queue_handlers_.find(handle);
+  if (acl_queue_handler == acl_queue_handlers_.end()) {
+    LOG_WARN("handle %d is invalid", handle);
+    return;
+  }
+  if (weight == 0) {
+    LOG_WARN("Ignoring zero weight for handle %d", handle);
+    return;
+  }
+  const std::lock_guard<std::mutex> lock(dumpsys_mutex_);
+  acl_queue_handler->second.weight_ = weight;
+}
+
 uint16_t RoundRobinScheduler::GetCredits() {
   return acl_packet_credits_;
 }
@@ -100,6 +136,10 @@ void RoundRobinScheduler::start_round_robin() {
     send_next_fragment();
     return;
   }
+  if (weighted_) {
+    schedule_staged_packet();
+    return;
+  }
   if (acl_queue_handlers_.empty()) {
     LOG_INFO("No any acl connection");
     return;
@@ -132,45 +172,182 @@ void RoundRobinScheduler::start_round_robin() {
 }
 
 void RoundRobinScheduler::buffer_packet(uint16_t acl_handle) {
-  BroadcastFlag broadcast_flag = BroadcastFlag::POINT_TO_POINT;
   auto acl_queue_handler = acl_queue_handlers_.find(acl_handle);
   if( acl_queue_handler == acl_queue_handlers_.end()) {
     LOG_ERROR("Ignore since ACL connection vanished with handle: 0x%X", acl_handle);
     return;
   }
 
-  // Wrap packet and enqueue it
-  uint16_t handle = acl_queue_handler->first;
   auto packet = acl_queue_handler->second.queue_->GetDownEnd()->TryDequeue();
   ASSERT(packet != nullptr);
+  enqueue_fragments(
+      acl_queue_handler->first, acl_queue_handler->second, std::move(packet), std::chrono::steady_clock::now());
+  ASSERT(fragments_to_send_.size() > 0);
+  unregister_all_connections();
+
+  send_next_fragment();
+}
 
-  ConnectionType connection_type = acl_queue_handler->second.connection_type_;
+// Wrap packet and enqueue it
+void RoundRobinScheduler::enqueue_fragments(
+    uint16_t handle,
+    acl_queue_handler& acl_queue_handler,
+    std::unique_ptr<packet::BasePacketBuilder> packet,
+    std::chrono::steady_clock::time_point dequeued_at) {
+  BroadcastFlag broadcast_flag = BroadcastFlag::POINT_TO_POINT;
+  ConnectionType connection_type = acl_queue_handler.connection_type_;
   size_t mtu = connection_type == ConnectionType::CLASSIC ? hci_mtu_ : le_hci_mtu_;
   PacketBoundaryFlag packet_boundary_flag = (packet->IsFlushable())
                                                 ? PacketBoundaryFlag::FIRST_AUTOMATICALLY_FLUSHABLE
                                                 : PacketBoundaryFlag::FIRST_NON_AUTOMATICALLY_FLUSHABLE;
 
-  int acl_priority = acl_queue_handler->second.high_priority_ ? 1 : 0;
+  int acl_priority = acl_queue_handler.high_priority_ ? 1 : 0;
   if (packet->size() <= mtu) {
     fragments_to_send_.push(
-        std::make_pair(
-            connection_type, AclBuilder::Create(handle, packet_boundary_flag, broadcast_flag, std::move(packet))),
+        fragment{
+            connection_type,
+            handle,
+            AclBuilder::Create(handle, packet_boundary_flag, broadcast_flag, std::move(packet)),
+            true,
+            dequeued_at},
         acl_priority);
+    acl_queue_handler.number_of_sent_packets_ += 1;
   } else {
     auto fragments = AclFragmenter(mtu, std::move(packet)).GetFragments();
     for (size_t i = 0; i < fragments.size(); i++) {
       fragments_to_send_.push(
-          std::make_pair(
+          fragment{
               connection_type,
-              AclBuilder::Create(handle, packet_boundary_flag, broadcast_flag, std::move(fragments[i]))),
+              handle,
+              AclBuilder::Create(handle, packet_boundary_flag, broadcast_flag, std::move(fragments[i])),
+              i + 1 == fragments.size(),
+              dequeued_at},
           acl_priority);
       packet_boundary_flag = PacketBoundaryFlag::CONTINUING_FRAGMENT;
     }
+    acl_queue_handler.number_of_sent_packets_ += fragments.size();
   }
-  ASSERT(fragments_to_send_.size() > 0);
-  unregister_all_connections();
+}
 
-  acl_queue_handler->second.number_of_sent_packets_ += fragments_to_send_.size();
+void RoundRobinScheduler::stage_packet(uint16_t acl_handle) {
+  auto acl_queue_handler = acl_queue_handlers_.find(acl_handle);
+  if (acl_queue_handler == acl_queue_handlers_.end()) {
+    LOG_ERROR("Ignore since ACL connection vanished with handle: 0x%X", acl_handle);
+    return;
+  }
+  if (acl_queue_handler->second.dequeue_is_registered_) {
+    acl_queue_handler->second.dequeue_is_registered_ = false;
+    acl_queue_handler->second.queue_->GetDownEnd()->UnregisterDequeue();
+  }
+  refill_staged_packet(acl_handle, acl_queue_handler->second);
+  if (fragments_to_send_.empty()) {
+    schedule_staged_packet();
+  }
+}
+
+void RoundRobinScheduler::refill_staged_packet(uint16_t handle, acl_queue_handler& acl_queue_handler) {
+  if (acl_queue_handler.staged_packet_ != nullptr || acl_queue_handler.dequeue_is_registered_) {
+    return;
+  }
+  auto packet = acl_queue_handler.queue_->GetDownEnd()->TryDequeue();
+  if (packet == nullptr) {
+    // Idle links do not carry credits over to their next busy period
+    acl_queue_handler.deficit_ = 0;
+    acl_queue_handler.dequeue_is_registered_ = true;
+    acl_queue_handler.queue_->GetDownEnd()->RegisterDequeue(
+        handler_, common::Bind(&RoundRobinScheduler::stage_packet, common::Unretained(this), handle));
+    return;
+  }
+  acl_queue_handler.staged_packet_ = std::move(packet);
+  acl_queue_handler.staged_at_ = std::chrono::steady_clock::now();
+}
+
+uint16_t RoundRobinScheduler::reserved_credits(ConnectionType connection_type) const {
+  for (const auto& [handle, acl_queue_handler] : acl_queue_handlers_) {
+    if (acl_queue_handler.high_priority_ && acl_queue_handler.connection_type_ == connection_type) {
+      uint16_t max_credits =
+          connection_type == ConnectionType::CLASSIC ? max_acl_packet_credits_ : le_max_acl_packet_credits_;
+      return std::min<uint16_t>(kReservedHighPriorityCredits, max_credits / 2);
+    }
+  }
+  return 0;
+}
+
+bool RoundRobinScheduler::can_start_packet(const acl_queue_handler& acl_queue_handler) const {
+  ConnectionType connection_type = acl_queue_handler.connection_type_;
+  uint16_t credits = connection_type == ConnectionType::CLASSIC ? acl_packet_credits_ : le_acl_packet_credits_;
+  if (acl_queue_handler.high_priority_) {
+    return credits > 0;
+  }
+  return credits > reserved_credits(connection_type);
+}
+
+void RoundRobinScheduler::schedule_staged_packet() {
+  // Packets are not interleaved, the current one is sent out completely first
+  if (!fragments_to_send_.empty()) {
+    return;
+  }
+
+  // Links eligible to start a packet, high priority links first. The list is
+  // in visiting order: starting after the link served last, which comes last.
+  std::vector<std::map<uint16_t, acl_queue_handler>::iterator> candidates;
+  for (bool high_priority : {true, false}) {
+    auto first = acl_queue_handlers_.upper_bound(current_handle_);
+    for (size_t i = 0; i < acl_queue_handlers_.size(); i++) {
+      if (first == acl_queue_handlers_.end()) {
+        first = acl_queue_handlers_.begin();
+      }
+      if (first->second.staged_packet_ != nullptr && first->second.high_priority_ == high_priority &&
+          can_start_packet(first->second)) {
+        candidates.push_back(first);
+      }
+      first++;
+    }
+    if (!candidates.empty()) {
+      break;
+    }
+  }
+  if (candidates.empty()) {
+    return;
+  }
+
+  // Each packet costs one credit per fragment
+  auto cost = [this](const acl_queue_handler& acl_queue_handler) -> uint32_t {
+    size_t mtu = acl_queue_handler.connection_type_ == ConnectionType::CLASSIC ? hci_mtu_ : le_hci_mtu_;
+    size_t size = acl_queue_handler.staged_packet_->size();
+    return std::max<size_t>(1, (size + mtu - 1) / mtu);
+  };
+
+  auto served = candidates.back();
+  if (served->first != current_handle_ || served->second.deficit_ < cost(served->second)) {
+    // Instead of visiting links round after round, find the first visit at
+    // which a link has accumulated enough credits. Link i is visited at times
+    // i + 1, i + 1 + n, i + 1 + 2n, ... and gains its weight on each visit.
+    const uint64_t n = candidates.size();
+    uint64_t served_at = std::numeric_limits<uint64_t>::max();
+    for (uint64_t i = 0; i < n; i++) {
+      const auto& acl_queue_handler = candidates[i]->second;
+      uint32_t packet_cost = cost(acl_queue_handler);
+      uint64_t missing = packet_cost > acl_queue_handler.deficit_ ? packet_cost - acl_queue_handler.deficit_ : 0;
+      uint64_t visits = std::max<uint64_t>(1, (missing + acl_queue_handler.weight_ - 1) / acl_queue_handler.weight_);
+      uint64_t visited_at = i + 1 + (visits - 1) * n;
+      if (visited_at < served_at) {
+        served_at = visited_at;
+        served = candidates[i];
+      }
+    }
+    for (uint64_t i = 0; i < n; i++) {
+      if (served_at >= i + 1) {
+        candidates[i]->second.deficit_ += candidates[i]->second.weight_ * ((served_at - i - 1) / n + 1);
+      }
+    }
+  }
+  served->second.deficit_ -= cost(served->second);
+  current_handle_ = served->first;
+
+  enqueue_fragments(
+      served->first, served->second, std::move(served->second.staged_packet_), served->second.staged_at_);
+  refill_staged_packet(served->first, served->second);
   send_next_fragment();
 }
 
@@ -193,7 +370,8 @@ void RoundRobinScheduler::send_next_fragment() {
 
 // Invoked from some external Queue Reactable context 1
 std::unique_ptr<AclBuilder> RoundRobinScheduler::handle_enqueue_next_fragment() {
-  ConnectionType connection_type = fragments_to_send_.front().first;
+  auto& next_fragment = fragments_to_send_.front();
+  ConnectionType connection_type = next_fragment.connection_type_;
   if (connection_type == ConnectionType::CLASSIC) {
     ASSERT(acl_packet_credits_ > 0);
     acl_packet_credits_ -= 1;
@@ -202,7 +380,23 @@ std::unique_ptr<AclBuilder> RoundRobinScheduler::handle_enqueue_next_fragment()
     le_acl_packet_credits_ -= 1;
   }
 
-  auto raw_pointer = fragments_to_send_.front().second.release();
+  auto raw_pointer = next_fragment.packet_.release();
+  {
+    const std::lock_guard<std::mutex> lock(dumpsys_mutex_);
+    auto acl_queue_handler = acl_queue_handlers_.find(next_fragment.handle_);
+    if (acl_queue_handler != acl_queue_handlers_.end()) {
+      auto& stats = acl_queue_handler->second.stats_;
+      stats.fragments_sent_++;
+      stats.bytes_sent_ += raw_pointer->size();
+      if (next_fragment.last_) {
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - next_fragment.dequeued_at_);
+        stats.packets_sent_++;
+        stats.total_latency_ += latency;
+        stats.max_latency_ = std::max(stats.max_latency_, latency);
+      }
+    }
+  }
   fragments_to_send_.pop();
   if (fragments_to_send_.empty()) {
     if (enqueue_registered_.exchange(false)) {
@@ -210,7 +404,7 @@ std::unique_ptr<AclBuilder> RoundRobinScheduler::handle_enqueue_next_fragment()
     }
     handler_->Post(common::BindOnce(&RoundRobinScheduler::start_round_robin, common::Unretained(this)));
   } else {
-    ConnectionType next_connection_type = fragments_to_send_.front().first;
+    ConnectionType next_connection_type = fragments_to_send_.front().connection_type_;
     bool classic_buffer_full = next_connection_type == ConnectionType::CLASSIC && acl_packet_credits_ == 0;
     bool le_buffer_full = next_connection_type == ConnectionType::LE && le_acl_packet_credits_ == 0;
     if ((classic_buffer_full || le_buffer_full) && enqueue_registered_.exchange(false)) {
@@ -232,6 +426,10 @@ void RoundRobinScheduler::incoming_acl_credits(uint16_t handle, uint16_t credits
     LOG_WARN("receive more credits than we sent");
     acl_queue_handler->second.number_of_sent_packets_ = 0;
   }
+  {
+    const std::lock_guard<std::mutex> lock(dumpsys_mutex_);
+    acl_queue_handler->second.stats_.credits_returned_ += credits;
+  }
 
   bool credit_was_zero = false;
   if (acl_queue_handler->second.connection_type_ == ConnectionType::CLASSIC) {
@@ -253,11 +451,45 @@ void RoundRobinScheduler::incoming_acl_credits(uint16_t handle, uint16_t credits
       LOG_WARN("le acl packet credits overflow due to receive %hx credits", credits);
     }
   }
-  if (credit_was_zero) {
+  // Low priority links may also be waiting for credits above the reserve
+  if (credit_was_zero || (weighted_ && fragments_to_send_.empty())) {
     start_round_robin();
   }
 }
 
+void RoundRobinScheduler::Dump(int fd) const {
+  const std::lock_guard<std::mutex> lock(dumpsys_mutex_);
+  auto now = std::chrono::steady_clock::now();
+  dprintf(fd, "ACL scheduler: %s\n", weighted_ ? "weighted" : "round robin");
+  for (const auto& [handle, acl_queue_handler] : acl_queue_handlers_) {
+    const auto& stats = acl_queue_handler.stats_;
+    auto elapsed_ms =
+        std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::milliseconds>(now - stats.registered_at_).count());
+    uint64_t average_latency_us =
+        stats.packets_sent_ == 0 ? 0 : stats.total_latency_.count() / stats.packets_sent_;
+    dprintf(
+        fd,
+        "  handle 0x%04x %s priority:%s weight:%u\n",
+        handle,
+        acl_queue_handler.connection_type_ == ConnectionType::CLASSIC ? "classic" : "le",
+        acl_queue_handler.high_priority_ ? "high" : "normal",
+        acl_queue_handler.weight_);
+    dprintf(
+        fd,
+        "    packets: %" PRIu64 " fragments: %" PRIu64 " bytes: %" PRIu64 " credits returned: %" PRIu64 "\n",
+        stats.packets_sent_,
+        stats.fragments_sent_,
+        stats.bytes_sent_,
+        stats.credits_returned_);
+    dprintf(
+        fd,
+        "    throughput: %" PRIu64 " bytes/s latency avg: %" PRIu64 " us max: %" PRId64 " us\n",
+        stats.bytes_sent_ * 1000 / elapsed_ms,
+        average_latency_us,
+        static_cast<int64_t>(stats.max_latency_.count()));
+  }
+}
+
 }  // namespace acl_manager
 }  // namespace hci
 }  // namespace bluetooth
@@ -18,6 +18,9 @@
 
 #include <stdint.h>
 
+#include <chrono>
+#include <mutex>
+
 #include "common/bidi_queue.h"
 #include "common/multi_priority_queue.h"
 #include "hci/acl_manager/acl_connection.h"
@@ -29,32 +32,88 @@ namespace bluetooth {
 namespace hci {
 namespace acl_manager {
 
+// Schedules outgoing ACL packets of all links onto the shared controller
+// buffers.
+//
+// By default links take turns in round-robin order. In weighted mode every
+// link keeps one packet staged and links are served by deficit round robin:
+// a link may start a packet once it accumulated as many credits as the packet
+// has fragments, and accumulates |weight| credits per round. High priority
+// links are always served first, and as long as one is connected low priority
+// links of the same transport leave a few controller buffers free for it.
 class RoundRobinScheduler {
  public:
   RoundRobinScheduler(
-      os::Handler* handler, Controller* controller, common::BidiQueueEnd<AclBuilder, AclView>* hci_queue_end);
+      os::Handler* handler,
+      Controller* controller,
+      common::BidiQueueEnd<AclBuilder, AclView>* hci_queue_end,
+      bool weighted = false);
   ~RoundRobinScheduler();
 
   enum ConnectionType { CLASSIC, LE };
 
+  static constexpr uint8_t kDefaultLinkWeight = 1;
+  // Controller buffers kept free for high priority links in weighted mode
+  static constexpr uint16_t kReservedHighPriorityCredits = 2;
+
+  struct link_stats {
+    uint64_t packets_sent_ = 0;
+    uint64_t fragments_sent_ = 0;
+    uint64_t bytes_sent_ = 0;
+    uint64_t credits_returned_ = 0;
+    // Time from dequeuing a packet from the link to handing its last fragment to HCI
+    std::chrono::microseconds total_latency_{0};
+    std::chrono::microseconds max_latency_{0};
+    std::chrono::steady_clock::time_point registered_at_;
+  };
+
   struct acl_queue_handler {
     ConnectionType connection_type_;
     std::shared_ptr<acl_manager::AclConnection::Queue> queue_;
     bool dequeue_is_registered_ = false;
     uint16_t number_of_sent_packets_ = 0;  // Track credits
     bool high_priority_ = false;           // For A2dp use
+    uint8_t weight_ = kDefaultLinkWeight;
+    // Weighted mode only
+    uint32_t deficit_ = 0;
+    std::unique_ptr<packet::BasePacketBuilder> staged_packet_;
+    std::chrono::steady_clock::time_point staged_at_;
+    link_stats stats_;
   };
 
   void Register(ConnectionType connection_type, uint16_t handle,
                 std::shared_ptr<acl_manager::AclConnection::Queue> queue);
   void Unregister(uint16_t handle);
   void SetLinkPriority(uint16_t handle, bool high_priority);
+  // Relative share of the controller buffers |handle| gets among links of the
+  // same priority, only used in weighted mode.
+  void SetLinkWeight(uint16_t handle, uint8_t weight);
   uint16_t GetCredits();
   uint16_t GetLeCredits();
+  void Dump(int fd) const;
 
  private:
+  struct fragment {
+    ConnectionType connection_type_;
+    uint16_t handle_;
+    std::unique_ptr<AclBuilder> packet_;
+    // Set on the last fragment of a packet, when its latency is accounted
+    bool last_;
+    std::chrono::steady_clock::time_point dequeued_at_;
+  };
+
   void start_round_robin();
   void buffer_packet(uint16_t acl_handle);
+  void enqueue_fragments(
+      uint16_t handle,
+      acl_queue_handler& acl_queue_handler,
+      std::unique_ptr<packet::BasePacketBuilder> packet,
+      std::chrono::steady_clock::time_point dequeued_at);
+  void stage_packet(uint16_t acl_handle);
+  void refill_staged_packet(uint16_t handle, acl_queue_handler& acl_queue_handler);
+  void schedule_staged_packet();
+  bool can_start_packet(const acl_queue_handler& acl_queue_handler) const;
+  uint16_t reserved_credits(ConnectionType connection_type) const;
   void unregister_all_connections();
   void send_next_fragment();
   std::unique_ptr<AclBuilder> handle_enqueue_next_fragment();
@@ -62,8 +121,11 @@ class RoundRobinScheduler {
 
   os::Handler* handler_ = nullptr;
   Controller* controller_ = nullptr;
+  const bool weighted_;
   std::map<uint16_t, acl_queue_handler> acl_queue_handlers_;
-  common::MultiPriorityQueue<std::pair<ConnectionType, std::unique_ptr<AclBuilder>>, 2> fragments_to_send_;
+  // Guards link registration and per link settings and counters read by Dump()
+  mutable std::mutex dumpsys_mutex_;
+  common::MultiPriorityQueue<fragment, 2> fragments_to_send_;
   uint16_t max_acl_packet_credits_ = 0;
   uint16_t acl_packet_credits_ = 0;
   uint16_t le_max_acl_packet_credits_ = 0;
@@ -74,6 +136,8 @@ class RoundRobinScheduler {
   common::BidiQueueEnd<AclBuilder, AclView>* hci_queue_end_ = nullptr;
   // first register queue end for the Round-robin schedule
   std::map<uint16_t, acl_queue_handler>::iterator starting_point_;
+  // Link served last in weighted mode, it keeps its turn while it has credits left
+  uint16_t current_handle_ = 0;
 };
 
 }  // namespace acl_manager
@@ -16,7 +16,9 @@
 
 #include "hci/acl_manager/round_robin_scheduler.h"
 
+#include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <unistd.h>
 
 #include "common/bidi_queue.h"
 #include "common/callback.h"
@@ -82,7 +84,7 @@ class RoundRobinSchedulerTest : public ::testing::Test {
     thread_ = new Thread("thread", Thread::Priority::NORMAL);
     handler_ = new Handler(thread_);
     controller_ = new TestController();
-    round_robin_scheduler_ = new RoundRobinScheduler(handler_, controller_, hci_queue_.GetUpEnd());
+    round_robin_scheduler_ = new RoundRobinScheduler(handler_, controller_, hci_queue_.GetUpEnd(), weighted_);
     hci_queue_.GetDownEnd()->RegisterDequeue(
         handler_, common::Bind(&RoundRobinSchedulerTest::HciDownEndDequeue, common::Unretained(this)));
   }
@@ -158,6 +160,37 @@ class RoundRobinSchedulerTest : public ::testing::Test {
     packet_future_ = std::make_unique<std::future<void>>(packet_promise_->get_future());
   }
 
+  // Returns the handle of the packet sent after giving back one credit of |handle|
+  uint16_t ReturnCreditAndGetNextHandle(uint16_t handle) {
+    SetPacketFuture(1);
+    controller_->SendCompletedAclPacketsCallback(handle, 1);
+    packet_future_->wait();
+    uint16_t next_handle = sent_acl_packets_.front().GetHandle();
+    sent_acl_packets_.pop();
+    return next_handle;
+  }
+
+  // Sends a packet per classic credit on |handle| so that later packets have to wait for credits
+  void ExhaustClassicCredits(uint16_t handle, AclConnection::QueueUpEnd* queue_up_end) {
+    SetPacketFuture(controller_->max_acl_packet_credits_);
+    for (uint16_t i = 0; i < controller_->max_acl_packet_credits_; i++) {
+      EnqueueAclUpEnd(queue_up_end, {0x01, 0x02, 0x03});
+    }
+    packet_future_->wait();
+    while (!sent_acl_packets_.empty()) {
+      sent_acl_packets_.pop();
+    }
+    ASSERT_EQ(round_robin_scheduler_->GetCredits(), 0);
+  }
+
+  void WaitForEnqueuedPackets() {
+    if (enqueue_future_ != nullptr) {
+      enqueue_future_->wait();
+    }
+    sync_handler();
+  }
+
+  bool weighted_ = false;
   BidiQueue<AclView, AclBuilder> hci_queue_{3};
   Thread* thread_;
   Handler* handler_;
@@ -411,6 +444,210 @@ TEST_F(RoundRobinSchedulerTest, receive_le_credit_when_next_fragment_is_classic)
   round_robin_scheduler_->Unregister(le_handle);
 }
 
+class WeightedRoundRobinSchedulerTest : public RoundRobinSchedulerTest {
+ protected:
+  void SetUp() override {
+    weighted_ = true;
+    RoundRobinSchedulerTest::SetUp();
+  }
+};
+
+TEST_F(WeightedRoundRobinSchedulerTest, buffer_packet_from_two_connections) {
+  uint16_t handle = 0x01;
+  uint16_t le_handle = 0x02;
+  auto connection_queue = std::make_shared<AclConnection::Queue>(10);
+  auto le_connection_queue = std::make_shared<AclConnection::Queue>(10);
+
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, handle, connection_queue);
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::LE, le_handle, le_connection_queue);
+
+  ASSERT_NO_FATAL_FAILURE(SetPacketFuture(2));
+  std::vector<uint8_t> packet = {0x01, 0x02, 0x03};
+  std::vector<uint8_t> le_packet = {0x04, 0x05, 0x06};
+  EnqueueAclUpEnd(le_connection_queue->GetUpEnd(), le_packet);
+  EnqueueAclUpEnd(connection_queue->GetUpEnd(), packet);
+
+  packet_future_->wait();
+  VerifyPacket(le_handle, le_packet);
+  VerifyPacket(handle, packet);
+  ASSERT_EQ(round_robin_scheduler_->GetCredits(), controller_->max_acl_packet_credits_ - 1);
+  ASSERT_EQ(round_robin_scheduler_->GetLeCredits(), controller_->le_max_acl_packet_credits_ - 1);
+
+  round_robin_scheduler_->Unregister(handle);
+  round_robin_scheduler_->Unregister(le_handle);
+}
+
+TEST_F(WeightedRoundRobinSchedulerTest, send_fragments_of_one_packet_back_to_back) {
+  uint16_t handle = 0x01;
+  uint16_t le_handle = 0x02;
+  auto connection_queue = std::make_shared<AclConnection::Queue>(10);
+  auto le_connection_queue = std::make_shared<AclConnection::Queue>(10);
+
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, handle, connection_queue);
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::LE, le_handle, le_connection_queue);
+
+  ASSERT_NO_FATAL_FAILURE(SetPacketFuture(5));
+  std::vector<uint8_t> packet(controller_->hci_mtu_ + 3, 0xff);
+  std::vector<uint8_t> le_packet(controller_->le_hci_mtu_ * 3, 0x55);
+  EnqueueAclUpEnd(le_connection_queue->GetUpEnd(), le_packet);
+  EnqueueAclUpEnd(connection_queue->GetUpEnd(), packet);
+
+  packet_future_->wait();
+  for (int i = 0; i < 3; i++) {
+    VerifyPacket(le_handle, std::vector<uint8_t>(controller_->le_hci_mtu_, 0x55));
+  }
+  VerifyPacket(handle, std::vector<uint8_t>(controller_->hci_mtu_, 0xff));
+  VerifyPacket(handle, {0xff, 0xff, 0xff});
+  ASSERT_EQ(round_robin_scheduler_->GetCredits(), controller_->max_acl_packet_credits_ - 2);
+  ASSERT_EQ(round_robin_scheduler_->GetLeCredits(), controller_->le_max_acl_packet_credits_ - 3);
+
+  round_robin_scheduler_->Unregister(handle);
+  round_robin_scheduler_->Unregister(le_handle);
+}
+
+TEST_F(WeightedRoundRobinSchedulerTest, share_credits_by_weight) {
+  uint16_t handle1 = 0x01;
+  uint16_t handle2 = 0x02;
+  uint16_t filler_handle = 0x03;
+  auto connection_queue1 = std::make_shared<AclConnection::Queue>(10);
+  auto connection_queue2 = std::make_shared<AclConnection::Queue>(10);
+  auto filler_queue = std::make_shared<AclConnection::Queue>(10);
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, handle1, connection_queue1);
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, handle2, connection_queue2);
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, filler_handle, filler_queue);
+  round_robin_scheduler_->SetLinkWeight(handle1, 3);
+
+  ASSERT_NO_FATAL_FAILURE(ExhaustClassicCredits(filler_handle, filler_queue->GetUpEnd()));
+  for (uint8_t i = 0; i < 8; i++) {
+    EnqueueAclUpEnd(connection_queue1->GetUpEnd(), {0x01, i});
+    EnqueueAclUpEnd(connection_queue2->GetUpEnd(), {0x02, i});
+  }
+  WaitForEnqueuedPackets();
+
+  // Credits trickle back one at a time while both links are backlogged
+  std::vector<uint16_t> handles;
+  for (int i = 0; i < 8; i++) {
+    handles.push_back(ReturnCreditAndGetNextHandle(filler_handle));
+  }
+  EXPECT_THAT(
+      handles, ::testing::ElementsAre(handle1, handle1, handle1, handle2, handle1, handle1, handle1, handle2));
+
+  round_robin_scheduler_->Unregister(handle1);
+  round_robin_scheduler_->Unregister(handle2);
+  round_robin_scheduler_->Unregister(filler_handle);
+}
+
+TEST_F(WeightedRoundRobinSchedulerTest, charge_links_per_fragment) {
+  uint16_t handle1 = 0x01;
+  uint16_t handle2 = 0x02;
+  uint16_t filler_handle = 0x03;
+  auto connection_queue1 = std::make_shared<AclConnection::Queue>(10);
+  auto connection_queue2 = std::make_shared<AclConnection::Queue>(10);
+  auto filler_queue = std::make_shared<AclConnection::Queue>(10);
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, handle1, connection_queue1);
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, handle2, connection_queue2);
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, filler_handle, filler_queue);
+
+  ASSERT_NO_FATAL_FAILURE(ExhaustClassicCredits(filler_handle, filler_queue->GetUpEnd()));
+  // Packets of two fragments on the first link, of one on the second
+  for (uint8_t i = 0; i < 2; i++) {
+    EnqueueAclUpEnd(connection_queue1->GetUpEnd(), std::vector<uint8_t>(controller_->hci_mtu_ + 1, i));
+  }
+  for (uint8_t i = 0; i < 4; i++) {
+    EnqueueAclUpEnd(connection_queue2->GetUpEnd(), {0x02, i});
+  }
+  WaitForEnqueuedPackets();
+
+  std::vector<uint16_t> handles;
+  for (int i = 0; i < 6; i++) {
+    handles.push_back(ReturnCreditAndGetNextHandle(filler_handle));
+  }
+  EXPECT_THAT(handles, ::testing::ElementsAre(handle2, handle1, handle1, handle2, handle2, handle1));
+
+  round_robin_scheduler_->Unregister(handle1);
+  round_robin_scheduler_->Unregister(handle2);
+  round_robin_scheduler_->Unregister(filler_handle);
+}
+
+TEST_F(WeightedRoundRobinSchedulerTest, high_priority_link_uses_reserved_credits) {
+  uint16_t bulk_handle = 0x01;
+  uint16_t audio_handle = 0x02;
+  uint16_t filler_handle = 0x03;
+  auto bulk_queue = std::make_shared<AclConnection::Queue>(10);
+  auto audio_queue = std::make_shared<AclConnection::Queue>(10);
+  auto filler_queue = std::make_shared<AclConnection::Queue>(10);
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, bulk_handle, bulk_queue);
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, audio_handle, audio_queue);
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, filler_handle, filler_queue);
+
+  ASSERT_NO_FATAL_FAILURE(ExhaustClassicCredits(filler_handle, filler_queue->GetUpEnd()));
+  round_robin_scheduler_->SetLinkPriority(audio_handle, true);
+  for (uint8_t i = 0; i < 4; i++) {
+    EnqueueAclUpEnd(bulk_queue->GetUpEnd(), {0x01, i});
+  }
+  for (uint8_t i = 0; i < 2; i++) {
+    EnqueueAclUpEnd(audio_queue->GetUpEnd(), {0x02, i});
+  }
+  WaitForEnqueuedPackets();
+
+  // The high priority link goes first, the bulk link stops once only the reserved credits are left
+  ASSERT_NO_FATAL_FAILURE(SetPacketFuture(3));
+  controller_->SendCompletedAclPacketsCallback(filler_handle, 5);
+  packet_future_->wait();
+  VerifyPacket(audio_handle, {0x02, 0x00});
+  VerifyPacket(audio_handle, {0x02, 0x01});
+  VerifyPacket(bulk_handle, {0x01, 0x00});
+  sync_handler();
+  ASSERT_EQ(round_robin_scheduler_->GetCredits(), RoundRobinScheduler::kReservedHighPriorityCredits);
+
+  // The reserved credits are still available to the high priority link
+  ASSERT_NO_FATAL_FAILURE(SetPacketFuture(1));
+  EnqueueAclUpEnd(audio_queue->GetUpEnd(), {0x02, 0x02});
+  packet_future_->wait();
+  VerifyPacket(audio_handle, {0x02, 0x02});
+  sync_handler();
+  ASSERT_EQ(round_robin_scheduler_->GetCredits(), RoundRobinScheduler::kReservedHighPriorityCredits - 1);
+
+  // The bulk link resumes once credits above the reserve come back
+  ASSERT_NO_FATAL_FAILURE(SetPacketFuture(1));
+  controller_->SendCompletedAclPacketsCallback(filler_handle, 2);
+  packet_future_->wait();
+  VerifyPacket(bulk_handle, {0x01, 0x01});
+
+  round_robin_scheduler_->Unregister(bulk_handle);
+  round_robin_scheduler_->Unregister(audio_handle);
+  round_robin_scheduler_->Unregister(filler_handle);
+}
+
+TEST_F(WeightedRoundRobinSchedulerTest, dump_link_counters) {
+  uint16_t handle = 0x01;
+  auto connection_queue = std::make_shared<AclConnection::Queue>(10);
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, handle, connection_queue);
+  round_robin_scheduler_->SetLinkWeight(handle, 4);
+
+  ASSERT_NO_FATAL_FAILURE(SetPacketFuture(2));
+  EnqueueAclUpEnd(connection_queue->GetUpEnd(), {0x01, 0x02, 0x03});
+  EnqueueAclUpEnd(connection_queue->GetUpEnd(), {0x04, 0x05, 0x06});
+  packet_future_->wait();
+  controller_->SendCompletedAclPacketsCallback(handle, 2);
+  sync_handler();
+
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  round_robin_scheduler_->Dump(fds[1]);
+  close(fds[1]);
+  char buffer[1024] = {};
+  ASSERT_GT(read(fds[0], buffer, sizeof(buffer) - 1), 0);
+  close(fds[0]);
+
+  std::string dump(buffer);
+  EXPECT_THAT(dump, ::testing::HasSubstr("ACL scheduler: weighted"));
+  EXPECT_THAT(dump, ::testing::HasSubstr("handle 0x0001 classic priority:normal weight:4"));
+  EXPECT_THAT(dump, ::testing::HasSubstr("packets: 2 fragments: 2 bytes: 14 credits returned: 2"));
+
+  round_robin_scheduler_->Unregister(handle);
+}
+
 }  // namespace
 }  // namespace acl_manager
 }  // namespace hci
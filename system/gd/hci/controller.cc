@@ -20,11 +20,14 @@
 
 #include <android-base/strings.h>
 #include <future>
+#include <map>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "common/init_flags.h"
+#include "common/strings.h"
 #include "dumpsys_data_generated.h"
 #include "hci/controller_interface.h"
 #include "hci/event_checkers.h"
@@ -33,6 +36,8 @@
 #include "os/log.h"
 #include "os/metrics.h"
 #include "os/system_properties.h"
+#include "packet/raw_builder.h"
+#include "storage/storage_module.h"
 #include "sysprops/sysprops_module.h"
 
 namespace bluetooth {
@@ -50,47 +55,95 @@ constexpr bool kDefaultErroneousDataReportingEnabled = true;
 static const std::string kPropertyErroneousDataReportingEnabled =
     "bluetooth.hci.erroneous_data_reporting.enabled";
 
+constexpr bool kDefaultCapabilitySnapshotEnabled = false;
+static const std::string kPropertyCapabilitySnapshotEnabled =
+    "bluetooth.core.controller.capability_snapshot.enabled";
+static const std::string kCapabilitySnapshotSection = "Controller";
+static const std::string kCapabilitySnapshotCommandPrefix = "Command_";
+
+// Op code and parameter length
+constexpr size_t kCommandHeaderSize = 3;
+// Offset of Num_HCI_Command_Packets in a Command Complete event
+constexpr size_t kNumHciCommandPacketsOffset = 2;
+
 using os::Handler;
 
+static OpCode GetCommandOpCode(const std::vector<uint8_t>& command_bytes) {
+  return static_cast<OpCode>(command_bytes[0] | (command_bytes[1] << 8));
+}
+
+// Bytes of a capability read result, without the command credits that vary from one read to the next
+static std::vector<uint8_t> GetCapabilityReadBytes(const CommandCompleteView& view) {
+  std::vector<uint8_t> bytes(view.begin(), view.end());
+  bytes[kNumHciCommandPacketsOffset] = 1;
+  return bytes;
+}
+
 struct Controller::impl {
   impl(Controller& module) : module_(module) {}
 
-  void Start(hci::HciLayer* hci) {
+  void Start(hci::HciLayer* hci, storage::StorageModule* storage) {
     hci_ = hci;
+    storage_ = storage;
     Handler* handler = module_.GetHandler();
     hci_->RegisterEventHandler(
         EventCode::NUMBER_OF_COMPLETED_PACKETS, handler->BindOn(this, &Controller::impl::NumberOfCompletedPackets));
 
+    capability_snapshot_enabled_ = os::GetSystemPropertyBool(
+        kPropertyCapabilitySnapshotEnabled, kDefaultCapabilitySnapshotEnabled);
+    if (capability_snapshot_enabled_) {
+      // The snapshot is only valid for the controller and firmware it was taken from
+      std::promise<void> identity_promise;
+      auto identity_future = identity_promise.get_future();
+      hci_->EnqueueCommand(ReadLocalVersionInformationBuilder::Create(),
+                           handler->BindOnceOn(this, &Controller::impl::read_local_version_information_complete_handler));
+      hci_->EnqueueCommand(
+          ReadBdAddrBuilder::Create(),
+          handler->BindOnceOn(
+              this, &Controller::impl::read_controller_mac_address_handler, std::move(identity_promise)));
+      identity_future.wait();
+      replaying_capability_snapshot_ = capability_snapshot_matches();
+      LOG_INFO("Capability snapshot %s", replaying_capability_snapshot_ ? "found" : "not found");
+    }
+
     set_event_mask(kDefaultEventMask);
     write_le_host_support(Enable::ENABLED, Enable::DISABLED);
-    hci_->EnqueueCommand(ReadLocalNameBuilder::Create(),
-                         handler->BindOnceOn(this, &Controller::impl::read_local_name_complete_handler));
-    hci_->EnqueueCommand(ReadLocalVersionInformationBuilder::Create(),
-                         handler->BindOnceOn(this, &Controller::impl::read_local_version_information_complete_handler));
-    hci_->EnqueueCommand(ReadLocalSupportedCommandsBuilder::Create(),
-                         handler->BindOnceOn(this, &Controller::impl::read_local_supported_commands_complete_handler));
+    read_capability(
+        ReadLocalNameBuilder::Create(),
+        common::BindOnce(&Controller::impl::read_local_name_complete_handler, common::Unretained(this)));
+    if (!capability_snapshot_enabled_) {
+      hci_->EnqueueCommand(ReadLocalVersionInformationBuilder::Create(),
+                           handler->BindOnceOn(this, &Controller::impl::read_local_version_information_complete_handler));
+    }
+    read_capability(
+        ReadLocalSupportedCommandsBuilder::Create(),
+        common::BindOnce(&Controller::impl::read_local_supported_commands_complete_handler, common::Unretained(this)));
 
-    hci_->EnqueueCommand(
+    read_capability(
         LeReadLocalSupportedFeaturesBuilder::Create(),
-        handler->BindOnceOn(this, &Controller::impl::le_read_local_supported_features_handler));
+        common::BindOnce(&Controller::impl::le_read_local_supported_features_handler, common::Unretained(this)));
 
-    hci_->EnqueueCommand(
+    read_capability(
         LeReadSupportedStatesBuilder::Create(),
-        handler->BindOnceOn(this, &Controller::impl::le_read_supported_states_handler));
+        common::BindOnce(&Controller::impl::le_read_supported_states_handler, common::Unretained(this)));
 
     // Wait for all extended features read
     std::promise<void> features_promise;
     auto features_future = features_promise.get_future();
 
-    hci_->EnqueueCommand(ReadLocalExtendedFeaturesBuilder::Create(0x00),
-                         handler->BindOnceOn(this, &Controller::impl::read_local_extended_features_complete_handler,
-                                             std::move(features_promise)));
+    read_capability(
+        ReadLocalExtendedFeaturesBuilder::Create(0x00),
+        common::BindOnce(
+            &Controller::impl::read_local_extended_features_complete_handler,
+            common::Unretained(this),
+            std::move(features_promise)));
     features_future.wait();
 
     le_set_event_mask(MaskLeEventMask(local_version_information_.hci_version_, kDefaultLeEventMask));
 
-    hci_->EnqueueCommand(ReadBufferSizeBuilder::Create(),
-                         handler->BindOnceOn(this, &Controller::impl::read_buffer_size_complete_handler));
+    read_capability(
+        ReadBufferSizeBuilder::Create(),
+        common::BindOnce(&Controller::impl::read_buffer_size_complete_handler, common::Unretained(this)));
 
     if (common::init_flags::set_min_encryption_is_enabled() && is_supported(OpCode::SET_MIN_ENCRYPTION_KEY_SIZE)) {
       hci_->EnqueueCommand(
@@ -99,37 +152,38 @@ struct Controller::impl {
     }
 
     if (is_supported(OpCode::LE_READ_BUFFER_SIZE_V2)) {
-      hci_->EnqueueCommand(
+      read_capability(
           LeReadBufferSizeV2Builder::Create(),
-          handler->BindOnceOn(this, &Controller::impl::le_read_buffer_size_v2_handler));
+          common::BindOnce(&Controller::impl::le_read_buffer_size_v2_handler, common::Unretained(this)));
     } else {
-      hci_->EnqueueCommand(
+      read_capability(
           LeReadBufferSizeV1Builder::Create(),
-          handler->BindOnceOn(this, &Controller::impl::le_read_buffer_size_handler));
+          common::BindOnce(&Controller::impl::le_read_buffer_size_handler, common::Unretained(this)));
     }
 
     if (is_supported(OpCode::READ_LOCAL_SUPPORTED_CODECS_V1)) {
-      hci_->EnqueueCommand(
+      read_capability(
           ReadLocalSupportedCodecsV1Builder::Create(),
-          handler->BindOnceOn(this, &Controller::impl::read_local_supported_codecs_v1_handler));
+          common::BindOnce(&Controller::impl::read_local_supported_codecs_v1_handler, common::Unretained(this)));
     }
 
-    hci_->EnqueueCommand(
+    read_capability(
         LeReadFilterAcceptListSizeBuilder::Create(),
-        handler->BindOnceOn(this, &Controller::impl::le_read_accept_list_size_handler));
+        common::BindOnce(&Controller::impl::le_read_accept_list_size_handler, common::Unretained(this)));
 
     if (is_supported(OpCode::LE_READ_RESOLVING_LIST_SIZE) && module_.SupportsBlePrivacy()) {
-      hci_->EnqueueCommand(
+      read_capability(
           LeReadResolvingListSizeBuilder::Create(),
-          handler->BindOnceOn(this, &Controller::impl::le_read_resolving_list_size_handler));
+          common::BindOnce(&Controller::impl::le_read_resolving_list_size_handler, common::Unretained(this)));
     } else {
       LOG_INFO("LE_READ_RESOLVING_LIST_SIZE not supported, defaulting to 0");
       le_resolving_list_size_ = 0;
     }
 
     if (is_supported(OpCode::LE_READ_MAXIMUM_DATA_LENGTH) && module_.SupportsBleDataPacketLengthExtension()) {
-      hci_->EnqueueCommand(LeReadMaximumDataLengthBuilder::Create(),
-                           handler->BindOnceOn(this, &Controller::impl::le_read_maximum_data_length_handler));
+      read_capability(
+          LeReadMaximumDataLengthBuilder::Create(),
+          common::BindOnce(&Controller::impl::le_read_maximum_data_length_handler, common::Unretained(this)));
     } else {
       LOG_INFO("LE_READ_MAXIMUM_DATA_LENGTH not supported, defaulting to 0");
       le_maximum_data_length_.supported_max_rx_octets_ = 0;
@@ -147,18 +201,20 @@ struct Controller::impl {
               this, &Controller::impl::write_secure_connections_host_support_complete_handler));
     }
     if (is_supported(OpCode::LE_READ_SUGGESTED_DEFAULT_DATA_LENGTH) && module_.SupportsBleDataPacketLengthExtension()) {
-      hci_->EnqueueCommand(
+      read_capability(
           LeReadSuggestedDefaultDataLengthBuilder::Create(),
-          handler->BindOnceOn(this, &Controller::impl::le_read_suggested_default_data_length_handler));
+          common::BindOnce(
+              &Controller::impl::le_read_suggested_default_data_length_handler, common::Unretained(this)));
     } else {
       LOG_INFO("LE_READ_SUGGESTED_DEFAULT_DATA_LENGTH not supported, defaulting to 27 (0x1B)");
       le_suggested_default_data_length_ = 27;
     }
 
     if (is_supported(OpCode::LE_READ_MAXIMUM_ADVERTISING_DATA_LENGTH) && module_.SupportsBleExtendedAdvertising()) {
-      hci_->EnqueueCommand(
+      read_capability(
           LeReadMaximumAdvertisingDataLengthBuilder::Create(),
-          handler->BindOnceOn(this, &Controller::impl::le_read_maximum_advertising_data_length_handler));
+          common::BindOnce(
+              &Controller::impl::le_read_maximum_advertising_data_length_handler, common::Unretained(this)));
     } else {
       LOG_INFO("LE_READ_MAXIMUM_ADVERTISING_DATA_LENGTH not supported, defaulting to 31 (0x1F)");
       le_maximum_advertising_data_length_ = 31;
@@ -166,9 +222,10 @@ struct Controller::impl {
 
     if (is_supported(OpCode::LE_READ_NUMBER_OF_SUPPORTED_ADVERTISING_SETS) &&
         module_.SupportsBleExtendedAdvertising()) {
-      hci_->EnqueueCommand(
+      read_capability(
           LeReadNumberOfSupportedAdvertisingSetsBuilder::Create(),
-          handler->BindOnceOn(this, &Controller::impl::le_read_number_of_supported_advertising_sets_handler));
+          common::BindOnce(
+              &Controller::impl::le_read_number_of_supported_advertising_sets_handler, common::Unretained(this)));
     } else {
       LOG_INFO("LE_READ_NUMBER_OF_SUPPORTED_ADVERTISING_SETS not supported, defaulting to 1");
       le_number_supported_advertising_sets_ = 1;
@@ -176,13 +233,15 @@ struct Controller::impl {
 
     if (is_supported(OpCode::LE_READ_PERIODIC_ADVERTISER_LIST_SIZE) &&
         module_.SupportsBlePeriodicAdvertising()) {
-      hci_->EnqueueCommand(
+      read_capability(
           LeReadPeriodicAdvertiserListSizeBuilder::Create(),
-          handler->BindOnceOn(this, &Controller::impl::le_read_periodic_advertiser_list_size_handler));
+          common::BindOnce(
+              &Controller::impl::le_read_periodic_advertiser_list_size_handler, common::Unretained(this)));
     } else {
       LOG_INFO("LE_READ_PERIODIC_ADVERTISER_LIST_SIZE not supported, defaulting to 0");
       le_periodic_advertiser_list_size_ = 0;
     }
+
     if (is_supported(OpCode::LE_SET_HOST_FEATURE) && module_.SupportsBleConnectedIsochronousStreamCentral()) {
       hci_->EnqueueCommand(
           LeSetHostFeatureBuilder::Create(LeHostFeatureBits::CONNECTED_ISO_STREAM_HOST_SUPPORT, Enable::ENABLED),
@@ -200,10 +259,10 @@ struct Controller::impl {
     if (os::GetSystemPropertyBool(
             kPropertyErroneousDataReportingEnabled, kDefaultErroneousDataReportingEnabled)) {
         if (is_supported(OpCode::READ_DEFAULT_ERRONEOUS_DATA_REPORTING)) {
-          hci_->EnqueueCommand(
+          read_capability(
               ReadDefaultErroneousDataReportingBuilder::Create(),
-              handler->BindOnceOn(
-                  this, &Controller::impl::read_default_erroneous_data_reporting_handler));
+              common::BindOnce(
+                  &Controller::impl::read_default_erroneous_data_reporting_handler, common::Unretained(this)));
         }
     }
 
@@ -213,30 +272,146 @@ struct Controller::impl {
       // More commands can be enqueued from le_get_vendor_capabilities_handler
       std::promise<void> vendor_promise;
       auto vendor_future = vendor_promise.get_future();
-      hci_->EnqueueCommand(
+      read_capability(
           LeGetVendorCapabilitiesBuilder::Create(),
-          handler->BindOnceOn(
-              this,
+          common::BindOnce(
               &Controller::impl::le_get_vendor_capabilities_handler,
+              common::Unretained(this),
               std::move(vendor_promise)));
       vendor_future.wait();
     } else {
       vendor_capabilities_.is_supported_ = 0x00;
     }
 
-    // We only need to synchronize the last read. Make BD_ADDR to be the last one.
     std::promise<void> promise;
     auto future = promise.get_future();
-    hci_->EnqueueCommand(
-        ReadBdAddrBuilder::Create(),
-        handler->BindOnceOn(this, &Controller::impl::read_controller_mac_address_handler, std::move(promise)));
+    if (replaying_capability_snapshot_ && !capability_snapshot_outdated_) {
+      // Every read was answered from the snapshot, on the handler and in order. The writes above are left in flight:
+      // commands sent by other modules are queued behind them.
+      handler->Post(common::BindOnce(&std::promise<void>::set_value, common::Unretained(&promise)));
+    } else {
+      // We only need to synchronize the last read. Make BD_ADDR to be the last one.
+      hci_->EnqueueCommand(
+          ReadBdAddrBuilder::Create(),
+          handler->BindOnceOn(this, &Controller::impl::read_controller_mac_address_handler, std::move(promise)));
+    }
     future.wait();
+
+    if (replaying_capability_snapshot_) {
+      handler->Post(
+          common::BindOnce(&Controller::impl::validate_capability_snapshot, common::Unretained(this)));
+    } else if (capability_snapshot_enabled_) {
+      store_capability_snapshot();
+    }
   }
 
   void Stop() {
     hci_ = nullptr;
   }
 
+  // Sends a command whose result only depends on the controller, or answers it from the capability snapshot
+  void read_capability(
+      std::unique_ptr<CommandBuilder> command, common::OnceCallback<void(CommandCompleteView)> on_complete) {
+    std::vector<uint8_t> command_bytes(command->size());
+    command->SerializeInto(command_bytes);
+    if (replaying_capability_snapshot_) {
+      auto event_bytes =
+          storage_->GetBin(kCapabilitySnapshotSection, kCapabilitySnapshotCommandPrefix + common::ToHexString(command_bytes));
+      if (event_bytes) {
+        auto view = CommandCompleteView::Create(EventView::Create(
+            PacketView<kLittleEndian>(std::make_shared<std::vector<uint8_t>>(std::move(*event_bytes)))));
+        if (view.IsValid()) {
+          module_.GetHandler()->Post(common::BindOnce(
+              &Controller::impl::on_capability_read_complete,
+              common::Unretained(this),
+              std::move(command_bytes),
+              true,
+              std::move(on_complete),
+              view));
+          return;
+        }
+      }
+      LOG_INFO("%s is not in the capability snapshot", OpCodeText(GetCommandOpCode(command_bytes)).c_str());
+      capability_snapshot_outdated_ = true;
+    }
+    hci_->EnqueueCommand(
+        std::move(command),
+        module_.GetHandler()->BindOnceOn(
+            this, &Controller::impl::on_capability_read_complete, std::move(command_bytes), false, std::move(on_complete)));
+  }
+
+  void on_capability_read_complete(
+      std::vector<uint8_t> command_bytes,
+      bool from_snapshot,
+      common::OnceCallback<void(CommandCompleteView)> on_complete,
+      CommandCompleteView view) {
+    if (capability_snapshot_enabled_) {
+      if (from_snapshot) {
+        snapshot_commands_.push_back(command_bytes);
+      }
+      capability_reads_[std::move(command_bytes)] = GetCapabilityReadBytes(view);
+    }
+    std::move(on_complete).Run(view);
+  }
+
+  bool capability_snapshot_matches() const {
+    const LocalVersionInformation& version = local_version_information_;
+    return storage_->GetInt(kCapabilitySnapshotSection, "Manufacturer") == version.manufacturer_name_ &&
+           storage_->GetInt(kCapabilitySnapshotSection, "LmpSubversion") == version.lmp_subversion_ &&
+           storage_->GetInt(kCapabilitySnapshotSection, "LmpVersion") == static_cast<int>(version.lmp_version_) &&
+           storage_->GetInt(kCapabilitySnapshotSection, "HciRevision") == version.hci_revision_ &&
+           storage_->GetInt(kCapabilitySnapshotSection, "HciVersion") == static_cast<int>(version.hci_version_) &&
+           storage_->GetProperty(kCapabilitySnapshotSection, "Address") == mac_address_.ToString();
+  }
+
+  void store_capability_snapshot() {
+    LOG_INFO("Storing capability snapshot of %zu reads", capability_reads_.size());
+    const LocalVersionInformation& version = local_version_information_;
+    storage_->RemoveSection(kCapabilitySnapshotSection);
+    storage_->SetInt(kCapabilitySnapshotSection, "Manufacturer", version.manufacturer_name_);
+    storage_->SetInt(kCapabilitySnapshotSection, "LmpSubversion", version.lmp_subversion_);
+    storage_->SetInt(kCapabilitySnapshotSection, "LmpVersion", static_cast<int>(version.lmp_version_));
+    storage_->SetInt(kCapabilitySnapshotSection, "HciRevision", version.hci_revision_);
+    storage_->SetInt(kCapabilitySnapshotSection, "HciVersion", static_cast<int>(version.hci_version_));
+    storage_->SetProperty(kCapabilitySnapshotSection, "Address", mac_address_.ToString());
+    for (const auto& [command_bytes, event_bytes] : capability_reads_) {
+      storage_->SetBin(
+          kCapabilitySnapshotSection, kCapabilitySnapshotCommandPrefix + common::ToHexString(command_bytes), event_bytes);
+    }
+  }
+
+  // The stack is already running on the snapshot, so a controller that now answers differently only gets its new
+  // answers used on the next start
+  void validate_capability_snapshot() {
+    pending_snapshot_validations_ = snapshot_commands_.size();
+    for (const auto& command_bytes : snapshot_commands_) {
+      auto payload = std::make_unique<packet::RawBuilder>(
+          std::vector<uint8_t>(command_bytes.begin() + kCommandHeaderSize, command_bytes.end()));
+      hci_->EnqueueCommand(
+          CommandBuilder::Create(GetCommandOpCode(command_bytes), std::move(payload)),
+          module_.GetHandler()->BindOnceOn(this, &Controller::impl::on_capability_snapshot_validated, command_bytes));
+    }
+    snapshot_commands_.clear();
+    if (pending_snapshot_validations_ == 0 && capability_snapshot_outdated_) {
+      store_capability_snapshot();
+    }
+  }
+
+  void on_capability_snapshot_validated(std::vector<uint8_t> command_bytes, CommandCompleteView view) {
+    auto event_bytes = GetCapabilityReadBytes(view);
+    auto& snapshot_bytes = capability_reads_[command_bytes];
+    if (event_bytes != snapshot_bytes) {
+      LOG_WARN(
+          "Controller no longer matches the capability snapshot for %s",
+          OpCodeText(view.GetCommandOpCode()).c_str());
+      snapshot_bytes = std::move(event_bytes);
+      capability_snapshot_outdated_ = true;
+    }
+    if (--pending_snapshot_validations_ == 0 && capability_snapshot_outdated_) {
+      store_capability_snapshot();
+    }
+  }
+
   void NumberOfCompletedPackets(EventView event) {
     if (acl_credits_callback_.IsEmpty()) {
       LOG_WARN("Received event when AclManager is not listening");
@@ -346,10 +521,12 @@ struct Controller::impl {
     // Query all extended features
     if (page_number < complete_view.GetMaximumPageNumber()) {
       page_number++;
-      hci_->EnqueueCommand(
+      read_capability(
           ReadLocalExtendedFeaturesBuilder::Create(page_number),
-          module_.GetHandler()->BindOnceOn(this, &Controller::impl::read_local_extended_features_complete_handler,
-                                           std::move(promise)));
+          common::BindOnce(
+              &Controller::impl::read_local_extended_features_complete_handler,
+              common::Unretained(this),
+              std::move(promise)));
     } else {
       promise.set_value();
     }
@@ -668,11 +845,11 @@ struct Controller::impl {
       }
 
       if (vendor_capabilities_.dynamic_audio_buffer_support_) {
-        hci_->EnqueueCommand(
+        read_capability(
             DabGetAudioBufferTimeCapabilityBuilder::Create(),
-            module_.GetHandler()->BindOnceOn(
-                this,
+            common::BindOnce(
                 &Controller::impl::le_get_dynamic_audio_buffer_support_handler,
+                common::Unretained(this),
                 std::move(vendor_promise)));
         return;
       }
@@ -683,11 +860,11 @@ struct Controller::impl {
         vendor_promise.set_value();
         return;
       }
-      hci_->EnqueueCommand(
+      read_capability(
           DabGetAudioBufferTimeCapabilityBuilder::Create(),
-          module_.GetHandler()->BindOnceOn(
-              this,
+          common::BindOnce(
               &Controller::impl::le_get_dynamic_audio_buffer_support_handler,
+              common::Unretained(this),
               std::move(vendor_promise)));
     }
   }
@@ -1212,6 +1389,18 @@ struct Controller::impl {
   Controller& module_;
 
   HciLayer* hci_;
+  storage::StorageModule* storage_;
+
+  bool capability_snapshot_enabled_{false};
+  // Capability reads are answered from the snapshot taken on a previous start
+  bool replaying_capability_snapshot_{false};
+  // The snapshot missed a read or the controller answered a read differently, so it must be stored again
+  bool capability_snapshot_outdated_{false};
+  // Command Complete events of the capability reads, by serialized command
+  std::map<std::vector<uint8_t>, std::vector<uint8_t>> capability_reads_{};
+  // Commands answered from the snapshot, to be sent to the controller once the stack is up
+  std::vector<std::vector<uint8_t>> snapshot_commands_{};
+  size_t pending_snapshot_validations_{0};
 
   CompletedAclPacketsCallback acl_credits_callback_{};
   CompletedAclPacketsCallback acl_monitor_credits_callback_{};
@@ -1558,11 +1747,12 @@ const ModuleFactory Controller::Factory = ModuleFactory([]() { return new Contro
 
 void Controller::ListDependencies(ModuleList* list) const {
   list->add<hci::HciLayer>();
+  list->add<storage::StorageModule>();
   list->add<sysprops::SyspropsModule>();
 }
 
 void Controller::Start() {
-  impl_->Start(GetDependency<hci::HciLayer>());
+  impl_->Start(GetDependency<hci::HciLayer>(), GetDependency<storage::StorageModule>());
 }
 
 void Controller::Stop() {
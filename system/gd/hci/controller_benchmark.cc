@@ -0,0 +1,253 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <thread>
+
+#include "benchmark/benchmark.h"
+#include "common/bind.h"
+#include "hci/controller.h"
+#include "hci/hci_layer_fake.h"
+#include "module.h"
+#include "os/handler.h"
+#include "os/system_properties.h"
+#include "os/thread.h"
+#include "packet/raw_builder.h"
+#include "storage/storage_module.h"
+
+using ::benchmark::State;
+using ::bluetooth::TestModuleRegistry;
+using ::bluetooth::hci::Controller;
+using ::bluetooth::hci::HciLayer;
+
+namespace bluetooth {
+namespace hci {
+namespace {
+
+// Answers every command after |round_trip|, one command at a time, like a controller granting a single credit
+class HciLayerFakeController : public HciLayerFake {
+ public:
+  explicit HciLayerFakeController(std::chrono::microseconds round_trip) : round_trip_(round_trip) {}
+
+  void EnqueueCommand(
+      std::unique_ptr<CommandBuilder> command,
+      common::ContextualOnceCallback<void(CommandCompleteView)> on_complete) override {
+    commands_sent_++;
+    controller_handler_.Post(common::BindOnce(
+        &HciLayerFakeController::HandleCommand,
+        common::Unretained(this),
+        std::move(command),
+        std::move(on_complete)));
+  }
+
+  size_t GetCommandsSent() const {
+    return commands_sent_;
+  }
+
+ protected:
+  void Stop() override {
+    controller_handler_.Clear();
+    controller_handler_.WaitUntilStopped(std::chrono::seconds(1));
+    HciLayerFake::Stop();
+  }
+
+ private:
+  void HandleCommand(
+      std::unique_ptr<CommandBuilder> command_builder,
+      common::ContextualOnceCallback<void(CommandCompleteView)> on_complete) {
+    std::this_thread::sleep_for(round_trip_);
+    CommandView command = CommandView::Create(GetPacketView(std::move(command_builder)));
+    auto event = EventView::Create(GetPacketView(CreateCommandComplete(command)));
+    on_complete.Invoke(CommandCompleteView::Create(event));
+  }
+
+  static std::unique_ptr<EventBuilder> CreateCommandComplete(CommandView command) {
+    switch (command.GetOpCode()) {
+      case OpCode::READ_LOCAL_NAME: {
+        std::array<uint8_t, 248> local_name = {'D', 'U', 'T', '\0'};
+        return ReadLocalNameCompleteBuilder::Create(1, ErrorCode::SUCCESS, local_name);
+      }
+      case OpCode::READ_LOCAL_VERSION_INFORMATION: {
+        LocalVersionInformation local_version_information;
+        local_version_information.hci_version_ = HciVersion::V_5_3;
+        local_version_information.hci_revision_ = 0x1234;
+        local_version_information.lmp_version_ = LmpVersion::V_5_3;
+        local_version_information.manufacturer_name_ = 0x001d;
+        local_version_information.lmp_subversion_ = 0x5678;
+        return ReadLocalVersionInformationCompleteBuilder::Create(
+            1, ErrorCode::SUCCESS, local_version_information);
+      }
+      case OpCode::READ_LOCAL_SUPPORTED_COMMANDS: {
+        std::array<uint8_t, 64> supported_commands{};
+        for (int i = 0; i < 37; i++) {
+          supported_commands[i] = 0xff;
+        }
+        return ReadLocalSupportedCommandsCompleteBuilder::Create(1, ErrorCode::SUCCESS, supported_commands);
+      }
+      case OpCode::READ_LOCAL_EXTENDED_FEATURES: {
+        auto read_command = ReadLocalExtendedFeaturesView::Create(command);
+        uint8_t page_number = read_command.GetPageNumber();
+        return ReadLocalExtendedFeaturesCompleteBuilder::Create(
+            1, ErrorCode::SUCCESS, page_number, 0x02, 0x012345678abcdef + page_number);
+      }
+      case OpCode::READ_LOCAL_SUPPORTED_CODECS_V1:
+        return ReadLocalSupportedCodecsV1CompleteBuilder::Create(
+            1, ErrorCode::SUCCESS, std::vector<uint8_t>{0, 1, 2, 3, 4, 5, 6}, std::vector<uint32_t>{});
+      case OpCode::READ_BUFFER_SIZE:
+        return ReadBufferSizeCompleteBuilder::Create(1, ErrorCode::SUCCESS, 1021, 60, 8, 12);
+      case OpCode::READ_BD_ADDR:
+        return ReadBdAddrCompleteBuilder::Create(1, ErrorCode::SUCCESS, Address({0x01, 0x02, 0x03, 0x04, 0x05, 0x06}));
+      case OpCode::LE_READ_BUFFER_SIZE_V1: {
+        LeBufferSize le_buffer_size;
+        le_buffer_size.le_data_packet_length_ = 251;
+        le_buffer_size.total_num_le_packets_ = 8;
+        return LeReadBufferSizeV1CompleteBuilder::Create(1, ErrorCode::SUCCESS, le_buffer_size);
+      }
+      case OpCode::LE_READ_LOCAL_SUPPORTED_FEATURES:
+        return LeReadLocalSupportedFeaturesCompleteBuilder::Create(1, ErrorCode::SUCCESS, 0x001f123456789abc);
+      case OpCode::LE_READ_SUPPORTED_STATES:
+        return LeReadSupportedStatesCompleteBuilder::Create(1, ErrorCode::SUCCESS, 0x001f123456789abe);
+      case OpCode::LE_READ_FILTER_ACCEPT_LIST_SIZE:
+        return LeReadFilterAcceptListSizeCompleteBuilder::Create(1, ErrorCode::SUCCESS, 0x80);
+      case OpCode::LE_READ_RESOLVING_LIST_SIZE:
+        return LeReadResolvingListSizeCompleteBuilder::Create(1, ErrorCode::SUCCESS, 0x20);
+      case OpCode::LE_READ_MAXIMUM_DATA_LENGTH: {
+        LeMaximumDataLength le_maximum_data_length;
+        le_maximum_data_length.supported_max_tx_octets_ = 251;
+        le_maximum_data_length.supported_max_tx_time_ = 2120;
+        le_maximum_data_length.supported_max_rx_octets_ = 251;
+        le_maximum_data_length.supported_max_rx_time_ = 2120;
+        return LeReadMaximumDataLengthCompleteBuilder::Create(1, ErrorCode::SUCCESS, le_maximum_data_length);
+      }
+      case OpCode::LE_READ_SUGGESTED_DEFAULT_DATA_LENGTH:
+        return LeReadSuggestedDefaultDataLengthCompleteBuilder::Create(1, ErrorCode::SUCCESS, 251, 2120);
+      case OpCode::LE_READ_MAXIMUM_ADVERTISING_DATA_LENGTH:
+        return LeReadMaximumAdvertisingDataLengthCompleteBuilder::Create(1, ErrorCode::SUCCESS, 0x0672);
+      case OpCode::LE_READ_NUMBER_OF_SUPPORTED_ADVERTISING_SETS:
+        return LeReadNumberOfSupportedAdvertisingSetsCompleteBuilder::Create(1, ErrorCode::SUCCESS, 0x10);
+      case OpCode::LE_READ_PERIODIC_ADVERTISER_LIST_SIZE:
+        return LeReadPeriodicAdvertiserListSizeCompleteBuilder::Create(1, ErrorCode::SUCCESS, 0x08);
+      default:
+        // Writes, and reads the controller may reject, such as vendor capabilities
+        return CommandCompleteBuilder::Create(
+            1, command.GetOpCode(), std::make_unique<packet::RawBuilder>(std::vector<uint8_t>{0x00}));
+    }
+  }
+
+  const std::chrono::microseconds round_trip_;
+  std::atomic<size_t> commands_sent_{0};
+  os::Thread controller_thread_{"fake_controller", os::Thread::Priority::NORMAL};
+  os::Handler controller_handler_{&controller_thread_};
+};
+
+class TestStorageModule : public storage::StorageModule {
+ public:
+  explicit TestStorageModule(std::string config_file_path)
+      : StorageModule(std::move(config_file_path), std::chrono::milliseconds(100), 10, false, false) {}
+
+ protected:
+  void Start() override {
+    StorageModule::Start();
+    // A config without an adapter section is not loaded again
+    SetProperty(kAdapterSection, "Address", "01:02:03:04:05:06");
+  }
+};
+
+}  // namespace
+}  // namespace hci
+}  // namespace bluetooth
+
+using ::bluetooth::hci::HciLayerFakeController;
+using ::bluetooth::hci::TestStorageModule;
+
+class BM_ControllerStartup : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    config_path_ = std::filesystem::temp_directory_path() / "bm_controller_config.conf";
+    DeleteConfigFiles();
+    bluetooth::os::SetSystemProperty("bluetooth.core.controller.capability_snapshot.enabled", "true");
+  }
+
+  void TearDown(State& st) override {
+    DeleteConfigFiles();
+    bluetooth::os::ClearSystemPropertiesForHost();
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  void DeleteConfigFiles() {
+    std::filesystem::remove(config_path_);
+    std::filesystem::remove(std::filesystem::path(config_path_).replace_extension(".bak"));
+  }
+
+  // Returns the number of commands sent by the time the controller is ready
+  size_t StartController(State& state) {
+    auto* hci_layer = new HciLayerFakeController(std::chrono::microseconds(state.range(0)));
+    registry_.InjectTestModule(&HciLayer::Factory, hci_layer);
+    registry_.InjectTestModule(&bluetooth::storage::StorageModule::Factory, new TestStorageModule(config_path_.string()));
+    registry_.Start<Controller>(&registry_.GetTestThread());
+    return hci_layer->GetCommandsSent();
+  }
+
+  std::filesystem::path config_path_;
+  TestModuleRegistry registry_;
+};
+
+// No snapshot stored: every capability is read from the controller
+BENCHMARK_DEFINE_F(BM_ControllerStartup, cold_start)(State& state) {
+  size_t commands_sent = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    DeleteConfigFiles();
+    state.ResumeTiming();
+    commands_sent = StartController(state);
+    state.PauseTiming();
+    registry_.StopAll();
+    state.ResumeTiming();
+  }
+  state.counters["commands_sent"] = commands_sent;
+}
+
+BENCHMARK_REGISTER_F(BM_ControllerStartup, cold_start)
+    ->Arg(0)
+    ->Arg(500)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Snapshot stored by a previous start: only the controller identity is read before the controller is ready
+BENCHMARK_DEFINE_F(BM_ControllerStartup, warm_start)(State& state) {
+  StartController(state);
+  // Let the storage module take the snapshot save before it stops
+  registry_.SynchronizeModuleHandler(&bluetooth::storage::StorageModule::Factory, std::chrono::seconds(1));
+  registry_.StopAll();
+  size_t commands_sent = 0;
+  for (auto _ : state) {
+    commands_sent = StartController(state);
+    state.PauseTiming();
+    registry_.StopAll();
+    state.ResumeTiming();
+  }
+  state.counters["commands_sent"] = commands_sent;
+}
+
+BENCHMARK_REGISTER_F(BM_ControllerStartup, warm_start)
+    ->Arg(0)
+    ->Arg(500)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
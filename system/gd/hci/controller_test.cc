@@ -21,6 +21,7 @@
 #include <unistd.h>
 
 #include <chrono>
+#include <filesystem>
 #include <future>
 #include <memory>
 #include <sstream>
@@ -30,8 +31,10 @@
 #include "hci/address.h"
 #include "hci/hci_layer_fake.h"
 #include "module_dumper.h"
+#include "os/system_properties.h"
 #include "os/thread.h"
 #include "packet/raw_builder.h"
+#include "storage/storage_module.h"
 
 using namespace bluetooth;
 using namespace std::chrono_literals;
@@ -59,6 +62,23 @@ constexpr char title[] = "hci_controller_test";
 
 namespace {
 
+class TestStorageModule : public storage::StorageModule {
+ public:
+  explicit TestStorageModule(std::string config_file_path)
+      : StorageModule(std::move(config_file_path), std::chrono::milliseconds(100), 10, false, false) {}
+
+  bool HasSectionPublic(const std::string& section) const {
+    return HasSection(section);
+  }
+
+ protected:
+  void Start() override {
+    StorageModule::Start();
+    // A config without an adapter section is not loaded again
+    SetProperty(kAdapterSection, "Address", "01:02:03:04:05:06");
+  }
+};
+
 class HciLayerFakeForController : public HciLayerFake {
  public:
   void EnqueueCommand(
@@ -101,7 +121,7 @@ class HciLayerFakeForController : public HciLayerFake {
         local_version_information.hci_revision_ = 0x1234;
         local_version_information.lmp_version_ = LmpVersion::V_4_2;
         local_version_information.manufacturer_name_ = 0xBAD;
-        local_version_information.lmp_subversion_ = 0x5678;
+        local_version_information.lmp_subversion_ = lmp_subversion;
         event_builder = ReadLocalVersionInformationCompleteBuilder::Create(
             num_packets, ErrorCode::SUCCESS, local_version_information);
       } break;
@@ -167,8 +187,8 @@ class HciLayerFakeForController : public HciLayerFake {
             LeReadMaximumDataLengthCompleteBuilder::Create(num_packets, ErrorCode::SUCCESS, le_maximum_data_length);
       } break;
       case (OpCode::LE_READ_MAXIMUM_ADVERTISING_DATA_LENGTH): {
-        event_builder =
-            LeReadMaximumAdvertisingDataLengthCompleteBuilder::Create(num_packets, ErrorCode::SUCCESS, 0x0672);
+        event_builder = LeReadMaximumAdvertisingDataLengthCompleteBuilder::Create(
+            num_packets, ErrorCode::SUCCESS, le_maximum_advertising_data_length);
       } break;
       case (OpCode::LE_READ_NUMBER_OF_SUPPORTED_ADVERTISING_SETS): {
         event_builder =
@@ -277,6 +297,8 @@ class HciLayerFakeForController : public HciLayerFake {
   uint64_t event_mask = 0;
   uint64_t le_event_mask = 0;
   uint16_t dynamic_audio_buffer_time = 0;
+  uint16_t lmp_subversion = 0x5678;
+  uint16_t le_maximum_advertising_data_length = 0x0672;
 };
 
 class ControllerTest : public ::testing::Test {
@@ -284,26 +306,71 @@ class ControllerTest : public ::testing::Test {
   void SetUp() override {
     feature_spec_version = feature_spec_version_;
     bluetooth::common::InitFlags::SetAllForTesting();
+    temp_config_ = std::filesystem::temp_directory_path() / "controller_test_config.conf";
+    DeleteConfigFiles();
+    StartController();
+  }
+
+  void TearDown() override {
+    fake_registry_.StopAll();
+    DeleteConfigFiles();
+  }
+
+  void StartController() {
     test_hci_layer_ = new HciLayerFakeForController;
     test_hci_layer_->vendor_capabilities_ = std::move(vendor_capabilities_);
+    test_hci_layer_->lmp_subversion = lmp_subversion_;
+    test_hci_layer_->le_maximum_advertising_data_length = le_maximum_advertising_data_length_;
     vendor_capabilities_.reset();
     fake_registry_.InjectTestModule(&HciLayer::Factory, test_hci_layer_);
     client_handler_ = fake_registry_.GetTestModuleHandler(&HciLayer::Factory);
+    test_storage_ = new TestStorageModule(temp_config_.string());
+    fake_registry_.InjectTestModule(&storage::StorageModule::Factory, test_storage_);
     fake_registry_.Start<Controller>(&thread_);
     controller_ = static_cast<Controller*>(fake_registry_.GetModuleUnderTest(&Controller::Factory));
   }
 
-  void TearDown() override {
-    fake_registry_.StopAll();
+  void DeleteConfigFiles() {
+    std::filesystem::remove(temp_config_);
+    std::filesystem::remove(std::filesystem::path(temp_config_).replace_extension(".bak"));
   }
 
   TestModuleRegistry fake_registry_;
   HciLayerFakeForController* test_hci_layer_ = nullptr;
+  TestStorageModule* test_storage_ = nullptr;
+  std::filesystem::path temp_config_;
   os::Thread& thread_ = fake_registry_.GetTestThread();
   Controller* controller_ = nullptr;
   os::Handler* client_handler_ = nullptr;
   uint16_t feature_spec_version_ = 98;
   std::unique_ptr<EventBuilder> vendor_capabilities_ = nullptr;
+  uint16_t lmp_subversion_ = 0x5678;
+  uint16_t le_maximum_advertising_data_length_ = 0x0672;
+};
+
+class ControllerCapabilitySnapshotTest : public ControllerTest {
+ protected:
+  void SetUp() override {
+    os::SetSystemProperty("bluetooth.core.controller.capability_snapshot.enabled", "true");
+    ControllerTest::SetUp();
+  }
+
+  void TearDown() override {
+    ControllerTest::TearDown();
+    os::ClearSystemPropertiesForHost();
+  }
+
+  void RestartController() {
+    // Let the snapshot validation run to completion
+    for (int i = 0; i < 3; i++) {
+      ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&Controller::Factory, std::chrono::milliseconds(100)));
+      ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, std::chrono::milliseconds(100)));
+      ASSERT_TRUE(fake_registry_.SynchronizeModuleHandler(
+          &storage::StorageModule::Factory, std::chrono::milliseconds(100)));
+    }
+    fake_registry_.StopAll();
+    StartController();
+  }
 };
 }  // namespace
 
@@ -652,5 +719,35 @@ TEST_F(ControllerTest, Dumpsys) {
   ASSERT_TRUE(output.find("Hci Controller Dumpsys") != std::string::npos);
 }
 
+TEST_F(ControllerTest, capability_snapshot_disabled) {
+  ASSERT_FALSE(test_storage_->HasSectionPublic("Controller"));
+}
+
+TEST_F(ControllerCapabilitySnapshotTest, cold_start_stores_snapshot) {
+  ASSERT_TRUE(test_storage_->HasSectionPublic("Controller"));
+  ASSERT_EQ(controller_->GetLeMaximumAdvertisingDataLength(), 0x0672);
+}
+
+TEST_F(ControllerCapabilitySnapshotTest, warm_start_applies_snapshot_then_refreshes_it) {
+  le_maximum_advertising_data_length_ = 0x0100;
+  RestartController();
+  // Taken from the snapshot
+  ASSERT_EQ(controller_->GetLeMaximumAdvertisingDataLength(), 0x0672);
+  ASSERT_EQ(controller_->GetLocalName(), "DUT");
+  ASSERT_EQ(controller_->GetAclPacketLength(), test_hci_layer_->acl_data_packet_length);
+
+  // The background validation stored what the controller answers now
+  RestartController();
+  ASSERT_EQ(controller_->GetLeMaximumAdvertisingDataLength(), 0x0100);
+}
+
+TEST_F(ControllerCapabilitySnapshotTest, snapshot_of_other_firmware_is_ignored) {
+  lmp_subversion_ = 0x5679;
+  le_maximum_advertising_data_length_ = 0x0100;
+  RestartController();
+  ASSERT_EQ(controller_->GetLocalVersionInformation().lmp_subversion_, 0x5679);
+  ASSERT_EQ(controller_->GetLeMaximumAdvertisingDataLength(), 0x0100);
+}
+
 }  // namespace hci
 }  // namespace bluetooth
@@ -20,6 +20,11 @@
 #include <signal.h>
 #endif
 
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <cstdio>
+
 #include "common/bind.h"
 #include "common/init_flags.h"
 #include "common/stop_watch.h"
@@ -28,6 +33,7 @@
 #include "os/alarm.h"
 #include "os/metrics.h"
 #include "os/queue.h"
+#include "os/system_properties.h"
 #include "osi/include/stack_power_telemetry.h"
 #include "packet/packet_builder.h"
 #include "storage/storage_module.h"
@@ -52,6 +58,11 @@ using os::Alarm;
 using os::Handler;
 using std::unique_ptr;
 
+// More than one outstanding command is only sent when this is above 1, and never more than the controller accepts
+static const std::string kPropertyMaxCommandsInFlight = "bluetooth.hci.max_commands_in_flight";
+static constexpr uint32_t kDefaultMaxCommandsInFlight = 1;
+static constexpr uint32_t kMaxCommandsInFlight = 8;
+
 static void fail_if_reset_complete_not_success(CommandCompleteView complete) {
   auto reset_complete = ResetCompleteView::Create(complete);
   ASSERT(reset_complete.IsValid());
@@ -81,7 +92,10 @@ class CommandQueueEntry {
         on_status(std::move(on_status_function)) {}
 
   unique_ptr<CommandBuilder> command;
+  // Set when the command is serialized, which may happen before it is sent
+  std::shared_ptr<std::vector<uint8_t>> command_bytes;
   unique_ptr<CommandView> command_view;
+  std::chrono::steady_clock::time_point sent_time;
 
   bool waiting_for_status_;
   ContextualOnceCallback<void(CommandStatusView)> on_status;
@@ -104,8 +118,17 @@ class CommandQueueEntry {
 };
 
 struct HciLayer::impl {
-  impl(hal::HciHal* hal, HciLayer& module) : hal_(hal), module_(module) {
+  impl(hal::HciHal* hal, HciLayer& module)
+      : hal_(hal),
+        module_(module),
+        max_commands_in_flight_(std::clamp(
+            os::GetSystemPropertyUint32(kPropertyMaxCommandsInFlight, kDefaultMaxCommandsInFlight),
+            uint32_t{1},
+            kMaxCommandsInFlight)) {
     hci_timeout_alarm_ = new Alarm(module.GetHandler());
+    if (max_commands_in_flight_ > 1) {
+      LOG_INFO("Pipelining up to %zu HCI commands", max_commands_in_flight_);
+    }
   }
 
   ~impl() {
@@ -127,26 +150,26 @@ struct HciLayer::impl {
 
   void on_outbound_acl_ready() {
     auto packet = acl_queue_.GetDownEnd()->TryDequeue();
-    std::vector<uint8_t> bytes;
-    BitInserter bi(bytes);
-    packet->Serialize(bi);
-    hal_->sendAclData(bytes);
+    // Serialize straight into the buffer handed over to the HAL
+    std::vector<uint8_t> bytes(packet->size());
+    bytes.resize(packet->SerializeInto(bytes));
+    hal_->sendAclData(std::move(bytes));
   }
 
   void on_outbound_sco_ready() {
     auto packet = sco_queue_.GetDownEnd()->TryDequeue();
-    std::vector<uint8_t> bytes;
-    BitInserter bi(bytes);
-    packet->Serialize(bi);
-    hal_->sendScoData(bytes);
+    // Serialize straight into the buffer handed over to the HAL
+    std::vector<uint8_t> bytes(packet->size());
+    bytes.resize(packet->SerializeInto(bytes));
+    hal_->sendScoData(std::move(bytes));
   }
 
   void on_outbound_iso_ready() {
     auto packet = iso_queue_.GetDownEnd()->TryDequeue();
-    std::vector<uint8_t> bytes;
-    BitInserter bi(bytes);
-    packet->Serialize(bi);
-    hal_->sendIsoData(bytes);
+    // Serialize straight into the buffer handed over to the HAL
+    std::vector<uint8_t> bytes(packet->size());
+    bytes.resize(packet->SerializeInto(bytes));
+    hal_->sendIsoData(std::move(bytes));
   }
 
   template <typename TResponse>
@@ -192,22 +215,24 @@ struct HciLayer::impl {
         logging_id.c_str(),
         op_code,
         OpCodeText(op_code).c_str());
-    if (waiting_command_ == OpCode::CONTROLLER_DEBUG_INFO && op_code != OpCode::CONTROLLER_DEBUG_INFO) {
+    OpCode waiting_command = get_oldest_command_in_flight();
+    if (waiting_command == OpCode::CONTROLLER_DEBUG_INFO && op_code != OpCode::CONTROLLER_DEBUG_INFO) {
       LOG_ERROR("Discarding event that came after timeout 0x%02hx (%s)", op_code, OpCodeText(op_code).c_str());
       common::StopWatch::DumpStopWatchLog();
       return;
     }
+    auto command = find_command_in_flight(op_code);
     ASSERT_LOG(
-        waiting_command_ == op_code,
+        command != get_end_of_commands_in_flight(),
         "Waiting for 0x%02hx (%s), got 0x%02hx (%s)",
-        waiting_command_,
-        OpCodeText(waiting_command_).c_str(),
+        waiting_command,
+        OpCodeText(waiting_command).c_str(),
         op_code,
         OpCodeText(op_code).c_str());
 
     bool is_vendor_specific = static_cast<int>(op_code) & (0x3f << 10);
     CommandStatusView status_view = CommandStatusView::Create(event);
-    if (is_vendor_specific && (is_status && !command_queue_.front().waiting_for_status_) &&
+    if (is_vendor_specific && (is_status && !command->waiting_for_status_) &&
         (status_view.IsValid() && status_view.GetStatus() == ErrorCode::UNKNOWN_HCI_COMMAND)) {
       // If this is a command status of a vendor specific command, and command complete is expected,
       // we can't treat this as hard failure since we have no way of probing this lack of support at
@@ -215,15 +240,14 @@ struct HciLayer::impl {
       // packet, which will be interpreted as invalid response.
       CommandCompleteView command_complete_view = CommandCompleteView::Create(
           EventView::Create(PacketView<kLittleEndian>(std::make_shared<std::vector<uint8_t>>(std::vector<uint8_t>()))));
-      command_queue_.front().GetCallback<CommandCompleteView>()->Invoke(
-          std::move(command_complete_view));
+      command->GetCallback<CommandCompleteView>()->Invoke(std::move(command_complete_view));
     } else {
-      if (command_queue_.front().waiting_for_status_ == is_status) {
-        command_queue_.front().GetCallback<TResponse>()->Invoke(std::move(response_view));
+      if (command->waiting_for_status_ == is_status) {
+        command->GetCallback<TResponse>()->Invoke(std::move(response_view));
       } else {
         CommandCompleteView command_complete_view = CommandCompleteView::Create(
             EventView::Create(PacketView<kLittleEndian>(std::make_shared<std::vector<uint8_t>>(std::vector<uint8_t>()))));
-        command_queue_.front().GetCallback<CommandCompleteView>()->Invoke(std::move(command_complete_view));
+        command->GetCallback<CommandCompleteView>()->Invoke(std::move(command_complete_view));
       }
     }
 
@@ -235,7 +259,7 @@ struct HciLayer::impl {
     // would return UNKNOWN_CONNECTION in some cases.
     if (op_code == OpCode::LE_READ_REMOTE_FEATURES && is_status && status_view.IsValid() &&
         status_view.GetStatus() == ErrorCode::UNKNOWN_CONNECTION) {
-      auto& command_view = *command_queue_.front().command_view;
+      auto& command_view = *command->command_view;
       auto le_read_features_view = bluetooth::hci::LeReadRemoteFeaturesView::Create(
           LeConnectionManagementCommandView::Create(AclCommandView::Create(command_view)));
       if (le_read_features_view.IsValid()) {
@@ -245,10 +269,12 @@ struct HciLayer::impl {
     }
 #endif
 
-    command_queue_.pop_front();
-    waiting_command_ = OpCode::NONE;
+    record_command_latency(op_code, std::chrono::steady_clock::now() - command->sent_time);
+    command_queue_.erase(command);
+    commands_in_flight_--;
     if (hci_timeout_alarm_ != nullptr) {
       hci_timeout_alarm_->Cancel();
+      schedule_hci_timeout();
       send_next_command();
     }
   }
@@ -261,8 +287,8 @@ struct HciLayer::impl {
     LOG_ERROR("Flushing %zd waiting commands", command_queue_.size());
     // Clear any waiting commands (there is an abort coming anyway)
     command_queue_.clear();
+    commands_in_flight_ = 0;
     command_credits_ = 1;
-    waiting_command_ = OpCode::NONE;
     // Ignore the response, since we don't know what might come back.
     enqueue_command(ControllerDebugInfoBuilder::Create(), module_.GetHandler()->BindOnce([](CommandCompleteView) {}));
     // Don't time out for this one;
@@ -279,34 +305,127 @@ struct HciLayer::impl {
     }
   }
 
-  void send_next_command() {
-    if (command_credits_ == 0) {
-      return;
+  // Commands in flight are at the front of command_queue_, in the order they were sent
+  std::list<CommandQueueEntry>::iterator get_end_of_commands_in_flight() {
+    return std::next(command_queue_.begin(), commands_in_flight_);
+  }
+
+  OpCode get_oldest_command_in_flight() const {
+    return commands_in_flight_ > 0 ? command_queue_.front().command_view->GetOpCode() : OpCode::NONE;
+  }
+
+  // Responses to commands with the same opcode come back in the order the commands were sent
+  std::list<CommandQueueEntry>::iterator find_command_in_flight(OpCode op_code) {
+    return std::find_if(command_queue_.begin(), get_end_of_commands_in_flight(), [op_code](const auto& entry) {
+      return entry.command_view->GetOpCode() == op_code;
+    });
+  }
+
+  static bool is_vendor_specific_command(OpCode op_code) {
+    return (static_cast<uint16_t>(op_code) >> 10) == 0x3f;
+  }
+
+  // Reset and the debug info requested after a timeout must not overlap with anything. Vendor specific commands
+  // only overlap with commands of the same opcode, such as a run of APCF filter updates.
+  static bool can_be_in_flight_together(OpCode in_flight, OpCode next) {
+    for (OpCode op_code : {in_flight, next}) {
+      if (op_code == OpCode::RESET || op_code == OpCode::CONTROLLER_DEBUG_INFO) {
+        return false;
+      }
+    }
+    if (is_vendor_specific_command(in_flight) || is_vendor_specific_command(next)) {
+      return in_flight == next;
     }
-    if (waiting_command_ != OpCode::NONE) {
+    return true;
+  }
+
+  // Commands are serialized ahead of sending when their opcode is needed to decide whether they can be sent
+  void serialize_command(CommandQueueEntry& entry) {
+    if (entry.command_view != nullptr) {
       return;
     }
-    if (command_queue_.size() == 0) {
+    entry.command_bytes = std::make_shared<std::vector<uint8_t>>(entry.command->size());
+    entry.command_bytes->resize(entry.command->SerializeInto(*entry.command_bytes));
+    auto cmd_view = CommandView::Create(PacketView<kLittleEndian>(entry.command_bytes));
+    ASSERT(cmd_view.IsValid());
+    entry.command_view = std::make_unique<CommandView>(std::move(cmd_view));
+  }
+
+  // The timeout is for the oldest command in flight, with the time it has already been waiting for
+  void schedule_hci_timeout() {
+    if (commands_in_flight_ == 0) {
       return;
     }
-    std::shared_ptr<std::vector<uint8_t>> bytes = std::make_shared<std::vector<uint8_t>>();
-    BitInserter bi(*bytes);
-    command_queue_.front().command->Serialize(bi);
-    hal_->sendHciCommand(*bytes);
+    const auto& oldest = command_queue_.front();
+    auto waiting_time =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - oldest.sent_time);
+    hci_timeout_alarm_->Schedule(
+        BindOnce(&impl::on_hci_timeout, common::Unretained(this), oldest.command_view->GetOpCode()),
+        std::max(kHciTimeoutMs - waiting_time, std::chrono::milliseconds(0)));
+  }
 
-    auto cmd_view = CommandView::Create(PacketView<kLittleEndian>(bytes));
-    ASSERT(cmd_view.IsValid());
-    OpCode op_code = cmd_view.GetOpCode();
-    power_telemetry::GetInstance().LogHciCmdDetail();
-    command_queue_.front().command_view = std::make_unique<CommandView>(std::move(cmd_view));
-    log_link_layer_connection_command(command_queue_.front().command_view);
-    log_classic_pairing_command_status(command_queue_.front().command_view, ErrorCode::STATUS_UNKNOWN);
-    waiting_command_ = op_code;
-    command_credits_ = 0;  // Only allow one outstanding command
-    if (hci_timeout_alarm_ != nullptr) {
-      hci_timeout_alarm_->Schedule(BindOnce(&impl::on_hci_timeout, common::Unretained(this), op_code), kHciTimeoutMs);
-    } else {
-      LOG_WARN("%s sent without an hci-timeout timer", OpCodeText(op_code).c_str());
+  void send_next_command() {
+    while (command_credits_ > 0 && commands_in_flight_ < max_commands_in_flight_ &&
+           commands_in_flight_ < command_queue_.size()) {
+      auto& next = *get_end_of_commands_in_flight();
+      serialize_command(next);
+      OpCode op_code = next.command_view->GetOpCode();
+      if (commands_in_flight_ > 0 && !can_be_in_flight_together(get_oldest_command_in_flight(), op_code)) {
+        return;
+      }
+      hal_->sendHciCommand(*next.command_bytes);
+      next.command_bytes.reset();
+      next.sent_time = std::chrono::steady_clock::now();
+
+      power_telemetry::GetInstance().LogHciCmdDetail();
+      log_link_layer_connection_command(next.command_view);
+      log_classic_pairing_command_status(next.command_view, ErrorCode::STATUS_UNKNOWN);
+      command_credits_--;
+      commands_in_flight_++;
+      if (hci_timeout_alarm_ == nullptr) {
+        LOG_WARN("%s sent without an hci-timeout timer", OpCodeText(op_code).c_str());
+      } else if (commands_in_flight_ == 1) {
+        schedule_hci_timeout();
+      }
+      std::lock_guard<std::mutex> lock(command_stats_mutex_);
+      peak_commands_in_flight_ = std::max(peak_commands_in_flight_, commands_in_flight_);
+    }
+  }
+
+  void record_command_latency(OpCode op_code, std::chrono::steady_clock::duration round_trip) {
+    auto latency_us = std::chrono::duration_cast<std::chrono::microseconds>(round_trip).count();
+    std::lock_guard<std::mutex> lock(command_stats_mutex_);
+    auto& latency = command_latency_[op_code];
+    latency.count++;
+    latency.total_us += latency_us;
+    latency.max_us = std::max(latency.max_us, latency_us);
+    size_t bucket = 0;
+    while (bucket < kCommandLatencyBucketsUs.size() && latency_us >= kCommandLatencyBucketsUs[bucket]) {
+      bucket++;
+    }
+    latency.histogram[bucket]++;
+  }
+
+  void dump(int fd) const {
+    std::lock_guard<std::mutex> lock(command_stats_mutex_);
+    dprintf(
+        fd,
+        "HCI commands: max in flight:%zu peak in flight:%zu\n",
+        max_commands_in_flight_,
+        peak_commands_in_flight_);
+    for (const auto& [op_code, latency] : command_latency_) {
+      dprintf(
+          fd,
+          "  0x%04hx %s: count:%" PRIu64 " avg:%" PRId64 "us max:%" PRId64 "us",
+          static_cast<uint16_t>(op_code),
+          OpCodeText(op_code).c_str(),
+          latency.count,
+          latency.total_us / static_cast<int64_t>(latency.count),
+          latency.max_us);
+      for (size_t i = 0; i < kCommandLatencyBucketsUs.size(); i++) {
+        dprintf(fd, " <%" PRId64 "us:%" PRIu64, kCommandLatencyBucketsUs[i], latency.histogram[i]);
+      }
+      dprintf(fd, " >=%" PRId64 "us:%" PRIu64 "\n", kCommandLatencyBucketsUs.back(), latency.histogram.back());
     }
   }
 
@@ -401,7 +520,11 @@ struct HciLayer::impl {
       std::unique_ptr<CommandView> no_waiting_command{nullptr};
       log_hci_event(no_waiting_command, event, module_.GetDependency<storage::StorageModule>());
     } else {
-      log_hci_event(command_queue_.front().command_view, event, module_.GetDependency<storage::StorageModule>());
+      auto command = find_command_in_flight(get_response_op_code(event));
+      if (command == get_end_of_commands_in_flight()) {
+        command = command_queue_.begin();
+      }
+      log_hci_event(command->command_view, event, module_.GetDependency<storage::StorageModule>());
     }
     power_telemetry::GetInstance().LogHciEvtDetail();
     EventCode event_code = event.GetEventCode();
@@ -443,6 +566,18 @@ struct HciLayer::impl {
     }
   }
 
+  static OpCode get_response_op_code(EventView event) {
+    if (event.GetEventCode() == EventCode::COMMAND_COMPLETE) {
+      auto view = CommandCompleteView::Create(event);
+      return view.IsValid() ? view.GetCommandOpCode() : OpCode::NONE;
+    }
+    if (event.GetEventCode() == EventCode::COMMAND_STATUS) {
+      auto view = CommandStatusView::Create(event);
+      return view.IsValid() ? view.GetCommandOpCode() : OpCode::NONE;
+    }
+    return OpCode::NONE;
+  }
+
   void on_hardware_error(EventView event) {
     HardwareErrorView event_view = HardwareErrorView::Create(event);
     ASSERT(event_view.IsValid());
@@ -473,10 +608,24 @@ struct HciLayer::impl {
 
   // Command Handling
   std::list<CommandQueueEntry> command_queue_;
+  size_t commands_in_flight_{0};
+  const size_t max_commands_in_flight_;
+
+  // Upper bounds of the round trip latency histogram buckets, in microseconds. The last bucket of the histogram counts
+  // the round trips above the last bound.
+  static constexpr std::array<int64_t, 6> kCommandLatencyBucketsUs = {500, 1000, 2000, 5000, 20000, 100000};
+  struct CommandLatency {
+    uint64_t count{0};
+    int64_t total_us{0};
+    int64_t max_us{0};
+    std::array<uint64_t, kCommandLatencyBucketsUs.size() + 1> histogram{};
+  };
+  mutable std::mutex command_stats_mutex_;
+  std::map<OpCode, CommandLatency> command_latency_;
+  size_t peak_commands_in_flight_{0};
 
   std::map<EventCode, ContextualCallback<void(EventView)>> event_handlers_;
   std::map<SubeventCode, ContextualCallback<void(LeMetaEventView)>> subevent_handlers_;
-  OpCode waiting_command_{OpCode::NONE};
   uint8_t command_credits_{1};  // Send reset first
   Alarm* hci_timeout_alarm_{nullptr};
   Alarm* hci_abort_alarm_{nullptr};
@@ -760,6 +909,12 @@ DistanceMeasurementInterface* HciLayer::GetDistanceMeasurementInterface(
 
 const ModuleFactory HciLayer::Factory = ModuleFactory([]() { return new HciLayer(); });
 
+void HciLayer::GetDumpsysData(int fd) const {
+  if (impl_ != nullptr) {
+    impl_->dump(fd);
+  }
+}
+
 void HciLayer::ListDependencies(ModuleList* list) const {
   list->add<hal::HciHal>();
   list->add<storage::StorageModule>();
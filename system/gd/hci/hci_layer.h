@@ -128,6 +128,8 @@ class HciLayer : public Module, public CommandInterface<CommandBuilder> {
 
   void Start() override;
 
+  void GetDumpsysData(int fd) const override;  // Module
+
   void StartWithNoHalDependencies(os::Handler* handler);
 
   void Stop() override;
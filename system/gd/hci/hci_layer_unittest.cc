@@ -31,6 +31,7 @@
 #include "module.h"
 #include "os/fake_timer/fake_timerfd.h"
 #include "os/handler.h"
+#include "os/system_properties.h"
 #include "os/thread.h"
 #include "packet/raw_builder.h"
 
@@ -112,6 +113,14 @@ class HciLayerTest : public ::testing::Test {
     ASSERT(fake_registry_.GetTestThread().GetReactor()->WaitForIdle(2s));
   }
 
+  std::optional<OpCode> GetSentOpCode(std::chrono::milliseconds timeout = 1s) {
+    auto sent_command = hal_->GetSentCommand(timeout);
+    if (!sent_command.has_value()) {
+      return std::nullopt;
+    }
+    return sent_command->GetOpCode();
+  }
+
   hal::TestHciHal* hal_ = nullptr;
   HciLayer* hci_ = nullptr;
   os::Handler* hci_handler_ = nullptr;
@@ -120,6 +129,19 @@ class HciLayerTest : public ::testing::Test {
 
 class HciLayerDeathTest : public HciLayerTest {};
 
+class HciLayerPipelinedTest : public HciLayerTest {
+ protected:
+  void SetUp() override {
+    os::SetSystemProperty("bluetooth.hci.max_commands_in_flight", "4");
+    HciLayerTest::SetUp();
+  }
+
+  void TearDown() override {
+    HciLayerTest::TearDown();
+    os::ClearSystemPropertiesForHost();
+  }
+};
+
 TEST_F(HciLayerTest, setup_teardown) {}
 
 TEST_F(HciLayerTest, reset_command_sent_on_start) {
@@ -494,5 +516,79 @@ TEST_F(HciLayerTest, command_status_callback_is_invoked_with_failure_status) {
   sync_handler();
 }
 
+TEST_F(HciLayerTest, only_one_command_in_flight_by_default) {
+  FailIfResetNotSent();
+  hal_->InjectEvent(ResetCompleteBuilder::Create(4, ErrorCode::SUCCESS));
+  hci_->EnqueueCommand(ReadBdAddrBuilder::Create(), hci_handler_->BindOnce([](CommandCompleteView /* view */) {}));
+  hci_->EnqueueCommand(
+      ReadClockOffsetBuilder::Create(0x001), hci_handler_->BindOnce([](CommandStatusView /* view */) {}));
+
+  ASSERT_EQ(GetSentOpCode(), OpCode::READ_BD_ADDR);
+  ASSERT_FALSE(GetSentOpCode(100ms).has_value());
+
+  hal_->InjectEvent(ReadBdAddrCompleteBuilder::Create(4, ErrorCode::SUCCESS, Address::kEmpty));
+  ASSERT_EQ(GetSentOpCode(), OpCode::READ_CLOCK_OFFSET);
+  hal_->InjectEvent(ReadClockOffsetStatusBuilder::Create(ErrorCode::SUCCESS, 4));
+  sync_handler();
+}
+
+TEST_F(HciLayerPipelinedTest, commands_are_sent_up_to_the_controller_credits) {
+  FailIfResetNotSent();
+  hal_->InjectEvent(ResetCompleteBuilder::Create(2, ErrorCode::SUCCESS));
+
+  std::promise<void> read_bd_addr_promise;
+  auto read_bd_addr_future = read_bd_addr_promise.get_future();
+  std::promise<void> read_clock_offset_promise;
+  auto read_clock_offset_future = read_clock_offset_promise.get_future();
+  hci_->EnqueueCommand(
+      ReadBdAddrBuilder::Create(),
+      hci_handler_->BindOnce(
+          [](std::promise<void> promise, CommandCompleteView /* view */) { promise.set_value(); },
+          std::move(read_bd_addr_promise)));
+  hci_->EnqueueCommand(
+      ReadClockOffsetBuilder::Create(0x001),
+      hci_handler_->BindOnce(
+          [](std::promise<void> promise, CommandStatusView /* view */) { promise.set_value(); },
+          std::move(read_clock_offset_promise)));
+  hci_->EnqueueCommand(
+      ReadClockOffsetBuilder::Create(0x002), hci_handler_->BindOnce([](CommandStatusView /* view */) {}));
+
+  ASSERT_EQ(GetSentOpCode(), OpCode::READ_BD_ADDR);
+  ASSERT_EQ(GetSentOpCode(), OpCode::READ_CLOCK_OFFSET);
+  // The controller only accepts two commands
+  ASSERT_FALSE(GetSentOpCode(100ms).has_value());
+
+  // Responses are matched by opcode, not by the order the commands were sent in
+  hal_->InjectEvent(ReadClockOffsetStatusBuilder::Create(ErrorCode::SUCCESS, 1));
+  ASSERT_EQ(read_clock_offset_future.wait_for(1s), std::future_status::ready);
+  ASSERT_EQ(GetSentOpCode(), OpCode::READ_CLOCK_OFFSET);
+  ASSERT_NE(read_bd_addr_future.wait_for(0s), std::future_status::ready);
+
+  hal_->InjectEvent(ReadBdAddrCompleteBuilder::Create(1, ErrorCode::SUCCESS, Address::kEmpty));
+  ASSERT_EQ(read_bd_addr_future.wait_for(1s), std::future_status::ready);
+  hal_->InjectEvent(ReadClockOffsetStatusBuilder::Create(ErrorCode::SUCCESS, 1));
+  sync_handler();
+}
+
+TEST_F(HciLayerPipelinedTest, reset_does_not_overlap_with_other_commands) {
+  FailIfResetNotSent();
+  hal_->InjectEvent(ResetCompleteBuilder::Create(4, ErrorCode::SUCCESS));
+  hci_->EnqueueCommand(ReadBdAddrBuilder::Create(), hci_handler_->BindOnce([](CommandCompleteView /* view */) {}));
+  hci_->EnqueueCommand(ResetBuilder::Create(), hci_handler_->BindOnce([](CommandCompleteView /* view */) {}));
+  hci_->EnqueueCommand(ReadBdAddrBuilder::Create(), hci_handler_->BindOnce([](CommandCompleteView /* view */) {}));
+
+  ASSERT_EQ(GetSentOpCode(), OpCode::READ_BD_ADDR);
+  ASSERT_FALSE(GetSentOpCode(100ms).has_value());
+
+  hal_->InjectEvent(ReadBdAddrCompleteBuilder::Create(4, ErrorCode::SUCCESS, Address::kEmpty));
+  ASSERT_EQ(GetSentOpCode(), OpCode::RESET);
+  ASSERT_FALSE(GetSentOpCode(100ms).has_value());
+
+  hal_->InjectEvent(ResetCompleteBuilder::Create(4, ErrorCode::SUCCESS));
+  ASSERT_EQ(GetSentOpCode(), OpCode::READ_BD_ADDR);
+  hal_->InjectEvent(ReadBdAddrCompleteBuilder::Create(4, ErrorCode::SUCCESS, Address::kEmpty));
+  sync_handler();
+}
+
 }  // namespace hci
 }  // namespace bluetooth
@@ -16,9 +16,23 @@
 
 #include "l2cap/fcs.h"
 
+#include <array>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FCS_PCLMUL
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_PMULL
+#define HWCAP_PMULL (1 << 4)
+#endif
+#define FCS_PMULL
+#endif
+
 namespace {
 // Table for optimizing the CRC calculation, which is a bitwise operation.
-static const uint16_t crctab[256] = {
+constexpr uint16_t crctab[256] = {
     0x0000, 0xc0c1, 0xc181, 0x0140, 0xc301, 0x03c0, 0x0280, 0xc241, 0xc601, 0x06c0, 0x0780, 0xc741, 0x0500, 0xc5c1,
     0xc481, 0x0440, 0xcc01, 0x0cc0, 0x0d80, 0xcd41, 0x0f00, 0xcfc1, 0xce81, 0x0e40, 0x0a00, 0xcac1, 0xcb81, 0x0b40,
     0xc901, 0x09c0, 0x0880, 0xc841, 0xd801, 0x18c0, 0x1980, 0xd941, 0x1b00, 0xdbc1, 0xda81, 0x1a40, 0x1e00, 0xdec1,
@@ -39,6 +53,166 @@ static const uint16_t crctab[256] = {
     0x4c80, 0x8c41, 0x4400, 0x84c1, 0x8581, 0x4540, 0x8701, 0x47c0, 0x4680, 0x8641, 0x8201, 0x42c0, 0x4380, 0x8341,
     0x4100, 0x81c1, 0x8081, 0x4040,
 };
+
+// slice_tables[k][i] is the CRC of byte i followed by k zero bytes, so that eight bytes are consumed per round
+constexpr std::array<std::array<uint16_t, 256>, 8> MakeSliceTables() {
+  std::array<std::array<uint16_t, 256>, 8> tables{};
+  for (int i = 0; i < 256; i++) {
+    tables[0][i] = crctab[i];
+  }
+  for (int k = 1; k < 8; k++) {
+    for (int i = 0; i < 256; i++) {
+      uint16_t crc = tables[k - 1][i];
+      tables[k][i] = (crc >> 8) ^ crctab[crc & 0xff];
+    }
+  }
+  return tables;
+}
+
+constexpr std::array<std::array<uint16_t, 256>, 8> slice_tables = MakeSliceTables();
+
+uint16_t UpdateSliceBy8(uint16_t crc, const uint8_t* data, size_t length) {
+  for (; length >= 8; data += 8, length -= 8) {
+    crc = slice_tables[7][data[0] ^ (crc & 0xff)] ^ slice_tables[6][data[1] ^ (crc >> 8)] ^ slice_tables[5][data[2]] ^
+          slice_tables[4][data[3]] ^ slice_tables[3][data[4]] ^ slice_tables[2][data[5]] ^ slice_tables[1][data[6]] ^
+          slice_tables[0][data[7]];
+  }
+  for (; length > 0; data++, length--) {
+    crc = (crc >> 8) ^ crctab[(crc & 0xff) ^ *data];
+  }
+  return crc;
+}
+
+#if defined(FCS_PCLMUL) || defined(FCS_PMULL)
+
+// The FCS is reflected: the first bit of the frame is the highest degree coefficient of the message polynomial. A
+// 16 byte block loaded in a vector register therefore holds its higher degree half in the low 64 bits. Moving a block
+// n bits further into the frame multiplies it by x^n, which modulo the generator x^16 + x^15 + x^2 + 1 is the same as
+// multiplying the low half by x^(n+64) mod P and the high half by x^n mod P. The product of two reflected 64 bit
+// operands comes out shifted by one bit, hence the constants below are computed for one degree less.
+constexpr uint32_t kGenerator = 0x18005;
+
+constexpr uint64_t FoldConstant(int degree) {
+  uint32_t remainder = 1;
+  for (int i = 0; i < degree; i++) {
+    remainder <<= 1;
+    if (remainder & 0x10000) {
+      remainder ^= kGenerator;
+    }
+  }
+  uint64_t reflected = 0;
+  for (int i = 0; i < 16; i++) {
+    if (remainder & (1u << i)) {
+      reflected |= uint64_t{1} << (63 - i);
+    }
+  }
+  return reflected;
+}
+
+// Folding four blocks at a time keeps four independent multiplications in flight
+constexpr size_t kBlockSize = 16;
+constexpr size_t kFoldBlocks = 4;
+constexpr size_t kMinFoldLength = kBlockSize * kFoldBlocks;
+constexpr uint64_t kFold512Low = FoldConstant(512 + 64 - 1);
+constexpr uint64_t kFold512High = FoldConstant(512 - 1);
+constexpr uint64_t kFold128Low = FoldConstant(128 + 64 - 1);
+constexpr uint64_t kFold128High = FoldConstant(128 - 1);
+
+// The first two bytes carry the running CRC, then the remainder of the folded blocks is taken with the tables
+uint16_t FinishFold(const uint8_t folded[kBlockSize], const uint8_t* data, size_t length) {
+  uint16_t crc = UpdateSliceBy8(0, folded, kBlockSize);
+  return UpdateSliceBy8(crc, data, length);
+}
+
+#endif
+
+#if defined(FCS_PCLMUL)
+
+bool CpuHasCarryLessMultiply() {
+  return __builtin_cpu_supports("pclmul");
+}
+
+__attribute__((target("pclmul,sse2"))) __m128i Fold(__m128i block, __m128i constants) {
+  return _mm_xor_si128(_mm_clmulepi64_si128(block, constants, 0x00), _mm_clmulepi64_si128(block, constants, 0x11));
+}
+
+__attribute__((target("pclmul,sse2"))) __m128i Load(const uint8_t* data) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+__attribute__((target("pclmul,sse2"))) uint16_t UpdateCarryLessMultiply(
+    uint16_t crc, const uint8_t* data, size_t length) {
+  const __m128i fold512 = _mm_set_epi64x(kFold512High, kFold512Low);
+  const __m128i fold128 = _mm_set_epi64x(kFold128High, kFold128Low);
+
+  __m128i blocks[kFoldBlocks];
+  for (size_t i = 0; i < kFoldBlocks; i++) {
+    blocks[i] = Load(data + i * kBlockSize);
+  }
+  blocks[0] = _mm_xor_si128(blocks[0], _mm_cvtsi32_si128(crc));
+  data += kMinFoldLength;
+  length -= kMinFoldLength;
+
+  for (; length >= kMinFoldLength; data += kMinFoldLength, length -= kMinFoldLength) {
+    for (size_t i = 0; i < kFoldBlocks; i++) {
+      blocks[i] = _mm_xor_si128(Fold(blocks[i], fold512), Load(data + i * kBlockSize));
+    }
+  }
+  __m128i folded = blocks[0];
+  for (size_t i = 1; i < kFoldBlocks; i++) {
+    folded = _mm_xor_si128(Fold(folded, fold128), blocks[i]);
+  }
+  for (; length >= kBlockSize; data += kBlockSize, length -= kBlockSize) {
+    folded = _mm_xor_si128(Fold(folded, fold128), Load(data));
+  }
+
+  uint8_t folded_bytes[kBlockSize];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(folded_bytes), folded);
+  return FinishFold(folded_bytes, data, length);
+}
+
+#elif defined(FCS_PMULL)
+
+bool CpuHasCarryLessMultiply() {
+  return (getauxval(AT_HWCAP) & HWCAP_PMULL) != 0;
+}
+
+__attribute__((target("aes"))) uint8x16_t Fold(uint8x16_t block, poly64_t low_constant, poly64_t high_constant) {
+  uint64x2_t halves = vreinterpretq_u64_u8(block);
+  poly128_t low = vmull_p64(static_cast<poly64_t>(vgetq_lane_u64(halves, 0)), low_constant);
+  poly128_t high = vmull_p64(static_cast<poly64_t>(vgetq_lane_u64(halves, 1)), high_constant);
+  return veorq_u8(vreinterpretq_u8_p128(low), vreinterpretq_u8_p128(high));
+}
+
+__attribute__((target("aes"))) uint16_t UpdateCarryLessMultiply(uint16_t crc, const uint8_t* data, size_t length) {
+  uint8x16_t blocks[kFoldBlocks];
+  for (size_t i = 0; i < kFoldBlocks; i++) {
+    blocks[i] = vld1q_u8(data + i * kBlockSize);
+  }
+  blocks[0] = veorq_u8(blocks[0], vreinterpretq_u8_u16(vsetq_lane_u16(crc, vdupq_n_u16(0), 0)));
+  data += kMinFoldLength;
+  length -= kMinFoldLength;
+
+  for (; length >= kMinFoldLength; data += kMinFoldLength, length -= kMinFoldLength) {
+    for (size_t i = 0; i < kFoldBlocks; i++) {
+      blocks[i] = veorq_u8(Fold(blocks[i], kFold512Low, kFold512High), vld1q_u8(data + i * kBlockSize));
+    }
+  }
+  uint8x16_t folded = blocks[0];
+  for (size_t i = 1; i < kFoldBlocks; i++) {
+    folded = veorq_u8(Fold(folded, kFold128Low, kFold128High), blocks[i]);
+  }
+  for (; length >= kBlockSize; data += kBlockSize, length -= kBlockSize) {
+    folded = veorq_u8(Fold(folded, kFold128Low, kFold128High), vld1q_u8(data));
+  }
+
+  uint8_t folded_bytes[kBlockSize];
+  vst1q_u8(folded_bytes, folded);
+  return FinishFold(folded_bytes, data, length);
+}
+
+#endif
+
 }  // namespace
 
 namespace bluetooth {
@@ -52,9 +226,27 @@ void Fcs::AddByte(uint8_t byte) {
   crc = ((crc >> 8) & 0x00ff) ^ crctab[(crc & 0x00ff) ^ byte];
 }
 
+void Fcs::AddBytes(const uint8_t* data, size_t length) {
+  crc = Update(crc, data, length);
+}
+
 uint16_t Fcs::GetChecksum() const {
   return crc;
 }
 
+uint16_t Fcs::Update(uint16_t crc, const uint8_t* data, size_t length) {
+#if defined(FCS_PCLMUL) || defined(FCS_PMULL)
+  static const bool has_carry_less_multiply = CpuHasCarryLessMultiply();
+  if (has_carry_less_multiply && length >= kMinFoldLength) {
+    return UpdateCarryLessMultiply(crc, data, length);
+  }
+#endif
+  return UpdateSliceBy8(crc, data, length);
+}
+
+uint16_t Fcs::UpdateWithTables(uint16_t crc, const uint8_t* data, size_t length) {
+  return UpdateSliceBy8(crc, data, length);
+}
+
 }  // namespace l2cap
 }  // namespace bluetooth
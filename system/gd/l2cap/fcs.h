@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace bluetooth {
@@ -28,8 +29,17 @@ class Fcs {
 
   void AddByte(uint8_t byte);
 
+  void AddBytes(const uint8_t* data, size_t length);
+
   uint16_t GetChecksum() const;
 
+  // Continues the FCS |crc| over |length| bytes. Long inputs are folded with carry-less multiplication (PCLMULQDQ or
+  // PMULL) when the CPU has it, and processed eight bytes per table lookup round otherwise.
+  static uint16_t Update(uint16_t crc, const uint8_t* data, size_t length);
+
+  // Same as Update(), never using carry-less multiplication
+  static uint16_t UpdateWithTables(uint16_t crc, const uint8_t* data, size_t length);
+
  private:
   uint16_t crc;
 };
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "l2cap/fcs.h"
+
+using ::benchmark::State;
+
+namespace bluetooth {
+namespace l2cap {
+
+// What the PDL generated checksum code does
+static void BM_Fcs_bytewise(State& state) {
+  std::vector<uint8_t> frame(state.range(0), 0x5a);
+  for (auto _ : state) {
+    Fcs fcs;
+    fcs.Initialize();
+    for (uint8_t byte : frame) {
+      fcs.AddByte(byte);
+    }
+    benchmark::DoNotOptimize(fcs.GetChecksum());
+  }
+  state.SetBytesProcessed(static_cast<int_fast64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_Fcs_bytewise)->Arg(8)->Arg(64)->Arg(672)->Arg(1021)->Arg(65535);
+
+static void BM_Fcs_tables(State& state) {
+  std::vector<uint8_t> frame(state.range(0), 0x5a);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Fcs::UpdateWithTables(0, frame.data(), frame.size()));
+  }
+  state.SetBytesProcessed(static_cast<int_fast64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_Fcs_tables)->Arg(8)->Arg(64)->Arg(672)->Arg(1021)->Arg(65535);
+
+// Carry-less multiplication when the CPU has it
+static void BM_Fcs_default(State& state) {
+  std::vector<uint8_t> frame(state.range(0), 0x5a);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Fcs::Update(0, frame.data(), frame.size()));
+  }
+  state.SetBytesProcessed(static_cast<int_fast64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_Fcs_default)->Arg(8)->Arg(64)->Arg(672)->Arg(1021)->Arg(65535);
+
+}  // namespace l2cap
+}  // namespace bluetooth
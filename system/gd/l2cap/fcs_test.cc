@@ -0,0 +1,94 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "l2cap/fcs.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace bluetooth {
+namespace l2cap {
+namespace {
+
+std::vector<uint8_t> MakeFrame(size_t length) {
+  std::vector<uint8_t> frame(length);
+  uint32_t state = 1;
+  for (auto& byte : frame) {
+    state = state * 1103515245u + 12345u;
+    byte = static_cast<uint8_t>(state >> 16);
+  }
+  return frame;
+}
+
+uint16_t BytewiseFcs(const uint8_t* data, size_t length) {
+  Fcs fcs;
+  fcs.Initialize();
+  for (size_t i = 0; i < length; i++) {
+    fcs.AddByte(data[i]);
+  }
+  return fcs.GetChecksum();
+}
+
+TEST(L2capFcsTest, check_value) {
+  // CRC-16/ARC of "123456789"
+  const uint8_t kCheck[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  EXPECT_EQ(BytewiseFcs(kCheck, sizeof(kCheck)), 0xbb3d);
+  EXPECT_EQ(Fcs::Update(0, kCheck, sizeof(kCheck)), 0xbb3d);
+  EXPECT_EQ(Fcs::UpdateWithTables(0, kCheck, sizeof(kCheck)), 0xbb3d);
+}
+
+TEST(L2capFcsTest, same_as_bytewise_for_every_length) {
+  // Crosses the eight byte table rounds and the 16 and 64 byte folding blocks at every alignment
+  auto frame = MakeFrame(1100);
+  for (size_t offset = 0; offset < 16; offset++) {
+    for (size_t length = 0; offset + length <= 300; length++) {
+      uint16_t expected = BytewiseFcs(frame.data() + offset, length);
+      ASSERT_EQ(Fcs::Update(0, frame.data() + offset, length), expected) << offset << " " << length;
+      ASSERT_EQ(Fcs::UpdateWithTables(0, frame.data() + offset, length), expected) << offset << " " << length;
+    }
+  }
+  for (size_t length : {1021u, 1024u, 1100u}) {
+    EXPECT_EQ(Fcs::Update(0, frame.data(), length), BytewiseFcs(frame.data(), length));
+  }
+}
+
+TEST(L2capFcsTest, continues_from_a_previous_checksum) {
+  auto frame = MakeFrame(700);
+  uint16_t expected = BytewiseFcs(frame.data(), frame.size());
+  for (size_t split : {0u, 1u, 4u, 63u, 64u, 65u, 200u, 699u, 700u}) {
+    uint16_t crc = Fcs::Update(0, frame.data(), split);
+    EXPECT_EQ(Fcs::Update(crc, frame.data() + split, frame.size() - split), expected) << split;
+    crc = Fcs::UpdateWithTables(0, frame.data(), split);
+    EXPECT_EQ(Fcs::UpdateWithTables(crc, frame.data() + split, frame.size() - split), expected) << split;
+  }
+}
+
+TEST(L2capFcsTest, add_bytes_mixed_with_add_byte) {
+  auto frame = MakeFrame(500);
+  Fcs fcs;
+  fcs.Initialize();
+  fcs.AddByte(frame[0]);
+  fcs.AddBytes(frame.data() + 1, 100);
+  fcs.AddByte(frame[101]);
+  fcs.AddBytes(frame.data() + 102, frame.size() - 102);
+  EXPECT_EQ(fcs.GetChecksum(), BytewiseFcs(frame.data(), frame.size()));
+}
+
+}  // namespace
+}  // namespace l2cap
+}  // namespace bluetooth
@@ -18,6 +18,7 @@
 #include "module.h"
 
 #include "common/init_flags.h"
+#include "os/system_properties.h"
 
 using ::bluetooth::os::Handler;
 using ::bluetooth::os::Thread;
@@ -25,6 +26,7 @@ using ::bluetooth::os::Thread;
 namespace bluetooth {
 
 constexpr std::chrono::milliseconds kModuleStopTimeout = std::chrono::milliseconds(2000);
+constexpr char kBatchedHandlerProperty[] = "bluetooth.gd.module.batched_handler.enabled";
 
 ModuleFactory::ModuleFactory(std::function<Module*()> ctor) : ctor_(ctor) {
 }
@@ -66,7 +68,8 @@ void ModuleRegistry::Start(ModuleList* modules, Thread* thread) {
 
 void ModuleRegistry::set_registry_and_handler(Module* instance, Thread* thread) const {
   instance->registry_ = this;
-  instance->handler_ = new Handler(thread);
+  static const bool batched = os::GetSystemPropertyBool(kBatchedHandlerProperty, false);
+  instance->handler_ = new Handler(thread, batched);
 }
 
 Module* ModuleRegistry::Start(const ModuleFactory* module, Thread* thread) {
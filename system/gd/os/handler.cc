@@ -28,10 +28,17 @@ namespace bluetooth {
 namespace os {
 using common::OnceClosure;
 
-Handler::Handler(Thread* thread) : tasks_(new std::queue<OnceClosure>()), thread_(thread) {
+Handler::Handler(Thread* thread, bool batched)
+    : tasks_(new std::queue<OnceClosure>()),
+      thread_(thread),
+      batched_(batched),
+      cleared_(std::make_shared<std::atomic_bool>(false)) {
   event_ = thread_->GetReactor()->NewEvent();
   reactable_ = thread_->GetReactor()->Register(
-      event_->Id(), common::Bind(&Handler::handle_next_event, common::Unretained(this)), common::Closure());
+      event_->Id(),
+      batched_ ? common::Bind(&Handler::handle_next_batch, common::Unretained(this))
+               : common::Bind(&Handler::handle_next_event, common::Unretained(this)),
+      common::Closure());
 }
 
 Handler::~Handler() {
@@ -43,6 +50,7 @@ Handler::~Handler() {
 }
 
 void Handler::Post(OnceClosure closure) {
+  bool notify = true;
   {
     std::lock_guard<std::mutex> lock(mutex_);
     if (was_cleared()) {
@@ -50,8 +58,14 @@ void Handler::Post(OnceClosure closure) {
       return;
     }
     tasks_->emplace(std::move(closure));
+    if (batched_) {
+      notify = !notified_;
+      notified_ = true;
+    }
+  }
+  if (notify) {
+    event_->Notify();
   }
-  event_->Notify();
 }
 
 void Handler::Clear() {
@@ -60,6 +74,7 @@ void Handler::Clear() {
     std::lock_guard<std::mutex> lock(mutex_);
     ASSERT_LOG(!was_cleared(), "Handlers must only be cleared once");
     std::swap(tasks_, tmp);
+    cleared_->store(true);
   }
   delete tmp;
 
@@ -88,8 +103,40 @@ void Handler::handle_next_event() {
     closure = std::move(tasks_->front());
     tasks_->pop();
   }
+  thread_->GetReactor()->RecordExecutedTasks(1);
   std::move(closure).Run();
 }
 
+void Handler::handle_next_batch() {
+  std::queue<OnceClosure> batch;
+  std::shared_ptr<std::atomic_bool> cleared;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool has_data = event_->Read();
+
+    if (was_cleared()) {
+      return;
+    }
+    ASSERT_LOG(has_data, "Notified for work but no work available");
+
+    // Tasks posted from now on notify the reactor again, so that other reactables of this thread get their turn
+    // between batches
+    notified_ = false;
+    std::swap(*tasks_, batch);
+    cleared = cleared_;
+  }
+
+  // A task may clear, or even destroy this handler, do not access it anymore
+  Reactor* reactor = thread_->GetReactor();
+  size_t executed = 0;
+  while (!batch.empty() && !cleared->load()) {
+    OnceClosure closure = std::move(batch.front());
+    batch.pop();
+    std::move(closure).Run();
+    executed++;
+  }
+  reactor->RecordExecutedTasks(executed);
+}
+
 }  // namespace os
 }  // namespace bluetooth
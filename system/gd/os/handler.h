@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -35,8 +36,9 @@ namespace os {
 // from the thread.
 class Handler : public common::IPostableContext {
  public:
-  // Create and register a handler on given thread
-  explicit Handler(Thread* thread);
+  // Create and register a handler on given thread. A |batched| handler wakes up the reactor once for all the tasks
+  // posted in a row, and then runs every task pending at that time. Otherwise each task is a separate reactor event.
+  explicit Handler(Thread* thread, bool batched = false);
 
   Handler(const Handler&) = delete;
   Handler& operator=(const Handler&) = delete;
@@ -90,6 +92,9 @@ class Handler : public common::IPostableContext {
   template <typename T>
   friend class Queue;
 
+  template <typename T>
+  friend class SpscQueue;
+
   friend class Alarm;
 
   friend class RepeatingAlarm;
@@ -100,10 +105,16 @@ class Handler : public common::IPostableContext {
   };
   std::queue<common::OnceClosure>* tasks_;
   Thread* thread_;
+  const bool batched_;
+  // Batched mode only, guarded by |mutex_|. Set while the reactor has been notified of pending tasks.
+  bool notified_ = false;
+  // Set by Clear(), outlives the handler for a batch in progress
+  std::shared_ptr<std::atomic_bool> cleared_;
   std::unique_ptr<Reactor::Event> event_;
   Reactor::Reactable* reactable_;
   mutable std::mutex mutex_;
   void handle_next_event();
+  void handle_next_batch();
 };
 
 }  // namespace os
@@ -18,6 +18,7 @@
 
 #include <future>
 #include <thread>
+#include <vector>
 
 #include "common/bind.h"
 #include "common/callback.h"
@@ -116,6 +117,97 @@ TEST_F(HandlerTest, callback_with_promise) {
   handler_->Clear();
 }
 
+class BatchedHandlerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    thread_ = new Thread("test_thread", Thread::Priority::NORMAL);
+    handler_ = new Handler(thread_, true);
+  }
+  void TearDown() override {
+    delete handler_;
+    delete thread_;
+  }
+
+  Handler* handler_;
+  Thread* thread_;
+};
+
+TEST_F(BatchedHandlerTest, tasks_run_in_order) {
+  std::vector<int> order;
+  std::promise<void> unblock;
+  auto unblock_future = unblock.get_future();
+  handler_->Post(common::BindOnce([](std::future<void> future) { future.wait(); }, std::move(unblock_future)));
+  for (int i = 0; i < 10; i++) {
+    handler_->Post(common::BindOnce([](std::vector<int>* order, int i) { order->push_back(i); }, &order, i));
+  }
+  std::promise<void> done;
+  auto done_future = done.get_future();
+  handler_->Post(common::BindOnce(&std::promise<void>::set_value, common::Unretained(&done)));
+  unblock.set_value();
+  done_future.wait();
+
+  ASSERT_EQ(order.size(), 10u);
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(order[i], i);
+  }
+  handler_->Clear();
+}
+
+TEST_F(BatchedHandlerTest, pending_tasks_run_in_one_wakeup) {
+  std::promise<void> unblock;
+  auto unblock_future = unblock.get_future();
+  std::promise<void> started;
+  auto started_future = started.get_future();
+  handler_->Post(common::BindOnce(
+      [](std::promise<void> started, std::future<void> future) {
+        started.set_value();
+        future.wait();
+      },
+      std::move(started),
+      std::move(unblock_future)));
+  started_future.wait();
+
+  // Posted while the handler is busy, all run on the next wakeup
+  const Reactor::Stats before = thread_->GetReactor()->GetStats();
+  int count = 0;
+  for (int i = 0; i < 100; i++) {
+    handler_->Post(common::BindOnce([](int* count) { (*count)++; }, &count));
+  }
+  std::promise<void> done;
+  auto done_future = done.get_future();
+  handler_->Post(common::BindOnce(&std::promise<void>::set_value, common::Unretained(&done)));
+  unblock.set_value();
+  done_future.wait();
+  ASSERT_TRUE(thread_->GetReactor()->WaitForIdle(std::chrono::seconds(2)));
+
+  const Reactor::Stats after = thread_->GetReactor()->GetStats();
+  EXPECT_EQ(count, 100);
+  EXPECT_EQ(after.tasks - before.tasks, 102u);
+  EXPECT_LE(after.callbacks - before.callbacks, 2u);
+  handler_->Clear();
+}
+
+TEST_F(BatchedHandlerTest, clear_stops_batch) {
+  int val = 0;
+  std::promise<void> unblock;
+  auto unblock_future = unblock.get_future();
+  handler_->Post(common::BindOnce([](std::future<void> future) { future.wait(); }, std::move(unblock_future)));
+  std::promise<void> cleared;
+  auto cleared_future = cleared.get_future();
+  handler_->Post(common::BindOnce(
+      [](Handler* handler, std::promise<void> cleared) {
+        handler->Clear();
+        cleared.set_value();
+      },
+      common::Unretained(handler_),
+      std::move(cleared)));
+  handler_->Post(common::BindOnce([](int* val) { *val = 1; }, common::Unretained(&val)));
+  unblock.set_value();
+  cleared_future.wait();
+  ASSERT_TRUE(thread_->GetReactor()->WaitForIdle(std::chrono::seconds(2)));
+  EXPECT_EQ(val, 0);
+}
+
 // For Death tests, all the threading needs to be done in the ASSERT_DEATH call
 class HandlerDeathTest : public ::testing::Test {
  protected:
@@ -35,6 +35,11 @@ constexpr int kEpollMaxEvents = 64;
 constexpr uint64_t kStopReactor = 1 << 0;
 constexpr uint64_t kWaitForIdle = 1 << 1;
 
+// Counters are only written from the reactor thread, no need for an atomic read-modify-write
+void increment(std::atomic<uint64_t>* counter, uint64_t value = 1) {
+  counter->store(counter->load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
 }  // namespace
 
 namespace bluetooth {
@@ -127,6 +132,9 @@ Reactor::~Reactor() {
 void Reactor::Run() {
   bool already_running = is_running_.exchange(true);
   ASSERT(!already_running);
+  started_at_ns_.store(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(),
+      std::memory_order_relaxed);
 
   int timeout_ms = -1;
   bool waiting_for_idle = false;
@@ -139,6 +147,9 @@ void Reactor::Run() {
     int count;
     RUN_NO_INTR(count = epoll_wait(epoll_fd_, events, kEpollMaxEvents, timeout_ms));
     ASSERT(count != -1);
+    if (count > 0) {
+      increment(&wakeups_);
+    }
     if (waiting_for_idle && count == 0) {
       timeout_ms = -1;
       waiting_for_idle = false;
@@ -180,12 +191,14 @@ void Reactor::Run() {
         lock.unlock();
         reactable->is_executing_ = true;
       }
+      auto callback_start = std::chrono::steady_clock::now();
       if (event.events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP | EPOLLERR) && !reactable->on_read_ready_.is_null()) {
         reactable->on_read_ready_.Run();
       }
       if (event.events & EPOLLOUT && !reactable->on_write_ready_.is_null()) {
         reactable->on_write_ready_.Run();
       }
+      record_callback(std::chrono::steady_clock::now() - callback_start);
       {
         std::unique_lock<std::mutex> reactable_lock(reactable->mutex_);
         reactable->is_executing_ = false;
@@ -289,6 +302,38 @@ bool Reactor::WaitForIdle(std::chrono::milliseconds timeout) {
   return idle_status == std::future_status::ready;
 }
 
+void Reactor::record_callback(std::chrono::steady_clock::duration latency) {
+  increment(&callbacks_);
+  const int64_t latency_us = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+  size_t bucket = 0;
+  while (bucket < kCallbackLatencyBucketsUs.size() && latency_us >= kCallbackLatencyBucketsUs[bucket]) {
+    bucket++;
+  }
+  increment(&callback_latency_histogram_[bucket]);
+}
+
+void Reactor::RecordExecutedTasks(size_t count) {
+  increment(&tasks_, count);
+}
+
+Reactor::Stats Reactor::GetStats() const {
+  Stats stats = {
+      .wakeups = wakeups_.load(std::memory_order_relaxed),
+      .callbacks = callbacks_.load(std::memory_order_relaxed),
+      .tasks = tasks_.load(std::memory_order_relaxed),
+      .running_time = std::chrono::steady_clock::duration::zero(),
+      .callback_latency_histogram = {},
+  };
+  const int64_t started_at_ns = started_at_ns_.load(std::memory_order_relaxed);
+  if (started_at_ns != 0) {
+    stats.running_time = std::chrono::steady_clock::now().time_since_epoch() - std::chrono::nanoseconds(started_at_ns);
+  }
+  for (size_t i = 0; i < stats.callback_latency_histogram.size(); i++) {
+    stats.callback_latency_histogram[i] = callback_latency_histogram_[i].load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
 void Reactor::ModifyRegistration(Reactor::Reactable* reactable, ReactOn react_on) {
   ASSERT(reactable != nullptr);
 
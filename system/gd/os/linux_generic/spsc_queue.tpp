@@ -0,0 +1,173 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+template <typename T>
+SpscQueue<T>::SpscQueue(size_t capacity)
+    : capacity_(capacity), ring_(capacity), enqueue_(true), dequeue_(false) {
+  ASSERT(capacity_ > 0);
+}
+
+template <typename T>
+SpscQueue<T>::~SpscQueue() {
+  ASSERT_LOG(enqueue_.handler_ == nullptr, "Enqueue is not unregistered");
+  ASSERT_LOG(dequeue_.handler_ == nullptr, "Dequeue is not unregistered");
+  while (enqueue_.active_.load(std::memory_order_acquire) != 0 ||
+         dequeue_.active_.load(std::memory_order_acquire) != 0) {
+    std::this_thread::yield();
+  }
+}
+
+template <typename T>
+void SpscQueue<T>::RegisterEnqueue(Handler* handler, EnqueueCallback callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t generation = enqueue_.generation_.load() + 1;
+  Register(
+      &enqueue_,
+      handler,
+      base::Bind(&SpscQueue<T>::EnqueueCallbackInternal, base::Unretained(this), generation, std::move(callback)));
+}
+
+template <typename T>
+void SpscQueue<T>::UnregisterEnqueue() {
+  Unregister(&enqueue_, &mutex_);
+}
+
+template <typename T>
+void SpscQueue<T>::RegisterDequeue(Handler* handler, DequeueCallback callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t generation = dequeue_.generation_.load() + 1;
+  Register(
+      &dequeue_,
+      handler,
+      base::Bind(&SpscQueue<T>::DequeueCallbackInternal, base::Unretained(this), generation, std::move(callback)));
+}
+
+template <typename T>
+void SpscQueue<T>::UnregisterDequeue() {
+  Unregister(&dequeue_, &mutex_);
+}
+
+template <typename T>
+std::unique_ptr<T> SpscQueue<T>::TryDequeue() {
+  ActiveScope active(&dequeue_);
+  const uint64_t tail = tail_.load(std::memory_order_relaxed);
+  if (head_.load(std::memory_order_acquire) == tail) {
+    return nullptr;
+  }
+
+  std::unique_ptr<T> data = std::move(ring_[tail % capacity_]);
+  tail_.store(tail + 1, std::memory_order_release);
+  Notify(&enqueue_);
+  return data;
+}
+
+template <typename T>
+void SpscQueue<T>::Register(QueueEndpoint* endpoint, Handler* handler, common::Closure callback) {
+  ASSERT(endpoint->handler_ == nullptr);
+  ASSERT(endpoint->reactable_ == nullptr);
+  endpoint->generation_.fetch_add(1);
+  endpoint->handler_ = handler;
+  endpoint->reactable_ =
+      endpoint->handler_->thread_->GetReactor()->Register(endpoint->event_.Id(), std::move(callback), base::Closure());
+}
+
+template <typename T>
+void SpscQueue<T>::Unregister(QueueEndpoint* endpoint, std::mutex* mutex) {
+  Reactor* reactor = nullptr;
+  Reactor::Reactable* to_unregister = nullptr;
+  bool wait_for_unregister = false;
+  {
+    std::lock_guard<std::mutex> lock(*mutex);
+    ASSERT(endpoint->reactable_ != nullptr);
+    endpoint->generation_.fetch_add(1);
+    reactor = endpoint->handler_->thread_->GetReactor();
+    wait_for_unregister = (!endpoint->handler_->thread_->IsSameThread());
+    to_unregister = endpoint->reactable_;
+    endpoint->reactable_ = nullptr;
+    endpoint->handler_ = nullptr;
+  }
+  reactor->Unregister(to_unregister);
+  if (wait_for_unregister) {
+    reactor->WaitForUnregisteredReactable(std::chrono::milliseconds(1000));
+  }
+}
+
+template <typename T>
+void SpscQueue<T>::Notify(QueueEndpoint* endpoint) {
+  // Pairs with the fence in Park(): either the parked end sees the new
+  // position, or this sees it parked.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!endpoint->signaled_.load(std::memory_order_relaxed) && !endpoint->signaled_.exchange(true)) {
+    endpoint->event_.Notify();
+  }
+}
+
+template <typename T>
+bool SpscQueue<T>::Park(QueueEndpoint* endpoint, bool (SpscQueue<T>::*is_ready)() const) {
+  endpoint->event_.Clear();
+  endpoint->signaled_.store(false, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if ((this->*is_ready)()) {
+    Notify(endpoint);
+    return false;
+  }
+  return true;
+}
+
+template <typename T>
+bool SpscQueue<T>::CanEnqueue() const {
+  return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_acquire) < capacity_;
+}
+
+template <typename T>
+bool SpscQueue<T>::CanDequeue() const {
+  return head_.load(std::memory_order_acquire) != tail_.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+void SpscQueue<T>::EnqueueCallbackInternal(uint64_t generation, EnqueueCallback callback) {
+  ActiveScope active(&enqueue_);
+  for (int i = 0; i < kMaxBatchSize; i++) {
+    if (enqueue_.generation_.load(std::memory_order_relaxed) != generation) {
+      return;
+    }
+    if (!CanEnqueue()) {
+      Park(&enqueue_, &SpscQueue<T>::CanEnqueue);
+      return;
+    }
+    std::unique_ptr<T> data = callback.Run();
+    ASSERT(data != nullptr);
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    ring_[head % capacity_] = std::move(data);
+    head_.store(head + 1, std::memory_order_release);
+    Notify(&dequeue_);
+  }
+}
+
+template <typename T>
+void SpscQueue<T>::DequeueCallbackInternal(uint64_t generation, DequeueCallback callback) {
+  ActiveScope active(&dequeue_);
+  for (int i = 0; i < kMaxBatchSize; i++) {
+    if (dequeue_.generation_.load(std::memory_order_relaxed) != generation) {
+      return;
+    }
+    if (!CanDequeue()) {
+      Park(&dequeue_, &SpscQueue<T>::CanDequeue);
+      return;
+    }
+    callback.Run();
+  }
+}
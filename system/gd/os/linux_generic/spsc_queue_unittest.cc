@@ -0,0 +1,208 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "os/spsc_queue.h"
+
+#include <chrono>
+#include <future>
+#include <queue>
+
+#include "common/bind.h"
+#include "gtest/gtest.h"
+
+using namespace std::chrono_literals;
+
+namespace bluetooth {
+namespace os {
+namespace {
+
+constexpr int kQueueSize = 10;
+
+class SpscQueueTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    enqueue_thread_ = new Thread("enqueue_thread", Thread::Priority::NORMAL);
+    enqueue_handler_ = new Handler(enqueue_thread_);
+    dequeue_thread_ = new Thread("dequeue_thread", Thread::Priority::NORMAL);
+    dequeue_handler_ = new Handler(dequeue_thread_);
+  }
+  void TearDown() override {
+    enqueue_handler_->Clear();
+    delete enqueue_handler_;
+    delete enqueue_thread_;
+    dequeue_handler_->Clear();
+    delete dequeue_handler_;
+    delete dequeue_thread_;
+  }
+
+  void sync_handler(Handler* handler) {
+    std::promise<void> promise;
+    auto future = promise.get_future();
+    handler->Post(common::BindOnce(&std::promise<void>::set_value, common::Unretained(&promise)));
+    ASSERT_EQ(future.wait_for(2s), std::future_status::ready);
+  }
+
+  Thread* enqueue_thread_;
+  Handler* enqueue_handler_;
+  Thread* dequeue_thread_;
+  Handler* dequeue_handler_;
+};
+
+// Enqueues |count| increasing integers, then unregisters
+class TestEnqueueEnd {
+ public:
+  TestEnqueueEnd(SpscQueue<int>* queue, Handler* handler, int count)
+      : queue_(queue), handler_(handler), count_(count) {}
+
+  void Register() {
+    handler_->Post(common::BindOnce(&TestEnqueueEnd::handle_register, common::Unretained(this)));
+  }
+
+  std::unique_ptr<int> EnqueueCallback() {
+    auto data = std::make_unique<int>(enqueued_++);
+    if (enqueued_ == count_) {
+      queue_->UnregisterEnqueue();
+    }
+    return data;
+  }
+
+  std::atomic_int enqueued_ = 0;
+
+ private:
+  void handle_register() {
+    queue_->RegisterEnqueue(handler_, common::Bind(&TestEnqueueEnd::EnqueueCallback, common::Unretained(this)));
+  }
+
+  SpscQueue<int>* queue_;
+  Handler* handler_;
+  int count_;
+};
+
+// Dequeues until |count| pieces of data were received, then unregisters
+class TestDequeueEnd {
+ public:
+  TestDequeueEnd(SpscQueue<int>* queue, Handler* handler, int count)
+      : queue_(queue), handler_(handler), count_(count) {}
+
+  std::future<void> Register() {
+    handler_->Post(common::BindOnce(&TestDequeueEnd::handle_register, common::Unretained(this)));
+    return promise_.get_future();
+  }
+
+  void DequeueCallback() {
+    callback_count_++;
+    std::unique_ptr<int> data = queue_->TryDequeue();
+    ASSERT_NE(data, nullptr);
+    received_.push_back(*data);
+    if (received_.size() == static_cast<size_t>(count_)) {
+      queue_->UnregisterDequeue();
+      promise_.set_value();
+    }
+  }
+
+  std::vector<int> received_;
+  std::atomic_int callback_count_ = 0;
+
+ private:
+  void handle_register() {
+    queue_->RegisterDequeue(handler_, common::Bind(&TestDequeueEnd::DequeueCallback, common::Unretained(this)));
+  }
+
+  SpscQueue<int>* queue_;
+  Handler* handler_;
+  int count_;
+  std::promise<void> promise_;
+};
+
+TEST_F(SpscQueueTest, try_dequeue_with_empty_queue) {
+  SpscQueue<int> queue(kQueueSize);
+  EXPECT_EQ(queue.TryDequeue(), nullptr);
+}
+
+TEST_F(SpscQueueTest, register_dequeue_with_empty_queue) {
+  SpscQueue<int> queue(kQueueSize);
+  TestDequeueEnd test_dequeue_end(&queue, dequeue_handler_, kQueueSize);
+  test_dequeue_end.Register();
+  sync_handler(dequeue_handler_);
+  std::this_thread::sleep_for(20ms);
+  EXPECT_EQ(test_dequeue_end.callback_count_, 0);
+
+  dequeue_handler_->Post(common::BindOnce(&SpscQueue<int>::UnregisterDequeue, common::Unretained(&queue)));
+  sync_handler(dequeue_handler_);
+}
+
+TEST_F(SpscQueueTest, enqueue_stops_when_queue_is_full) {
+  SpscQueue<int> queue(kQueueSize);
+  TestEnqueueEnd test_enqueue_end(&queue, enqueue_handler_, kQueueSize * 2);
+  test_enqueue_end.Register();
+  sync_handler(enqueue_handler_);
+  std::this_thread::sleep_for(20ms);
+  EXPECT_EQ(test_enqueue_end.enqueued_, kQueueSize);
+
+  // Draining the queue wakes up the enqueue end again
+  TestDequeueEnd test_dequeue_end(&queue, dequeue_handler_, kQueueSize * 2);
+  auto future = test_dequeue_end.Register();
+  ASSERT_EQ(future.wait_for(2s), std::future_status::ready);
+  EXPECT_EQ(test_enqueue_end.enqueued_, kQueueSize * 2);
+}
+
+TEST_F(SpscQueueTest, data_is_received_in_order) {
+  constexpr int kCount = 10000;
+  SpscQueue<int> queue(kQueueSize);
+  TestDequeueEnd test_dequeue_end(&queue, dequeue_handler_, kCount);
+  auto future = test_dequeue_end.Register();
+  TestEnqueueEnd test_enqueue_end(&queue, enqueue_handler_, kCount);
+  test_enqueue_end.Register();
+
+  ASSERT_EQ(future.wait_for(5s), std::future_status::ready);
+  ASSERT_EQ(test_dequeue_end.received_.size(), static_cast<size_t>(kCount));
+  for (int i = 0; i < kCount; i++) {
+    ASSERT_EQ(test_dequeue_end.received_[i], i);
+  }
+  // Every callback found data to dequeue
+  EXPECT_EQ(test_dequeue_end.callback_count_, kCount);
+}
+
+TEST_F(SpscQueueTest, queue_size_one) {
+  constexpr int kCount = 100;
+  SpscQueue<int> queue(1);
+  TestDequeueEnd test_dequeue_end(&queue, dequeue_handler_, kCount);
+  auto future = test_dequeue_end.Register();
+  TestEnqueueEnd test_enqueue_end(&queue, enqueue_handler_, kCount);
+  test_enqueue_end.Register();
+
+  ASSERT_EQ(future.wait_for(2s), std::future_status::ready);
+  EXPECT_EQ(test_dequeue_end.received_.size(), static_cast<size_t>(kCount));
+}
+
+TEST_F(SpscQueueTest, unregister_enqueue_stops_batch) {
+  // Unregistering from the callback stops the batch right away
+  SpscQueue<int> queue(kQueueSize);
+  TestEnqueueEnd test_enqueue_end(&queue, enqueue_handler_, 3);
+  test_enqueue_end.Register();
+  sync_handler(enqueue_handler_);
+  std::this_thread::sleep_for(20ms);
+  EXPECT_EQ(test_enqueue_end.enqueued_, 3);
+
+  EXPECT_EQ(*queue.TryDequeue(), 0);
+  EXPECT_EQ(*queue.TryDequeue(), 1);
+  EXPECT_EQ(*queue.TryDequeue(), 2);
+  EXPECT_EQ(queue.TryDequeue(), nullptr);
+}
+
+}  // namespace
+}  // namespace os
+}  // namespace bluetooth
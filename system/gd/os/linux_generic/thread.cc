@@ -21,6 +21,8 @@
 #include <unistd.h>
 
 #include <cerrno>
+#include <cinttypes>
+#include <cstdio>
 #include <cstring>
 
 #include "os/log.h"
@@ -72,6 +74,29 @@ Reactor* Thread::GetReactor() const {
   return &reactor_;
 }
 
+void Thread::GetDumpsysData(int fd) const {
+  const Reactor::Stats stats = reactor_.GetStats();
+  const double seconds = std::chrono::duration<double>(stats.running_time).count();
+  dprintf(
+      fd,
+      "  %s: wakeups:%" PRIu64 " (%.1f/s) callbacks:%" PRIu64 " tasks:%" PRIu64 " tasks per wakeup:%.2f\n",
+      name_.c_str(),
+      stats.wakeups,
+      seconds > 0 ? stats.wakeups / seconds : 0.0,
+      stats.callbacks,
+      stats.tasks,
+      stats.wakeups > 0 ? static_cast<double>(stats.tasks) / stats.wakeups : 0.0);
+  dprintf(fd, "    callback latency:");
+  for (size_t i = 0; i < Reactor::kCallbackLatencyBucketsUs.size(); i++) {
+    dprintf(fd, " <%" PRId64 "us:%" PRIu64, Reactor::kCallbackLatencyBucketsUs[i], stats.callback_latency_histogram[i]);
+  }
+  dprintf(
+      fd,
+      " >=%" PRId64 "us:%" PRIu64 "\n",
+      Reactor::kCallbackLatencyBucketsUs.back(),
+      stats.callback_latency_histogram.back());
+}
+
 std::string Thread::GetThreadName() const {
   return name_;
 }
@@ -19,6 +19,7 @@
 #include "benchmark/benchmark.h"
 #include "os/handler.h"
 #include "os/queue.h"
+#include "os/spsc_queue.h"
 #include "os/thread.h"
 
 using ::benchmark::State;
@@ -37,8 +38,10 @@ class BM_QueuePerformance : public ::benchmark::Fixture {
   }
 
   void TearDown(State& st) override {
+    enqueue_handler_->Clear();
     delete enqueue_handler_;
     delete enqueue_thread_;
+    dequeue_handler_->Clear();
     delete dequeue_handler_;
     delete dequeue_thread_;
     enqueue_handler_ = nullptr;
@@ -56,7 +59,8 @@ class BM_QueuePerformance : public ::benchmark::Fixture {
 
 class TestEnqueueEnd {
  public:
-  explicit TestEnqueueEnd(int64_t count, Queue<std::string>* queue, Handler* handler, std::promise<void>* promise)
+  explicit TestEnqueueEnd(
+      int64_t count, IQueueEnqueue<std::string>* queue, Handler* handler, std::promise<void>* promise)
       : count_(count), handler_(handler), queue_(queue), promise_(promise) {}
 
   void RegisterEnqueue() {
@@ -95,7 +99,7 @@ class TestEnqueueEnd {
 
  private:
   Handler* handler_;
-  Queue<std::string>* queue_;
+  IQueueEnqueue<std::string>* queue_;
   std::promise<void>* promise_;
   std::mutex mutex_;
 
@@ -106,7 +110,8 @@ class TestEnqueueEnd {
 
 class TestDequeueEnd {
  public:
-  explicit TestDequeueEnd(int64_t count, Queue<std::string>* queue, Handler* handler, std::promise<void>* promise)
+  explicit TestDequeueEnd(
+      int64_t count, IQueueDequeue<std::string>* queue, Handler* handler, std::promise<void>* promise)
       : count_(count), handler_(handler), queue_(queue), promise_(promise) {}
 
   void RegisterDequeue() {
@@ -129,7 +134,7 @@ class TestDequeueEnd {
 
  private:
   Handler* handler_;
-  Queue<std::string>* queue_;
+  IQueueDequeue<std::string>* queue_;
   std::promise<void>* promise_;
 
   void handle_register_dequeue() {
@@ -137,28 +142,35 @@ class TestDequeueEnd {
   }
 };
 
-BENCHMARK_DEFINE_F(BM_QueuePerformance, send_packet_vary_by_packet_num)(State& state) {
+// Moves |num_packets| strings of |packet_size| bytes from the enqueue thread
+// to the dequeue thread through a |QueueType| of |num_packets| capacity.
+template <typename QueueType>
+void SendPackets(
+    State& state, Handler* enqueue_handler, Handler* dequeue_handler, int64_t num_packets, int64_t packet_size) {
   for (auto _ : state) {
-    int64_t num_data_to_send_ = state.range(0);
-    Queue<std::string> queue(num_data_to_send_);
+    QueueType queue(num_packets);
 
     // register dequeue
     std::promise<void> dequeue_promise;
     auto dequeue_future = dequeue_promise.get_future();
-    TestDequeueEnd test_dequeue_end(num_data_to_send_, &queue, enqueue_handler_, &dequeue_promise);
+    TestDequeueEnd test_dequeue_end(num_packets, &queue, dequeue_handler, &dequeue_promise);
     test_dequeue_end.RegisterDequeue();
 
     // Push data to enqueue end buffer and register enqueue
     std::promise<void> enqueue_promise;
-    TestEnqueueEnd test_enqueue_end(num_data_to_send_, &queue, enqueue_handler_, &enqueue_promise);
-    for (int i = 0; i < num_data_to_send_; i++) {
-      std::string data = std::to_string(1);
-      test_enqueue_end.push(std::move(data));
+    TestEnqueueEnd test_enqueue_end(num_packets, &queue, enqueue_handler, &enqueue_promise);
+    for (int i = 0; i < num_packets; i++) {
+      test_enqueue_end.push(std::string(packet_size, 'x'));
     }
     dequeue_future.wait();
   }
 
-  state.SetBytesProcessed(static_cast<int_fast64_t>(state.iterations()) * state.range(0));
+  state.SetItemsProcessed(static_cast<int_fast64_t>(state.iterations()) * num_packets);
+  state.SetBytesProcessed(static_cast<int_fast64_t>(state.iterations()) * num_packets * packet_size);
+}
+
+BENCHMARK_DEFINE_F(BM_QueuePerformance, send_packet_vary_by_packet_num)(State& state) {
+  SendPackets<Queue<std::string>>(state, enqueue_handler_, enqueue_handler_, state.range(0), 1);
 };
 
 BENCHMARK_REGISTER_F(BM_QueuePerformance, send_packet_vary_by_packet_num)
@@ -171,34 +183,61 @@ BENCHMARK_REGISTER_F(BM_QueuePerformance, send_packet_vary_by_packet_num)
     ->UseRealTime();
 
 BENCHMARK_DEFINE_F(BM_QueuePerformance, send_10000_packet_vary_by_packet_size)(State& state) {
-  for (auto _ : state) {
-    int64_t num_data_to_send_ = 10000;
-    int64_t packet_size = state.range(0);
-    Queue<std::string> queue(num_data_to_send_);
+  SendPackets<Queue<std::string>>(state, enqueue_handler_, enqueue_handler_, 10000, state.range(0));
+};
 
-    // register dequeue
-    std::promise<void> dequeue_promise;
-    auto dequeue_future = dequeue_promise.get_future();
-    TestDequeueEnd test_dequeue_end(num_data_to_send_, &queue, enqueue_handler_, &dequeue_promise);
-    test_dequeue_end.RegisterDequeue();
+BENCHMARK_REGISTER_F(BM_QueuePerformance, send_10000_packet_vary_by_packet_size)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Iterations(100)
+    ->UseRealTime();
 
-    // Push data to enqueue end buffer and register enqueue
-    std::promise<void> enqueue_promise;
-    TestEnqueueEnd test_enqueue_end(num_data_to_send_, &queue, enqueue_handler_, &enqueue_promise);
-    for (int i = 0; i < num_data_to_send_; i++) {
-      std::string data = std::string(packet_size, 'x');
-      test_enqueue_end.push(std::move(data));
-    }
-    dequeue_future.wait();
-  }
+// Enqueue and dequeue ends on different threads, as for ACL data between the
+// HCI layer and a connection handler
+BENCHMARK_DEFINE_F(BM_QueuePerformance, cross_thread_vary_by_packet_num)(State& state) {
+  SendPackets<Queue<std::string>>(state, enqueue_handler_, dequeue_handler_, state.range(0), 1);
+};
+
+BENCHMARK_REGISTER_F(BM_QueuePerformance, cross_thread_vary_by_packet_num)
+    ->Arg(10)
+    ->Arg(1000)
+    ->Arg(100000)
+    ->Iterations(100)
+    ->UseRealTime();
 
-  state.SetBytesProcessed(static_cast<int_fast64_t>(state.iterations()) * state.range(0) * 10000);
+BENCHMARK_DEFINE_F(BM_QueuePerformance, spsc_send_packet_vary_by_packet_num)(State& state) {
+  SendPackets<SpscQueue<std::string>>(state, enqueue_handler_, enqueue_handler_, state.range(0), 1);
 };
 
-BENCHMARK_REGISTER_F(BM_QueuePerformance, send_10000_packet_vary_by_packet_size)
+BENCHMARK_REGISTER_F(BM_QueuePerformance, spsc_send_packet_vary_by_packet_num)
     ->Arg(10)
     ->Arg(100)
     ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(100000)
+    ->Iterations(100)
+    ->UseRealTime();
+
+BENCHMARK_DEFINE_F(BM_QueuePerformance, spsc_send_10000_packet_vary_by_packet_size)(State& state) {
+  SendPackets<SpscQueue<std::string>>(state, enqueue_handler_, enqueue_handler_, 10000, state.range(0));
+};
+
+BENCHMARK_REGISTER_F(BM_QueuePerformance, spsc_send_10000_packet_vary_by_packet_size)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Iterations(100)
+    ->UseRealTime();
+
+BENCHMARK_DEFINE_F(BM_QueuePerformance, spsc_cross_thread_vary_by_packet_num)(State& state) {
+  SendPackets<SpscQueue<std::string>>(state, enqueue_handler_, dequeue_handler_, state.range(0), 1);
+};
+
+BENCHMARK_REGISTER_F(BM_QueuePerformance, spsc_cross_thread_vary_by_packet_num)
+    ->Arg(10)
+    ->Arg(1000)
+    ->Arg(100000)
     ->Iterations(100)
     ->UseRealTime();
 
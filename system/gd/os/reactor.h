@@ -18,7 +18,9 @@
 
 #include <sys/epoll.h>
 
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <functional>
 #include <future>
 #include <list>
@@ -79,6 +81,27 @@ class Reactor {
   // Modify subscribed poll events on the fly
   void ModifyRegistration(Reactable* reactable, ReactOn react_on);
 
+  // Upper bounds of the callback latency histogram buckets, in microseconds. The last bucket of the histogram counts
+  // the callbacks above the last bound.
+  static constexpr std::array<int64_t, 5> kCallbackLatencyBucketsUs = {10, 100, 1000, 10000, 100000};
+
+  // Dispatch statistics, collected since the reactor started running
+  struct Stats {
+    // epoll_wait() returns with at least one ready reactable
+    uint64_t wakeups;
+    // on_read_ready() and on_write_ready() invocations
+    uint64_t callbacks;
+    // Tasks run by handlers of this reactor, see RecordExecutedTasks()
+    uint64_t tasks;
+    std::chrono::steady_clock::duration running_time;
+    std::array<uint64_t, kCallbackLatencyBucketsUs.size() + 1> callback_latency_histogram;
+  };
+
+  Stats GetStats() const;
+
+  // Accounts for |count| tasks run by a reactable callback, called by handlers on the reactor thread
+  void RecordExecutedTasks(size_t count);
+
   class Event {
    public:
     Event();
@@ -104,6 +127,15 @@ class Reactor {
   std::list<Reactable*> invalidation_list_;
   std::shared_ptr<std::future<void>> executing_reactable_finished_;
   std::shared_ptr<std::promise<void>> idle_promise_;
+
+  void record_callback(std::chrono::steady_clock::duration latency);
+
+  // Only written from the reactor thread
+  std::atomic<int64_t> started_at_ns_{0};
+  std::atomic<uint64_t> wakeups_{0};
+  std::atomic<uint64_t> callbacks_{0};
+  std::atomic<uint64_t> tasks_{0};
+  std::array<std::atomic<uint64_t>, kCallbackLatencyBucketsUs.size() + 1> callback_latency_histogram_{};
 };
 
 }  // namespace os
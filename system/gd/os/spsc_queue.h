@@ -0,0 +1,134 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/bind.h"
+#include "common/callback.h"
+#include "os/handler.h"
+#include "os/log.h"
+#include "os/queue.h"
+#include "os/reactor.h"
+
+namespace bluetooth {
+namespace os {
+
+// Drop-in replacement for |Queue| when data only ever flows from one enqueue
+// handler to one dequeue handler.
+//
+// Data is kept in a fixed size ring indexed by lock free positions, so moving
+// data costs no lock and no system call. The enqueue and dequeue ends are
+// only signaled when the ring goes from full to not full, and from empty to
+// not empty. Once woken up, an end moves up to |kMaxBatchSize| pieces of data
+// before yielding back to its reactor.
+//
+// EnqueueCallback must only be invoked from the registered enqueue handler,
+// and TryDequeue() only from the registered dequeue handler.
+template <typename T>
+class SpscQueue : public IQueueEnqueue<T>, public IQueueDequeue<T> {
+ public:
+  using EnqueueCallback = common::Callback<std::unique_ptr<T>()>;
+  using DequeueCallback = common::Callback<void()>;
+  // Create a queue with |capacity| is the maximum number of messages a queue can contain
+  explicit SpscQueue(size_t capacity);
+  ~SpscQueue();
+  // See |Queue::RegisterEnqueue|
+  void RegisterEnqueue(Handler* handler, EnqueueCallback callback) override;
+  // See |Queue::UnregisterEnqueue|
+  void UnregisterEnqueue() override;
+  // See |Queue::RegisterDequeue|
+  void RegisterDequeue(Handler* handler, DequeueCallback callback) override;
+  // See |Queue::UnregisterDequeue|
+  void UnregisterDequeue() override;
+
+  // Try to dequeue an item from this queue. Return nullptr when there is nothing in the queue.
+  std::unique_ptr<T> TryDequeue() override;
+
+  // Maximum number of callbacks run for one reactor wake up
+  static constexpr int kMaxBatchSize = 16;
+
+ private:
+  class QueueEndpoint {
+   public:
+    explicit QueueEndpoint(bool ready) : signaled_(ready), handler_(nullptr), reactable_(nullptr) {
+      if (ready) {
+        event_.Notify();
+      }
+    }
+    // Readable as long as |signaled_| is set
+    Reactor::Event event_;
+    std::atomic_bool signaled_;
+    // Bumped on each registration change, so that a batch stops as soon as
+    // its callback unregisters
+    std::atomic<uint64_t> generation_{0};
+    // Non zero while the thread of this end runs queue code. The last piece
+    // of data may be consumed, and the queue destroyed, before the end that
+    // handed it over is done signaling the other end.
+    std::atomic<int> active_{0};
+    Handler* handler_;
+    Reactor::Reactable* reactable_;
+  };
+
+  void EnqueueCallbackInternal(uint64_t generation, EnqueueCallback callback);
+  void DequeueCallbackInternal(uint64_t generation, DequeueCallback callback);
+  static void Register(QueueEndpoint* endpoint, Handler* handler, common::Closure callback);
+  static void Unregister(QueueEndpoint* endpoint, std::mutex* mutex);
+  // Wakes up |endpoint| unless it is already signaled. Must follow the
+  // position update that made it ready.
+  static void Notify(QueueEndpoint* endpoint);
+  // Stops signaling |endpoint|, returns false if it was made ready again in
+  // the meantime.
+  bool Park(QueueEndpoint* endpoint, bool (SpscQueue<T>::*is_ready)() const);
+  bool CanEnqueue() const;
+  bool CanDequeue() const;
+
+  class ActiveScope {
+   public:
+    explicit ActiveScope(QueueEndpoint* endpoint) : endpoint_(endpoint) {
+      // Only ever modified from the thread of the end
+      endpoint_->active_.store(endpoint_->active_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    ~ActiveScope() {
+      endpoint_->active_.store(endpoint_->active_.load(std::memory_order_relaxed) - 1, std::memory_order_release);
+    }
+
+   private:
+    QueueEndpoint* endpoint_;
+  };
+
+  const size_t capacity_;
+  std::vector<std::unique_ptr<T>> ring_;
+  // Monotonic positions, the ring index is position % capacity_. |head_| is
+  // only written by the enqueue end and |tail_| by the dequeue end.
+  alignas(64) std::atomic<uint64_t> head_{0};
+  alignas(64) std::atomic<uint64_t> tail_{0};
+
+  // Guards registration changes only
+  std::mutex mutex_;
+  QueueEndpoint enqueue_;
+  QueueEndpoint dequeue_;
+};
+
+#include "os/linux_generic/spsc_queue.tpp"
+
+}  // namespace os
+}  // namespace bluetooth
@@ -64,6 +64,9 @@ class Thread {
   // Return the pointer of underlying reactor. The ownership is NOT transferred.
   Reactor* GetReactor() const;
 
+  // Dump the dispatch statistics of the underlying reactor to |fd|
+  void GetDumpsysData(int fd) const;
+
  private:
   void run(Priority priority);
   mutable std::mutex mutex_;
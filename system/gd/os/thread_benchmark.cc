@@ -61,9 +61,13 @@ class BM_ReactorThread : public BM_ThreadPerformance {
   void SetUp(State& st) override {
     BM_ThreadPerformance::SetUp(st);
     thread_ = std::make_unique<Thread>("BM_ReactorThread thread", Thread::Priority::NORMAL);
-    handler_ = std::make_unique<Handler>(thread_.get());
+    handler_ = std::make_unique<Handler>(thread_.get(), batched());
+  }
+  virtual bool batched() const {
+    return false;
   }
   void TearDown(State& st) override {
+    handler_->Clear();
     handler_ = nullptr;
     thread_->Stop();
     thread_ = nullptr;
@@ -115,3 +119,64 @@ BENCHMARK_REGISTER_F(BM_ReactorThread, sequential_execution)
     ->Arg(100000)
     ->Iterations(1)
     ->UseRealTime();
+
+class BM_BatchedReactorThread : public BM_ReactorThread {
+ protected:
+  bool batched() const override {
+    return true;
+  }
+  void ReportReactorStats(State& state, const bluetooth::os::Reactor::Stats& before) {
+    auto after = thread_->GetReactor()->GetStats();
+    uint64_t wakeups = after.wakeups - before.wakeups;
+    state.counters["wakeups"] = wakeups;
+    state.counters["tasks_per_wakeup"] = wakeups == 0 ? 0.0 : static_cast<double>(after.tasks - before.tasks) / wakeups;
+  }
+};
+
+BENCHMARK_DEFINE_F(BM_BatchedReactorThread, batch_enque_dequeue)(State& state) {
+  auto before = thread_->GetReactor()->GetStats();
+  for (auto _ : state) {
+    num_messages_to_send_ = state.range(0);
+    counter_ = 0;
+    counter_promise_ = std::promise<void>();
+    std::future<void> counter_future = counter_promise_.get_future();
+    for (int i = 0; i < num_messages_to_send_; i++) {
+      handler_->Post(BindOnce(
+          &BM_BatchedReactorThread_batch_enque_dequeue_Benchmark::callback_batch,
+          bluetooth::common::Unretained(this)));
+    }
+    counter_future.wait();
+  }
+  ReportReactorStats(state, before);
+};
+
+BENCHMARK_REGISTER_F(BM_BatchedReactorThread, batch_enque_dequeue)
+    ->Arg(10)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(100000)
+    ->Iterations(1)
+    ->UseRealTime();
+
+BENCHMARK_DEFINE_F(BM_BatchedReactorThread, sequential_execution)(State& state) {
+  auto before = thread_->GetReactor()->GetStats();
+  for (auto _ : state) {
+    num_messages_to_send_ = state.range(0);
+    for (int i = 0; i < num_messages_to_send_; i++) {
+      counter_promise_ = std::promise<void>();
+      std::future<void> counter_future = counter_promise_.get_future();
+      handler_->Post(BindOnce(
+          &BM_BatchedReactorThread_sequential_execution_Benchmark::callback, bluetooth::common::Unretained(this)));
+      counter_future.wait();
+    }
+  }
+  ReportReactorStats(state, before);
+};
+
+BENCHMARK_REGISTER_F(BM_BatchedReactorThread, sequential_execution)
+    ->Arg(10)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(100000)
+    ->Iterations(1)
+    ->UseRealTime();
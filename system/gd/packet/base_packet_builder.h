@@ -20,9 +20,12 @@
 #include <forward_list>
 #include <iterator>
 #include <memory>
+#include <span>
 #include <vector>
 
+#include "os/log.h"
 #include "packet/bit_inserter.h"
+#include "packet/buffer_inserter.h"
 
 namespace bluetooth {
 namespace packet {
@@ -38,6 +41,15 @@ class BasePacketBuilder {
   // Write to the vector with the given iterator.
   virtual void Serialize(BitInserter& it) const = 0;
 
+  // Write to |buffer|, which must hold at least size() bytes, without any
+  // intermediate copy. Returns the number of bytes written.
+  size_t SerializeInto(std::span<uint8_t> buffer) const {
+    ASSERT_LOG(buffer.size() >= size(), "Buffer of %zu bytes is too small for %zu", buffer.size(), size());
+    BufferInserter it(buffer);
+    Serialize(it);
+    return it.size();
+  }
+
   void SetFlushable(bool is_flushable) {
     is_flushable_ = is_flushable;
   }
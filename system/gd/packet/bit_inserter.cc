@@ -44,5 +44,11 @@ void BitInserter::insert_byte(uint8_t byte) {
   insert_bits(byte, 8);
 }
 
+void BitInserter::insert_bytes(const uint8_t* bytes, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    insert_byte(bytes[i]);
+  }
+}
+
 }  // namespace packet
 }  // namespace bluetooth
@@ -35,6 +35,9 @@ class BitInserter : public ByteInserter {
 
   void insert_byte(uint8_t byte) override;
 
+  // Write |length| whole bytes
+  virtual void insert_bytes(const uint8_t* bytes, size_t length);
+
  protected:
   size_t num_saved_bits_{0};
   uint8_t saved_bits_{0};
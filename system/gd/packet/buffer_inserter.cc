@@ -0,0 +1,75 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "packet/buffer_inserter.h"
+
+#include <cstring>
+
+#include "os/log.h"
+
+namespace bluetooth {
+namespace packet {
+
+BufferInserter::BufferInserter(std::span<uint8_t> buffer)
+    : BitInserter(to_construct_bit_inserter_), buffer_(buffer) {}
+
+void BufferInserter::insert_bits(uint8_t byte, size_t num_bits) {
+  size_t total_bits = num_bits + num_saved_bits_;
+  uint16_t new_value = static_cast<uint8_t>(saved_bits_) | (static_cast<uint16_t>(byte) << num_saved_bits_);
+  if (total_bits >= 8) {
+    uint8_t new_byte = static_cast<uint8_t>(new_value);
+    ASSERT_LOG(offset_ < buffer_.size(), "Serializing past the end of a %zu byte buffer", buffer_.size());
+    on_byte(new_byte);
+    buffer_[offset_++] = new_byte;
+    total_bits -= 8;
+    new_value = new_value >> 8;
+  }
+  num_saved_bits_ = total_bits;
+  uint8_t mask = static_cast<uint8_t>(0xff) >> (8 - num_saved_bits_);
+  saved_bits_ = static_cast<uint8_t>(new_value) & mask;
+}
+
+void BufferInserter::insert_byte(uint8_t byte) {
+  if (num_saved_bits_ != 0) {
+    insert_bits(byte, 8);
+    return;
+  }
+  ASSERT_LOG(offset_ < buffer_.size(), "Serializing past the end of a %zu byte buffer", buffer_.size());
+  on_byte(byte);
+  buffer_[offset_++] = byte;
+}
+
+void BufferInserter::insert_bytes(const uint8_t* bytes, size_t length) {
+  // Byte aligned runs nobody is observing are copied in one go
+  if (num_saved_bits_ != 0 || HasObservers()) {
+    BitInserter::insert_bytes(bytes, length);
+    return;
+  }
+  ASSERT_LOG(
+      length <= buffer_.size() - offset_,
+      "Serializing %zu bytes past the end of a %zu byte buffer",
+      length,
+      buffer_.size());
+  std::memcpy(buffer_.data() + offset_, bytes, length);
+  offset_ += length;
+}
+
+size_t BufferInserter::size() const {
+  return offset_;
+}
+
+}  // namespace packet
+}  // namespace bluetooth
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "packet/bit_inserter.h"
+
+namespace bluetooth {
+namespace packet {
+
+// BitInserter writing into a caller-provided buffer instead of appending to a
+// vector, so builders can be serialized straight into their final storage.
+// Writing past the end of the buffer is fatal.
+class BufferInserter : public BitInserter {
+ public:
+  explicit BufferInserter(std::span<uint8_t> buffer);
+
+  void insert_bits(uint8_t byte, size_t num_bits) override;
+
+  void insert_byte(uint8_t byte) override;
+
+  void insert_bytes(const uint8_t* bytes, size_t length) override;
+
+  // Number of bytes written so far
+  size_t size() const;
+
+ protected:
+  std::vector<uint8_t> to_construct_bit_inserter_;
+  std::span<uint8_t> buffer_;
+  size_t offset_{0};
+};
+
+}  // namespace packet
+}  // namespace bluetooth
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "packet/buffer_inserter.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+
+using bluetooth::packet::BufferInserter;
+
+namespace bluetooth {
+namespace packet {
+
+TEST(BufferInserterTest, addMoreBits) {
+  std::array<uint8_t, 5> bytes{};
+  BufferInserter it(bytes);
+
+  for (size_t i = 0; i < 9; i++) {
+    it.insert_bits(static_cast<uint8_t>(i), i);
+  }
+  it.insert_bits(static_cast<uint8_t>(0b1010), 4);
+  std::array<uint8_t, 5> result = {
+      0b00011101 /* 3 2 1 */,
+      0b00010101 /* 5 4 */,
+      0b11100011 /* 7 6 */,
+      0b10000000 /* 8 */,
+      0b10100000 /* filled with 1010 */};
+
+  ASSERT_EQ(result.size(), it.size());
+  ASSERT_EQ(result, bytes);
+}
+
+TEST(BufferInserterTest, observerTest) {
+  std::array<uint8_t, 2> bytes{};
+  BufferInserter it(bytes);
+  std::vector<uint8_t> copy;
+
+  uint64_t checksum = 0x0123456789abcdef;
+  it.RegisterObserver(ByteObserver([&copy](uint8_t byte) { copy.push_back(byte); }, [checksum]() { return checksum; }));
+  it.insert_byte(0x12);
+  ByteObserver observer = it.UnregisterObserver();
+  ASSERT_EQ(checksum, observer.GetValue());
+  it.insert_byte(0x34);
+
+  ASSERT_EQ(2u, it.size());
+  ASSERT_EQ(0x12, bytes[0]);
+  ASSERT_EQ(0x34, bytes[1]);
+  ASSERT_EQ(std::vector<uint8_t>({0x12}), copy);
+}
+
+TEST(BufferInserterTest, overflowDeathTest) {
+  std::array<uint8_t, 1> bytes{};
+  BufferInserter it(bytes);
+  it.insert_byte(0x12);
+  ASSERT_DEATH(it.insert_byte(0x34), "");
+}
+
+}  // namespace packet
+}  // namespace bluetooth
@@ -43,6 +43,10 @@ void ByteInserter::on_byte(uint8_t byte) {
   }
 }
 
+bool ByteInserter::HasObservers() const {
+  return !registered_observers_.empty();
+}
+
 void ByteInserter::insert_byte(uint8_t byte) {
   on_byte(byte);
   std::back_insert_iterator<std::vector<uint8_t>>::operator=(byte);
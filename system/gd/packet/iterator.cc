@@ -22,23 +22,20 @@ namespace bluetooth {
 namespace packet {
 
 template <bool little_endian>
-Iterator<little_endian>::Iterator(const std::forward_list<View>& data, size_t offset) {
-  data_ = data;
-  index_ = offset;
-  begin_ = 0;
-  end_ = 0;
-  for (auto& view : data) {
-    end_ += view.size();
-  }
-}
+Iterator<little_endian>::Iterator(
+    const uint8_t* contiguous_data,
+    std::shared_ptr<const std::vector<View>> fragments,
+    size_t length,
+    size_t offset)
+    : contiguous_data_(contiguous_data),
+      fragments_(std::move(fragments)),
+      index_(offset),
+      begin_(0),
+      end_(length) {}
 
 template <bool little_endian>
-Iterator<little_endian>::Iterator(std::shared_ptr<std::vector<uint8_t>> data) {
-  data_.emplace_front(data, 0, data->size());
-  index_ = 0;
-  begin_ = 0;
-  end_ = data_.front().size();
-}
+Iterator<little_endian>::Iterator(std::shared_ptr<std::vector<uint8_t>> data)
+    : contiguous_data_(data->data()), owned_data_(data), index_(0), begin_(0), end_(data->size()) {}
 
 template <bool little_endian>
 Iterator<little_endian> Iterator<little_endian>::operator+(int offset) const {
@@ -91,7 +88,9 @@ Iterator<little_endian>& Iterator<little_endian>::operator=(const Iterator<littl
   if (this == &itr) {
     return *this;
   }
-  this->data_ = itr.data_;
+  this->contiguous_data_ = itr.contiguous_data_;
+  this->fragments_ = itr.fragments_;
+  this->owned_data_ = itr.owned_data_;
   this->begin_ = itr.begin_;
   this->end_ = itr.end_;
   this->index_ = itr.index_;
@@ -136,9 +135,12 @@ uint8_t Iterator<little_endian>::operator*() const {
       index_,
       begin_,
       end_);
-  size_t index = index_;
+  if (contiguous_data_ != nullptr) {
+    return contiguous_data_[index_];
+  }
 
-  for (auto view : data_) {
+  size_t index = index_;
+  for (const auto& view : *fragments_) {
     if (index < view.size()) {
       return view[index];
     }
@@ -17,9 +17,9 @@
 #pragma once
 
 #include <cstdint>
-#include <forward_list>
 #include <memory>
 #include <type_traits>
+#include <vector>
 
 #include "packet/custom_field_fixed_size_interface.h"
 #include "packet/view.h"
@@ -41,11 +41,17 @@ struct IteratorTraits {
 struct IteratorTraits : public std::iterator<std::random_access_iterator_tag, uint8_t> {};
 #endif
 
+template <bool little_endian>
+class PacketView;
+
 // Templated Iterator for endianness
+//
+// Iterators created from a PacketView do not own the packet bytes: they must
+// not outlive every view sharing that data. Iterators of single fragment
+// packets read straight from the contiguous bytes of the fragment.
 template <bool little_endian>
 class Iterator : public IteratorTraits {
  public:
-  Iterator(const std::forward_list<View>& data, size_t offset);
   Iterator(std::shared_ptr<std::vector<uint8_t>> data);
   Iterator(const Iterator& itr) = default;
   virtual ~Iterator() = default;
@@ -84,6 +90,15 @@ class Iterator : public IteratorTraits {
     T extracted_value{};
     uint8_t* value_ptr = (uint8_t*)&extracted_value;
 
+    if (contiguous_data_ != nullptr && NumBytesRemaining() >= sizeof(T)) {
+      const uint8_t* src = contiguous_data_ + index_;
+      for (size_t i = 0; i < sizeof(T); i++) {
+        value_ptr[little_endian ? i : sizeof(T) - i - 1] = src[i];
+      }
+      index_ += sizeof(T);
+      return extracted_value;
+    }
+
     for (size_t i = 0; i < sizeof(T); i++) {
       size_t index = (little_endian ? i : sizeof(T) - i - 1);
       value_ptr[index] = this->operator*();
@@ -104,7 +119,20 @@ class Iterator : public IteratorTraits {
   }
 
  private:
-  std::forward_list<View> data_;
+  friend class PacketView<little_endian>;
+
+  Iterator(
+      const uint8_t* contiguous_data,
+      std::shared_ptr<const std::vector<View>> fragments,
+      size_t length,
+      size_t offset);
+
+  // Bytes of a single fragment packet, nullptr for packets made of several
+  // fragments which are looked up in |fragments_| instead.
+  const uint8_t* contiguous_data_;
+  std::shared_ptr<const std::vector<View>> fragments_;
+  // Only set when the iterator was created from a buffer it has to keep alive
+  std::shared_ptr<std::vector<uint8_t>> owned_data_;
   size_t index_;
   size_t begin_;
   size_t end_;
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "hci/address.h"
+#include "hci/hci_packets.h"
+#include "packet/bit_inserter.h"
+#include "packet/raw_builder.h"
+
+using ::benchmark::State;
+
+namespace bluetooth {
+namespace packet {
+
+namespace {
+std::unique_ptr<BasePacketBuilder> MakeCommand() {
+  return hci::LeSetRandomAddressBuilder::Create(hci::Address({0x01, 0x02, 0x03, 0x04, 0x05, 0x06}));
+}
+
+std::unique_ptr<BasePacketBuilder> MakeAcl(size_t payload_size) {
+  return hci::AclBuilder::Create(
+      0x0123,
+      hci::PacketBoundaryFlag::FIRST_AUTOMATICALLY_FLUSHABLE,
+      hci::BroadcastFlag::POINT_TO_POINT,
+      std::make_unique<RawBuilder>(std::vector<uint8_t>(payload_size, 0x5a)));
+}
+
+// Serialization as done before SerializeInto(): grow a vector through a
+// BitInserter, to be copied again into the HAL buffer.
+void SerializeToVector(State& state, const BasePacketBuilder& builder) {
+  for (auto _ : state) {
+    std::vector<uint8_t> bytes;
+    BitInserter it(bytes);
+    builder.Serialize(it);
+    std::vector<uint8_t> hal_buffer(bytes);
+    ::benchmark::DoNotOptimize(hal_buffer.data());
+  }
+  state.SetBytesProcessed(static_cast<int_fast64_t>(state.iterations()) * builder.size());
+}
+
+void SerializeIntoBuffer(State& state, const BasePacketBuilder& builder) {
+  for (auto _ : state) {
+    std::vector<uint8_t> hal_buffer(builder.size());
+    builder.SerializeInto(hal_buffer);
+    ::benchmark::DoNotOptimize(hal_buffer.data());
+  }
+  state.SetBytesProcessed(static_cast<int_fast64_t>(state.iterations()) * builder.size());
+}
+}  // namespace
+
+static void BM_SerializeCommandToVector(State& state) {
+  SerializeToVector(state, *MakeCommand());
+}
+BENCHMARK(BM_SerializeCommandToVector);
+
+static void BM_SerializeCommandIntoBuffer(State& state) {
+  SerializeIntoBuffer(state, *MakeCommand());
+}
+BENCHMARK(BM_SerializeCommandIntoBuffer);
+
+static void BM_SerializeAclToVector(State& state) {
+  SerializeToVector(state, *MakeAcl(state.range(0)));
+}
+BENCHMARK(BM_SerializeAclToVector)->Arg(27)->Arg(251)->Arg(1021);
+
+static void BM_SerializeAclIntoBuffer(State& state) {
+  SerializeIntoBuffer(state, *MakeAcl(state.range(0)));
+}
+BENCHMARK(BM_SerializeAclIntoBuffer)->Arg(27)->Arg(251)->Arg(1021);
+
+}  // namespace packet
+}  // namespace bluetooth
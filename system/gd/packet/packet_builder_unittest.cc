@@ -96,6 +96,22 @@ TEST(PacketBuilderEndianTest, insertTest) {
   ASSERT_EQ(*big.FinalPacket(), *little.FinalPacket());
 }
 
+TEST(PacketBuilderEndianTest, serializeIntoTest) {
+  EndianBuilder<true> little(0x04, 0x0605, 0x0a090807, 0x1211100f0e0d0c0b);
+  std::vector<uint8_t> buffer(little.size() + 2, 0xff);
+  ASSERT_EQ(little.size(), little.SerializeInto(buffer));
+  ASSERT_EQ(*little.FinalPacket(), std::vector<uint8_t>(buffer.begin(), buffer.begin() + little.size()));
+  // Bytes past size() are left untouched
+  ASSERT_EQ(0xff, buffer[little.size()]);
+  ASSERT_EQ(*little.FinalPacket(), little.SerializeToBytes());
+}
+
+TEST(PacketBuilderEndianTest, serializeIntoSmallBufferDeathTest) {
+  EndianBuilder<true> little(0x04, 0x0605, 0x0a090807, 0x1211100f0e0d0c0b);
+  std::vector<uint8_t> buffer(little.size() - 1);
+  ASSERT_DEATH(little.SerializeInto(buffer), "");
+}
+
 template <typename T>
 class VectorBuilder : public PacketBuilder<true> {
  public:
@@ -24,25 +24,25 @@ namespace bluetooth {
 namespace packet {
 
 template <bool little_endian>
-PacketView<little_endian>::PacketView(const std::forward_list<class View> fragments)
-    : fragments_(fragments), length_(0) {
-  for (auto fragment : fragments_) {
-    length_ += fragment.size();
-  }
+PacketView<little_endian>::PacketView(View fragment) : fragment_(std::move(fragment)), length_(fragment_->size()) {}
+
+template <bool little_endian>
+PacketView<little_endian>::PacketView(std::vector<View> fragments) : length_(0) {
+  SetFragments(std::move(fragments));
 }
 
 template <bool little_endian>
 PacketView<little_endian>::PacketView(std::shared_ptr<const std::vector<uint8_t>> packet)
-    : fragments_({View(packet, 0, packet->size())}), length_(packet->size()) {}
+    : fragment_(View(packet, 0, packet->size())), length_(packet->size()) {}
 
 template <bool little_endian>
 Iterator<little_endian> PacketView<little_endian>::begin() const {
-  return Iterator<little_endian>(this->fragments_, 0);
+  return Iterator<little_endian>(fragment_ ? fragment_->data() : nullptr, fragments_, length_, 0);
 }
 
 template <bool little_endian>
 Iterator<little_endian> PacketView<little_endian>::end() const {
-  return Iterator<little_endian>(this->fragments_, size());
+  return Iterator<little_endian>(fragment_ ? fragment_->data() : nullptr, fragments_, length_, length_);
 }
 
 template <bool little_endian>
@@ -53,7 +53,10 @@ uint8_t PacketView<little_endian>::operator[](size_t index) const {
 template <bool little_endian>
 uint8_t PacketView<little_endian>::at(size_t index) const {
   ASSERT_LOG(index < length_, "Index %zu out of bounds", index);
-  for (const auto& fragment : fragments_) {
+  if (fragment_) {
+    return (*fragment_)[index];
+  }
+  for (const auto& fragment : *fragments_) {
     if (index < fragment.size()) {
       return fragment[index];
     }
@@ -69,20 +72,43 @@ size_t PacketView<little_endian>::size() const {
 }
 
 template <bool little_endian>
-std::forward_list<View> PacketView<little_endian>::GetSubviewList(size_t begin, size_t end) const {
+void PacketView<little_endian>::SetFragments(std::vector<View> fragments) {
+  length_ = 0;
+  for (const auto& fragment : fragments) {
+    length_ += fragment.size();
+  }
+  if (fragments.size() == 1) {
+    fragment_.emplace(std::move(fragments.front()));
+    fragments_.reset();
+  } else {
+    fragment_.reset();
+    fragments_ = fragments.empty() ? nullptr : std::make_shared<const std::vector<View>>(std::move(fragments));
+  }
+}
+
+template <bool little_endian>
+void PacketView<little_endian>::AppendFragmentsTo(std::vector<View>* fragments) const {
+  if (fragment_) {
+    fragments->push_back(*fragment_);
+  } else if (fragments_ != nullptr) {
+    fragments->insert(fragments->end(), fragments_->begin(), fragments_->end());
+  }
+}
+
+template <bool little_endian>
+std::vector<View> PacketView<little_endian>::GetSubviewList(size_t begin, size_t end) const {
   ASSERT(begin <= end);
   ASSERT(end <= length_);
 
-  std::forward_list<View> view_list;
-  std::forward_list<View>::iterator it = view_list.before_begin();
+  std::vector<View> view_list;
   size_t length = end - begin;
-  for (const auto& fragment : fragments_) {
+  for (const auto& fragment : *fragments_) {
     if (begin >= fragment.size()) {
       begin -= fragment.size();
     } else {
       View view(fragment, begin, begin + std::min(length, fragment.size() - begin));
       length -= view.size();
-      it = view_list.insert_after(it, view);
+      view_list.push_back(view);
       begin = 0;
     }
   }
@@ -91,30 +117,32 @@ std::forward_list<View> PacketView<little_endian>::GetSubviewList(size_t begin,
 
 template <bool little_endian>
 PacketView<true> PacketView<little_endian>::GetLittleEndianSubview(size_t begin, size_t end) const {
+  if (fragments_ == nullptr) {
+    ASSERT(begin <= end);
+    ASSERT(end <= length_);
+    // Single fragment (or empty) packets are sliced without any allocation
+    return fragment_ ? PacketView<true>(View(*fragment_, begin, end)) : PacketView<true>(std::vector<View>());
+  }
   return PacketView<true>(GetSubviewList(begin, end));
 }
 
 template <bool little_endian>
 PacketView<false> PacketView<little_endian>::GetBigEndianSubview(size_t begin, size_t end) const {
+  if (fragments_ == nullptr) {
+    ASSERT(begin <= end);
+    ASSERT(end <= length_);
+    return fragment_ ? PacketView<false>(View(*fragment_, begin, end)) : PacketView<false>(std::vector<View>());
+  }
   return PacketView<false>(GetSubviewList(begin, end));
 }
 
 template <bool little_endian>
 void PacketView<little_endian>::Append(PacketView to_add) {
-  auto insertion_point = fragments_.begin();
-  size_t remaining_length = length_;
-  while (remaining_length > 0) {
-    remaining_length -= insertion_point->size();
-    if (remaining_length > 0) {
-      insertion_point++;
-    }
-  }
-  ASSERT(insertion_point != fragments_.end());
-  for (const auto& fragment : to_add.fragments_) {
-    fragments_.insert_after(insertion_point, fragment);
-    insertion_point++;
-  }
-  length_ += to_add.length_;
+  // Fragment lists are shared between copies, build a new one
+  std::vector<View> fragments;
+  AppendFragmentsTo(&fragments);
+  to_add.AppendFragmentsTo(&fragments);
+  SetFragments(std::move(fragments));
 }
 
 // Explicit instantiations for both types of PacketViews.
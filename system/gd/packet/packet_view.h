@@ -17,7 +17,8 @@
 #pragma once
 
 #include <cstdint>
-#include <forward_list>
+#include <memory>
+#include <optional>
 #include <vector>
 
 #include "packet/iterator.h"
@@ -34,7 +35,8 @@ static const bool kLittleEndian = true;
 template <bool little_endian>
 class PacketView {
  public:
-  explicit PacketView(std::forward_list<View> fragments);
+  explicit PacketView(View fragment);
+  explicit PacketView(std::vector<View> fragments);
   explicit PacketView(std::shared_ptr<const std::vector<uint8_t>> packet);
   PacketView(const PacketView& PacketView) = default;
   PacketView<little_endian>() = delete;
@@ -55,10 +57,16 @@ class PacketView {
   void Append(PacketView to_add);
 
  private:
-  std::forward_list<View> fragments_;
+  // Packets made of a single fragment, which is almost all of them, keep it
+  // inline in |fragment_|. Only reassembled packets share an immutable list
+  // of fragments in |fragments_|.
+  std::optional<View> fragment_;
+  std::shared_ptr<const std::vector<View>> fragments_;
   size_t length_;
 
-  std::forward_list<View> GetSubviewList(size_t begin, size_t end) const;
+  void SetFragments(std::vector<View> fragments);
+  void AppendFragmentsTo(std::vector<View>* fragments) const;
+  std::vector<View> GetSubviewList(size_t begin, size_t end) const;
 };
 
 }  // namespace packet
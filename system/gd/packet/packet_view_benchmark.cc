@@ -0,0 +1,117 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "hci/hci_packets.h"
+#include "packet/packet_view.h"
+
+using ::benchmark::State;
+
+namespace bluetooth {
+namespace packet {
+
+namespace {
+// Command Complete for Read BD_ADDR
+const std::vector<uint8_t> kReadBdAddrComplete = {
+    0x0e, 0x0a, 0x01, 0x09, 0x10, 0x00, 0x14, 0x8e, 0x61, 0x5f, 0x36, 0x88};
+
+// Number Of Completed Packets for four connections
+const std::vector<uint8_t> kNumberOfCompletedPackets = {
+    0x13, 0x11, 0x04, 0x01, 0x00, 0x02, 0x00, 0x02, 0x00, 0x01, 0x00,
+    0x03, 0x00, 0x05, 0x00, 0x04, 0x00, 0x01, 0x00};
+
+std::shared_ptr<std::vector<uint8_t>> MakeAclPacket(size_t payload_size) {
+  auto packet = std::make_shared<std::vector<uint8_t>>(payload_size + 4, 0x5a);
+  (*packet)[0] = 0x01;
+  (*packet)[1] = 0x20;
+  (*packet)[2] = static_cast<uint8_t>(payload_size);
+  (*packet)[3] = static_cast<uint8_t>(payload_size >> 8);
+  return packet;
+}
+}  // namespace
+
+static void BM_ParseCommandComplete(State& state) {
+  auto bytes = std::make_shared<std::vector<uint8_t>>(kReadBdAddrComplete);
+  for (auto _ : state) {
+    auto event = hci::EventView::Create(PacketView<kLittleEndian>(bytes));
+    auto complete = hci::ReadBdAddrCompleteView::Create(hci::CommandCompleteView::Create(event));
+    if (!complete.IsValid()) {
+      state.SkipWithError("invalid packet");
+      break;
+    }
+    ::benchmark::DoNotOptimize(complete.GetBdAddr());
+  }
+  state.SetItemsProcessed(static_cast<int_fast64_t>(state.iterations()));
+}
+BENCHMARK(BM_ParseCommandComplete);
+
+static void BM_ParseNumberOfCompletedPackets(State& state) {
+  auto bytes = std::make_shared<std::vector<uint8_t>>(kNumberOfCompletedPackets);
+  for (auto _ : state) {
+    auto event = hci::NumberOfCompletedPacketsView::Create(hci::EventView::Create(PacketView<kLittleEndian>(bytes)));
+    if (!event.IsValid()) {
+      state.SkipWithError("invalid packet");
+      break;
+    }
+    ::benchmark::DoNotOptimize(event.GetCompletedPackets());
+  }
+  state.SetItemsProcessed(static_cast<int_fast64_t>(state.iterations()));
+}
+BENCHMARK(BM_ParseNumberOfCompletedPackets);
+
+static void BM_ParseAcl(State& state) {
+  auto bytes = MakeAclPacket(state.range(0));
+  for (auto _ : state) {
+    auto acl = hci::AclView::Create(PacketView<kLittleEndian>(bytes));
+    if (!acl.IsValid()) {
+      state.SkipWithError("invalid packet");
+      break;
+    }
+    ::benchmark::DoNotOptimize(acl.GetHandle());
+    ::benchmark::DoNotOptimize(acl.GetPacketBoundaryFlag());
+    // Walk the payload the way the L2CAP reassembler does
+    auto payload = acl.GetPayload();
+    uint32_t sum = 0;
+    for (auto it = payload.begin(); it != payload.end(); ++it) {
+      sum += *it;
+    }
+    ::benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(static_cast<int_fast64_t>(state.iterations()));
+  state.SetBytesProcessed(static_cast<int_fast64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_ParseAcl)->Arg(27)->Arg(251)->Arg(1021);
+
+static void BM_IteratorExtract(State& state) {
+  auto bytes = MakeAclPacket(1021);
+  PacketView<kLittleEndian> view(bytes);
+  for (auto _ : state) {
+    auto it = view.begin();
+    uint64_t sum = 0;
+    while (it.NumBytesRemaining() >= sizeof(uint32_t)) {
+      sum += it.extract<uint32_t>();
+    }
+    ::benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(static_cast<int_fast64_t>(state.iterations()) * bytes->size());
+}
+BENCHMARK(BM_IteratorExtract);
+
+}  // namespace packet
+}  // namespace bluetooth
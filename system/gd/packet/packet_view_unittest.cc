@@ -159,6 +159,31 @@ TEST(IteratorExtractTest, extractBeTest) {
   ASSERT_EQ(0x16, general_case.extract<uint8_t>());
 }
 
+TEST(IteratorExtractTest, extractAcrossFragmentsTest) {
+  PacketView<true> packet({
+      View(std::make_shared<const vector<uint8_t>>(count_1), 0, count_1.size()),
+      View(std::make_shared<const vector<uint8_t>>(count_2), 0, count_2.size()),
+      View(std::make_shared<const vector<uint8_t>>(count_3), 0, count_3.size()),
+  });
+  PacketView<true> single_packet({View(std::make_shared<const vector<uint8_t>>(count_all), 0, count_all.size())});
+  auto multi_case = packet.begin();
+  auto single_case = single_packet.begin();
+
+  while (multi_case.NumBytesRemaining() >= sizeof(uint32_t)) {
+    ASSERT_EQ(single_case.extract<uint32_t>(), multi_case.extract<uint32_t>());
+  }
+  ASSERT_EQ(single_case.NumBytesRemaining(), multi_case.NumBytesRemaining());
+}
+
+TEST(IteratorExtractTest, iteratorOutlivesSubviewTest) {
+  PacketView<true> packet({View(std::make_shared<const vector<uint8_t>>(count_all), 0, count_all.size())});
+  // Iterators do not own the packet, but the bytes stay alive with |packet|
+  auto it = packet.GetLittleEndianSubview(3, 7).begin();
+
+  ASSERT_EQ(4u, it.NumBytesRemaining());
+  ASSERT_EQ(0x06050403u, it.extract<uint32_t>());
+}
+
 TYPED_TEST(IteratorTest, extractBoundsDeathTest) {
   auto bounds_test = this->packet->end();
 
@@ -35,6 +35,10 @@ class View {
 
   size_t size() const;
 
+  // Contiguous bytes of this view, valid for as long as the view (or any copy
+  // sharing its data) is alive.
+  const uint8_t* data() const;
+
  private:
   std::shared_ptr<const std::vector<uint8_t>> data_;
   size_t begin_;
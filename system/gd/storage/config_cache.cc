@@ -74,7 +74,10 @@ ConfigCache::ConfigCache(ConfigCache&& other) noexcept
       persistent_property_names_(std::move(other.persistent_property_names_)),
       information_sections_(std::move(other.information_sections_)),
       persistent_devices_(std::move(other.persistent_devices_)),
-      temporary_devices_(std::move(other.temporary_devices_)) {
+      temporary_devices_(std::move(other.temporary_devices_)),
+      track_persistent_changes_(other.track_persistent_changes_),
+      pending_full_write_(other.pending_full_write_),
+      pending_changes_(std::move(other.pending_changes_)) {
   ASSERT_LOG(
       other.persistent_config_changed_callback_ == nullptr,
       "Can't assign after setting the callback");
@@ -94,6 +97,9 @@ ConfigCache& ConfigCache::operator=(ConfigCache&& other) noexcept {
   information_sections_ = std::move(other.information_sections_);
   persistent_devices_ = std::move(other.persistent_devices_);
   temporary_devices_ = std::move(other.temporary_devices_);
+  track_persistent_changes_ = other.track_persistent_changes_;
+  pending_full_write_ = other.pending_full_write_;
+  pending_changes_ = std::move(other.pending_changes_);
   return *this;
 }
 
@@ -109,8 +115,82 @@ bool ConfigCache::operator!=(const ConfigCache& rhs) const {
   return !(*this == rhs);
 }
 
+void ConfigCache::TrackPersistentChanges() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  track_persistent_changes_ = true;
+}
+
+std::optional<std::vector<MutationEntry>> ConfigCache::ExtractPersistentChanges() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (!track_persistent_changes_ || pending_full_write_) {
+    pending_full_write_ = false;
+    pending_changes_.clear();
+    return std::nullopt;
+  }
+  std::vector<MutationEntry> entries;
+  for (const auto& [section, change] : pending_changes_) {
+    const common::ListMap<std::string, std::string>* properties = nullptr;
+    auto section_iter = information_sections_.find(section);
+    if (section_iter != information_sections_.end()) {
+      properties = &section_iter->second;
+    } else if ((section_iter = persistent_devices_.find(section)) != persistent_devices_.end()) {
+      properties = &section_iter->second;
+    }
+    // Values are copied as stored, encrypted ones stay encrypted
+    if (properties == nullptr || change.rewrite) {
+      entries.push_back(MutationEntry::Remove(MutationEntry::PropertyType::NORMAL, section));
+      if (properties != nullptr) {
+        for (const auto& [property, value] : *properties) {
+          entries.push_back(MutationEntry::Set(MutationEntry::PropertyType::NORMAL, section, property, value));
+        }
+      }
+      continue;
+    }
+    for (const auto& property : change.properties) {
+      auto property_iter = properties->find(property);
+      if (property_iter != properties->end()) {
+        entries.push_back(
+            MutationEntry::Set(MutationEntry::PropertyType::NORMAL, section, property, property_iter->second));
+      } else {
+        entries.push_back(MutationEntry::Remove(MutationEntry::PropertyType::NORMAL, section, property));
+      }
+    }
+  }
+  pending_changes_.clear();
+  return entries;
+}
+
+void ConfigCache::RecordPropertyChange(const std::string& section, const std::string& property) {
+  if (!track_persistent_changes_ || pending_full_write_) {
+    return;
+  }
+  auto change_iter = pending_changes_.find(section);
+  if (change_iter == pending_changes_.end()) {
+    change_iter = pending_changes_.try_emplace_back(section, PendingChange{}).first;
+  }
+  if (!change_iter->second.rewrite) {
+    change_iter->second.properties.insert(property);
+  }
+}
+
+void ConfigCache::RecordSectionChange(const std::string& section) {
+  if (!track_persistent_changes_ || pending_full_write_) {
+    return;
+  }
+  auto change_iter = pending_changes_.find(section);
+  if (change_iter == pending_changes_.end()) {
+    change_iter = pending_changes_.try_emplace_back(section, PendingChange{}).first;
+  }
+  change_iter->second.rewrite = true;
+  change_iter->second.properties.clear();
+}
+
 void ConfigCache::Clear() {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (track_persistent_changes_ && (information_sections_.size() > 0 || persistent_devices_.size() > 0)) {
+    pending_full_write_ = true;
+    pending_changes_.clear();
+  }
   if (information_sections_.size() > 0) {
     information_sections_.clear();
     PersistentConfigChangedCallback();
@@ -189,12 +269,14 @@ void ConfigCache::SetProperty(std::string section, std::string property, std::st
     if (section_iter == information_sections_.end()) {
       section_iter = information_sections_.try_emplace_back(section, common::ListMap<std::string, std::string>{}).first;
     }
+    RecordPropertyChange(section, property);
     section_iter->second.insert_or_assign(property, std::move(value));
     PersistentConfigChangedCallback();
     return;
   }
   auto section_iter = persistent_devices_.find(section);
   if (section_iter == persistent_devices_.end() && IsPersistentProperty(property)) {
+    RecordSectionChange(section);
     // move paired devices or create new paired device when a link key is set
     auto section_properties = temporary_devices_.extract(section);
     if (section_properties) {
@@ -212,6 +294,7 @@ void ConfigCache::SetProperty(std::string section, std::string property, std::st
         value = kEncryptedStr;
       }
     }
+    RecordPropertyChange(section, property);
     section_iter->second.insert_or_assign(property, std::move(value));
     PersistentConfigChangedCallback();
     return;
@@ -228,6 +311,7 @@ bool ConfigCache::RemoveSection(const std::string& section) {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
   // sections are unique among all three maps, hence removing from one of them is enough
   if (information_sections_.extract(section) || persistent_devices_.extract(section)) {
+    RecordSectionChange(section);
     PersistentConfigChangedCallback();
     return true;
   } else {
@@ -245,6 +329,7 @@ bool ConfigCache::RemoveProperty(const std::string& section, const std::string&
       information_sections_.erase(section_iter);
     }
     if (value.has_value()) {
+      RecordPropertyChange(section, property);
       PersistentConfigChangedCallback();
       return true;
     } else {
@@ -257,12 +342,15 @@ bool ConfigCache::RemoveProperty(const std::string& section, const std::string&
     // if section is empty after removal, remove the whole section as empty section is not allowed
     if (section_iter->second.size() == 0) {
       persistent_devices_.erase(section_iter);
+      RecordSectionChange(section);
     } else if (value && IsPersistentProperty(property)) {
       // move unpaired device
       auto section_properties = persistent_devices_.extract(section);
       temporary_devices_.insert_or_assign(section, std::move(section_properties->second));
+      RecordSectionChange(section);
     }
     if (value.has_value()) {
+      RecordPropertyChange(section, property);
       PersistentConfigChangedCallback();
       if (os::ParameterProvider::GetBtKeystoreInterface() != nullptr && os::ParameterProvider::IsCommonCriteriaMode() &&
           InEncryptKeyNameList(property)) {
@@ -328,6 +416,7 @@ void ConfigCache::RemoveSectionWithProperty(const std::string& property) {
     for (auto it = config_section->begin(); it != config_section->end();) {
       if (it->second.contains(property)) {
         LOG_INFO("Removing persistent section %s with property %s", it->first.c_str(), property.c_str());
+        RecordSectionChange(it->first);
         it = config_section->erase(it);
         num_persistent_removed++;
         continue;
@@ -473,6 +562,7 @@ bool ConfigCache::FixDeviceTypeInconsistencies() {
   for (auto* config_section : {&information_sections_, &persistent_devices_}) {
     for (auto& elem : *config_section) {
       if (FixDeviceTypeInconsistencyInSection(elem.first, elem.second)) {
+        RecordSectionChange(elem.first);
         persistent_device_changed = true;
       }
     }
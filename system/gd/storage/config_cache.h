@@ -111,6 +111,12 @@ class ConfigCache {
   virtual void Clear();
   // Set a callback to notify interested party that a persistent config change has just happened
   virtual void SetPersistentConfigChangedCallback(std::function<void()> persistent_config_changed_callback);
+  // Start recording which persistent sections and properties are changed, see ExtractPersistentChanges()
+  virtual void TrackPersistentChanges();
+  // Return the persistent changes made since tracking started or since the last call, as mutation entries that
+  // turn the previously persisted config into the current one when committed in order. Return std::nullopt when
+  // changes were not tracked individually, in which case the whole config must be persisted again
+  virtual std::optional<std::vector<MutationEntry>> ExtractPersistentChanges();
 
   // Device config specific methods
   // TODO: methods here should be moved to a device specific config cache if this config cache is supposed to be generic
@@ -139,6 +145,18 @@ class ConfigCache {
   // if capacity exceeds given value during initialization
   common::LruCache<std::string, common::ListMap<std::string, std::string>> temporary_devices_;
 
+  // Persistent changes not extracted yet, in the order sections were first changed. A rewritten section is persisted
+  // as a whole, otherwise only its listed properties are
+  struct PendingChange {
+    bool rewrite = false;
+    std::unordered_set<std::string> properties;
+  };
+  bool track_persistent_changes_ = false;
+  bool pending_full_write_ = false;
+  common::ListMap<std::string, PendingChange> pending_changes_;
+  void RecordPropertyChange(const std::string& section, const std::string& property);
+  void RecordSectionChange(const std::string& section);
+
   // Convenience method to check if the callback is valid before calling it
   inline void PersistentConfigChangedCallback() const {
     if (persistent_config_changed_callback_) {
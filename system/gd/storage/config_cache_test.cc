@@ -20,6 +20,7 @@
 #include <gtest/gtest.h>
 
 #include <cstdio>
+#include <queue>
 
 #include "hci/enum_helper.h"
 #include "storage/config_keys.h"
@@ -38,6 +39,7 @@ std::string GetTestAddress(int i) {
 
 using bluetooth::storage::ConfigCache;
 using bluetooth::storage::Device;
+using bluetooth::storage::MutationEntry;
 using SectionAndPropertyValue = bluetooth::storage::ConfigCache::SectionAndPropertyValue;
 
 TEST(ConfigCacheTest, simple_set_get_test) {
@@ -442,4 +444,81 @@ TEST(ConfigCacheTest, test_empty_persistent_properties) {
   ASSERT_THAT(config.GetPersistentSections(), ElementsAre());
 }
 
+namespace {
+void SetUpPersistentChangesTestConfig(ConfigCache& config) {
+  config.SetProperty("A", "B", "C");
+  config.SetProperty("A", "C", "D");
+  config.SetProperty("AA:BB:CC:DD:EE:01", "Name", "one");
+  config.SetProperty("AA:BB:CC:DD:EE:01", BTIF_STORAGE_KEY_LINK_KEY, "0101");
+  config.SetProperty("AA:BB:CC:DD:EE:02", "Name", "two");
+  config.SetProperty("AA:BB:CC:DD:EE:02", BTIF_STORAGE_KEY_LINK_KEY, "0202");
+  config.SetProperty("AA:BB:CC:DD:EE:03", "Name", "three");
+}
+
+void ApplyPersistentChanges(ConfigCache& config, const std::vector<MutationEntry>& entries) {
+  std::queue<MutationEntry> queue;
+  for (const auto& entry : entries) {
+    queue.push(entry);
+  }
+  config.Commit(queue);
+}
+}  // namespace
+
+TEST(ConfigCacheTest, persistent_changes_not_tracked_by_default) {
+  ConfigCache config(100, Device::kLinkKeyProperties);
+  config.SetProperty("A", "B", "C");
+  ASSERT_FALSE(config.ExtractPersistentChanges());
+}
+
+TEST(ConfigCacheTest, persistent_changes_replay_test) {
+  ConfigCache config(100, Device::kLinkKeyProperties);
+  SetUpPersistentChangesTestConfig(config);
+  ConfigCache persisted(100, Device::kLinkKeyProperties);
+  SetUpPersistentChangesTestConfig(persisted);
+
+  config.TrackPersistentChanges();
+  config.SetProperty("A", "B", "E");
+  config.RemoveProperty("A", "C");
+  config.SetProperty("Info", "X", "Y");
+  // Paired device changes
+  config.SetProperty("AA:BB:CC:DD:EE:01", "Name", "uno");
+  config.RemoveProperty("AA:BB:CC:DD:EE:02", BTIF_STORAGE_KEY_LINK_KEY);
+  // Temporary device becomes paired
+  config.SetProperty("AA:BB:CC:DD:EE:03", BTIF_STORAGE_KEY_LINK_KEY, "0303");
+  // Temporary devices are not persisted
+  config.SetProperty("AA:BB:CC:DD:EE:04", "Name", "four");
+
+  auto changes = config.ExtractPersistentChanges();
+  ASSERT_TRUE(changes);
+  ApplyPersistentChanges(persisted, *changes);
+  ASSERT_EQ(config.SerializeToLegacyFormat(), persisted.SerializeToLegacyFormat());
+  ASSERT_THAT(persisted.GetPersistentSections(), ElementsAre("AA:BB:CC:DD:EE:01", "AA:BB:CC:DD:EE:03"));
+
+  // Changes are only extracted once
+  changes = config.ExtractPersistentChanges();
+  ASSERT_TRUE(changes);
+  ASSERT_TRUE(changes->empty());
+
+  config.RemoveSection("AA:BB:CC:DD:EE:01");
+  config.RemoveSectionWithProperty("X");
+  changes = config.ExtractPersistentChanges();
+  ASSERT_TRUE(changes);
+  ApplyPersistentChanges(persisted, *changes);
+  ASSERT_EQ(config.SerializeToLegacyFormat(), persisted.SerializeToLegacyFormat());
+}
+
+TEST(ConfigCacheTest, persistent_changes_after_clear_test) {
+  ConfigCache config(100, Device::kLinkKeyProperties);
+  SetUpPersistentChangesTestConfig(config);
+  config.TrackPersistentChanges();
+  config.Clear();
+  config.SetProperty("A", "B", "C");
+  // The whole config has to be written again
+  ASSERT_FALSE(config.ExtractPersistentChanges());
+  config.SetProperty("A", "B", "D");
+  auto changes = config.ExtractPersistentChanges();
+  ASSERT_TRUE(changes);
+  ASSERT_EQ(changes->size(), 1u);
+}
+
 }  // namespace testing
\ No newline at end of file
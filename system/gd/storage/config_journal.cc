@@ -0,0 +1,210 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/config_journal.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <queue>
+
+#include "common/strings.h"
+#include "os/files.h"
+#include "os/log.h"
+
+namespace bluetooth {
+namespace storage {
+
+namespace {
+
+constexpr char kFieldSeparator = '\t';
+constexpr char kBase = 'B';
+constexpr char kSet = 'S';
+constexpr char kRemoveProperty = 'P';
+constexpr char kRemoveSection = 'R';
+constexpr char kCommit = 'C';
+
+bool IsValidKey(const std::string& key) {
+  return key.find(kFieldSeparator) == std::string::npos && key.find('\n') == std::string::npos;
+}
+
+bool WriteFully(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = TEMP_FAILURE_RETRY(write(fd, data, size));
+    if (written < 0) {
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+std::string BaseLine(uint64_t config_checksum) {
+  std::string line(1, kBase);
+  return line + kFieldSeparator + std::to_string(config_checksum) + '\n';
+}
+
+}  // namespace
+
+ConfigJournal::ConfigJournal(std::string path) : path_(std::move(path)) {
+  ASSERT(!path_.empty());
+}
+
+uint64_t ConfigJournal::Checksum(const std::string& config_content) {
+  // 64-bit FNV-1a
+  uint64_t checksum = 0xcbf29ce484222325;
+  for (unsigned char c : config_content) {
+    checksum = (checksum ^ c) * 0x100000001b3;
+  }
+  return checksum;
+}
+
+size_t ConfigJournal::Replay(ConfigCache* cache, uint64_t config_checksum) {
+  ASSERT(cache != nullptr);
+  if (!os::FileExists(path_)) {
+    return 0;
+  }
+  auto content = os::ReadSmallFile(path_);
+  if (!content) {
+    return 0;
+  }
+  auto base_line = BaseLine(config_checksum);
+  if (content->compare(0, base_line.size(), base_line) != 0) {
+    LOG_WARN("Discarding config journal %s, it does not apply to the current config", path_.c_str());
+    Delete();
+    return 0;
+  }
+
+  size_t replayed = 0;
+  size_t committed_size = base_line.size();
+  std::queue<MutationEntry> batch;
+  size_t line_start = base_line.size();
+  size_t line_end;
+  // Lines without a trailing new line were cut short and are ignored
+  while ((line_end = content->find('\n', line_start)) != std::string::npos) {
+    std::string line = content->substr(line_start, line_end - line_start);
+    line_start = line_end + 1;
+    if (line.size() < 2 || line[1] != kFieldSeparator) {
+      break;
+    }
+    auto fields = common::StringSplit(line.substr(2), std::string(1, kFieldSeparator), line[0] == kSet ? 3 : 2);
+    if (line[0] == kSet && fields.size() == 3) {
+      batch.push(MutationEntry::Set(
+          MutationEntry::PropertyType::NORMAL, std::move(fields[0]), std::move(fields[1]), std::move(fields[2])));
+    } else if (line[0] == kRemoveProperty && fields.size() == 2) {
+      batch.push(
+          MutationEntry::Remove(MutationEntry::PropertyType::NORMAL, std::move(fields[0]), std::move(fields[1])));
+    } else if (line[0] == kRemoveSection && fields.size() == 1) {
+      batch.push(MutationEntry::Remove(MutationEntry::PropertyType::NORMAL, std::move(fields[0])));
+    } else if (line[0] == kCommit && fields.size() == 1 && common::Uint64FromString(fields[0]) == batch.size()) {
+      replayed += batch.size();
+      cache->Commit(batch);
+      committed_size = line_start;
+    } else {
+      break;
+    }
+  }
+
+  if (committed_size < content->size()) {
+    LOG_WARN(
+        "Dropping %zu bytes of incomplete changes at the end of config journal %s",
+        content->size() - committed_size,
+        path_.c_str());
+    if (TEMP_FAILURE_RETRY(truncate(path_.c_str(), committed_size)) != 0) {
+      LOG_ERROR("unable to truncate '%s', error: %s", path_.c_str(), strerror(errno));
+    }
+  }
+  return replayed;
+}
+
+bool ConfigJournal::Append(uint64_t config_checksum, const std::vector<MutationEntry>& entries) {
+  if (entries.empty()) {
+    return true;
+  }
+  std::string batch;
+  for (const auto& entry : entries) {
+    if (!IsValidKey(entry.section) || !IsValidKey(entry.property) || entry.value.find('\n') != std::string::npos) {
+      LOG_WARN("Config entry in section %s can't be journaled", entry.section.c_str());
+      return false;
+    }
+    switch (entry.entry_type) {
+      case MutationEntry::EntryType::SET:
+        batch += kSet;
+        batch += kFieldSeparator + entry.section + kFieldSeparator + entry.property + kFieldSeparator + entry.value;
+        break;
+      case MutationEntry::EntryType::REMOVE_PROPERTY:
+        batch += kRemoveProperty;
+        batch += kFieldSeparator + entry.section + kFieldSeparator + entry.property;
+        break;
+      case MutationEntry::EntryType::REMOVE_SECTION:
+        batch += kRemoveSection;
+        batch += kFieldSeparator + entry.section;
+        break;
+        // do not write a default case so that when a new enum is defined, compilation would fail automatically
+    }
+    batch += '\n';
+  }
+  batch += kCommit;
+  batch += kFieldSeparator + std::to_string(entries.size()) + '\n';
+
+  int fd = TEMP_FAILURE_RETRY(open(path_.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0660));
+  if (fd < 0) {
+    LOG_ERROR("unable to open '%s', error: %s", path_.c_str(), strerror(errno));
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    LOG_ERROR("unable to stat '%s', error: %s", path_.c_str(), strerror(errno));
+    close(fd);
+    return false;
+  }
+  off_t committed_size = st.st_size;
+  if (committed_size == 0) {
+    batch.insert(0, BaseLine(config_checksum));
+  }
+  bool success = WriteFully(fd, batch.data(), batch.size()) && fdatasync(fd) == 0;
+  if (!success) {
+    LOG_ERROR("unable to append to '%s', error: %s", path_.c_str(), strerror(errno));
+    // Never leave a partial batch behind, later batches would not be replayed
+    if (TEMP_FAILURE_RETRY(ftruncate(fd, committed_size)) != 0) {
+      LOG_ERROR("unable to truncate '%s', error: %s", path_.c_str(), strerror(errno));
+    }
+  }
+  close(fd);
+  return success;
+}
+
+size_t ConfigJournal::Size() const {
+  struct stat st;
+  if (stat(path_.c_str(), &st) != 0) {
+    return 0;
+  }
+  return st.st_size;
+}
+
+bool ConfigJournal::Delete() {
+  if (!os::FileExists(path_)) {
+    return true;
+  }
+  return os::RemoveFile(path_);
+}
+
+}  // namespace storage
+}  // namespace bluetooth
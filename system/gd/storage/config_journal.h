@@ -0,0 +1,68 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "storage/config_cache.h"
+#include "storage/mutation_entry.h"
+
+namespace bluetooth {
+namespace storage {
+
+// Append-only log of persistent config changes, replayed on top of the legacy config file when it is loaded
+//
+// Each Append() writes one batch of mutation entries terminated by a commit line and syncs it to disk, so that
+// persisting a change costs I/O proportional to the change rather than to the whole config. A batch that was not
+// completely written, e.g. because of a crash, is ignored on replay and trimmed from the file.
+//
+// The journal starts with the checksum of the config file it applies to. A journal left next to a different config,
+// e.g. because of a crash between writing the full config and deleting the journal, is discarded rather than replayed
+// over newer values.
+//
+// One entry per line, fields separated by tabs:
+//   B <checksum of the config file>
+//   S <section> <property> <value>
+//   P <section> <property>
+//   R <section>
+//   C <number of entries in the batch>
+class ConfigJournal {
+ public:
+  static ConfigJournal FromPath(std::string path) {
+    return ConfigJournal(std::move(path));
+  }
+  explicit ConfigJournal(std::string path);
+  // Checksum of the content of a config file, stable across builds
+  static uint64_t Checksum(const std::string& config_content);
+  // Commit every complete batch to |cache| in order, return the number of entries replayed. A journal that does not
+  // apply to the config with |config_checksum| is deleted without being replayed
+  size_t Replay(ConfigCache* cache, uint64_t config_checksum);
+  // Return false if nothing was written, which happens on I/O errors and for entries that can't be represented.
+  // |config_checksum| is recorded when the journal is created and must be that of the config file on disk
+  bool Append(uint64_t config_checksum, const std::vector<MutationEntry>& entries);
+  // Size of the journal on disk in bytes, 0 if it does not exist
+  size_t Size() const;
+  bool Delete();
+
+ private:
+  std::string path_;
+};
+
+}  // namespace storage
+}  // namespace bluetooth
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "storage/config_cache.h"
+#include "storage/config_journal.h"
+#include "storage/config_keys.h"
+#include "storage/device.h"
+#include "storage/legacy_config_file.h"
+
+using ::benchmark::State;
+using ::bluetooth::storage::ConfigCache;
+using ::bluetooth::storage::ConfigJournal;
+using ::bluetooth::storage::Device;
+using ::bluetooth::storage::LegacyConfigFile;
+
+namespace {
+// Only has to match between appending and replaying
+constexpr uint64_t kConfigChecksum = 1;
+
+std::string GetDeviceSection(int i) {
+  char section[18];
+  std::snprintf(section, sizeof(section), "AA:BB:CC:%02X:%02X:%02X", (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+  return section;
+}
+
+// Bonded LE devices, with the kind of properties LE Audio and GATT caching leave behind
+void FillConfig(ConfigCache& config, int num_devices) {
+  config.SetProperty("Adapter", "Address", "01:02:03:ab:cd:ef");
+  for (int i = 0; i < num_devices; i++) {
+    auto section = GetDeviceSection(i);
+    config.SetProperty(section, "Name", "Device " + std::to_string(i));
+    config.SetProperty(section, "DevType", "2");
+    config.SetProperty(section, "AddrType", "1");
+    config.SetProperty(section, BTIF_STORAGE_KEY_LE_KEY_PENC, std::string(56, 'a'));
+    config.SetProperty(section, BTIF_STORAGE_KEY_LE_KEY_PID, std::string(46, 'b'));
+    config.SetProperty(section, BTIF_STORAGE_KEY_LE_KEY_LENC, std::string(56, 'c'));
+    config.SetProperty(section, "GattClientSupportedFeatures", "07");
+    config.SetProperty(section, "GattServerSupportedFeatures", "01");
+    config.SetProperty(section, "LeAudioSinkLocation", "3");
+    config.SetProperty(section, "LeAudioSinkPacs", std::string(128, 'd'));
+  }
+}
+}  // namespace
+
+class BM_ConfigPersistence : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    const std::filesystem::path temp_dir = std::filesystem::temp_directory_path();
+    config_path_ = temp_dir / "bm_bt_config.conf";
+    journal_path_ = temp_dir / "bm_bt_config.journal";
+  }
+
+  void TearDown(State& st) override {
+    std::filesystem::remove(config_path_);
+    std::filesystem::remove(journal_path_);
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  std::filesystem::path config_path_;
+  std::filesystem::path journal_path_;
+};
+
+// One property changed, then the whole config written out, as StorageModule does without a journal
+BENCHMARK_DEFINE_F(BM_ConfigPersistence, full_write)(State& state) {
+  ConfigCache config(state.range(0), Device::kLinkKeyProperties);
+  FillConfig(config, state.range(0));
+  int i = 0;
+  for (auto _ : state) {
+    config.SetProperty(GetDeviceSection(i++ % state.range(0)), "Name", "Renamed " + std::to_string(i));
+    LegacyConfigFile::FromPath(config_path_.string()).Write(config);
+  }
+  state.counters["file_bytes"] = std::filesystem::file_size(config_path_);
+}
+
+BENCHMARK_REGISTER_F(BM_ConfigPersistence, full_write)->Arg(1000)->Arg(5000)->UseRealTime();
+
+// One property changed, then only that change appended to the journal
+BENCHMARK_DEFINE_F(BM_ConfigPersistence, journal_append)(State& state) {
+  ConfigCache config(state.range(0), Device::kLinkKeyProperties);
+  FillConfig(config, state.range(0));
+  config.TrackPersistentChanges();
+  auto journal = ConfigJournal::FromPath(journal_path_.string());
+  int i = 0;
+  for (auto _ : state) {
+    config.SetProperty(GetDeviceSection(i++ % state.range(0)), "Name", "Renamed " + std::to_string(i));
+    journal.Append(kConfigChecksum, *config.ExtractPersistentChanges());
+  }
+  state.counters["journal_bytes_per_change"] = static_cast<double>(journal.Size()) / state.iterations();
+}
+
+BENCHMARK_REGISTER_F(BM_ConfigPersistence, journal_append)->Arg(1000)->Arg(5000)->UseRealTime();
+
+// Cost added to loading the config by a journal as large as the config itself, the compaction threshold
+BENCHMARK_DEFINE_F(BM_ConfigPersistence, journal_replay)(State& state) {
+  ConfigCache config(state.range(0), Device::kLinkKeyProperties);
+  FillConfig(config, state.range(0));
+  LegacyConfigFile::FromPath(config_path_.string()).Write(config);
+  config.TrackPersistentChanges();
+  auto journal = ConfigJournal::FromPath(journal_path_.string());
+  for (int i = 0; journal.Size() < std::filesystem::file_size(config_path_); i++) {
+    config.SetProperty(GetDeviceSection(i % state.range(0)), "Name", "Renamed " + std::to_string(i));
+    journal.Append(kConfigChecksum, *config.ExtractPersistentChanges());
+  }
+  for (auto _ : state) {
+    auto loaded = LegacyConfigFile::FromPath(config_path_.string()).Read(state.range(0));
+    journal.Replay(&loaded.value(), kConfigChecksum);
+  }
+}
+
+BENCHMARK_REGISTER_F(BM_ConfigPersistence, journal_replay)->Arg(1000)->Arg(5000)->UseRealTime();
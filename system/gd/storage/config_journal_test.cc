@@ -0,0 +1,126 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/config_journal.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include "os/files.h"
+#include "storage/config_keys.h"
+#include "storage/device.h"
+
+namespace testing {
+
+using bluetooth::os::ReadSmallFile;
+using bluetooth::storage::ConfigCache;
+using bluetooth::storage::ConfigJournal;
+using bluetooth::storage::Device;
+using bluetooth::storage::MutationEntry;
+
+constexpr uint64_t kConfigChecksum = 0x1234;
+
+class ConfigJournalTest : public Test {
+ protected:
+  void SetUp() override {
+    temp_journal_ = std::filesystem::temp_directory_path() / "temp_config.journal";
+    std::filesystem::remove(temp_journal_);
+  }
+
+  void TearDown() override {
+    std::filesystem::remove(temp_journal_);
+  }
+
+  std::filesystem::path temp_journal_;
+};
+
+TEST_F(ConfigJournalTest, append_and_replay_loop_back_test) {
+  auto journal = ConfigJournal::FromPath(temp_journal_.string());
+  ASSERT_EQ(journal.Size(), 0u);
+  EXPECT_TRUE(journal.Append(kConfigChecksum, {
+      MutationEntry::Set(MutationEntry::PropertyType::NORMAL, "A", "B", "C\twith tab"),
+      MutationEntry::Set(MutationEntry::PropertyType::NORMAL, "A", "E", ""),
+      MutationEntry::Set(MutationEntry::PropertyType::NORMAL, "CC:DD:EE:FF:00:11", BTIF_STORAGE_KEY_LINK_KEY, "AABB"),
+  }));
+  EXPECT_TRUE(journal.Append(kConfigChecksum, {
+      MutationEntry::Remove(MutationEntry::PropertyType::NORMAL, "A", "B"),
+      MutationEntry::Remove(MutationEntry::PropertyType::NORMAL, "Info"),
+  }));
+  EXPECT_GT(journal.Size(), 0u);
+
+  ConfigCache config(100, Device::kLinkKeyProperties);
+  config.SetProperty("Info", "X", "Y");
+  EXPECT_EQ(journal.Replay(&config, kConfigChecksum), 5u);
+  EXPECT_FALSE(config.HasSection("Info"));
+  EXPECT_FALSE(config.HasProperty("A", "B"));
+  EXPECT_THAT(config.GetProperty("A", "E"), Optional(StrEq("")));
+  EXPECT_THAT(config.GetPersistentSections(), ElementsAre("CC:DD:EE:FF:00:11"));
+
+  EXPECT_TRUE(journal.Delete());
+  EXPECT_FALSE(bluetooth::os::FileExists(temp_journal_.string()));
+}
+
+TEST_F(ConfigJournalTest, incomplete_batch_is_dropped_test) {
+  auto journal = ConfigJournal::FromPath(temp_journal_.string());
+  EXPECT_TRUE(
+      journal.Append(kConfigChecksum, {MutationEntry::Set(MutationEntry::PropertyType::NORMAL, "A", "B", "C")}));
+  auto committed = ReadSmallFile(temp_journal_.string());
+  ASSERT_TRUE(committed);
+  {
+    // A batch cut short by a crash, without its commit line
+    std::ofstream file(temp_journal_, std::ios::app);
+    file << "S\tA\tB\tD\nS\tA\tC";
+  }
+
+  ConfigCache config(100, Device::kLinkKeyProperties);
+  EXPECT_EQ(journal.Replay(&config, kConfigChecksum), 1u);
+  EXPECT_THAT(config.GetProperty("A", "B"), Optional(StrEq("C")));
+  EXPECT_FALSE(config.HasProperty("A", "C"));
+  // The incomplete batch is trimmed so that later batches can be replayed
+  EXPECT_EQ(ReadSmallFile(temp_journal_.string()), committed);
+}
+
+TEST_F(ConfigJournalTest, unrepresentable_entry_is_rejected_test) {
+  auto journal = ConfigJournal::FromPath(temp_journal_.string());
+  EXPECT_FALSE(
+      journal.Append(kConfigChecksum, {MutationEntry::Set(MutationEntry::PropertyType::NORMAL, "A", "B\tC", "D")}));
+  EXPECT_EQ(journal.Size(), 0u);
+}
+
+TEST_F(ConfigJournalTest, journal_for_other_config_is_discarded_test) {
+  auto journal = ConfigJournal::FromPath(temp_journal_.string());
+  EXPECT_TRUE(
+      journal.Append(kConfigChecksum, {MutationEntry::Set(MutationEntry::PropertyType::NORMAL, "A", "B", "C")}));
+  // Later batches keep the checksum the journal was created with
+  EXPECT_TRUE(
+      journal.Append(kConfigChecksum + 1, {MutationEntry::Set(MutationEntry::PropertyType::NORMAL, "A", "C", "D")}));
+
+  ConfigCache config(100, Device::kLinkKeyProperties);
+  EXPECT_EQ(journal.Replay(&config, kConfigChecksum + 1), 0u);
+  EXPECT_FALSE(config.HasSection("A"));
+  EXPECT_FALSE(bluetooth::os::FileExists(temp_journal_.string()));
+}
+
+TEST_F(ConfigJournalTest, checksum_test) {
+  EXPECT_EQ(ConfigJournal::Checksum(""), 0xcbf29ce484222325u);
+  EXPECT_EQ(ConfigJournal::Checksum("a"), 0xaf63dc4c8601ec8cu);
+  EXPECT_NE(ConfigJournal::Checksum("[Info]\n"), ConfigJournal::Checksum("[Info]\r\n"));
+}
+
+}  // namespace testing
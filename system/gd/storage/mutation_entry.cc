@@ -36,7 +36,7 @@ MutationEntry::MutationEntry(
     case EntryType::SET:
       ASSERT_LOG(!section.empty(), "section cannot be empty for EntryType::SET");
       ASSERT_LOG(!property.empty(), "property cannot be empty for EntryType::SET");
-      ASSERT_LOG(!value.empty(), "value cannot be empty for EntryType::SET");
+      // empty value is allowed, same as in ConfigCache
       break;
     case EntryType::REMOVE_PROPERTY:
       ASSERT_LOG(!section.empty(), "section cannot be empty for EntryType::REMOVE_PROPERTY");
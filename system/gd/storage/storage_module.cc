@@ -16,6 +16,9 @@
 
 #include "storage/storage_module.h"
 
+#include <sys/stat.h>
+
+#include <algorithm>
 #include <chrono>
 #include <ctime>
 #include <iomanip>
@@ -30,6 +33,7 @@
 #include "os/parameter_provider.h"
 #include "os/system_properties.h"
 #include "storage/config_cache.h"
+#include "storage/config_journal.h"
 #include "storage/config_keys.h"
 #include "storage/legacy_config_file.h"
 #include "storage/mutation.h"
@@ -41,6 +45,7 @@ using os::Alarm;
 using os::Handler;
 
 static const std::string kFactoryResetProperty = "persist.bluetooth.factoryreset";
+static const std::string kConfigJournalProperty = "bluetooth.gd.storage.config_journal.enabled";
 
 static const size_t kDefaultTempDeviceCapacity = 10000;
 // Save config whenever there is a change, but delay it by this value so that burst config change won't overwhelm disk
@@ -48,6 +53,9 @@ static const std::chrono::milliseconds kDefaultConfigSaveDelay = std::chrono::mi
 // Writing a config to disk takes a minimum 10 ms on a decent x86_64 machine, and 20 ms if including backup file
 // The config saving delay must be bigger than this value to avoid overwhelming the disk
 static const std::chrono::milliseconds kMinConfigSaveDelay = std::chrono::milliseconds(20);
+// The journal is folded into the config file once it is larger than the config file itself, or than this value for
+// small configs, which bounds the extra work done when loading the config to replaying at most that many bytes
+static const size_t kMinConfigJournalCompactionSize = 64 * 1024;
 
 const int kConfigFileComparePass = 1;
 const int kConfigBackupComparePass = 2;
@@ -66,14 +74,18 @@ StorageModule::StorageModule(
     std::chrono::milliseconds config_save_delay,
     size_t temp_devices_capacity,
     bool is_restricted_mode,
-    bool is_single_user_mode)
+    bool is_single_user_mode,
+    bool is_journal_enabled)
     : config_file_path_(std::move(config_file_path)),
       config_save_delay_(config_save_delay),
       temp_devices_capacity_(temp_devices_capacity),
       is_restricted_mode_(is_restricted_mode),
-      is_single_user_mode_(is_single_user_mode) {
+      is_single_user_mode_(is_single_user_mode),
+      is_journal_enabled_(is_journal_enabled) {
   // e.g. "/data/misc/bluedroid/bt_config.conf" to "/data/misc/bluedroid/bt_config.bak"
   config_backup_path_ = config_file_path_.substr(0, config_file_path_.find_last_of('.')) + ".bak";
+  // e.g. "/data/misc/bluedroid/bt_config.conf" to "/data/misc/bluedroid/bt_config.journal"
+  config_journal_path_ = config_file_path_.substr(0, config_file_path_.find_last_of('.')) + ".journal";
   ASSERT_LOG(
       config_save_delay > kMinConfigSaveDelay,
       "Config save delay of %lld ms is not enough, must be at least %lld ms to avoid overwhelming the disk",
@@ -88,7 +100,12 @@ StorageModule::~StorageModule() {
 
 const ModuleFactory StorageModule::Factory = ModuleFactory([]() {
   return new StorageModule(
-      os::ParameterProvider::ConfigFilePath(), kDefaultConfigSaveDelay, kDefaultTempDeviceCapacity, false, false);
+      os::ParameterProvider::ConfigFilePath(),
+      kDefaultConfigSaveDelay,
+      kDefaultTempDeviceCapacity,
+      false,
+      false,
+      os::GetSystemPropertyBool(kConfigJournalProperty, false));
 });
 
 struct StorageModule::impl {
@@ -98,8 +115,27 @@ struct StorageModule::impl {
   ConfigCache cache_;
   ConfigCache memory_only_cache_;
   bool has_pending_config_save_ = false;
+  // Size of the config file last written or read
+  size_t config_file_size_ = 0;
+  // Checksum of the same config file, the journal only applies on top of it
+  uint64_t config_file_checksum_ = 0;
 };
 
+namespace {
+size_t GetFileSize(const std::string& path) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return 0;
+  }
+  return st.st_size;
+}
+
+uint64_t GetFileChecksum(const std::string& path) {
+  auto content = os::ReadSmallFile(path);
+  return content ? ConfigJournal::Checksum(*content) : 0;
+}
+}  // namespace
+
 Mutation StorageModule::Modify() {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
   return Mutation(&pimpl_->cache_, &pimpl_->memory_only_cache_);
@@ -111,7 +147,7 @@ void StorageModule::SaveDelayed() {
     return;
   }
   pimpl_->config_save_alarm_.Schedule(
-      common::BindOnce(&StorageModule::SaveImmediately, common::Unretained(this)), config_save_delay_);
+      common::BindOnce(&StorageModule::SaveChanges, common::Unretained(this)), config_save_delay_);
   pimpl_->has_pending_config_save_ = true;
 }
 
@@ -131,7 +167,17 @@ void StorageModule::SaveImmediately() {
   if (!LegacyConfigFile::FromPath(config_backup_path_).Write(pimpl_->cache_)) {
     LOG_ERROR("Unable to write backup config file");
   }
-  // 4. save checksum if it is running in common criteria mode
+  // 4. everything journaled so far is part of the config file now
+  pimpl_->cache_.ExtractPersistentChanges();
+  if (is_journal_enabled_) {
+    pimpl_->cache_.TrackPersistentChanges();
+  }
+  if (!ConfigJournal::FromPath(config_journal_path_).Delete()) {
+    LOG_ERROR("Unable to delete config journal");
+  }
+  pimpl_->config_file_size_ = GetFileSize(config_file_path_);
+  pimpl_->config_file_checksum_ = GetFileChecksum(config_file_path_);
+  // 5. save checksum if it is running in common criteria mode
   if (bluetooth::os::ParameterProvider::GetBtKeystoreInterface() != nullptr &&
       bluetooth::os::ParameterProvider::IsCommonCriteriaMode()) {
     bluetooth::os::ParameterProvider::GetBtKeystoreInterface()->set_encrypt_key_or_remove_key(
@@ -139,6 +185,23 @@ void StorageModule::SaveImmediately() {
   }
 }
 
+void StorageModule::SaveChanges() {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (pimpl_->has_pending_config_save_) {
+    pimpl_->config_save_alarm_.Cancel();
+    pimpl_->has_pending_config_save_ = false;
+  }
+  if (is_journal_enabled_) {
+    auto journal = ConfigJournal::FromPath(config_journal_path_);
+    auto changes = pimpl_->cache_.ExtractPersistentChanges();
+    if (changes && journal.Size() < std::max(kMinConfigJournalCompactionSize, pimpl_->config_file_size_) &&
+        journal.Append(pimpl_->config_file_checksum_, *changes)) {
+      return;
+    }
+  }
+  SaveImmediately();
+}
+
 void StorageModule::Clear() {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
   pimpl_->cache_.Clear();
@@ -155,8 +218,14 @@ void StorageModule::Start() {
     LOG_INFO("%s is true, delete config files", kFactoryResetProperty.c_str());
     LegacyConfigFile::FromPath(config_file_path_).Delete();
     LegacyConfigFile::FromPath(config_backup_path_).Delete();
+    ConfigJournal::FromPath(config_journal_path_).Delete();
     os::SetSystemProperty(kFactoryResetProperty, "false");
   }
+  if (is_journal_enabled_ && bluetooth::os::ParameterProvider::IsCommonCriteriaMode()) {
+    // The config checksum does not cover the journal
+    LOG_INFO("Config journal disabled in common criteria mode");
+    is_journal_enabled_ = false;
+  }
   if (!is_config_checksum_pass(kConfigFileComparePass)) {
     LegacyConfigFile::FromPath(config_file_path_).Delete();
   }
@@ -177,6 +246,23 @@ void StorageModule::Start() {
     config.emplace(temp_devices_capacity_, Device::kLinkKeyProperties);
     file_source = "Empty";
   }
+  uint64_t config_file_checksum = 0;
+  if (file_source == "Empty") {
+    // The journal only holds changes on top of a config that is gone
+    ConfigJournal::FromPath(config_journal_path_).Delete();
+  } else {
+    // The backup, if used, holds the same config as the file it backs up
+    config_file_checksum = GetFileChecksum(file_source.empty() ? config_file_path_ : config_backup_path_);
+    if (ConfigJournal::FromPath(config_journal_path_).Replay(&config.value(), config_file_checksum) > 0) {
+      LOG_INFO("Replayed config journal %s", config_journal_path_.c_str());
+      // Fold the journal into the config file if it is not going to be appended to
+      save_needed |= !is_journal_enabled_;
+    }
+  }
+  if (is_journal_enabled_ && file_source.empty()) {
+    // Otherwise the config file has to be written in full first, which starts tracking
+    config->TrackPersistentChanges();
+  }
   if (!file_source.empty()) {
     config->SetProperty(kInfoSection, kFileSourceProperty, std::move(file_source));
   }
@@ -196,6 +282,8 @@ void StorageModule::Start() {
   config->FixDeviceTypeInconsistencies();
   // TODO (b/158035889) Migrate metrics module to GD
   pimpl_ = std::make_unique<impl>(GetHandler(), std::move(config.value()), temp_devices_capacity_);
+  pimpl_->config_file_size_ = GetFileSize(config_file_path_);
+  pimpl_->config_file_checksum_ = config_file_checksum;
   if (save_needed) {
     // Set a timer and write the new config file to disk.
     SaveDelayed();
@@ -211,7 +299,7 @@ void StorageModule::Stop() {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
   if (pimpl_->has_pending_config_save_) {
     // Save pending changes before stopping the module.
-    SaveImmediately();
+    SaveChanges();
   }
   if (bluetooth::os::ParameterProvider::GetBtKeystoreInterface() != nullptr) {
     bluetooth::os::ParameterProvider::GetBtKeystoreInterface()->clear_map();
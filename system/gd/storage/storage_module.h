@@ -42,6 +42,7 @@ class SecurityManagerImpl;
 
 namespace hci {
 class AclManager;
+class Controller;
 }
 
 namespace storage {
@@ -121,6 +122,7 @@ class StorageModule : public bluetooth::Module {
 
   friend shim::BtifConfigInterface;
   friend hci::AclManager;
+  friend hci::Controller;
   friend security::internal::SecurityManagerImpl;
   // For unit test only
   ConfigCache* GetMemoryOnlyConfigCache();
@@ -128,8 +130,11 @@ class StorageModule : public bluetooth::Module {
   // This method triggers the delayed saving automatically, the delay is equal to |config_save_delay_|
   void SaveDelayed();
   // In some cases, one may want to save the config immediately to disk. Call this method with caution as it runs
-  // immediately on the calling thread
+  // immediately on the calling thread. This always rewrites the whole config file and empties the journal
   void SaveImmediately();
+  // Save the changes made since the last save, appending them to the journal when journaling is enabled and the
+  // journal is still small enough, otherwise same as SaveImmediately()
+  void SaveChanges();
   // remove all content in this config cache, restore it to the state after the explicit constructor
   void Clear();
 
@@ -138,12 +143,15 @@ class StorageModule : public bluetooth::Module {
   // - config_save_delay is the duration after which to dump config to disk after SaveDelayed() is called
   // - temp_devices_capacity is the number of temporary, typically unpaired devices to hold in a memory based LRU
   // - is_restricted_mode and is_single_user_mode are flags from upper layer
+  // - is_journal_enabled makes config changes be appended to a journal next to the config file, which is only
+  //   rewritten once the journal grows past the size of the config
   StorageModule(
       std::string config_file_path,
       std::chrono::milliseconds config_save_delay,
       size_t temp_devices_capacity,
       bool is_restricted_mode,
-      bool is_single_user_mode);
+      bool is_single_user_mode,
+      bool is_journal_enabled = false);
 
   bool HasSection(const std::string& section) const;
   bool HasProperty(const std::string& section, const std::string& property) const;
@@ -181,10 +189,12 @@ class StorageModule : public bluetooth::Module {
   std::unique_ptr<impl> pimpl_;
   std::string config_file_path_;
   std::string config_backup_path_;
+  std::string config_journal_path_;
   std::chrono::milliseconds config_save_delay_;
   size_t temp_devices_capacity_;
   bool is_restricted_mode_;
   bool is_single_user_mode_;
+  bool is_journal_enabled_;
   static bool is_config_checksum_pass(int check_bit);
 };
 
@@ -54,13 +54,15 @@ class TestStorageModule : public StorageModule {
       std::string config_file_path,
       std::chrono::milliseconds config_save_delay,
       bool is_restricted_mode,
-      bool is_single_user_mode)
+      bool is_single_user_mode,
+      bool is_journal_enabled = false)
       : StorageModule(
             std::move(config_file_path),
             config_save_delay,
             kTestTempDevicesCapacity,
             is_restricted_mode,
-            is_single_user_mode) {}
+            is_single_user_mode,
+            is_journal_enabled) {}
 
   ConfigCache* GetMemoryOnlyConfigCachePublic() {
     return StorageModule::GetMemoryOnlyConfigCache();
@@ -108,6 +110,7 @@ class StorageModuleTest : public Test {
     temp_dir_ = std::filesystem::temp_directory_path();
     temp_config_ = temp_dir_ / "temp_config.txt";
     temp_backup_config_ = temp_dir_ / "temp_config.bak";
+    temp_journal_ = temp_dir_ / "temp_config.journal";
     DeleteConfigFiles();
     ASSERT_FALSE(std::filesystem::exists(temp_config_));
     ASSERT_FALSE(std::filesystem::exists(temp_backup_config_));
@@ -125,6 +128,9 @@ class StorageModuleTest : public Test {
     if (std::filesystem::exists(temp_backup_config_)) {
       ASSERT_TRUE(std::filesystem::remove(temp_backup_config_));
     }
+    if (std::filesystem::exists(temp_journal_)) {
+      ASSERT_TRUE(std::filesystem::remove(temp_journal_));
+    }
   }
 
   void FakeTimerAdvance(std::chrono::milliseconds time) {
@@ -147,6 +153,7 @@ class StorageModuleTest : public Test {
   std::filesystem::path temp_dir_;
   std::filesystem::path temp_config_;
   std::filesystem::path temp_backup_config_;
+  std::filesystem::path temp_journal_;
 };
 
 TEST_F(StorageModuleTest, empty_config_no_op_test) {
@@ -266,6 +273,77 @@ TEST_F(StorageModuleTest, save_config_test) {
   ASSERT_TRUE(std::filesystem::exists(temp_config_));
 }
 
+TEST_F(StorageModuleTest, save_config_to_journal_test) {
+  // Prepare config file
+  ASSERT_TRUE(bluetooth::os::WriteToFile(temp_config_.string(), kReadTestConfig));
+
+  // Set up
+  auto* storage = new TestStorageModule(temp_config_.string(), kTestConfigSaveDelay, false, false, true);
+  test_registry_.InjectTestModule(&StorageModule::Factory, storage);
+
+  // Test
+  storage->SetPropertyPublic("01:02:03:ab:cd:ea", BTIF_STORAGE_KEY_NAME, "foo");
+  storage->RemovePropertyPublic(StorageModule::kAdapterSection, "ScanMode");
+  ASSERT_TRUE(WaitForReactorIdle(kTestConfigSaveDelay));
+
+  // Changes only go to the journal
+  ASSERT_TRUE(std::filesystem::exists(temp_journal_));
+  auto config = bluetooth::os::ReadSmallFile(temp_config_.string());
+  ASSERT_TRUE(config);
+  ASSERT_EQ(*config, kReadTestConfig);
+
+  // Restart from the config file and the journal
+  test_registry_.StopAll();
+  storage = new TestStorageModule(temp_config_.string(), kTestConfigSaveDelay, false, false, true);
+  test_registry_.InjectTestModule(&StorageModule::Factory, storage);
+  ASSERT_THAT(storage->GetPropertyPublic("01:02:03:ab:cd:ea", BTIF_STORAGE_KEY_NAME), Optional(StrEq("foo")));
+  ASSERT_FALSE(storage->HasPropertyPublic(StorageModule::kAdapterSection, "ScanMode"));
+  test_registry_.StopAll();
+
+  // Restarting without journaling folds the journal into the config file
+  storage = new TestStorageModule(temp_config_.string(), kTestConfigSaveDelay, false, false);
+  test_registry_.InjectTestModule(&StorageModule::Factory, storage);
+  ASSERT_THAT(storage->GetPropertyPublic("01:02:03:ab:cd:ea", BTIF_STORAGE_KEY_NAME), Optional(StrEq("foo")));
+  test_registry_.StopAll();
+  ASSERT_FALSE(std::filesystem::exists(temp_journal_));
+  auto config_read = LegacyConfigFile::FromPath(temp_config_.string()).Read(kTestTempDevicesCapacity);
+  ASSERT_TRUE(config_read);
+  ASSERT_THAT(config_read->GetProperty("01:02:03:ab:cd:ea", BTIF_STORAGE_KEY_NAME), Optional(StrEq("foo")));
+  ASSERT_FALSE(config_read->HasProperty(StorageModule::kAdapterSection, "ScanMode"));
+}
+
+TEST_F(StorageModuleTest, stale_journal_is_not_replayed_test) {
+  // Prepare config file
+  ASSERT_TRUE(bluetooth::os::WriteToFile(temp_config_.string(), kReadTestConfig));
+
+  // Journal a change on top of it
+  auto* storage = new TestStorageModule(temp_config_.string(), kTestConfigSaveDelay, false, false, true);
+  test_registry_.InjectTestModule(&StorageModule::Factory, storage);
+  storage->SetPropertyPublic("01:02:03:ab:cd:ea", BTIF_STORAGE_KEY_NAME, "foo");
+  ASSERT_TRUE(WaitForReactorIdle(kTestConfigSaveDelay));
+  test_registry_.StopAll();
+  auto stale_journal = bluetooth::os::ReadSmallFile(temp_journal_.string());
+  ASSERT_TRUE(stale_journal);
+
+  // Write a newer config in full
+  storage = new TestStorageModule(temp_config_.string(), kTestConfigSaveDelay, false, false);
+  test_registry_.InjectTestModule(&StorageModule::Factory, storage);
+  storage->SetPropertyPublic("01:02:03:ab:cd:ea", BTIF_STORAGE_KEY_NAME, "bar");
+  ASSERT_TRUE(WaitForReactorIdle(kTestConfigSaveDelay));
+  test_registry_.StopAll();
+  ASSERT_FALSE(std::filesystem::exists(temp_journal_));
+
+  // Crash before the journal was deleted
+  ASSERT_TRUE(bluetooth::os::WriteToFile(temp_journal_.string(), *stale_journal));
+
+  // The journal does not apply to the newer config
+  storage = new TestStorageModule(temp_config_.string(), kTestConfigSaveDelay, false, false, true);
+  test_registry_.InjectTestModule(&StorageModule::Factory, storage);
+  ASSERT_THAT(storage->GetPropertyPublic("01:02:03:ab:cd:ea", BTIF_STORAGE_KEY_NAME), Optional(StrEq("bar")));
+  ASSERT_FALSE(std::filesystem::exists(temp_journal_));
+  test_registry_.StopAll();
+}
+
 TEST_F(StorageModuleTest, get_bonded_devices_test) {
   // Prepare config file
   ASSERT_TRUE(bluetooth::os::WriteToFile(temp_config_.string(), kReadTestConfig));
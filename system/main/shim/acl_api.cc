@@ -179,6 +179,10 @@ void bluetooth::shim::ACL_LeSubrateRequest(
       hci_handle, subrate_min, subrate_max, max_latency, cont_num, sup_tout);
 }
 
+void bluetooth::shim::ACL_SetLinkWeight(uint16_t hci_handle, uint8_t weight) {
+  bluetooth::shim::GetAclManager()->SetAclTxWeight(hci_handle, weight);
+}
+
 void bluetooth::shim::ACL_RemoteNameRequest(const RawAddress& addr,
                                             uint8_t page_scan_rep_mode,
                                             uint8_t /* page_scan_mode */,
@@ -62,6 +62,7 @@ void ACL_LeSetDefaultSubrate(uint16_t subrate_min, uint16_t subrate_max,
 void ACL_LeSubrateRequest(uint16_t hci_handle, uint16_t subrate_min,
                           uint16_t subrate_max, uint16_t max_latency,
                           uint16_t cont_num, uint16_t sup_tout);
+void ACL_SetLinkWeight(uint16_t hci_handle, uint8_t weight);
 
 void ACL_RemoteNameRequest(const RawAddress& bd_addr,
                            uint8_t page_scan_rep_mode, uint8_t page_scan_mode,
@@ -19,6 +19,11 @@
  */
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <queue>
 #include <set>
 #include <vector>
@@ -48,6 +53,93 @@ class MsftCallbacks {
   MsftAdvMonitorEnableCallback Enable;
 };
 
+// An advertising report waiting in a ScanResultBatch for the JNI thread
+struct ScanResult {
+  uint16_t event_type;
+  uint8_t address_type;
+  RawAddress address;
+  tBLE_ADDR_TYPE ble_addr_type;
+  uint8_t primary_phy;
+  uint8_t secondary_phy;
+  uint8_t advertising_sid;
+  int8_t tx_power;
+  int8_t rssi;
+  uint16_t periodic_advertising_interval;
+  // Advertising data, in the arena of the batch
+  size_t data_offset;
+  size_t data_length;
+};
+
+// Scan results handed to the JNI thread together. The results and their
+// advertising data are stored in buffers kept across uses of the batch.
+class ScanResultBatch {
+ public:
+  const std::vector<ScanResult>& Results() const { return results_; }
+  const uint8_t* Data(const ScanResult& result) const {
+    return data_.data() + result.data_offset;
+  }
+
+ private:
+  friend class ScanResultBatcher;
+
+  void Clear();
+  // Index of a result with the same address and data, or -1
+  int FindDuplicate(const RawAddress& address,
+                    const std::vector<uint8_t>& data, size_t* slot) const;
+
+  std::vector<ScanResult> results_;
+  std::vector<uint8_t> data_;
+  // Open addressing table of result indexes + 1, for duplicate suppression
+  std::vector<uint8_t> slots_;
+};
+
+// Coalesces scan results so that a single closure is posted to the JNI
+// thread per batch rather than several per advertising report.
+//
+// A batch is open from its first result until it is full, is closed or is
+// taken by the JNI thread. Batches are taken in the order they were opened,
+// and are recycled once delivered.
+class ScanResultBatcher {
+ public:
+  static constexpr size_t kMaxResultsPerBatch = 64;
+
+  struct Counters {
+    uint64_t reports_in = 0;
+    uint64_t reports_out = 0;
+    uint64_t reports_suppressed = 0;
+    uint64_t batches = 0;
+  };
+
+  // Drops results with the address and data of a result already in the open
+  // batch
+  void SetSuppressDuplicates(bool suppress_duplicates);
+
+  // Returns true when the result opened a new batch, in which case the caller
+  // has to post one task calling TakeBatch() to the JNI thread
+  bool Add(const ScanResult& result, const std::vector<uint8_t>& data);
+
+  // Results added afterwards go to a new batch, so that they are not
+  // delivered before events posted in the meantime
+  void Close();
+
+  // Oldest batch, or nullptr
+  std::unique_ptr<ScanResultBatch> TakeBatch();
+
+  // Gives back a delivered batch for its buffers to be reused
+  void Recycle(std::unique_ptr<ScanResultBatch> batch);
+
+  Counters GetCounters() const;
+
+ private:
+  mutable std::mutex mutex_;
+  bool suppress_duplicates_ = false;
+  // The last batch accepts results while open_ is set
+  std::deque<std::unique_ptr<ScanResultBatch>> pending_;
+  bool open_ = false;
+  std::vector<std::unique_ptr<ScanResultBatch>> spare_;
+  Counters counters_;
+};
+
 class BleScannerInterfaceImpl : public ::BleScannerInterface,
                                 public bluetooth::hci::ScanningCallback {
  public:
@@ -146,7 +238,12 @@ class BleScannerInterfaceImpl : public ::BleScannerInterface,
           advertising_packet_content_filter_command,
       ApcfCommand apcf_command);
   void handle_remote_properties(RawAddress bd_addr, tBLE_ADDR_TYPE addr_type,
-                                std::vector<uint8_t> advertising_data);
+                                const std::vector<uint8_t>& advertising_data);
+  void deliver_scan_results();
+
+  // Scan results are coalesced before being posted to the JNI thread
+  bool scan_result_batching_ = false;
+  ScanResultBatcher scan_result_batcher_;
 
   class AddressCache {
    public:
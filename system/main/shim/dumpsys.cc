@@ -57,6 +57,7 @@ void bluetooth::shim::Dump(int fd, const char** args) {
   }
   bluetooth::shim::Stack::GetInstance()->LockForDumpsys([=]() {
     if (bluetooth::shim::is_gd_stack_started_up()) {
+      bluetooth::shim::Stack::GetInstance()->DumpThread(fd);
       if (bluetooth::shim::is_gd_dumpsys_module_started()) {
         bluetooth::shim::GetDumpsys()->Dump(fd, args);
       } else {
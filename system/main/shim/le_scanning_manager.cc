@@ -24,6 +24,9 @@
 #include <hardware/bluetooth.h>
 #include <stdio.h>
 
+#include <algorithm>
+#include <cstring>
+
 #include "advertise_data_parser.h"
 #include "btif/include/btif_common.h"
 #include "hci/address.h"
@@ -36,6 +39,7 @@
 #include "main/shim/le_scanning_manager.h"
 #include "main/shim/shim.h"
 #include "os/log.h"
+#include "os/system_properties.h"
 #include "stack/btm/btm_int_types.h"
 #include "stack/include/bt_dev_class.h"
 #include "stack/include/btm_log_history.h"
@@ -61,6 +65,25 @@ constexpr uint8_t kFilterLogicAnd = 0x01;
 constexpr uint8_t kLowestRssiValue = 129;
 constexpr uint16_t kAllowAllFilter = 0x00;
 constexpr uint16_t kListLogicOr = 0x01;
+constexpr char kScanResultBatchingProperty[] =
+    "bluetooth.le_scan.batched_delivery.enabled";
+constexpr char kSuppressDuplicateScanResultsProperty[] =
+    "bluetooth.le_scan.batched_delivery.suppress_duplicates";
+// Twice the results of a batch, and small enough for uint8_t indexes
+constexpr size_t kScanResultSlots = 128;
+
+__attribute__((no_sanitize("integer"))) size_t HashScanResult(
+    const RawAddress& address, const std::vector<uint8_t>& data) {
+  // FNV-1a
+  uint64_t hash = 0xcbf29ce484222325;
+  for (uint8_t byte : address.address) {
+    hash = (hash ^ byte) * 0x100000001b3;
+  }
+  for (uint8_t byte : data) {
+    hash = (hash ^ byte) * 0x100000001b3;
+  }
+  return static_cast<size_t>(hash ^ (hash >> 32));
+}
 
 class DefaultScanningCallback : public ::ScanningCallbacks {
   void OnScannerRegistered(const bluetooth::Uuid /* app_uuid */,
@@ -148,9 +171,118 @@ extern DEV_CLASS btm_ble_get_appearance_as_cod(
     std::vector<uint8_t> const& data);
 
 using bluetooth::shim::BleScannerInterfaceImpl;
+using bluetooth::shim::ScanResult;
+using bluetooth::shim::ScanResultBatch;
+using bluetooth::shim::ScanResultBatcher;
+
+void ScanResultBatch::Clear() {
+  results_.clear();
+  data_.clear();
+  std::fill(slots_.begin(), slots_.end(), 0);
+}
+
+int ScanResultBatch::FindDuplicate(const RawAddress& address,
+                                   const std::vector<uint8_t>& data,
+                                   size_t* slot) const {
+  size_t mask = slots_.size() - 1;
+  for (size_t i = HashScanResult(address, data) & mask;; i = (i + 1) & mask) {
+    if (slots_[i] == 0) {
+      *slot = i;
+      return -1;
+    }
+    const ScanResult& result = results_[slots_[i] - 1];
+    if (result.address == address && result.data_length == data.size() &&
+        (data.empty() ||
+         memcmp(Data(result), data.data(), data.size()) == 0)) {
+      return slots_[i] - 1;
+    }
+  }
+}
+
+void ScanResultBatcher::SetSuppressDuplicates(bool suppress_duplicates) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  suppress_duplicates_ = suppress_duplicates;
+}
+
+bool ScanResultBatcher::Add(const ScanResult& result,
+                            const std::vector<uint8_t>& data) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  counters_.reports_in++;
+
+  bool opened = false;
+  if (!open_) {
+    std::unique_ptr<ScanResultBatch> batch;
+    if (spare_.empty()) {
+      batch = std::make_unique<ScanResultBatch>();
+      batch->results_.reserve(kMaxResultsPerBatch);
+      batch->slots_.resize(kScanResultSlots);
+    } else {
+      batch = std::move(spare_.back());
+      spare_.pop_back();
+    }
+    pending_.push_back(std::move(batch));
+    open_ = true;
+    opened = true;
+    counters_.batches++;
+  }
+
+  ScanResultBatch& batch = *pending_.back();
+  if (suppress_duplicates_) {
+    size_t slot;
+    if (batch.FindDuplicate(result.address, data, &slot) >= 0) {
+      counters_.reports_suppressed++;
+      return opened;
+    }
+    batch.slots_[slot] = static_cast<uint8_t>(batch.results_.size() + 1);
+  }
+
+  ScanResult& stored = batch.results_.emplace_back(result);
+  stored.data_offset = batch.data_.size();
+  stored.data_length = data.size();
+  batch.data_.insert(batch.data_.end(), data.begin(), data.end());
+  if (batch.results_.size() == kMaxResultsPerBatch) {
+    open_ = false;
+  }
+  return opened;
+}
+
+void ScanResultBatcher::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  open_ = false;
+}
+
+std::unique_ptr<ScanResultBatch> ScanResultBatcher::TakeBatch() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (pending_.empty()) {
+    return nullptr;
+  }
+  std::unique_ptr<ScanResultBatch> batch = std::move(pending_.front());
+  pending_.pop_front();
+  if (pending_.empty()) {
+    open_ = false;
+  }
+  return batch;
+}
+
+void ScanResultBatcher::Recycle(std::unique_ptr<ScanResultBatch> batch) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  counters_.reports_out += batch->Results().size();
+  batch->Clear();
+  spare_.push_back(std::move(batch));
+}
+
+ScanResultBatcher::Counters ScanResultBatcher::GetCounters() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return counters_;
+}
 
 void BleScannerInterfaceImpl::Init() {
   LOG_INFO("init BleScannerInterfaceImpl");
+  scan_result_batching_ =
+      bluetooth::os::GetSystemPropertyBool(kScanResultBatchingProperty, false);
+  scan_result_batcher_.SetSuppressDuplicates(
+      bluetooth::os::GetSystemPropertyBool(
+          kSuppressDuplicateScanResultsProperty, false));
   bluetooth::shim::GetScanning()->RegisterScanningCallback(this);
 
   if (bluetooth::shim::GetMsftExtensionManager()) {
@@ -192,6 +324,16 @@ void BleScannerInterfaceImpl::Scan(bool start) {
                    base::StringPrintf("duration_s:%6.3f results:%-3lu",
                                       (double)duration_timestamp / 1000.0,
                                       btm_cb.neighbor.le_scan.results));
+    if (scan_result_batching_) {
+      ScanResultBatcher::Counters counters =
+          scan_result_batcher_.GetCounters();
+      LOG_INFO(
+          "Scan results in:%llu out:%llu suppressed:%llu batches:%llu",
+          static_cast<unsigned long long>(counters.reports_in),
+          static_cast<unsigned long long>(counters.reports_out),
+          static_cast<unsigned long long>(counters.reports_suppressed),
+          static_cast<unsigned long long>(counters.batches));
+    }
     btm_cb.ble_ctr_cb.reset_ble_observe();
     btm_cb.neighbor.le_scan = {};
   } else {
@@ -505,6 +647,7 @@ void BleScannerInterfaceImpl::OnScannerRegistered(
     const bluetooth::hci::Uuid app_uuid, bluetooth::hci::ScannerId scanner_id,
     ScanningStatus status) {
   auto uuid = bluetooth::Uuid::From128BitBE(app_uuid.To128BitBE());
+  scan_result_batcher_.Close();
   do_in_jni_thread(FROM_HERE,
                    base::BindOnce(&ScanningCallbacks::OnScannerRegistered,
                                   base::Unretained(scanning_callbacks_), uuid,
@@ -513,6 +656,7 @@ void BleScannerInterfaceImpl::OnScannerRegistered(
 
 void BleScannerInterfaceImpl::OnSetScannerParameterComplete(
     bluetooth::hci::ScannerId scanner_id, ScanningStatus status) {
+  scan_result_batcher_.Close();
   do_in_jni_thread(
       FROM_HERE,
       base::BindOnce(&ScanningCallbacks::OnSetScannerParameterComplete,
@@ -533,25 +677,67 @@ void BleScannerInterfaceImpl::OnScanResult(
     btm_ble_process_adv_addr(raw_address, &ble_addr_type);
   }
 
-  do_in_jni_thread(
-      FROM_HERE,
-      base::BindOnce(&BleScannerInterfaceImpl::handle_remote_properties,
-                     base::Unretained(this), raw_address, ble_addr_type,
-                     advertising_data));
-
-  do_in_jni_thread(
-      FROM_HERE,
-      base::BindOnce(&ScanningCallbacks::OnScanResult,
-                     base::Unretained(scanning_callbacks_), event_type,
-                     static_cast<uint8_t>(address_type), raw_address,
-                     primary_phy, secondary_phy, advertising_sid, tx_power,
-                     rssi, periodic_advertising_interval, advertising_data));
+  if (scan_result_batching_) {
+    ScanResult result = {
+        .event_type = event_type,
+        .address_type = address_type,
+        .address = raw_address,
+        .ble_addr_type = ble_addr_type,
+        .primary_phy = primary_phy,
+        .secondary_phy = secondary_phy,
+        .advertising_sid = advertising_sid,
+        .tx_power = tx_power,
+        .rssi = rssi,
+        .periodic_advertising_interval = periodic_advertising_interval,
+        .data_offset = 0,
+        .data_length = 0,
+    };
+    if (scan_result_batcher_.Add(result, advertising_data)) {
+      do_in_jni_thread(
+          FROM_HERE,
+          base::BindOnce(&BleScannerInterfaceImpl::deliver_scan_results,
+                         base::Unretained(this)));
+    }
+  } else {
+    do_in_jni_thread(
+        FROM_HERE,
+        base::BindOnce(&BleScannerInterfaceImpl::handle_remote_properties,
+                       base::Unretained(this), raw_address, ble_addr_type,
+                       advertising_data));
+
+    do_in_jni_thread(
+        FROM_HERE,
+        base::BindOnce(&ScanningCallbacks::OnScanResult,
+                       base::Unretained(scanning_callbacks_), event_type,
+                       static_cast<uint8_t>(address_type), raw_address,
+                       primary_phy, secondary_phy, advertising_sid, tx_power,
+                       rssi, periodic_advertising_interval, advertising_data));
+  }
 
   // TODO: Remove when StartInquiry in GD part implemented
   btm_ble_process_adv_pkt_cont_for_inquiry(
       event_type, ble_addr_type, raw_address, primary_phy, secondary_phy,
       advertising_sid, tx_power, rssi, periodic_advertising_interval,
-      advertising_data);
+      std::move(advertising_data));
+}
+
+void BleScannerInterfaceImpl::deliver_scan_results() {
+  std::unique_ptr<ScanResultBatch> batch = scan_result_batcher_.TakeBatch();
+  if (batch == nullptr) {
+    return;
+  }
+  for (const ScanResult& result : batch->Results()) {
+    const uint8_t* data = batch->Data(result);
+    std::vector<uint8_t> advertising_data(data, data + result.data_length);
+    handle_remote_properties(result.address, result.ble_addr_type,
+                             advertising_data);
+    scanning_callbacks_->OnScanResult(
+        result.event_type, result.address_type, result.address,
+        result.primary_phy, result.secondary_phy, result.advertising_sid,
+        result.tx_power, result.rssi, result.periodic_advertising_interval,
+        std::move(advertising_data));
+  }
+  scan_result_batcher_.Recycle(std::move(batch));
 }
 
 void BleScannerInterfaceImpl::OnTrackAdvFoundLost(
@@ -590,6 +776,7 @@ void BleScannerInterfaceImpl::OnTrackAdvFoundLost(
     track_info.scan_response.insert(track_info.scan_response.end(),
                                     scan_rsp_data.begin(), scan_rsp_data.end());
   }
+  scan_result_batcher_.Close();
   do_in_jni_thread(
       FROM_HERE,
       base::BindOnce(&ScanningCallbacks::OnTrackAdvFoundLost,
@@ -600,6 +787,7 @@ void BleScannerInterfaceImpl::OnBatchScanReports(int client_if, int status,
                                                  int report_format,
                                                  int num_records,
                                                  std::vector<uint8_t> data) {
+  scan_result_batcher_.Close();
   do_in_jni_thread(
       FROM_HERE,
       base::BindOnce(&ScanningCallbacks::OnBatchScanReports,
@@ -608,6 +796,7 @@ void BleScannerInterfaceImpl::OnBatchScanReports(int client_if, int status,
 }
 
 void BleScannerInterfaceImpl::OnBatchScanThresholdCrossed(int client_if) {
+  scan_result_batcher_.Close();
   do_in_jni_thread(
       FROM_HERE,
       base::BindOnce(&ScanningCallbacks::OnBatchScanThresholdCrossed,
@@ -625,6 +814,7 @@ void BleScannerInterfaceImpl::OnPeriodicSyncStarted(
     btm_identity_addr_to_random_pseudo(&raw_address, &ble_addr_type, true);
   }
 
+  scan_result_batcher_.Close();
   do_in_jni_thread(FROM_HERE,
                    base::BindOnce(&ScanningCallbacks::OnPeriodicSyncStarted,
                                   base::Unretained(scanning_callbacks_), reg_id,
@@ -637,6 +827,7 @@ void BleScannerInterfaceImpl::OnPeriodicSyncReport(uint16_t sync_handle,
                                                    int8_t tx_power, int8_t rssi,
                                                    uint8_t status,
                                                    std::vector<uint8_t> data) {
+  scan_result_batcher_.Close();
   do_in_jni_thread(
       FROM_HERE,
       base::BindOnce(&ScanningCallbacks::OnPeriodicSyncReport,
@@ -645,6 +836,7 @@ void BleScannerInterfaceImpl::OnPeriodicSyncReport(uint16_t sync_handle,
 }
 
 void BleScannerInterfaceImpl::OnPeriodicSyncLost(uint16_t sync_handle) {
+  scan_result_batcher_.Close();
   do_in_jni_thread(
       FROM_HERE,
       base::BindOnce(&ScanningCallbacks::OnPeriodicSyncLost,
@@ -653,6 +845,7 @@ void BleScannerInterfaceImpl::OnPeriodicSyncLost(uint16_t sync_handle) {
 
 void BleScannerInterfaceImpl::OnPeriodicSyncTransferred(
     int pa_source, uint8_t status, bluetooth::hci::Address address) {
+  scan_result_batcher_.Close();
   do_in_jni_thread(FROM_HERE,
                    base::BindOnce(&ScanningCallbacks::OnPeriodicSyncTransferred,
                                   base::Unretained(scanning_callbacks_),
@@ -660,6 +853,7 @@ void BleScannerInterfaceImpl::OnPeriodicSyncTransferred(
 }
 
 void BleScannerInterfaceImpl::OnBigInfoReport(uint16_t sync_handle, bool encrypted) {
+  scan_result_batcher_.Close();
   do_in_jni_thread(FROM_HERE,
                    base::BindOnce(&ScanningCallbacks::OnBigInfoReport,
                    base::Unretained(scanning_callbacks_), sync_handle, encrypted));
@@ -756,7 +950,7 @@ bool BleScannerInterfaceImpl::parse_filter_command(
 
 void BleScannerInterfaceImpl::handle_remote_properties(
     RawAddress bd_addr, tBLE_ADDR_TYPE addr_type,
-    std::vector<uint8_t> advertising_data) {
+    const std::vector<uint8_t>& advertising_data) {
   if (!bluetooth::shim::is_gd_stack_started_up()) {
     LOG_WARN("Gd stack is stopped, return");
     return;
@@ -213,5 +213,12 @@ void Stack::LockForDumpsys(std::function<void()> dumpsys_callback) {
   dumpsys_callback();
 }
 
+void Stack::DumpThread(int fd) const {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  if (stack_thread_ != nullptr) {
+    stack_thread_->GetDumpsysData(fd);
+  }
+}
+
 }  // namespace shim
 }  // namespace bluetooth
@@ -60,6 +60,9 @@ class Stack {
 
   void LockForDumpsys(std::function<void()> dumpsys_callback);
 
+  // Dumps the dispatch statistics of the stack thread
+  void DumpThread(int fd) const;
+
   // Start the list of modules with the given stack manager thread
   void StartModuleStack(const ModuleList* modules, const os::Thread* thread);
 
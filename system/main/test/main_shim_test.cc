@@ -656,6 +656,97 @@ TEST_F(MainShimTest, DISABLED_BleScannerInterfaceImpl_OnScanResult) {
   run_all_jni_thread_task();
 }
 
+namespace {
+
+bluetooth::shim::ScanResult MakeScanResult(uint8_t address_byte) {
+  bluetooth::shim::ScanResult result{};
+  result.address = RawAddress(
+      std::array<uint8_t, 6>{0x11, 0x22, 0x33, 0x44, 0x55, address_byte});
+  result.ble_addr_type = BLE_ADDR_RANDOM;
+  result.rssi = -50;
+  return result;
+}
+
+}  // namespace
+
+TEST_F(MainShimTest, ScanResultBatcher_one_batch_per_run_of_results) {
+  bluetooth::shim::ScanResultBatcher batcher;
+
+  ASSERT_TRUE(batcher.Add(MakeScanResult(0), {0x02, 0x01, 0x06}));
+  for (uint8_t i = 1; i < 10; i++) {
+    ASSERT_FALSE(batcher.Add(MakeScanResult(i), {0x02, 0x01, i}));
+  }
+
+  auto batch = batcher.TakeBatch();
+  ASSERT_NE(nullptr, batch);
+  ASSERT_EQ(10UL, batch->Results().size());
+  for (uint8_t i = 0; i < 10; i++) {
+    const auto& result = batch->Results()[i];
+    ASSERT_EQ(i, result.address.address[5]);
+    ASSERT_EQ(3UL, result.data_length);
+    ASSERT_EQ(i == 0 ? 0x06 : i, batch->Data(result)[2]);
+  }
+  ASSERT_EQ(nullptr, batcher.TakeBatch());
+  batcher.Recycle(std::move(batch));
+
+  // The next result opens a new batch, reusing the recycled one
+  ASSERT_TRUE(batcher.Add(MakeScanResult(0), {}));
+  batch = batcher.TakeBatch();
+  ASSERT_EQ(1UL, batch->Results().size());
+  batcher.Recycle(std::move(batch));
+
+  auto counters = batcher.GetCounters();
+  ASSERT_EQ(11UL, counters.reports_in);
+  ASSERT_EQ(11UL, counters.reports_out);
+  ASSERT_EQ(0UL, counters.reports_suppressed);
+  ASSERT_EQ(2UL, counters.batches);
+}
+
+TEST_F(MainShimTest, ScanResultBatcher_full_or_closed_batches) {
+  bluetooth::shim::ScanResultBatcher batcher;
+  const size_t max = bluetooth::shim::ScanResultBatcher::kMaxResultsPerBatch;
+
+  int opened = 0;
+  for (size_t i = 0; i < max + 1; i++) {
+    opened += batcher.Add(MakeScanResult(static_cast<uint8_t>(i)), {0x01});
+  }
+  ASSERT_EQ(2, opened);
+
+  // Results added after another event was posted are not delivered with the
+  // batch already pending
+  batcher.Close();
+  ASSERT_TRUE(batcher.Add(MakeScanResult(0), {0x01}));
+
+  ASSERT_EQ(max, batcher.TakeBatch()->Results().size());
+  ASSERT_EQ(1UL, batcher.TakeBatch()->Results().size());
+  ASSERT_EQ(1UL, batcher.TakeBatch()->Results().size());
+  ASSERT_EQ(nullptr, batcher.TakeBatch());
+}
+
+TEST_F(MainShimTest, ScanResultBatcher_suppress_duplicates) {
+  bluetooth::shim::ScanResultBatcher batcher;
+  batcher.SetSuppressDuplicates(true);
+
+  ASSERT_TRUE(batcher.Add(MakeScanResult(1), {0x02, 0x01, 0x06}));
+  ASSERT_FALSE(batcher.Add(MakeScanResult(1), {0x02, 0x01, 0x06}));
+  ASSERT_FALSE(batcher.Add(MakeScanResult(1), {0x02, 0x01, 0x1a}));
+  ASSERT_FALSE(batcher.Add(MakeScanResult(2), {0x02, 0x01, 0x06}));
+  ASSERT_FALSE(batcher.Add(MakeScanResult(2), {0x02, 0x01, 0x06}));
+
+  auto batch = batcher.TakeBatch();
+  ASSERT_EQ(3UL, batch->Results().size());
+  batcher.Recycle(std::move(batch));
+
+  // Suppression is limited to a batch
+  ASSERT_TRUE(batcher.Add(MakeScanResult(1), {0x02, 0x01, 0x06}));
+  batcher.Recycle(batcher.TakeBatch());
+
+  auto counters = batcher.GetCounters();
+  ASSERT_EQ(6UL, counters.reports_in);
+  ASSERT_EQ(4UL, counters.reports_out);
+  ASSERT_EQ(2UL, counters.reports_suppressed);
+}
+
 const char* test_flags[] = {
     "INIT_logging_debug_enabled_for_all=true",
     nullptr,
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <future>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "osi/include/alarm.h"
+#include "stack/include/main_thread.h"
+
+using ::benchmark::State;
+
+// Sets and cancels alarms while many others are armed, as the legacy stack
+// does with its per L2CAP channel, RFCOMM port, GATT transaction and ACL link
+// timers.
+
+bluetooth::common::MessageLoopThread* get_main_thread() { return nullptr; }
+
+namespace {
+
+constexpr int kNumIntervals = 4096;
+
+void noop_cb(void* /* data */) {}
+
+void set_promise_cb(void* data) {
+  static_cast<std::promise<void>*>(data)->set_value();
+}
+
+// Intervals of 10 seconds to 10 minutes, none of which expires while the
+// benchmark runs
+std::vector<uint64_t> make_intervals() {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<uint64_t> interval_ms(10000, 600000);
+  std::vector<uint64_t> intervals(kNumIntervals);
+  for (auto& interval : intervals) interval = interval_ms(rng);
+  return intervals;
+}
+
+class ArmedAlarms {
+ public:
+  explicit ArmedAlarms(int count) : intervals_(make_intervals()) {
+    for (int i = 0; i < count; i++) {
+      alarm_t* alarm =
+          alarm_new(("alarm_benchmark." + std::to_string(i)).c_str());
+      alarm_set(alarm, interval(i), noop_cb, nullptr);
+      alarms_.push_back(alarm);
+    }
+  }
+
+  ~ArmedAlarms() {
+    for (alarm_t* alarm : alarms_) alarm_free(alarm);
+  }
+
+  alarm_t* alarm(size_t i) const { return alarms_[i % alarms_.size()]; }
+  uint64_t interval(size_t i) const { return intervals_[i % kNumIntervals]; }
+
+ private:
+  std::vector<uint64_t> intervals_;
+  std::vector<alarm_t*> alarms_;
+};
+
+}  // namespace
+
+// Restarting a timer, the most common operation
+static void BM_AlarmSet(State& state) {
+  ArmedAlarms armed(state.range(0));
+  size_t i = 0;
+  for (auto _ : state) {
+    alarm_set(armed.alarm(i), armed.interval(i + 1), noop_cb, nullptr);
+    i++;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AlarmSet)->Arg(100)->Arg(1000)->Arg(10000);
+
+static void BM_AlarmCancelSet(State& state) {
+  ArmedAlarms armed(state.range(0));
+  size_t i = 0;
+  for (auto _ : state) {
+    alarm_cancel(armed.alarm(i));
+    alarm_set(armed.alarm(i), armed.interval(i + 1), noop_cb, nullptr);
+    i++;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AlarmCancelSet)->Arg(100)->Arg(1000)->Arg(10000);
+
+// Restarting the alarm that expires first, which also moves the timer of the
+// alarm module
+static void BM_AlarmSetEarliest(State& state) {
+  ArmedAlarms armed(state.range(0));
+  alarm_t* alarm = alarm_new("alarm_benchmark.earliest");
+  for (auto _ : state) {
+    alarm_set(alarm, 5000, noop_cb, nullptr);
+  }
+  alarm_free(alarm);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AlarmSetEarliest)->Arg(100)->Arg(1000)->Arg(10000);
+
+// Time from setting a short alarm to its callback
+static void BM_AlarmDispatch(State& state) {
+  ArmedAlarms armed(state.range(0));
+  alarm_t* alarm = alarm_new("alarm_benchmark.dispatch");
+  for (auto _ : state) {
+    std::promise<void> fired;
+    alarm_set(alarm, 1, set_promise_cb, &fired);
+    fired.get_future().wait();
+  }
+  alarm_free(alarm);
+}
+BENCHMARK(BM_AlarmDispatch)->Arg(100)->Arg(10000)->UseRealTime();
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+  alarm_cleanup();
+}
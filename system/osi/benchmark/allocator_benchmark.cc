@@ -0,0 +1,183 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <stdlib.h>
+
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "osi/include/allocator.h"
+
+using ::benchmark::State;
+
+// Replays an allocation trace through osi_malloc()/osi_free() and through
+// plain malloc()/free().
+//
+// A trace is a text file with one operation per line, either "+<id> <size>"
+// for an allocation or "-<id>" to free the buffer allocated as <id>. The file
+// is read from the path in the OSI_ALLOCATOR_TRACE environment variable, the
+// benchmark falls back to a synthetic trace otherwise.
+
+namespace {
+
+struct trace_op_t {
+  bool alloc;
+  uint32_t id;
+  size_t size;
+};
+
+struct trace_t {
+  std::vector<trace_op_t> ops;
+  uint32_t num_ids = 0;
+};
+
+bool load_trace(const char* path, trace_t* trace) {
+  std::ifstream file(path);
+  if (!file.is_open()) return false;
+
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.size() < 2) continue;
+    trace_op_t op = {};
+    op.alloc = line[0] == '+';
+    if (!op.alloc && line[0] != '-') continue;
+    char* end = nullptr;
+    op.id = strtoul(line.c_str() + 1, &end, 10);
+    if (op.alloc) op.size = strtoul(end, nullptr, 10);
+    trace->ops.push_back(op);
+    if (op.id >= trace->num_ids) trace->num_ids = op.id + 1;
+  }
+  return !trace->ops.empty();
+}
+
+// Approximates a device streaming A2DP while receiving LE and BR/EDR ACL
+// data: short lived HCI events, ACL buffers held until reassembly or
+// transmit completion, encoded audio frames sitting in the transmit queue,
+// and the occasional large buffer.
+trace_t make_synthetic_trace() {
+  trace_t trace;
+  std::deque<uint32_t> acl_in_flight;
+  std::deque<uint32_t> audio_queue;
+  uint32_t next_id = 0;
+  unsigned int seed = 1;
+
+  auto alloc = [&](size_t size) {
+    trace.ops.push_back({true, next_id, size});
+    return next_id++;
+  };
+  auto free_id = [&](uint32_t id) { trace.ops.push_back({false, id, 0}); };
+
+  for (int i = 0; i < 20000; i++) {
+    seed = seed * 1103515245 + 12345;
+    uint32_t r = seed >> 16;
+
+    // HCI event, freed once dispatched
+    free_id(alloc(24 + r % 100));
+
+    // ACL data, completed a few packets later
+    acl_in_flight.push_back(alloc((r & 1) ? 251 + 4 + 9 : 1021 + 4 + 9));
+    if (acl_in_flight.size() > 8) {
+      free_id(acl_in_flight.front());
+      acl_in_flight.pop_front();
+    }
+
+    // Encoded audio frame every other iteration, kept in the tx queue
+    if (i % 2 == 0) {
+      audio_queue.push_back(alloc(660));
+      if (audio_queue.size() > 12) {
+        free_id(audio_queue.front());
+        audio_queue.pop_front();
+      }
+    }
+
+    if (r % 64 == 0) free_id(alloc(4096));
+  }
+  for (uint32_t id : acl_in_flight) free_id(id);
+  for (uint32_t id : audio_queue) free_id(id);
+  trace.num_ids = next_id;
+  return trace;
+}
+
+const trace_t& get_trace() {
+  static const trace_t trace = [] {
+    trace_t loaded;
+    const char* path = getenv("OSI_ALLOCATOR_TRACE");
+    if (path != nullptr && load_trace(path, &loaded)) return loaded;
+    return make_synthetic_trace();
+  }();
+  return trace;
+}
+
+template <void* (*Alloc)(size_t), void (*Free)(void*)>
+void replay_trace(State& state) {
+  const trace_t& trace = get_trace();
+  std::vector<void*> buffers(trace.num_ids, nullptr);
+  for (auto _ : state) {
+    for (const trace_op_t& op : trace.ops) {
+      if (op.alloc) {
+        buffers[op.id] = Alloc(op.size);
+        // Touch the buffer like the stack writes the BT_HDR header
+        *static_cast<uint8_t*>(buffers[op.id]) = 0;
+      } else {
+        Free(buffers[op.id]);
+        buffers[op.id] = nullptr;
+      }
+    }
+    ::benchmark::ClobberMemory();
+  }
+  // Buffers the trace never freed
+  for (void* buffer : buffers) {
+    if (buffer != nullptr) Free(buffer);
+  }
+  state.SetItemsProcessed(static_cast<int_fast64_t>(state.iterations()) *
+                          trace.ops.size());
+}
+
+void* system_malloc(size_t size) { return malloc(size); }
+void system_free(void* ptr) { free(ptr); }
+
+}  // namespace
+
+static void BM_ReplayTraceOsiMalloc(State& state) {
+  replay_trace<osi_malloc, osi_free>(state);
+}
+BENCHMARK(BM_ReplayTraceOsiMalloc);
+
+static void BM_ReplayTraceSystemMalloc(State& state) {
+  replay_trace<system_malloc, system_free>(state);
+}
+BENCHMARK(BM_ReplayTraceSystemMalloc);
+
+static void BM_ReplayTraceOsiMallocThreaded(State& state) {
+  replay_trace<osi_malloc, osi_free>(state);
+}
+BENCHMARK(BM_ReplayTraceOsiMallocThreaded)->Threads(4)->UseRealTime();
+
+static void BM_ReplayTraceSystemMallocThreaded(State& state) {
+  replay_trace<system_malloc, system_free>(state);
+}
+BENCHMARK(BM_ReplayTraceSystemMallocThreaded)->Threads(4)->UseRealTime();
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "osi/include/config.h"
+
+using ::benchmark::State;
+
+// Loads, queries and saves configs shaped like bt_config.conf: one section per
+// remote device, named after its address, with a dozen keys each.
+
+namespace {
+
+constexpr int kKeysPerSection = 12;
+
+const std::filesystem::path kConfigFile =
+    std::filesystem::temp_directory_path() / "config_benchmark.conf";
+
+std::string section_name(int i) {
+  char name[18];
+  snprintf(name, sizeof(name), "%02x:%02x:%02x:%02x:%02x:%02x", 0x00, 0x1b,
+           (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff, (i * 7) & 0xff);
+  return name;
+}
+
+std::string key_name(int i) { return "Key" + std::to_string(i); }
+
+std::unique_ptr<config_t> make_config(int num_sections) {
+  std::unique_ptr<config_t> config = config_new_empty();
+  for (int i = 0; i < num_sections; i++) {
+    std::string section = section_name(i);
+    for (int j = 0; j < kKeysPerSection; j++) {
+      config_set_int(config.get(), section, key_name(j), i * j);
+    }
+  }
+  return config;
+}
+
+void BM_ConfigLoad(State& state) {
+  config_save(*make_config(state.range(0)), kConfigFile.string());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(config_new(kConfigFile.c_str()));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  std::filesystem::remove(kConfigFile);
+}
+BENCHMARK(BM_ConfigLoad)->Arg(100)->Arg(1000)->Arg(10000);
+
+// One key of every section, in an order unrelated to the order of the file
+void BM_ConfigLookup(State& state) {
+  const int num_sections = state.range(0);
+  std::unique_ptr<config_t> config = make_config(num_sections);
+  std::vector<std::string> sections;
+  for (int i = 0; i < num_sections; i++) {
+    sections.push_back(section_name((i * 7919) % num_sections));
+  }
+  const std::string key = key_name(kKeysPerSection - 1);
+  for (auto _ : state) {
+    for (const std::string& section : sections) {
+      benchmark::DoNotOptimize(config_get_int(*config, section, key, 0));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_sections);
+}
+BENCHMARK(BM_ConfigLookup)->Arg(100)->Arg(1000)->Arg(10000);
+
+void BM_ConfigSave(State& state) {
+  std::unique_ptr<config_t> config = make_config(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(config_save(*config, kConfigFile.string()));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  std::filesystem::remove(kConfigFile);
+}
+BENCHMARK(BM_ConfigSave)->Arg(100)->Arg(1000)->Arg(10000);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -47,6 +47,24 @@ void osi_free(void* ptr);
 // |p_ptr| cannot be NULL.
 void osi_free_and_reset(void** p_ptr);
 
+// Statistics of one size class of the |osi_malloc| buffer pools.
+typedef struct {
+  size_t block_size;   // Largest allocation served by the size class
+  size_t num_blocks;   // Number of preallocated blocks
+  uint64_t hits;       // Allocations served from the pool
+  uint64_t misses;     // Allocations that fell back to malloc, pool empty
+  size_t in_use;       // Blocks currently allocated
+  size_t high_water;   // Most blocks taken at once, including thread caches
+} osi_allocator_pool_stats_t;
+
+// Copies the statistics of up to |max_pools| size classes into |stats| and
+// returns the number of size classes. Returns 0 when the pools are disabled.
+size_t osi_allocator_get_pool_stats(osi_allocator_pool_stats_t* stats,
+                                    size_t max_pools);
+
+// Dump the buffer pool statistics to the |fd| file descriptor.
+void osi_allocator_debug_dump(int fd);
+
 class OsiObject {
  public:
   OsiObject(void* ptr);
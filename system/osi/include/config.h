@@ -15,16 +15,168 @@
 //   empty sections.
 // - Duplicate keys in a section will overwrite previous values.
 // - All strings are case sensitive.
+// - Sections and keys are kept in insertion order, which is the order they are
+//   saved in, and hash indexed by name so that lookups do not walk the lists.
 
 #include <stdbool.h>
+
+#include <initializer_list>
 #include <list>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 
 // The default section name to use if a key/value pair is not defined within
 // a section.
 #define CONFIG_DEFAULT_SECTION "Global"
 
+// std::list which also indexes its elements by the string member |Name|.
+// The index points to the first element of each name, as a linear search
+// would find it. Only the mutations below are exposed, so that the index
+// cannot go stale; elements must not be renamed once inserted.
+template <typename T, std::string T::*Name>
+class indexed_list : private std::list<T> {
+  using list = std::list<T>;
+
+ public:
+  using typename list::const_iterator;
+  using typename list::const_reference;
+  using typename list::iterator;
+  using typename list::reference;
+  using typename list::size_type;
+  using typename list::value_type;
+
+  using list::back;
+  using list::begin;
+  using list::cbegin;
+  using list::cend;
+  using list::crbegin;
+  using list::crend;
+  using list::empty;
+  using list::end;
+  using list::front;
+  using list::rbegin;
+  using list::rend;
+  using list::size;
+
+  indexed_list() = default;
+  indexed_list(std::initializer_list<T> elements) : list(elements) {
+    Reindex();
+  }
+  indexed_list(const indexed_list& other) : list(other) { Reindex(); }
+  // Moving a std::list keeps the iterators to its elements valid
+  indexed_list(indexed_list&& other) noexcept
+      : list(std::move(other)),
+        index_(std::move(other.index_)),
+        duplicates_(other.duplicates_) {
+    other.clear();
+  }
+
+  indexed_list& operator=(const indexed_list& other) {
+    if (this != &other) {
+      list::operator=(other);
+      Reindex();
+    }
+    return *this;
+  }
+  indexed_list& operator=(indexed_list&& other) noexcept {
+    if (this != &other) {
+      list::operator=(std::move(other));
+      index_ = std::move(other.index_);
+      duplicates_ = other.duplicates_;
+      other.clear();
+    }
+    return *this;
+  }
+  indexed_list& operator=(std::initializer_list<T> elements) {
+    list::operator=(elements);
+    Reindex();
+    return *this;
+  }
+
+  iterator Find(std::string_view name) {
+    auto it = index_.find(name);
+    return it == index_.end() ? end() : it->second;
+  }
+  const_iterator Find(std::string_view name) const {
+    auto it = index_.find(name);
+    return it == index_.end() ? cend() : const_iterator(it->second);
+  }
+
+  void push_back(const T& element) { emplace_back(element); }
+  void push_back(T&& element) { emplace_back(std::move(element)); }
+
+  template <typename... Args>
+  reference emplace_back(Args&&... args) {
+    list::emplace_back(std::forward<Args>(args)...);
+    Index(std::prev(end()));
+    return back();
+  }
+
+  void pop_front() { erase(begin()); }
+
+  iterator erase(const_iterator position) {
+    auto it = index_.find((*position).*Name);
+    if (it->second != position) {
+      duplicates_--;
+    } else {
+      index_.erase(it);
+      if (duplicates_ > 0) {
+        // The next element with the same name, if any, is now the first one
+        auto next = std::next(MutableIterator(position));
+        for (; next != end(); ++next) {
+          if ((*next).*Name == (*position).*Name) {
+            index_.emplace((*next).*Name, next);
+            duplicates_--;
+            break;
+          }
+        }
+      }
+    }
+    return list::erase(position);
+  }
+  iterator erase(const_iterator first, const_iterator last) {
+    while (first != last) first = erase(first);
+    return MutableIterator(last);
+  }
+
+  void clear() {
+    list::clear();
+    index_.clear();
+    duplicates_ = 0;
+  }
+
+  template <typename Compare>
+  void sort(Compare comp) {
+    list::sort(comp);
+    Reindex();
+  }
+  void sort() {
+    list::sort();
+    Reindex();
+  }
+
+ private:
+  iterator MutableIterator(const_iterator position) {
+    return list::erase(position, position);
+  }
+
+  void Index(iterator position) {
+    if (!index_.emplace((*position).*Name, position).second) duplicates_++;
+  }
+
+  void Reindex() {
+    index_.clear();
+    duplicates_ = 0;
+    for (auto it = begin(); it != end(); ++it) Index(it);
+  }
+
+  std::unordered_map<std::string_view, iterator> index_;
+  size_t duplicates_ = 0;
+};
+
 struct entry_t {
   std::string key;
   std::string value;
@@ -32,14 +184,14 @@ struct entry_t {
 
 struct section_t {
   std::string name;
-  std::list<entry_t> entries;
+  indexed_list<entry_t, &entry_t::key> entries;
   void Set(std::string key, std::string value);
   std::list<entry_t>::iterator Find(const std::string& key);
   bool Has(const std::string& key);
 };
 
 struct config_t {
-  std::list<section_t> sections;
+  indexed_list<section_t, &section_t::name> sections;
   std::list<section_t>::iterator Find(const std::string& section);
   bool Has(const std::string& section);
 };
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#ifndef LIB_OSI_INTERNAL
+#error "Please do not include this outside of osi."
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A hierarchical timing wheel: a set of entries ordered by deadline, with
+// constant time insertion and removal. Level |n| of the wheel has 64 slots of
+// 64^n milliseconds each. Entries are placed on the level of the highest
+// base 64 digit in which their deadline differs from the current time of the
+// wheel, and move down a level whenever that time reaches their slot.
+//
+// The wheel is not thread safe. Entries are owned by the caller.
+typedef struct timing_wheel_t timing_wheel_t;
+
+// Link of an object into a timing wheel, embedded in the object. It must be
+// initialized with |timing_wheel_entry_init| before its first use.
+typedef struct timing_wheel_entry_t {
+  struct timing_wheel_entry_t* prev;
+  struct timing_wheel_entry_t* next;
+  uint64_t deadline_ms;
+  uint8_t level;
+  uint8_t slot;
+  // Opaque to the wheel, typically the object embedding the entry.
+  void* context;
+} timing_wheel_entry_t;
+
+// Prototype for the function called by |timing_wheel_foreach|.
+typedef void (*timing_wheel_iter_cb)(timing_wheel_entry_t* entry,
+                                     void* context);
+
+// Creates a new empty timing wheel starting at |now_ms|. Returns NULL on
+// failure. The returned object must be released with |timing_wheel_free|.
+timing_wheel_t* timing_wheel_new(uint64_t now_ms);
+
+// Frees a timing wheel allocated with |timing_wheel_new|. The entries still in
+// it are removed first. |wheel| may be NULL.
+void timing_wheel_free(timing_wheel_t* wheel);
+
+// Initializes |entry| as not being in any wheel, with an opaque |context|.
+void timing_wheel_entry_init(timing_wheel_entry_t* entry, void* context);
+
+// Returns true if |entry| is in a wheel.
+bool timing_wheel_entry_is_linked(const timing_wheel_entry_t* entry);
+
+// Adds |entry| to |wheel| with a deadline of |deadline_ms|, after the entries
+// already in the wheel with the same deadline. If |entry| is already in
+// |wheel| it is moved. |deadline_ms| should not be earlier than the last time
+// passed to |timing_wheel_front|.
+void timing_wheel_add(timing_wheel_t* wheel, timing_wheel_entry_t* entry,
+                      uint64_t deadline_ms);
+
+// Removes |entry| from |wheel|. Does nothing if |entry| is not in a wheel.
+void timing_wheel_remove(timing_wheel_t* wheel, timing_wheel_entry_t* entry);
+
+// Returns the number of entries in |wheel|.
+size_t timing_wheel_size(const timing_wheel_t* wheel);
+
+// Returns true if |wheel| has no entries.
+bool timing_wheel_is_empty(const timing_wheel_t* wheel);
+
+// Returns the entry of |wheel| with the earliest deadline, the first one added
+// if there are several, or NULL if |wheel| is empty. |now_ms| is the current
+// time, which lets the wheel move the entries due by then down its levels. It
+// must not decrease from one call to the next.
+timing_wheel_entry_t* timing_wheel_front(timing_wheel_t* wheel,
+                                         uint64_t now_ms);
+
+// Calls |callback| with each entry of |wheel| and |context|, in no particular
+// order. |callback| must not modify |wheel|.
+void timing_wheel_foreach(const timing_wheel_t* wheel,
+                          timing_wheel_iter_cb callback, void* context);
@@ -30,17 +30,19 @@
 #include <string.h>
 #include <time.h>
 
+#include <algorithm>
 #include <mutex>
+#include <vector>
 
 #include "check.h"
 #include "os/log.h"
 #include "osi/include/allocator.h"
 #include "osi/include/fixed_queue.h"
-#include "osi/include/list.h"
 #include "osi/include/osi.h"
 #include "osi/include/thread.h"
 #include "osi/include/wakelock.h"
 #include "osi/semaphore.h"
+#include "osi/timing_wheel.h"
 #include "stack/include/main_thread.h"
 
 using base::Bind;
@@ -68,6 +70,18 @@ typedef struct {
   stat_t premature_scheduling;
 } alarm_stats_t;
 
+// Upper bounds of the buckets of the latency histograms, the last bucket
+// counting the latencies of at least LATENCY_HISTOGRAM_LIMITS_MS[5]
+static const uint64_t LATENCY_HISTOGRAM_LIMITS_MS[] = {1, 2, 5, 10, 50, 100};
+#define LATENCY_HISTOGRAM_BUCKETS \
+  (sizeof(LATENCY_HISTOGRAM_LIMITS_MS) / sizeof(uint64_t) + 1)
+
+// Latencies of all alarms past their deadline
+typedef struct {
+  stat_t stat;
+  size_t histogram[LATENCY_HISTOGRAM_BUCKETS];
+} latency_stats_t;
+
 /* Wrapper around CancellableClosure that let it be embedded in structs, without
  * need to define copy operator. */
 struct CancelableClosureInStruct {
@@ -99,6 +113,8 @@ struct alarm_t {
 
   bool for_msg_loop;  // True, if the alarm should be processed on message loop
   CancelableClosureInStruct closure;  // posted to message loop for processing
+
+  timing_wheel_entry_t wheel_entry;  // Linked into |alarms| while pending
 };
 
 // If the next wakeup time is less than this threshold, we should acquire
@@ -110,9 +126,11 @@ static const clockid_t CLOCK_ID = CLOCK_BOOTTIME;
 
 // This mutex ensures that the |alarm_set|, |alarm_cancel|, and alarm callback
 // functions execute serially and not concurrently. As a result, this mutex
-// also protects the |alarms| list.
+// also protects the |alarms| wheel and the latency statistics.
 static std::mutex alarms_mutex;
-static list_t* alarms;
+// The pending alarms. Setting and canceling an alarm take constant time no
+// matter how many alarms are pending.
+static timing_wheel_t* alarms;
 static timer_t timer;
 static timer_t wakeup_timer;
 static bool timer_set;
@@ -126,6 +144,11 @@ static semaphore_t* alarm_expired;
 static thread_t* default_callback_thread;
 static fixed_queue_t* default_callback_queue;
 
+// Time from the deadline of alarms to their dispatch to the thread processing
+// them, and to the start of their callback
+static latency_stats_t dispatch_latency;
+static latency_stats_t callback_latency;
+
 static alarm_t* alarm_new_internal(const char* name, bool is_periodic);
 static bool lazy_initialize(void);
 static uint64_t now_ms(void);
@@ -134,6 +157,7 @@ static void alarm_set_internal(alarm_t* alarm, uint64_t period_ms,
                                fixed_queue_t* queue, bool for_msg_loop);
 static void alarm_cancel_internal(alarm_t* alarm);
 static void remove_pending_alarm(alarm_t* alarm);
+static alarm_t* earliest_alarm(void);
 static void schedule_next_instance(alarm_t* alarm);
 static void reschedule_root_alarm(void);
 static void alarm_queue_ready(fixed_queue_t* queue, void* context);
@@ -153,6 +177,19 @@ static void update_stat(stat_t* stat, uint64_t delta_ms) {
   stat->count++;
 }
 
+static void update_latency_stats(latency_stats_t* stats, uint64_t now_ms,
+                                 uint64_t deadline_ms) {
+  uint64_t latency_ms = now_ms > deadline_ms ? now_ms - deadline_ms : 0;
+  update_stat(&stats->stat, latency_ms);
+
+  size_t bucket = 0;
+  while (bucket < LATENCY_HISTOGRAM_BUCKETS - 1 &&
+         latency_ms >= LATENCY_HISTOGRAM_LIMITS_MS[bucket]) {
+    bucket++;
+  }
+  stats->histogram[bucket]++;
+}
+
 alarm_t* alarm_new(const char* name) { return alarm_new_internal(name, false); }
 
 alarm_t* alarm_new_periodic(const char* name) {
@@ -177,6 +214,8 @@ static alarm_t* alarm_new_internal(const char* name, bool is_periodic) {
   // placement new
   new (&ret->closure) CancelableClosureInStruct();
 
+  timing_wheel_entry_init(&ret->wheel_entry, ret);
+
   // NOTE: The stats were reset by osi_calloc() above
 
   return ret;
@@ -255,8 +294,7 @@ void alarm_cancel(alarm_t* alarm) {
 // Internal implementation of canceling an alarm.
 // The caller must hold the |alarms_mutex|
 static void alarm_cancel_internal(alarm_t* alarm) {
-  bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
+  bool needs_reschedule = (earliest_alarm() == alarm);
 
   remove_pending_alarm(alarm);
 
@@ -296,8 +334,11 @@ void alarm_cleanup(void) {
   semaphore_free(alarm_expired);
   alarm_expired = NULL;
 
-  list_free(alarms);
+  timing_wheel_free(alarms);
   alarms = NULL;
+
+  memset(&dispatch_latency, 0, sizeof(dispatch_latency));
+  memset(&callback_latency, 0, sizeof(callback_latency));
 }
 
 static bool lazy_initialize(void) {
@@ -310,9 +351,10 @@ static bool lazy_initialize(void) {
 
   std::lock_guard<std::mutex> lock(alarms_mutex);
 
-  alarms = list_new(NULL);
+  // The wheel catches up with the current time the first time it is used
+  alarms = timing_wheel_new(0);
   if (!alarms) {
-    LOG_ERROR("%s unable to allocate alarm list.", __func__);
+    LOG_ERROR("%s unable to allocate alarm wheel.", __func__);
     goto error;
   }
 
@@ -375,7 +417,7 @@ error:
 
   if (timer_initialized) timer_delete(timer);
 
-  list_free(alarms);
+  timing_wheel_free(alarms);
   alarms = NULL;
 
   return false;
@@ -393,10 +435,10 @@ static uint64_t now_ms(void) {
   return (ts.tv_sec * 1000LL) + (ts.tv_nsec / 1000000LL);
 }
 
-// Remove alarm from internal alarm list and the processing queue
+// Remove alarm from internal alarm wheel and the processing queue
 // The caller must hold the |alarms_mutex|
 static void remove_pending_alarm(alarm_t* alarm) {
-  list_remove(alarms, alarm);
+  timing_wheel_remove(alarms, &alarm->wheel_entry);
 
   if (alarm->for_msg_loop) {
     alarm->closure.i.Cancel();
@@ -409,12 +451,18 @@ static void remove_pending_alarm(alarm_t* alarm) {
   }
 }
 
+// Returns the pending alarm with the earliest deadline, or NULL if there is
+// none. Must be called with |alarms_mutex| held
+static alarm_t* earliest_alarm(void) {
+  timing_wheel_entry_t* entry = timing_wheel_front(alarms, now_ms());
+  return entry ? static_cast<alarm_t*>(entry->context) : NULL;
+}
+
 // Must be called with |alarms_mutex| held
 static void schedule_next_instance(alarm_t* alarm) {
-  // If the alarm is currently set and it's at the start of the list,
-  // we'll need to re-schedule since we've adjusted the earliest deadline.
-  bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
+  // If the alarm is currently set and it's the earliest one, we'll need to
+  // re-schedule since we've adjusted the earliest deadline.
+  bool needs_reschedule = (earliest_alarm() == alarm);
   if (alarm->callback) remove_pending_alarm(alarm);
 
   // Calculate the next deadline for this alarm
@@ -425,26 +473,12 @@ static void schedule_next_instance(alarm_t* alarm) {
         ((just_now_ms - alarm->creation_time_ms) % alarm->period_ms);
   alarm->deadline_ms = just_now_ms + (alarm->period_ms - ms_into_period);
 
-  // Add it into the timer list sorted by deadline (earliest deadline first).
-  if (list_is_empty(alarms) ||
-      ((alarm_t*)list_front(alarms))->deadline_ms > alarm->deadline_ms) {
-    list_prepend(alarms, alarm);
-  } else {
-    for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-         node = list_next(node)) {
-      list_node_t* next = list_next(node);
-      if (next == list_end(alarms) ||
-          ((alarm_t*)list_node(next))->deadline_ms > alarm->deadline_ms) {
-        list_insert_after(alarms, node, alarm);
-        break;
-      }
-    }
-  }
+  // Add it into the timer wheel, after the alarms with the same deadline.
+  timing_wheel_add(alarms, &alarm->wheel_entry, alarm->deadline_ms);
 
   // If the new alarm has the earliest deadline, we need to re-evaluate our
   // schedule.
-  if (needs_reschedule ||
-      (!list_is_empty(alarms) && list_front(alarms) == alarm)) {
+  if (needs_reschedule || earliest_alarm() == alarm) {
     reschedule_root_alarm();
   }
 }
@@ -461,9 +495,9 @@ static void reschedule_root_alarm(void) {
   struct itimerspec timer_time;
   memset(&timer_time, 0, sizeof(timer_time));
 
-  if (list_is_empty(alarms)) goto done;
+  next = earliest_alarm();
+  if (next == NULL) goto done;
 
-  next = static_cast<alarm_t*>(list_front(alarms));
   next_expiration = next->deadline_ms - now_ms();
   if (next_expiration < TIMER_INTERVAL_FOR_WAKELOCK_IN_MS) {
     if (!timer_set) {
@@ -580,10 +614,12 @@ static void alarm_ready_generic(alarm_t* alarm,
   // before the callback gets finished executing.
   std::shared_ptr<std::recursive_mutex> local_mutex_ref = alarm->callback_mutex;
   std::lock_guard<std::recursive_mutex> cb_lock(*local_mutex_ref);
+  uint64_t just_now_ms = now_ms();
+  update_latency_stats(&callback_latency, just_now_ms, deadline_ms);
   lock.unlock();
 
   // Update the statistics
-  update_scheduling_stats(&alarm->stats, now_ms(), deadline_ms);
+  update_scheduling_stats(&alarm->stats, just_now_ms, deadline_ms);
 
   // NOTE: Do NOT access "alarm" after the callback, as a safety precaution
   // in case the callback itself deleted the alarm.
@@ -618,19 +654,19 @@ static void callback_dispatch(UNUSED_ATTR void* context) {
     if (!dispatcher_thread_active) break;
 
     std::lock_guard<std::mutex> lock(alarms_mutex);
-    alarm_t* alarm;
 
     // Take into account that the alarm may get cancelled before we get to it.
-    // We're done here if there are no alarms or the alarm at the front is in
-    // the future. Exit right away since there's nothing left to do.
-    if (list_is_empty(alarms) ||
-        (alarm = static_cast<alarm_t*>(list_front(alarms)))->deadline_ms >
-            now_ms()) {
+    // We're done here if there are no alarms or the earliest alarm is in the
+    // future. Exit right away since there's nothing left to do.
+    alarm_t* alarm = earliest_alarm();
+    uint64_t just_now_ms = now_ms();
+    if (alarm == NULL || alarm->deadline_ms > just_now_ms) {
       reschedule_root_alarm();
       continue;
     }
 
-    list_remove(alarms, alarm);
+    timing_wheel_remove(alarms, &alarm->wheel_entry);
+    update_latency_stats(&dispatch_latency, just_now_ms, alarm->deadline_ms);
 
     if (alarm->is_periodic) {
       alarm->prev_deadline_ms = alarm->deadline_ms;
@@ -717,6 +753,34 @@ static void dump_stat(int fd, stat_t* stat, const char* description) {
           (unsigned long long)average_time_ms);
 }
 
+static void dump_latency_stats(int fd, latency_stats_t* stats,
+                               const char* name) {
+  char description[64];
+  snprintf(description, sizeof(description),
+           "  %s latency in ms (total/max/avg)", name);
+  dump_stat(fd, &stats->stat, description);
+
+  snprintf(description, sizeof(description),
+           "  %s latency histogram (ms)", name);
+  dprintf(fd, "%-51s:", description);
+  for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+    if (i < LATENCY_HISTOGRAM_BUCKETS - 1) {
+      dprintf(fd, " <%llu: %zu",
+              (unsigned long long)LATENCY_HISTOGRAM_LIMITS_MS[i],
+              stats->histogram[i]);
+    } else {
+      dprintf(fd, " >=%llu: %zu\n",
+              (unsigned long long)LATENCY_HISTOGRAM_LIMITS_MS[i - 1],
+              stats->histogram[i]);
+    }
+  }
+}
+
+static void collect_alarm(timing_wheel_entry_t* entry, void* context) {
+  static_cast<std::vector<alarm_t*>*>(context)->push_back(
+      static_cast<alarm_t*>(entry->context));
+}
+
 void alarm_debug_dump(int fd) {
   dprintf(fd, "\nBluetooth Alarms Statistics:\n");
 
@@ -729,12 +793,20 @@ void alarm_debug_dump(int fd) {
 
   uint64_t just_now_ms = now_ms();
 
-  dprintf(fd, "  Total Alarms: %zu\n\n", list_length(alarms));
-
-  // Dump info for each alarm
-  for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-       node = list_next(node)) {
-    alarm_t* alarm = (alarm_t*)list_node(node);
+  dprintf(fd, "  Total Alarms: %zu\n", timing_wheel_size(alarms));
+  dump_latency_stats(fd, &dispatch_latency, "Dispatch");
+  dump_latency_stats(fd, &callback_latency, "Callback");
+  dprintf(fd, "\n");
+
+  // Dump info for each alarm, earliest deadline first
+  std::vector<alarm_t*> pending;
+  pending.reserve(timing_wheel_size(alarms));
+  timing_wheel_foreach(alarms, collect_alarm, &pending);
+  std::stable_sort(pending.begin(), pending.end(),
+                   [](const alarm_t* a, const alarm_t* b) {
+                     return a->deadline_ms < b->deadline_ms;
+                   });
+  for (alarm_t* alarm : pending) {
     alarm_stats_t* stats = &alarm->stats;
 
     dprintf(fd, "  Alarm : %s (%s)\n", stats->name,
@@ -18,11 +18,295 @@
 #include "osi/include/allocator.h"
 
 #include <base/logging.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <atomic>
+#include <mutex>
+
 #include "check.h"
 
+// Most allocations of the legacy stack are BT_HDR packet buffers of a few
+// common sizes, allocated and freed at packet rate. Those are served from
+// per size class pools of blocks carved out of a single arena. Each thread
+// caches a few free blocks per size class so that most allocations do not
+// take the pool lock, and allocations fall back to malloc once their size
+// class is exhausted. osi_free() recognizes pooled blocks by their address.
+//
+// The pools are disabled under the address sanitizers, which must see every
+// allocation.
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(hwaddress_sanitizer)
+#define OSI_ALLOCATOR_POOLS_DISABLED
+#endif
+#endif
+#if defined(__SANITIZE_ADDRESS__)
+#define OSI_ALLOCATOR_POOLS_DISABLED
+#endif
+
+#ifndef OSI_ALLOCATOR_POOLS_DISABLED
+
+namespace {
+
+typedef struct {
+  size_t block_size;
+  size_t num_blocks;
+} size_class_t;
+
+// Block sizes are multiples of 16 to preserve the malloc alignment.
+constexpr size_class_t kSizeClasses[] = {
+    {128, 256},   // HCI events and signaling PDUs
+    {288, 256},   // LE ACL data, 251 bytes of payload
+    {672, 128},   // BT_SMALL_BUFFER_SIZE
+    {1056, 64},   // BR/EDR ACL data, 1021 bytes of payload
+    {4112, 32},   // BT_DEFAULT_BUFFER_SIZE
+};
+constexpr size_t kNumSizeClasses =
+    sizeof(kSizeClasses) / sizeof(kSizeClasses[0]);
+
+// A thread returns half of its cached blocks to the pool beyond this number
+constexpr size_t kThreadCacheSize = 16;
+
+typedef struct free_block_t {
+  struct free_block_t* next;
+} free_block_t;
+
+struct pool_t {
+  uint8_t* begin = nullptr;
+  uint8_t* end = nullptr;
+  size_t block_size = 0;
+
+  std::mutex mutex;
+  // Guarded by |mutex|. Blocks never allocated yet start at |uncarved| so
+  // that their pages are only touched when needed.
+  free_block_t* free_list = nullptr;
+  uint8_t* uncarved = nullptr;
+  // Blocks handed out to threads, in use or sitting in a thread cache
+  size_t taken = 0;
+  size_t high_water = 0;
+
+  std::atomic<uint64_t> misses = 0;
+  // Allocations and frees of threads that exited or run without a cache
+  std::atomic<uint64_t> retired_allocs = 0;
+  std::atomic<uint64_t> retired_frees = 0;
+};
+
+pool_t pools[kNumSizeClasses];
+std::once_flag pools_once;
+// Set once the arena is allocated
+std::atomic<uint8_t*> arena_begin = nullptr;
+uint8_t* arena_end = nullptr;
+
+// The per thread cache is trivially destructible so that it stays usable
+// while other thread local objects are destroyed. |thread_cache_cleanup|
+// hands the cached blocks back to the pools when the thread exits.
+//
+// Allocation counts are only written by the owning thread, without atomic
+// read-modify-write, and summed up over all threads when read.
+struct thread_cache_t {
+  free_block_t* head[kNumSizeClasses];
+  size_t count[kNumSizeClasses];
+  std::atomic<uint64_t> allocs[kNumSizeClasses];
+  std::atomic<uint64_t> frees[kNumSizeClasses];
+  // Guarded by |thread_caches_mutex|
+  thread_cache_t* prev;
+  thread_cache_t* next;
+  bool initialized;
+  bool disabled;
+};
+thread_local thread_cache_t thread_cache;
+
+std::mutex thread_caches_mutex;
+thread_cache_t* thread_caches = nullptr;
+
+void increment(std::atomic<uint64_t>* counter) {
+  counter->store(counter->load(std::memory_order_relaxed) + 1,
+                 std::memory_order_relaxed);
+}
+
+void pool_release_blocks(pool_t* pool, free_block_t* head, free_block_t* tail,
+                         size_t num_blocks) {
+  std::lock_guard<std::mutex> lock(pool->mutex);
+  tail->next = pool->free_list;
+  pool->free_list = head;
+  pool->taken -= num_blocks;
+}
+
+struct thread_cache_cleanup_t {
+  ~thread_cache_cleanup_t() {
+    std::lock_guard<std::mutex> lock(thread_caches_mutex);
+    for (size_t i = 0; i < kNumSizeClasses; i++) {
+      pools[i].retired_allocs.fetch_add(thread_cache.allocs[i],
+                                        std::memory_order_relaxed);
+      pools[i].retired_frees.fetch_add(thread_cache.frees[i],
+                                       std::memory_order_relaxed);
+      free_block_t* head = thread_cache.head[i];
+      if (head == nullptr) continue;
+      free_block_t* tail = head;
+      while (tail->next != nullptr) tail = tail->next;
+      pool_release_blocks(&pools[i], head, tail, thread_cache.count[i]);
+      thread_cache.head[i] = nullptr;
+      thread_cache.count[i] = 0;
+    }
+    if (thread_cache.prev != nullptr) {
+      thread_cache.prev->next = thread_cache.next;
+    } else {
+      thread_caches = thread_cache.next;
+    }
+    if (thread_cache.next != nullptr) {
+      thread_cache.next->prev = thread_cache.prev;
+    }
+    thread_cache.disabled = true;
+  }
+};
+thread_local thread_cache_cleanup_t thread_cache_cleanup;
+
+void pools_init() {
+  size_t arena_size = 0;
+  for (const auto& size_class : kSizeClasses) {
+    arena_size += size_class.block_size * size_class.num_blocks;
+  }
+  // Never freed, blocks may be released until the very end of the process
+  uint8_t* arena = static_cast<uint8_t*>(aligned_alloc(16, arena_size));
+  CHECK(arena);
+
+  uint8_t* next = arena;
+  for (size_t i = 0; i < kNumSizeClasses; i++) {
+    pools[i].block_size = kSizeClasses[i].block_size;
+    pools[i].begin = next;
+    pools[i].uncarved = next;
+    next += kSizeClasses[i].block_size * kSizeClasses[i].num_blocks;
+    pools[i].end = next;
+  }
+  arena_end = next;
+  arena_begin.store(arena, std::memory_order_release);
+}
+
+free_block_t* pool_take_block_locked(pool_t* pool) {
+  free_block_t* block = pool->free_list;
+  if (block != nullptr) {
+    pool->free_list = block->next;
+  } else if (pool->uncarved < pool->end) {
+    block = reinterpret_cast<free_block_t*>(pool->uncarved);
+    pool->uncarved += pool->block_size;
+  } else {
+    return nullptr;
+  }
+  pool->taken++;
+  if (pool->taken > pool->high_water) pool->high_water = pool->taken;
+  return block;
+}
+
+thread_cache_t* get_thread_cache() {
+  thread_cache_t* cache = &thread_cache;
+  if (!cache->initialized) {
+    cache->initialized = true;
+    // First use registers the cleanup on thread exit
+    (void)&thread_cache_cleanup;
+    std::lock_guard<std::mutex> lock(thread_caches_mutex);
+    cache->next = thread_caches;
+    if (thread_caches != nullptr) thread_caches->prev = cache;
+    thread_caches = cache;
+  }
+  return cache->disabled ? nullptr : cache;
+}
+
+void* pool_alloc(size_t size) {
+  size_t i = 0;
+  while (i < kNumSizeClasses && size > kSizeClasses[i].block_size) i++;
+  if (i == kNumSizeClasses) return nullptr;
+
+  pool_t* pool = &pools[i];
+  thread_cache_t* cache = get_thread_cache();
+  if (cache == nullptr) {
+    std::call_once(pools_once, pools_init);
+    free_block_t* block;
+    {
+      std::lock_guard<std::mutex> lock(pool->mutex);
+      block = pool_take_block_locked(pool);
+    }
+    if (block == nullptr) {
+      pool->misses.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    pool->retired_allocs.fetch_add(1, std::memory_order_relaxed);
+    return block;
+  }
+
+  if (cache->head[i] == nullptr) {
+    // Refill half of the cache at once
+    std::call_once(pools_once, pools_init);
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    while (cache->count[i] < kThreadCacheSize / 2) {
+      free_block_t* refill = pool_take_block_locked(pool);
+      if (refill == nullptr) break;
+      refill->next = cache->head[i];
+      cache->head[i] = refill;
+      cache->count[i]++;
+    }
+  }
+  free_block_t* block = cache->head[i];
+  if (block == nullptr) {
+    pool->misses.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  cache->head[i] = block->next;
+  cache->count[i]--;
+  increment(&cache->allocs[i]);
+  return block;
+}
+
+// Returns false if |ptr| was not allocated from the pools
+bool pool_free(void* ptr) {
+  uint8_t* p = static_cast<uint8_t*>(ptr);
+  uint8_t* begin = arena_begin.load(std::memory_order_acquire);
+  if (begin == nullptr || p < begin || p >= arena_end) return false;
+
+  size_t i = 0;
+  while (p >= pools[i].end) i++;
+  pool_t* pool = &pools[i];
+  CHECK((p - pool->begin) % pool->block_size == 0);
+
+  free_block_t* block = reinterpret_cast<free_block_t*>(p);
+  thread_cache_t* cache = get_thread_cache();
+  if (cache == nullptr) {
+    pool->retired_frees.fetch_add(1, std::memory_order_relaxed);
+    block->next = nullptr;
+    pool_release_blocks(pool, block, block, 1);
+    return true;
+  }
+
+  increment(&cache->frees[i]);
+  block->next = cache->head[i];
+  cache->head[i] = block;
+  cache->count[i]++;
+  if (cache->count[i] > kThreadCacheSize) {
+    // Keep the most recently freed half, they are likely still cached
+    free_block_t* tail = cache->head[i];
+    for (size_t n = 1; n < kThreadCacheSize / 2; n++) tail = tail->next;
+    free_block_t* released = tail->next;
+    tail->next = nullptr;
+    free_block_t* released_tail = released;
+    while (released_tail->next != nullptr) released_tail = released_tail->next;
+    pool_release_blocks(pool, released, released_tail,
+                        cache->count[i] - kThreadCacheSize / 2);
+    cache->count[i] = kThreadCacheSize / 2;
+  }
+  return true;
+}
+
+}  // namespace
+
+#else  // OSI_ALLOCATOR_POOLS_DISABLED
+
+namespace {
+void* pool_alloc(size_t /* size */) { return nullptr; }
+bool pool_free(void* /* ptr */) { return false; }
+}  // namespace
+
+#endif  // OSI_ALLOCATOR_POOLS_DISABLED
+
 char* osi_strdup(const char* str) {
   size_t size = strlen(str) + 1;  // + 1 for the null terminator
   char* new_string = (char*)malloc(size);
@@ -50,19 +334,29 @@ char* osi_strndup(const char* str, size_t len) {
 
 void* osi_malloc(size_t size) {
   CHECK(static_cast<ssize_t>(size) >= 0);
-  void* ptr = malloc(size);
+  void* ptr = pool_alloc(size);
+  if (ptr != nullptr) return ptr;
+  ptr = malloc(size);
   CHECK(ptr);
   return ptr;
 }
 
 void* osi_calloc(size_t size) {
   CHECK(static_cast<ssize_t>(size) >= 0);
-  void* ptr = calloc(1, size);
+  void* ptr = pool_alloc(size);
+  if (ptr != nullptr) {
+    memset(ptr, 0, size);
+    return ptr;
+  }
+  ptr = calloc(1, size);
   CHECK(ptr);
   return ptr;
 }
 
-void osi_free(void* ptr) { free(ptr); }
+void osi_free(void* ptr) {
+  if (ptr == nullptr || pool_free(ptr)) return;
+  free(ptr);
+}
 
 void osi_free_and_reset(void** p_ptr) {
   CHECK(p_ptr != NULL);
@@ -70,6 +364,60 @@ void osi_free_and_reset(void** p_ptr) {
   *p_ptr = NULL;
 }
 
+size_t osi_allocator_get_pool_stats(osi_allocator_pool_stats_t* stats,
+                                    size_t max_pools) {
+#ifndef OSI_ALLOCATOR_POOLS_DISABLED
+  std::lock_guard<std::mutex> lock(thread_caches_mutex);
+  for (size_t i = 0; i < kNumSizeClasses && i < max_pools; i++) {
+    pool_t* pool = &pools[i];
+    // Frees are summed up first so that in flight allocations can only make
+    // the number of blocks in use look larger
+    uint64_t frees = pool->retired_frees.load(std::memory_order_relaxed);
+    for (thread_cache_t* cache = thread_caches; cache != nullptr;
+         cache = cache->next) {
+      frees += cache->frees[i].load(std::memory_order_relaxed);
+    }
+    uint64_t allocs = pool->retired_allocs.load(std::memory_order_relaxed);
+    for (thread_cache_t* cache = thread_caches; cache != nullptr;
+         cache = cache->next) {
+      allocs += cache->allocs[i].load(std::memory_order_relaxed);
+    }
+
+    stats[i].block_size = kSizeClasses[i].block_size;
+    stats[i].num_blocks = kSizeClasses[i].num_blocks;
+    stats[i].hits = allocs;
+    stats[i].misses = pool->misses.load(std::memory_order_relaxed);
+    stats[i].in_use = allocs > frees ? allocs - frees : 0;
+    std::lock_guard<std::mutex> pool_lock(pool->mutex);
+    stats[i].high_water = pool->high_water;
+  }
+  return kNumSizeClasses;
+#else
+  return 0;
+#endif
+}
+
+void osi_allocator_debug_dump(int fd) {
+  dprintf(fd, "\nBluetooth Buffer Pools:\n");
+
+  osi_allocator_pool_stats_t stats[8];
+  size_t num_pools = osi_allocator_get_pool_stats(stats, 8);
+  if (num_pools == 0) {
+    dprintf(fd, "  Disabled\n");
+    return;
+  }
+
+  for (size_t i = 0; i < num_pools; i++) {
+    dprintf(fd, "  Pool : %zu bytes x %zu blocks\n", stats[i].block_size,
+            stats[i].num_blocks);
+    dprintf(fd, "%-51s: %llu / %llu\n", "    Allocation counts (hit/miss)",
+            (unsigned long long)stats[i].hits,
+            (unsigned long long)stats[i].misses);
+    dprintf(fd, "%-51s: %zu / %zu\n", "    Blocks (in use/high water)",
+            stats[i].in_use, stats[i].high_water);
+  }
+}
+
 const allocator_t allocator_calloc = {osi_calloc, osi_free};
 
 const allocator_t allocator_malloc = {osi_malloc, osi_free};
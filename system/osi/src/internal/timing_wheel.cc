@@ -0,0 +1,258 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "bt_osi_timing_wheel"
+
+#include "osi/timing_wheel.h"
+
+#include "check.h"
+#include "osi/include/allocator.h"
+
+namespace {
+
+constexpr int kBitsPerLevel = 6;
+constexpr int kSlotsPerLevel = 1 << kBitsPerLevel;
+// Enough levels for any uint64_t deadline, the last one partly used
+constexpr int kLevels = (64 + kBitsPerLevel - 1) / kBitsPerLevel;
+
+static_assert(kSlotsPerLevel == 64, "Slot occupancy is a uint64_t bitmap");
+
+}  // namespace
+
+struct timing_wheel_t {
+  // Current time of the wheel, never later than the earliest deadline
+  uint64_t now_ms;
+  size_t size;
+  // Bit |n| is set if level |n| has entries
+  uint32_t occupied_levels;
+  // Bit |n| of |occupied_slots[l]| is set if |slots[l][n]| has entries
+  uint64_t occupied_slots[kLevels];
+  // Circular lists of the entries of each slot, in the order they were added
+  timing_wheel_entry_t* slots[kLevels][kSlotsPerLevel];
+  // The entry with the earliest deadline, NULL when it must be looked up
+  timing_wheel_entry_t* front;
+};
+
+static int digit(uint64_t time_ms, int level) {
+  return (time_ms >> (kBitsPerLevel * level)) & (kSlotsPerLevel - 1);
+}
+
+// Returns the first millisecond of |slot| of |level| from |now_ms|
+static uint64_t slot_start(uint64_t now_ms, int level, int slot) {
+  int shift = kBitsPerLevel * (level + 1);
+  uint64_t higher_digits = shift >= 64 ? 0 : (now_ms >> shift) << shift;
+  return higher_digits | (uint64_t)slot << (kBitsPerLevel * level);
+}
+
+// Appends |entry| to the slot of its deadline
+static void link_entry(timing_wheel_t* wheel, timing_wheel_entry_t* entry) {
+  int level = 0;
+  int slot = digit(wheel->now_ms, 0);
+  if (entry->deadline_ms > wheel->now_ms) {
+    int highest_bit = 63 - __builtin_clzll(entry->deadline_ms ^ wheel->now_ms);
+    level = highest_bit / kBitsPerLevel;
+    slot = digit(entry->deadline_ms, level);
+  }
+  entry->level = level;
+  entry->slot = slot;
+
+  timing_wheel_entry_t*& head = wheel->slots[level][slot];
+  if (head == NULL) {
+    entry->prev = entry;
+    entry->next = entry;
+    head = entry;
+    wheel->occupied_slots[level] |= 1ULL << slot;
+    wheel->occupied_levels |= 1U << level;
+  } else {
+    entry->prev = head->prev;
+    entry->next = head;
+    head->prev->next = entry;
+    head->prev = entry;
+  }
+}
+
+static void unlink_entry(timing_wheel_t* wheel, timing_wheel_entry_t* entry) {
+  timing_wheel_entry_t*& head = wheel->slots[entry->level][entry->slot];
+  if (entry->next == entry) {
+    head = NULL;
+    wheel->occupied_slots[entry->level] &= ~(1ULL << entry->slot);
+    if (wheel->occupied_slots[entry->level] == 0) {
+      wheel->occupied_levels &= ~(1U << entry->level);
+    }
+  } else {
+    entry->prev->next = entry->next;
+    entry->next->prev = entry->prev;
+    if (head == entry) head = entry->next;
+  }
+  entry->prev = NULL;
+  entry->next = NULL;
+}
+
+// The earliest entries are in the first occupied slot of the lowest occupied
+// level: lower levels hold deadlines that share more digits with the current
+// time of the wheel.
+static bool first_occupied_slot(const timing_wheel_t* wheel, int* level,
+                                int* slot) {
+  if (wheel->occupied_levels == 0) return false;
+  *level = __builtin_ctz(wheel->occupied_levels);
+  *slot = __builtin_ctzll(wheel->occupied_slots[*level]);
+  return true;
+}
+
+// Moves the current time of the wheel towards |now_ms|, without passing the
+// earliest deadline. The entries of each slot reached are spread over the
+// levels below, in order, so that they are never scanned more than once per
+// level.
+static void advance(timing_wheel_t* wheel, uint64_t now_ms) {
+  int level, slot;
+  while (first_occupied_slot(wheel, &level, &slot)) {
+    uint64_t start = slot_start(wheel->now_ms, level, slot);
+    if (level == 0 || start > now_ms) {
+      uint64_t target = start < now_ms ? start : now_ms;
+      if (target > wheel->now_ms) wheel->now_ms = target;
+      return;
+    }
+
+    wheel->now_ms = start;
+    timing_wheel_entry_t* head = wheel->slots[level][slot];
+    wheel->slots[level][slot] = NULL;
+    wheel->occupied_slots[level] &= ~(1ULL << slot);
+    if (wheel->occupied_slots[level] == 0) {
+      wheel->occupied_levels &= ~(1U << level);
+    }
+
+    timing_wheel_entry_t* entry = head;
+    do {
+      timing_wheel_entry_t* next = entry->next;
+      link_entry(wheel, entry);
+      entry = next;
+    } while (entry != head);
+  }
+
+  if (now_ms > wheel->now_ms) wheel->now_ms = now_ms;
+}
+
+timing_wheel_t* timing_wheel_new(uint64_t now_ms) {
+  timing_wheel_t* wheel =
+      static_cast<timing_wheel_t*>(osi_calloc(sizeof(timing_wheel_t)));
+  wheel->now_ms = now_ms;
+  return wheel;
+}
+
+void timing_wheel_free(timing_wheel_t* wheel) {
+  if (!wheel) return;
+
+  int level, slot;
+  while (first_occupied_slot(wheel, &level, &slot)) {
+    unlink_entry(wheel, wheel->slots[level][slot]);
+  }
+  osi_free(wheel);
+}
+
+void timing_wheel_entry_init(timing_wheel_entry_t* entry, void* context) {
+  CHECK(entry != NULL);
+
+  entry->prev = NULL;
+  entry->next = NULL;
+  entry->deadline_ms = 0;
+  entry->level = 0;
+  entry->slot = 0;
+  entry->context = context;
+}
+
+bool timing_wheel_entry_is_linked(const timing_wheel_entry_t* entry) {
+  CHECK(entry != NULL);
+  return entry->prev != NULL;
+}
+
+void timing_wheel_add(timing_wheel_t* wheel, timing_wheel_entry_t* entry,
+                      uint64_t deadline_ms) {
+  CHECK(wheel != NULL);
+  CHECK(entry != NULL);
+
+  timing_wheel_remove(wheel, entry);
+
+  entry->deadline_ms = deadline_ms;
+  link_entry(wheel, entry);
+  wheel->size++;
+
+  if (wheel->front != NULL && deadline_ms < wheel->front->deadline_ms) {
+    wheel->front = entry;
+  }
+}
+
+void timing_wheel_remove(timing_wheel_t* wheel, timing_wheel_entry_t* entry) {
+  CHECK(wheel != NULL);
+  CHECK(entry != NULL);
+
+  if (!timing_wheel_entry_is_linked(entry)) return;
+
+  unlink_entry(wheel, entry);
+  wheel->size--;
+
+  if (wheel->front == entry) wheel->front = NULL;
+}
+
+size_t timing_wheel_size(const timing_wheel_t* wheel) {
+  CHECK(wheel != NULL);
+  return wheel->size;
+}
+
+bool timing_wheel_is_empty(const timing_wheel_t* wheel) {
+  CHECK(wheel != NULL);
+  return wheel->size == 0;
+}
+
+timing_wheel_entry_t* timing_wheel_front(timing_wheel_t* wheel,
+                                         uint64_t now_ms) {
+  CHECK(wheel != NULL);
+
+  advance(wheel, now_ms);
+  if (wheel->front != NULL) return wheel->front;
+
+  int level, slot;
+  if (!first_occupied_slot(wheel, &level, &slot)) return NULL;
+
+  // A slot of level 0 holds a single deadline, slots of the levels above
+  // hold a range that has not been reached yet.
+  timing_wheel_entry_t* head = wheel->slots[level][slot];
+  timing_wheel_entry_t* front = head;
+  for (timing_wheel_entry_t* entry = head->next; entry != head;
+       entry = entry->next) {
+    if (entry->deadline_ms < front->deadline_ms) front = entry;
+  }
+  wheel->front = front;
+  return front;
+}
+
+void timing_wheel_foreach(const timing_wheel_t* wheel,
+                          timing_wheel_iter_cb callback, void* context) {
+  CHECK(wheel != NULL);
+  CHECK(callback != NULL);
+
+  for (int level = 0; level < kLevels; level++) {
+    for (int slot = 0; slot < kSlotsPerLevel; slot++) {
+      timing_wheel_entry_t* head = wheel->slots[level][slot];
+      if (head == NULL) continue;
+      timing_wheel_entry_t* entry = head;
+      do {
+        timing_wheel_entry_t* next = entry->next;
+        callback(entry, context);
+        entry = next;
+      } while (entry != head);
+    }
+  }
+}
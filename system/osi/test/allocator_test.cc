@@ -20,6 +20,8 @@
 #include <gtest/gtest.h>
 
 #include <cstring>
+#include <thread>
+#include <vector>
 
 class AllocatorTest : public ::testing::Test {};
 
@@ -48,3 +50,112 @@ TEST_F(AllocatorTest, test_osi_strndup) {
   EXPECT_EQ(0, strcmp(str, copy_str));
   osi_free(copy_str);
 }
+
+namespace {
+constexpr size_t kMaxPools = 8;
+
+// Returns the stats of the pool serving |size|, or false if no pool does
+bool get_pool_stats_for_size(size_t size, osi_allocator_pool_stats_t* stats) {
+  osi_allocator_pool_stats_t all_stats[kMaxPools];
+  size_t num_pools = osi_allocator_get_pool_stats(all_stats, kMaxPools);
+  for (size_t i = 0; i < num_pools; i++) {
+    if (size <= all_stats[i].block_size) {
+      *stats = all_stats[i];
+      return true;
+    }
+  }
+  return false;
+}
+}  // namespace
+
+TEST_F(AllocatorTest, test_osi_malloc_reuses_pooled_block) {
+  osi_allocator_pool_stats_t stats;
+  if (!get_pool_stats_for_size(100, &stats)) {
+    GTEST_SKIP() << "Buffer pools are disabled";
+  }
+
+  void* ptr = osi_malloc(100);
+  osi_free(ptr);
+  // The thread cache hands out the most recently freed block first
+  void* reused = osi_malloc(100);
+  EXPECT_EQ(ptr, reused);
+  osi_free(reused);
+}
+
+TEST_F(AllocatorTest, test_osi_calloc_pooled_block_is_zeroed) {
+  uint8_t* ptr = static_cast<uint8_t*>(osi_malloc(200));
+  memset(ptr, 0xa5, 200);
+  osi_free(ptr);
+
+  ptr = static_cast<uint8_t*>(osi_calloc(200));
+  for (size_t i = 0; i < 200; i++) {
+    EXPECT_EQ(0, ptr[i]);
+  }
+  osi_free(ptr);
+}
+
+TEST_F(AllocatorTest, test_osi_malloc_pool_stats) {
+  osi_allocator_pool_stats_t before;
+  if (!get_pool_stats_for_size(600, &before)) {
+    GTEST_SKIP() << "Buffer pools are disabled";
+  }
+
+  void* first = osi_malloc(600);
+  void* second = osi_malloc(600);
+  osi_allocator_pool_stats_t during;
+  ASSERT_TRUE(get_pool_stats_for_size(600, &during));
+  EXPECT_EQ(before.hits + 2, during.hits);
+  EXPECT_EQ(before.in_use + 2, during.in_use);
+  EXPECT_LE(during.in_use, during.high_water);
+
+  osi_free(first);
+  osi_free(second);
+  osi_allocator_pool_stats_t after;
+  ASSERT_TRUE(get_pool_stats_for_size(600, &after));
+  EXPECT_EQ(before.in_use, after.in_use);
+}
+
+TEST_F(AllocatorTest, test_osi_malloc_falls_back_to_malloc) {
+  // Larger than any size class
+  const size_t size = 64 * 1024;
+  osi_allocator_pool_stats_t stats[kMaxPools];
+  size_t num_pools = osi_allocator_get_pool_stats(stats, kMaxPools);
+  for (size_t i = 0; i < num_pools; i++) {
+    ASSERT_LT(stats[i].block_size, size);
+  }
+
+  uint8_t* ptr = static_cast<uint8_t*>(osi_malloc(size));
+  ASSERT_NE(nullptr, ptr);
+  memset(ptr, 0x5a, size);
+  osi_free(ptr);
+}
+
+TEST_F(AllocatorTest, test_osi_malloc_pool_exhausted) {
+  osi_allocator_pool_stats_t before;
+  if (!get_pool_stats_for_size(4000, &before)) {
+    GTEST_SKIP() << "Buffer pools are disabled";
+  }
+
+  std::vector<void*> ptrs;
+  for (size_t i = 0; i < before.num_blocks + 4; i++) {
+    ptrs.push_back(osi_malloc(4000));
+    ASSERT_NE(nullptr, ptrs.back());
+  }
+  osi_allocator_pool_stats_t during;
+  ASSERT_TRUE(get_pool_stats_for_size(4000, &during));
+  EXPECT_EQ(during.num_blocks, during.high_water);
+  EXPECT_LE(before.misses + 4, during.misses);
+
+  for (void* ptr : ptrs) {
+    osi_free(ptr);
+  }
+  osi_allocator_pool_stats_t after;
+  ASSERT_TRUE(get_pool_stats_for_size(4000, &after));
+  EXPECT_EQ(before.in_use, after.in_use);
+}
+
+TEST_F(AllocatorTest, test_osi_free_from_other_thread) {
+  void* ptr = osi_malloc(100);
+  std::thread([ptr]() { osi_free(ptr); }).join();
+  std::thread([]() { osi_free(osi_malloc(100)); }).join();
+}
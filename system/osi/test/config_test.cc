@@ -245,6 +245,66 @@ TEST_F(ConfigTest, config_save_basic) {
   EXPECT_TRUE(config_save(*config, CONFIG_FILE));
 }
 
+TEST_F(ConfigTest, config_save_keeps_insertion_order) {
+  std::unique_ptr<config_t> config = config_new_empty();
+  config_set_string(config.get(), "b", "y", "1");
+  config_set_string(config.get(), "a", "z", "2");
+  config_set_string(config.get(), "b", "x", "3");
+  config_set_string(config.get(), "c", "w", "4");
+  EXPECT_TRUE(config_remove_section(config.get(), "a"));
+  config_set_string(config.get(), "a", "v", "5");
+  config_set_string(config.get(), "b", "y", "6");
+  EXPECT_TRUE(config_save(*config, CONFIG_FILE));
+
+  std::string content;
+  EXPECT_TRUE(base::ReadFileToString(base::FilePath(CONFIG_FILE), &content));
+  EXPECT_EQ(content,
+            "[b]\ny = 6\nx = 3\n\n[c]\nw = 4\n\n[a]\nv = 5\n\n");
+}
+
+TEST_F(ConfigTest, config_index_follows_direct_list_changes) {
+  config_t config;
+  config.sections.push_back(section_t{.name = "dup"});
+  config.sections.push_back(section_t{.name = "other"});
+  config.sections.push_back(section_t{.name = "dup"});
+  config.sections.back().Set("key", "second");
+
+  // The first of the sections with the same name is found, as before
+  auto first = config.Find("dup");
+  ASSERT_EQ(first, config.sections.begin());
+  EXPECT_FALSE(first->Has("key"));
+
+  config.sections.erase(first);
+  auto second = config.Find("dup");
+  ASSERT_NE(second, config.sections.end());
+  EXPECT_EQ(*config_get_string(config, "dup", "key", nullptr), "second");
+
+  config.sections.erase(second);
+  EXPECT_FALSE(config.Has("dup"));
+  EXPECT_TRUE(config.Has("other"));
+
+  config_t copy = config;
+  config.sections.clear();
+  EXPECT_FALSE(config.Has("other"));
+  EXPECT_TRUE(copy.Has("other"));
+  EXPECT_EQ(copy.Find("other"), copy.sections.begin());
+}
+
+TEST_F(ConfigTest, section_index_follows_sort) {
+  section_t section = {.name = "section",
+                       .entries = {entry_t{.key = "b", .value = "1"},
+                                   entry_t{.key = "a", .value = "2"},
+                                   entry_t{.key = "a", .value = "3"}}};
+  EXPECT_EQ(section.Find("a")->value, "2");
+  section.entries.sort([](const entry_t& first, const entry_t& second) {
+    return first.value > second.value;
+  });
+  EXPECT_EQ(section.Find("a")->value, "3");
+  section.entries.pop_front();
+  EXPECT_EQ(section.Find("a")->value, "2");
+  EXPECT_EQ(section.Find("b")->value, "1");
+}
+
 TEST_F(ConfigTest, checksum_read) {
   auto tmp_dir = std::filesystem::temp_directory_path();
   auto filename = tmp_dir / "test.checksum";
@@ -0,0 +1,226 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "osi/timing_wheel.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr uint64_t kStartMs = 1234567;
+constexpr int kNumEntries = 2000;
+
+class TimingWheelTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    wheel_ = timing_wheel_new(kStartMs);
+    ASSERT_TRUE(wheel_ != NULL);
+    // Entries must outlive the wheel, which unlinks them when freed
+    entries_.resize(kNumEntries);
+    for (int i = 0; i < kNumEntries; i++) {
+      timing_wheel_entry_init(&entries_[i], reinterpret_cast<void*>(i));
+    }
+  }
+
+  void TearDown() override { timing_wheel_free(wheel_); }
+
+  // Removes the front entry once |now_ms| reaches its deadline
+  timing_wheel_entry_t* Pop(uint64_t* now_ms) {
+    timing_wheel_entry_t* front = timing_wheel_front(wheel_, *now_ms);
+    if (front == NULL) return NULL;
+    *now_ms = std::max(*now_ms, front->deadline_ms);
+    EXPECT_EQ(front, timing_wheel_front(wheel_, *now_ms));
+    timing_wheel_remove(wheel_, front);
+    return front;
+  }
+
+  timing_wheel_t* wheel_;
+  std::vector<timing_wheel_entry_t> entries_;
+};
+
+TEST_F(TimingWheelTest, test_new_empty) {
+  EXPECT_TRUE(timing_wheel_is_empty(wheel_));
+  EXPECT_EQ(timing_wheel_size(wheel_), 0u);
+  EXPECT_EQ(timing_wheel_front(wheel_, kStartMs), nullptr);
+}
+
+TEST_F(TimingWheelTest, test_free_null) { timing_wheel_free(NULL); }
+
+TEST_F(TimingWheelTest, test_add_remove) {
+  timing_wheel_entry_t entry;
+  int context;
+  timing_wheel_entry_init(&entry, &context);
+  EXPECT_FALSE(timing_wheel_entry_is_linked(&entry));
+  EXPECT_EQ(entry.context, &context);
+
+  timing_wheel_add(wheel_, &entry, kStartMs + 5000);
+  EXPECT_TRUE(timing_wheel_entry_is_linked(&entry));
+  EXPECT_EQ(timing_wheel_size(wheel_), 1u);
+  EXPECT_EQ(timing_wheel_front(wheel_, kStartMs), &entry);
+
+  timing_wheel_remove(wheel_, &entry);
+  EXPECT_FALSE(timing_wheel_entry_is_linked(&entry));
+  EXPECT_TRUE(timing_wheel_is_empty(wheel_));
+  EXPECT_EQ(timing_wheel_front(wheel_, kStartMs), nullptr);
+
+  // Removing again is a no-op
+  timing_wheel_remove(wheel_, &entry);
+  EXPECT_TRUE(timing_wheel_is_empty(wheel_));
+}
+
+TEST_F(TimingWheelTest, test_readd_moves_entry) {
+  timing_wheel_entry_t& early = entries_[0];
+  timing_wheel_entry_t& late = entries_[1];
+
+  timing_wheel_add(wheel_, &early, kStartMs + 10);
+  timing_wheel_add(wheel_, &late, kStartMs + 100000);
+  EXPECT_EQ(timing_wheel_front(wheel_, kStartMs), &early);
+
+  // As a periodic alarm does when it fires
+  uint64_t now_ms = kStartMs + 10;
+  EXPECT_EQ(timing_wheel_front(wheel_, now_ms), &early);
+  timing_wheel_add(wheel_, &early, now_ms + 200000);
+  EXPECT_EQ(timing_wheel_size(wheel_), 2u);
+  EXPECT_EQ(timing_wheel_front(wheel_, now_ms), &late);
+  EXPECT_EQ(Pop(&now_ms), &late);
+  EXPECT_EQ(Pop(&now_ms), &early);
+  EXPECT_EQ(now_ms, kStartMs + 200010);
+}
+
+TEST_F(TimingWheelTest, test_same_deadline_in_order_added) {
+  constexpr uint64_t kDeadlineMs = kStartMs + 3 * 3600 * 1000;
+  timing_wheel_entry_t* entries = entries_.data();
+
+  // Added from further and further away, so that each one starts on a lower
+  // level than the previous ones
+  uint64_t now_ms = kStartMs;
+  timing_wheel_add(wheel_, &entries[0], kDeadlineMs);
+  now_ms = kDeadlineMs - 100000;
+  EXPECT_EQ(timing_wheel_front(wheel_, now_ms), &entries[0]);
+  timing_wheel_add(wheel_, &entries[1], kDeadlineMs);
+  now_ms = kDeadlineMs - 1000;
+  EXPECT_EQ(timing_wheel_front(wheel_, now_ms), &entries[0]);
+  timing_wheel_add(wheel_, &entries[2], kDeadlineMs);
+  now_ms = kDeadlineMs - 1;
+  EXPECT_EQ(timing_wheel_front(wheel_, now_ms), &entries[0]);
+  timing_wheel_add(wheel_, &entries[3], kDeadlineMs);
+
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(Pop(&now_ms), &entries[i]);
+  }
+  EXPECT_EQ(now_ms, kDeadlineMs);
+}
+
+TEST_F(TimingWheelTest, test_deadline_in_the_past) {
+  timing_wheel_entry_t& entry = entries_[0];
+  timing_wheel_entry_t& late = entries_[1];
+  timing_wheel_add(wheel_, &late, kStartMs + 1);
+  timing_wheel_add(wheel_, &entry, kStartMs - 1000);
+  EXPECT_EQ(timing_wheel_front(wheel_, kStartMs), &entry);
+}
+
+TEST_F(TimingWheelTest, test_far_deadlines) {
+  timing_wheel_entry_t* entries = entries_.data();
+  timing_wheel_add(wheel_, &entries[2], UINT64_MAX);
+  timing_wheel_add(wheel_, &entries[1], UINT64_MAX - 1);
+  timing_wheel_add(wheel_, &entries[0], UINT64_C(1) << 62);
+
+  uint64_t now_ms = kStartMs;
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(Pop(&now_ms), &entries[i]);
+  }
+  EXPECT_EQ(now_ms, UINT64_MAX);
+}
+
+TEST_F(TimingWheelTest, test_foreach) {
+  for (uint64_t i = 0; i < 100; i++) {
+    timing_wheel_add(wheel_, &entries_[i], kStartMs + i * i * i);
+  }
+
+  std::set<timing_wheel_entry_t*> visited;
+  timing_wheel_foreach(
+      wheel_,
+      [](timing_wheel_entry_t* entry, void* context) {
+        static_cast<std::set<timing_wheel_entry_t*>*>(context)->insert(entry);
+      },
+      &visited);
+  EXPECT_EQ(visited.size(), 100u);
+}
+
+TEST_F(TimingWheelTest, test_free_unlinks_entries) {
+  timing_wheel_entry_t entry;
+  timing_wheel_entry_init(&entry, NULL);
+  timing_wheel_t* wheel = timing_wheel_new(kStartMs);
+  timing_wheel_add(wheel, &entry, kStartMs + 70000);
+  timing_wheel_free(wheel);
+  EXPECT_FALSE(timing_wheel_entry_is_linked(&entry));
+}
+
+// Adds, moves, removes and pops entries at random, and checks that they come
+// out in the same order as from a set sorted by deadline, then by the order
+// in which they were added.
+TEST_F(TimingWheelTest, test_random_operations) {
+  std::mt19937_64 rng(42);
+  // From a millisecond to a few days
+  std::uniform_int_distribution<int> log_delay(0, 28);
+  std::uniform_int_distribution<int> pick(0, kNumEntries - 1);
+  std::uniform_int_distribution<int> operation(0, 9);
+
+  std::vector<uint64_t> added_at(kNumEntries);
+  std::set<std::pair<std::pair<uint64_t, uint64_t>, int>> expected;
+
+  uint64_t now_ms = kStartMs;
+  uint64_t sequence = 0;
+  for (int step = 0; step < 200000; step++) {
+    int i = pick(rng);
+    int op = operation(rng);
+    if (op < 5) {
+      if (timing_wheel_entry_is_linked(&entries_[i])) {
+        expected.erase({{entries_[i].deadline_ms, added_at[i]}, i});
+      }
+      uint64_t delay = rng() & ((UINT64_C(1) << log_delay(rng)) - 1);
+      timing_wheel_add(wheel_, &entries_[i], now_ms + delay);
+      added_at[i] = sequence++;
+      expected.insert({{now_ms + delay, added_at[i]}, i});
+    } else if (op < 7) {
+      if (timing_wheel_entry_is_linked(&entries_[i])) {
+        expected.erase({{entries_[i].deadline_ms, added_at[i]}, i});
+      }
+      timing_wheel_remove(wheel_, &entries_[i]);
+    } else {
+      timing_wheel_entry_t* front = Pop(&now_ms);
+      if (expected.empty()) {
+        ASSERT_EQ(front, nullptr);
+        continue;
+      }
+      ASSERT_NE(front, nullptr);
+      int expected_index = expected.begin()->second;
+      ASSERT_EQ(reinterpret_cast<intptr_t>(front->context), expected_index)
+          << "at step " << step;
+      expected.erase(expected.begin());
+    }
+    ASSERT_EQ(timing_wheel_size(wheel_), expected.size());
+  }
+}
+
+}  // namespace
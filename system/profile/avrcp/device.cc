@@ -1150,12 +1150,30 @@ void Device::HandleGetFolderItems(uint8_t label,
                      weak_ptr_factory_.GetWeakPtr(), label, pkt));
       break;
     case Scope::VFS:
+      if (pkt->GetStartItem() > 0 && vfs_listing_.valid &&
+          vfs_listing_.player_id == curr_browsed_player_id_ &&
+          vfs_listing_.folder_id == CurrentFolder()) {
+        log::verbose("Serving folder items from the last listing");
+        SendVFSList(label, *pkt, vfs_listing_.items);
+        break;
+      }
+      vfs_listing_.Invalidate();
+      vfs_listing_.pending = true;
+      vfs_listing_.player_id = curr_browsed_player_id_;
+      vfs_listing_.folder_id = CurrentFolder();
       media_interface_->GetFolderItems(
           curr_browsed_player_id_, CurrentFolder(),
           base::Bind(&Device::GetVFSListResponse,
                      weak_ptr_factory_.GetWeakPtr(), label, pkt));
       break;
     case Scope::NOW_PLAYING:
+      if (pkt->GetStartItem() > 0 && now_playing_listing_.valid) {
+        log::verbose("Serving now playing items from the last listing");
+        SendNowPlayingList(label, *pkt, now_playing_listing_.items);
+        break;
+      }
+      now_playing_listing_.Invalidate();
+      now_playing_listing_.pending = true;
       media_interface_->GetNowPlayingList(
           base::Bind(&Device::GetNowPlayingListResponse,
                      weak_ptr_factory_.GetWeakPtr(), label, pkt));
@@ -1509,10 +1527,6 @@ void Device::GetVFSListResponse(uint8_t label,
   log::verbose("start_item={} end_item={}", pkt->GetStartItem(),
                pkt->GetEndItem());
 
-  // The builder will automatically correct the status if there are zero items
-  auto builder = GetFolderItemsResponseBuilder::MakeVFSBuilder(
-      Status::NO_ERROR, 0x0000, browse_mtu_);
-
   // TODO (apanicke): Add test that checks if vfs_ids_ is the correct size after
   // an operation.
   for (const auto& item : items) {
@@ -1523,12 +1537,31 @@ void Device::GetVFSListResponse(uint8_t label,
     }
   }
 
+  SendVFSList(label, *pkt, items);
+
+  // Keep the items for the following pages unless the folder changed, or the
+  // listing was invalidated, while they were being fetched.
+  if (vfs_listing_.pending &&
+      vfs_listing_.player_id == curr_browsed_player_id_ &&
+      vfs_listing_.folder_id == CurrentFolder()) {
+    vfs_listing_.valid = true;
+    vfs_listing_.pending = false;
+    vfs_listing_.items = std::move(items);
+  }
+}
+
+void Device::SendVFSList(uint8_t label, const GetFolderItemsRequest& pkt,
+                         const std::vector<ListItem>& items) {
+  // The builder will automatically correct the status if there are zero items
+  auto builder = GetFolderItemsResponseBuilder::MakeVFSBuilder(
+      Status::NO_ERROR, 0x0000, browse_mtu_);
+
   // Add the elements retrieved in the last get folder items request and map
   // them to UIDs The maps will be cleared every time a directory change
   // happens. These items do not need to correspond with the now playing list as
   // the UID's only need to be unique in the context of the current scope and
   // the current folder
-  for (auto i = pkt->GetStartItem(); i <= pkt->GetEndItem() && i < items.size();
+  for (auto i = pkt.GetStartItem(); i <= pkt.GetEndItem() && i < items.size();
        i++) {
     if (items[i].type == ListItem::FOLDER) {
       auto folder = items[i].folder;
@@ -1551,11 +1584,11 @@ void Device::GetVFSListResponse(uint8_t label,
       MediaElementItem song_item(vfs_ids_.get_uid(song.media_id), title,
                                  std::set<AttributeEntry>());
 
-      if (pkt->GetNumAttributes() == 0x00) {  // All attributes requested
+      if (pkt.GetNumAttributes() == 0x00) {  // All attributes requested
         song_item.attributes_ = std::move(song.attributes);
       } else {
         song_item.attributes_ =
-            filter_attributes_requested(song, pkt->GetAttributesRequested());
+            filter_attributes_requested(song, pkt.GetAttributesRequested());
       }
 
       // If we fail to add a song, don't accidentally add one later that might
@@ -1571,16 +1604,28 @@ void Device::GetNowPlayingListResponse(
     uint8_t label, std::shared_ptr<GetFolderItemsRequest> pkt,
     std::string /* unused curr_song_id */, std::vector<SongInfo> song_list) {
   log::verbose("");
-  auto builder = GetFolderItemsResponseBuilder::MakeNowPlayingBuilder(
-      Status::NO_ERROR, 0x0000, browse_mtu_);
 
   now_playing_ids_.clear();
   for (const SongInfo& song : song_list) {
     now_playing_ids_.insert(song.media_id);
   }
 
-  for (size_t i = pkt->GetStartItem();
-       i <= pkt->GetEndItem() && i < song_list.size(); i++) {
+  SendNowPlayingList(label, *pkt, song_list);
+
+  if (now_playing_listing_.pending) {
+    now_playing_listing_.valid = true;
+    now_playing_listing_.pending = false;
+    now_playing_listing_.items = std::move(song_list);
+  }
+}
+
+void Device::SendNowPlayingList(uint8_t label, const GetFolderItemsRequest& pkt,
+                                const std::vector<SongInfo>& song_list) {
+  auto builder = GetFolderItemsResponseBuilder::MakeNowPlayingBuilder(
+      Status::NO_ERROR, 0x0000, browse_mtu_);
+
+  for (size_t i = pkt.GetStartItem();
+       i <= pkt.GetEndItem() && i < song_list.size(); i++) {
     auto song = song_list[i];
 
     // Filter out DEFAULT_COVER_ART handle if this device has no client
@@ -1593,11 +1638,11 @@ void Device::GetNowPlayingListResponse(
                      : "No Song Info";
 
     MediaElementItem item(i + 1, title, std::set<AttributeEntry>());
-    if (pkt->GetNumAttributes() == 0x00) {
+    if (pkt.GetNumAttributes() == 0x00) {
       item.attributes_ = std::move(song.attributes);
     } else {
       item.attributes_ =
-          filter_attributes_requested(song, pkt->GetAttributesRequested());
+          filter_attributes_requested(song, pkt.GetAttributesRequested());
     }
 
     // If we fail to add a song, don't accidentally add one later that might
@@ -1684,11 +1729,18 @@ void Device::SendFolderUpdate(bool available_players, bool addressed_player,
   CHECK(media_interface_);
   log::verbose("");
 
+  // The media IDs of the folders listed so far may now refer to other items
+  if (uids) {
+    vfs_listing_.Invalidate();
+    now_playing_listing_.Invalidate();
+  }
+
   if (available_players) {
     HandleAvailablePlayerUpdate();
   }
 
   if (addressed_player) {
+    now_playing_listing_.Invalidate();
     HandleAddressedPlayerUpdate();
   }
 }
@@ -1719,6 +1771,7 @@ void Device::HandlePlayStatusUpdate() {
 
 void Device::HandleNowPlayingUpdate() {
   log::verbose("");
+  now_playing_listing_.Invalidate();
 
   if (!now_playing_changed_.first) {
     log::warn("Device is not registered for now playing updates");
@@ -327,6 +327,14 @@ class Device {
     active_labels_.erase(label);
     send_message_cb_.Run(label, browse, std::move(message));
   }
+
+  // Build the GetFolderItems response for the range of items requested by
+  // |pkt|.
+  void SendVFSList(uint8_t label, const GetFolderItemsRequest& pkt,
+                   const std::vector<ListItem>& items);
+  void SendNowPlayingList(uint8_t label, const GetFolderItemsRequest& pkt,
+                          const std::vector<SongInfo>& song_list);
+
   base::WeakPtrFactory<Device> weak_ptr_factory_;
 
   // TODO (apanicke): Initialize all the variables in the constructor.
@@ -361,6 +369,31 @@ class Device {
   MediaIdMap vfs_ids_;
   MediaIdMap now_playing_ids_;
 
+  // Items of the browsed folder, or of the now playing list, as fetched from
+  // the media interface for the last GetFolderItems request starting at the
+  // first item. The media interface has no way to fetch a range of items, so
+  // requests for the following pages are served from here instead of fetching
+  // and mapping the whole folder again for every page. A request for the first
+  // page always fetches the items again.
+  template <typename T>
+  struct FolderListing {
+    // The items are set and still current.
+    bool valid = false;
+    // A fetch was requested and nothing invalidated it since.
+    bool pending = false;
+    int player_id = -1;
+    std::string folder_id;
+    std::vector<T> items;
+
+    void Invalidate() {
+      valid = false;
+      pending = false;
+      items.clear();
+    }
+  };
+  FolderListing<ListItem> vfs_listing_;
+  FolderListing<SongInfo> now_playing_listing_;
+
   uint32_t play_pos_interval_ = 0;
 
   SongInfo last_song_info_;
@@ -16,7 +16,8 @@
 
 #pragma once
 
-#include <map>
+#include <string>
+#include <unordered_map>
 
 namespace bluetooth {
 namespace avrcp {
@@ -31,32 +32,32 @@ class MediaIdMap {
     uid_to_media_id_.clear();
   }
 
-  std::string get_media_id(uint64_t uid) {
+  std::string get_media_id(uint64_t uid) const {
     const auto& uid_it = uid_to_media_id_.find(uid);
     if (uid_it == uid_to_media_id_.end()) return "";
     return uid_it->second;
   }
 
-  uint64_t get_uid(std::string media_id) {
+  uint64_t get_uid(const std::string& media_id) const {
     const auto& media_id_it = media_id_to_uid_.find(media_id);
     if (media_id_it == media_id_to_uid_.end()) return 0;
     return media_id_it->second;
   }
 
-  uint64_t insert(std::string media_id) {
-    if (media_id_to_uid_.find(media_id) != media_id_to_uid_.end()) {
-      return media_id_to_uid_[media_id];
-    }
-
+  uint64_t insert(const std::string& media_id) {
     uint64_t uid = media_id_to_uid_.size() + 1;
-    media_id_to_uid_.insert(std::pair<std::string, uint64_t>(media_id, uid));
-    uid_to_media_id_.insert(std::pair<uint64_t, std::string>(uid, media_id));
+    auto [media_id_it, inserted] = media_id_to_uid_.emplace(media_id, uid);
+    if (!inserted) return media_id_it->second;
+
+    uid_to_media_id_.emplace(uid, media_id);
     return uid;
   }
 
  private:
-  std::map<std::string, uint64_t> media_id_to_uid_;
-  std::map<uint64_t, std::string> uid_to_media_id_;
+  // Looked up once per item of every folder listing sent to the remote, so
+  // hashed rather than ordered.
+  std::unordered_map<std::string, uint64_t> media_id_to_uid_;
+  std::unordered_map<uint64_t, std::string> uid_to_media_id_;
 };
 
 }  // namespace avrcp
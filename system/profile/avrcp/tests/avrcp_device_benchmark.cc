@@ -0,0 +1,182 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <base/functional/bind.h>
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "avrcp_packet.h"
+#include "device.h"
+#include "internal_include/stack_config.h"
+#include "tests/packet_test_helper.h"
+#include "types/raw_address.h"
+
+using ::benchmark::State;
+
+bool btif_av_src_sink_coexist_enabled(void) { return true; }
+
+namespace bluetooth {
+namespace avrcp {
+
+// Pages through a large browsed folder, as a remote listing a music library
+// does, one GetFolderItems request per page.
+
+namespace {
+
+constexpr int kItemsPerPage = 10;
+
+using TestBrowsePacket = TestPacketType<BrowsePacket>;
+
+// Serves the same folder listing for every fetch
+class FakeMediaInterface : public MediaInterface {
+ public:
+  explicit FakeMediaInterface(int num_items) {
+    for (int i = 0; i < num_items; i++) {
+      SongInfo song = {
+          "test_id" + std::to_string(i),
+          {AttributeEntry(Attribute::TITLE, "Test Song" + std::to_string(i)),
+           AttributeEntry(Attribute::ARTIST_NAME, "Test Artist"),
+           AttributeEntry(Attribute::ALBUM_NAME, "Test Album")}};
+      items_.push_back({ListItem::SONG, FolderInfo(), song});
+    }
+  }
+
+  void SendKeyEvent(uint8_t key, KeyState state) override {}
+  void GetSongInfo(SongInfoCallback info_cb) override {}
+  void GetPlayStatus(PlayStatusCallback status_cb) override {}
+  void GetNowPlayingList(NowPlayingCallback now_playing_cb) override {}
+  void GetMediaPlayerList(MediaListCallback list_cb) override {}
+  void GetFolderItems(uint16_t player_id, std::string media_id,
+                      FolderItemsCallback folder_cb) override {
+    folder_cb.Run(items_);
+  }
+  void SetBrowsedPlayer(uint16_t player_id,
+                        SetBrowsedPlayerCallback browse_cb) override {}
+  void PlayItem(uint16_t player_id, bool now_playing,
+                std::string media_id) override {}
+  void SetActiveDevice(const RawAddress& address) override {}
+  void RegisterUpdateCallback(MediaCallbacks* callback) override {}
+  void UnregisterUpdateCallback(MediaCallbacks* callback) override {}
+
+ private:
+  std::vector<ListItem> items_;
+};
+
+class FakeA2dpInterface : public A2dpInterface {
+ public:
+  RawAddress active_peer() override { return RawAddress(); }
+  bool is_peer_in_silence_mode(const RawAddress& peer_address) override {
+    return false;
+  }
+};
+
+std::shared_ptr<TestBrowsePacket> MakeGetFolderItemsRequest(int start) {
+  auto request = TestBrowsePacket::Make();
+  GetFolderItemsRequestBuilder::MakeBuilder(Scope::VFS, start,
+                                            start + kItemsPerPage - 1, {})
+      ->Serialize(request);
+  return request;
+}
+
+bool get_pts_avrcp_test(void) { return false; }
+
+}  // namespace
+
+const stack_config_t interface = {get_pts_avrcp_test,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr,
+                                  nullptr};
+
+// Every page of a folder of range(0) items, the first one fetching the folder
+static void BM_GetFolderItemsPaging(State& state) {
+  const int num_items = state.range(0);
+  FakeMediaInterface media_interface(num_items);
+  FakeA2dpInterface a2dp_interface;
+  std::vector<std::shared_ptr<TestBrowsePacket>> requests;
+  for (int i = 0; i < num_items; i += kItemsPerPage) {
+    requests.push_back(MakeGetFolderItemsRequest(i));
+  }
+
+  for (auto _ : state) {
+    Device device(
+        RawAddress::kAny, true,
+        base::BindRepeating(
+            [](uint8_t, bool, std::unique_ptr<::bluetooth::PacketBuilder>) {}),
+        0xFFFF, 0xFFFF);
+    device.RegisterInterfaces(&media_interface, &a2dp_interface, nullptr,
+                              nullptr);
+    for (auto& request : requests) {
+      device.BrowseMessageReceived(1, request);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * requests.size());
+}
+BENCHMARK(BM_GetFolderItemsPaging)->Arg(1000)->Arg(10000);
+
+// The first page alone, which always fetches the whole folder
+static void BM_GetFolderItemsFirstPage(State& state) {
+  FakeMediaInterface media_interface(state.range(0));
+  FakeA2dpInterface a2dp_interface;
+  auto request = MakeGetFolderItemsRequest(0);
+  Device device(
+      RawAddress::kAny, true,
+      base::BindRepeating(
+          [](uint8_t, bool, std::unique_ptr<::bluetooth::PacketBuilder>) {}),
+      0xFFFF, 0xFFFF);
+  device.RegisterInterfaces(&media_interface, &a2dp_interface, nullptr,
+                            nullptr);
+
+  for (auto _ : state) {
+    device.BrowseMessageReceived(1, request);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetFolderItemsFirstPage)->Arg(1000)->Arg(10000);
+
+}  // namespace avrcp
+}  // namespace bluetooth
+
+const stack_config_t* stack_config_get_interface(void) {
+  return &bluetooth::avrcp::interface;
+}
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
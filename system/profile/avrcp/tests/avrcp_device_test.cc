@@ -1061,6 +1061,139 @@ TEST_F(AvrcpDeviceTest, getFolderItemsMtuTest) {
       1, TestBrowsePacket::Make(get_folder_items_request_vfs));
 }
 
+TEST_F(AvrcpDeviceTest, getVFSFolderPagesTest) {
+  MockMediaInterface interface;
+  NiceMock<MockA2dpInterface> a2dp_interface;
+
+  test_device->RegisterInterfaces(&interface, &a2dp_interface, nullptr,
+                                  nullptr);
+
+  std::vector<ListItem> list;
+  for (int i = 0; i < 5; i++) {
+    FolderInfo info = {"test_id" + std::to_string(i), true,
+                       "Test Folder" + std::to_string(i)};
+    list.push_back({ListItem::FOLDER, info, SongInfo()});
+  }
+
+  // The following pages are served from the items fetched for the first one
+  // until the UIDs change.
+  EXPECT_CALL(interface, GetFolderItems(_, "", _))
+      .Times(2)
+      .WillRepeatedly(InvokeCb<2>(list));
+
+  for (uint8_t page = 0; page < 3; page++) {
+    auto expected_response = GetFolderItemsResponseBuilder::MakeVFSBuilder(
+        Status::NO_ERROR, 0x0000, 0xFFFF);
+    for (int i = page * 2; i <= page * 2 + 1 && i < 5; i++) {
+      expected_response->AddFolder(
+          FolderItem(i + 1, 0, true, "Test Folder" + std::to_string(i)));
+    }
+    EXPECT_CALL(response_cb,
+                Call(page, true, matchPacket(std::move(expected_response))))
+        .Times(1);
+
+    auto request = TestBrowsePacket::Make();
+    GetFolderItemsRequestBuilder::MakeBuilder(Scope::VFS, page * 2,
+                                              page * 2 + 1, {})
+        ->Serialize(request);
+    SendBrowseMessage(page, request);
+  }
+
+  test_device->SendFolderUpdate(false, false, true);
+
+  auto expected_response = GetFolderItemsResponseBuilder::MakeVFSBuilder(
+      Status::NO_ERROR, 0x0000, 0xFFFF);
+  expected_response->AddFolder(FolderItem(3, 0, true, "Test Folder2"));
+  expected_response->AddFolder(FolderItem(4, 0, true, "Test Folder3"));
+  EXPECT_CALL(response_cb,
+              Call(3, true, matchPacket(std::move(expected_response))))
+      .Times(1);
+
+  auto request = TestBrowsePacket::Make();
+  GetFolderItemsRequestBuilder::MakeBuilder(Scope::VFS, 2, 3, {})
+      ->Serialize(request);
+  SendBrowseMessage(3, request);
+}
+
+TEST_F(AvrcpDeviceTest, getNowPlayingListPagesTest) {
+  MockMediaInterface interface;
+  NiceMock<MockA2dpInterface> a2dp_interface;
+
+  test_device->RegisterInterfaces(&interface, &a2dp_interface, nullptr,
+                                  nullptr);
+
+  std::vector<SongInfo> list;
+  for (int i = 0; i < 4; i++) {
+    list.push_back({"test_id" + std::to_string(i),
+                    {AttributeEntry(Attribute::TITLE,
+                                    "Test Song" + std::to_string(i))}});
+  }
+
+  // The now playing list is fetched again once it changed
+  EXPECT_CALL(interface, GetNowPlayingList(_))
+      .Times(2)
+      .WillRepeatedly(InvokeCb<0>("test_id0", list));
+
+  for (uint8_t page = 0; page < 3; page++) {
+    // The last page is requested after the now playing list changed
+    if (page == 2) {
+      test_device->SendMediaUpdate(false, false, true);
+    }
+
+    uint32_t start_item = page == 0 ? 0 : 2;
+    auto expected_response =
+        GetFolderItemsResponseBuilder::MakeNowPlayingBuilder(Status::NO_ERROR,
+                                                             0x0000, 0xFFFF);
+    for (uint32_t i = start_item; i <= start_item + 1; i++) {
+      expected_response->AddSong(MediaElementItem(
+          i + 1, "Test Song" + std::to_string(i), std::set<AttributeEntry>()));
+    }
+    EXPECT_CALL(response_cb,
+                Call(page, true, matchPacket(std::move(expected_response))))
+        .Times(1);
+
+    auto request = TestBrowsePacket::Make();
+    GetFolderItemsRequestBuilder::MakeBuilder(Scope::NOW_PLAYING, start_item,
+                                              start_item + 1, {})
+        ->Serialize(request);
+    SendBrowseMessage(page, request);
+  }
+}
+
+TEST_F(AvrcpDeviceTest, getVFSFolderLargeFolderPagingTest) {
+  constexpr int kNumItems = 10000;
+  constexpr int kItemsPerPage = 10;
+
+  MockMediaInterface interface;
+  NiceMock<MockA2dpInterface> a2dp_interface;
+
+  test_device->RegisterInterfaces(&interface, &a2dp_interface, nullptr,
+                                  nullptr);
+
+  std::vector<ListItem> list;
+  for (int i = 0; i < kNumItems; i++) {
+    SongInfo song = {
+        "test_id" + std::to_string(i),
+        {AttributeEntry(Attribute::TITLE, "Test Song" + std::to_string(i)),
+         AttributeEntry(Attribute::ARTIST_NAME, "Test Artist"),
+         AttributeEntry(Attribute::ALBUM_NAME, "Test Album")}};
+    list.push_back({ListItem::SONG, FolderInfo(), song});
+  }
+
+  EXPECT_CALL(interface, GetFolderItems(_, "", _))
+      .Times(1)
+      .WillOnce(InvokeCb<2>(list));
+  EXPECT_CALL(response_cb, Call(_, true, _)).Times(kNumItems / kItemsPerPage);
+
+  for (int i = 0; i < kNumItems; i += kItemsPerPage) {
+    auto request = TestBrowsePacket::Make();
+    GetFolderItemsRequestBuilder::MakeBuilder(Scope::VFS, i,
+                                              i + kItemsPerPage - 1, {})
+        ->Serialize(request);
+    SendBrowseMessage(1, request);
+  }
+}
+
 TEST_F(AvrcpDeviceTest, changePathTest) {
   MockMediaInterface interface;
   NiceMock<MockA2dpInterface> a2dp_interface;
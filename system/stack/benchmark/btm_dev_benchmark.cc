@@ -0,0 +1,189 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "crypto_toolbox/crypto_toolbox.h"
+#include "internal_include/bt_target.h"
+#include "stack/btm/btm_dev.h"
+#include "stack/btm/btm_int_types.h"
+#include "stack/btm/btm_sec_cb.h"
+#include "stack/include/btm_api.h"
+#include "types/raw_address.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// Addresses looked up per iteration
+constexpr int kNumRequests = 64;
+
+Octet16 make_irk(uint16_t seed) {
+  Octet16 irk{};
+  for (size_t i = 0; i < irk.size(); i++) irk[i] = seed + i;
+  irk[0] = seed >> 8;
+  return irk;
+}
+
+// Resolvable private address for |irk| from the 22 bit |prand|
+RawAddress make_rpa(const Octet16& irk, uint32_t prand) {
+  RawAddress rpa;
+  rpa.address[0] = ((prand >> 16) & 0x3f) | 0x40;
+  rpa.address[1] = (prand >> 8) & 0xff;
+  rpa.address[2] = prand & 0xff;
+
+  Octet16 r{};
+  r[0] = rpa.address[2];
+  r[1] = rpa.address[1];
+  r[2] = rpa.address[0];
+  Octet16 hash = crypto_toolbox::aes_128(irk, r);
+  rpa.address[5] = hash[0];
+  rpa.address[4] = hash[1];
+  rpa.address[3] = hash[2];
+  return rpa;
+}
+
+// Device database of range(0) bonded LE records with an IRK each, and the
+// addresses requested of it
+class BM_BtmDevLookup : public ::benchmark::Fixture {
+ public:
+  void SetUp(State& state) override {
+    ::benchmark::Fixture::SetUp(state);
+    ::btm_sec_cb.Init(BTM_SEC_MODE_SC);
+    const uint16_t num_records = state.range(0);
+    for (uint16_t i = 0; i < num_records; i++) {
+      tBTM_SEC_DEV_REC* p_dev_rec = btm_sec_allocate_dev_rec();
+      p_dev_rec->bd_addr = RawAddress({0x00, 0x11, 0x22, 0x33,
+                                       static_cast<uint8_t>(i >> 8),
+                                       static_cast<uint8_t>(i)});
+      p_dev_rec->device_type = BT_DEVICE_TYPE_BLE;
+      p_dev_rec->sec_rec.ble_keys.key_type = BTM_LE_KEY_PID;
+      p_dev_rec->sec_rec.ble_keys.irk = make_irk(i);
+      records_.push_back(p_dev_rec);
+    }
+    btm_dev_invalidate_lookup_cache();
+
+    // Spread over the whole database, since the cost of resolving an RPA
+    // depends on the position of its record
+    for (int i = 0; i < kNumRequests; i++) {
+      const tBTM_SEC_DEV_REC* p_dev_rec = records_[(i * 7919) % num_records];
+      identity_hits_.push_back(p_dev_rec->bd_addr);
+      identity_misses_.push_back(RawAddress(
+          {0x00, 0x11, 0x22, 0x44, static_cast<uint8_t>(i >> 8),
+           static_cast<uint8_t>(i)}));
+      rpa_hits_.push_back(make_rpa(p_dev_rec->sec_rec.ble_keys.irk, i));
+      rpa_misses_.push_back(make_rpa(make_irk(0xf000 + i), i));
+    }
+  }
+
+  void TearDown(State& state) override {
+    identity_hits_.clear();
+    identity_misses_.clear();
+    rpa_hits_.clear();
+    rpa_misses_.clear();
+    records_.clear();
+    ::btm_sec_cb.Free();
+    ::benchmark::Fixture::TearDown(state);
+  }
+
+ protected:
+  std::vector<tBTM_SEC_DEV_REC*> records_;
+  std::vector<RawAddress> identity_hits_;
+  std::vector<RawAddress> identity_misses_;
+  std::vector<RawAddress> rpa_hits_;
+  std::vector<RawAddress> rpa_misses_;
+};
+
+template <typename Lookup>
+void RunLookups(State& state, const std::vector<RawAddress>& addresses,
+                Lookup lookup) {
+  for (auto _ : state) {
+    for (const RawAddress& address : addresses) {
+      benchmark::DoNotOptimize(lookup(address));
+    }
+  }
+  state.SetItemsProcessed(static_cast<int_fast64_t>(state.iterations()) *
+                          addresses.size());
+}
+
+}  // namespace
+
+// Identity address of a bonded device, served from the address index
+BENCHMARK_DEFINE_F(BM_BtmDevLookup, find_dev_identity_hit)(State& state) {
+  RunLookups(state, identity_hits_, btm_find_dev);
+}
+BENCHMARK_REGISTER_F(BM_BtmDevLookup, find_dev_identity_hit)
+    ->Arg(10)
+    ->Arg(50)
+    ->Arg(BTM_SEC_MAX_DEVICE_RECORDS);
+
+// Public address of a device that is not bonded, e.g. seen in a scan
+BENCHMARK_DEFINE_F(BM_BtmDevLookup, find_dev_identity_miss)(State& state) {
+  RunLookups(state, identity_misses_, btm_find_dev);
+}
+BENCHMARK_REGISTER_F(BM_BtmDevLookup, find_dev_identity_miss)
+    ->Arg(10)
+    ->Arg(50)
+    ->Arg(BTM_SEC_MAX_DEVICE_RECORDS);
+
+// RPA of a bonded device looked up again, as during a connection, served from
+// the resolution cache after the first iteration
+BENCHMARK_DEFINE_F(BM_BtmDevLookup, find_dev_rpa_hit)(State& state) {
+  RunLookups(state, rpa_hits_, btm_find_dev);
+}
+BENCHMARK_REGISTER_F(BM_BtmDevLookup, find_dev_rpa_hit)
+    ->Arg(10)
+    ->Arg(50)
+    ->Arg(BTM_SEC_MAX_DEVICE_RECORDS);
+
+// RPA of a device that is not bonded looked up again, served from the
+// negative entries of the resolution cache after the first iteration
+BENCHMARK_DEFINE_F(BM_BtmDevLookup, find_dev_rpa_miss)(State& state) {
+  RunLookups(state, rpa_misses_, btm_find_dev);
+}
+BENCHMARK_REGISTER_F(BM_BtmDevLookup, find_dev_rpa_miss)
+    ->Arg(10)
+    ->Arg(50)
+    ->Arg(BTM_SEC_MAX_DEVICE_RECORDS);
+
+// RPA resolved against the IRKs up to the one of its record
+BENCHMARK_DEFINE_F(BM_BtmDevLookup, resolve_rpa_hit)(State& state) {
+  RunLookups(state, rpa_hits_, btm_dev_resolve_rpa);
+}
+BENCHMARK_REGISTER_F(BM_BtmDevLookup, resolve_rpa_hit)
+    ->Arg(10)
+    ->Arg(50)
+    ->Arg(BTM_SEC_MAX_DEVICE_RECORDS);
+
+// RPA resolved against every IRK without a match, the worst case
+BENCHMARK_DEFINE_F(BM_BtmDevLookup, resolve_rpa_miss)(State& state) {
+  RunLookups(state, rpa_misses_, btm_dev_resolve_rpa);
+}
+BENCHMARK_REGISTER_F(BM_BtmDevLookup, resolve_rpa_miss)
+    ->Arg(10)
+    ->Arg(50)
+    ->Arg(BTM_SEC_MAX_DEVICE_RECORDS);
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "stack/gatt/gatt_int.h"
+
+using ::benchmark::State;
+
+namespace {
+
+// A service declaration and three characteristics of a declaration, a value
+// and a descriptor each
+constexpr int kAttributesPerService = 10;
+// Handles requested per iteration
+constexpr int kNumRequests = 256;
+
+// Server database of range(0) attributes, laid out as GATTS_AddService() does
+class BM_GattServerDispatch : public ::benchmark::Fixture {
+ public:
+  void SetUp(State& state) override {
+    ::benchmark::Fixture::SetUp(state);
+    int num_services = state.range(0) / kAttributesPerService;
+    dbs_ = std::vector<tGATT_SVC_DB>(num_services);
+    uint16_t handle = 0x0028;
+    for (tGATT_SVC_DB& db : dbs_) {
+      tGATT_SRV_LIST_ELEM& el = srv_list_.emplace_back();
+      el.p_db = &db;
+      el.s_hdl = handle;
+      db.attr_list.resize(kAttributesPerService);
+      for (tGATT_ATTR& attr : db.attr_list) {
+        attr.handle = handle++;
+        attr.gatt_type = BTGATT_DB_CHARACTERISTIC;
+      }
+      el.e_hdl = handle - 1;
+      // Handle ranges are reserved with some slack
+      handle += 2;
+    }
+    for (auto it = srv_list_.begin(); it != srv_list_.end(); it++) {
+      index_.Add(it);
+    }
+
+    // Characteristic values polled by the clients, over the whole database
+    for (int i = 0; i < kNumRequests; i++) {
+      const tGATT_SRV_LIST_ELEM& el =
+          *std::next(srv_list_.begin(), (i * 7919) % num_services);
+      requests_.push_back(el.s_hdl + 2 + 3 * (i % 3));
+    }
+  }
+
+  void TearDown(State& state) override {
+    requests_.clear();
+    srv_list_.clear();
+    dbs_.clear();
+    index_ = GattServerHandleIndex();
+    ::benchmark::Fixture::TearDown(state);
+  }
+
+ protected:
+  std::vector<tGATT_SVC_DB> dbs_;
+  std::list<tGATT_SRV_LIST_ELEM> srv_list_;
+  GattServerHandleIndex index_;
+  std::vector<uint16_t> requests_;
+};
+
+}  // namespace
+
+// What gatts_process_attribute_req() did: scan the services for the range,
+// then the attributes of the service for the handle
+BENCHMARK_DEFINE_F(BM_GattServerDispatch, linear_scan)(State& state) {
+  for (auto _ : state) {
+    for (uint16_t handle : requests_) {
+      const tGATT_ATTR* found = nullptr;
+      for (auto& el : srv_list_) {
+        if (el.s_hdl <= handle && el.e_hdl >= handle) {
+          for (const auto& attr : el.p_db->attr_list) {
+            if (attr.handle == handle) {
+              found = &attr;
+              break;
+            }
+          }
+          break;
+        }
+      }
+      benchmark::DoNotOptimize(found);
+    }
+  }
+  state.SetItemsProcessed(static_cast<int_fast64_t>(state.iterations()) *
+                          kNumRequests);
+}
+BENCHMARK_REGISTER_F(BM_GattServerDispatch, linear_scan)
+    ->Arg(50)
+    ->Arg(500)
+    ->Arg(5000);
+
+BENCHMARK_DEFINE_F(BM_GattServerDispatch, handle_index)(State& state) {
+  for (auto _ : state) {
+    for (uint16_t handle : requests_) {
+      const GattServerHandleIndex::Entry* entry = index_.Find(handle);
+      benchmark::DoNotOptimize(entry->attr);
+    }
+  }
+  state.SetItemsProcessed(static_cast<int_fast64_t>(state.iterations()) *
+                          kNumRequests);
+}
+BENCHMARK_REGISTER_F(BM_GattServerDispatch, handle_index)
+    ->Arg(50)
+    ->Arg(500)
+    ->Arg(5000);
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <math.h>
+#include <string.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "stack/btm/btm_sco_plc_kernels.h"
+
+using ::benchmark::State;
+using bluetooth::audio::sco::wbs::get_plc_kernels;
+using bluetooth::audio::sco::wbs::get_supported_plc_implementations;
+using bluetooth::audio::sco::wbs::kPlcTemplateLength;
+using bluetooth::audio::sco::wbs::kPlcWindowLength;
+using bluetooth::audio::sco::wbs::PlcKernels;
+
+namespace {
+
+// Sizes of btm_sco_hci.cc
+constexpr int kFrameSize = 120;
+constexpr int kHistoryLength = kPlcWindowLength + kFrameSize - 1;
+constexpr int kReconvergenceLength = 36;
+constexpr int kOverlapAddLength = 16;
+// Frames of 7.5 ms per iteration, 7.5 s of a call
+constexpr int kNumFrames = 1000;
+
+enum LossPattern {
+  // Lost frames spread out, as with interference
+  kRandom10Percent,
+  // Runs of 4 lost frames every 20, as when the link degrades
+  kBursts,
+  // Every other frame lost
+  kAlternate,
+};
+
+std::vector<bool> MakeLossPattern(LossPattern pattern) {
+  std::vector<bool> lost(kNumFrames);
+  std::mt19937 rng(42);
+  std::bernoulli_distribution ten_percent(0.1);
+  for (int i = 0; i < kNumFrames; i++) {
+    switch (pattern) {
+      case kRandom10Percent:
+        lost[i] = ten_percent(rng);
+        break;
+      case kBursts:
+        lost[i] = i % 20 >= 16;
+        break;
+      case kAlternate:
+        lost[i] = i % 2;
+        break;
+    }
+  }
+  return lost;
+}
+
+// The history handling of tBTM_MSBC_PLC around the kernels, without the mSBC
+// decoder
+class Plc {
+ public:
+  explicit Plc(const PlcKernels& kernels) : kernels_(kernels) {}
+
+  void HandleGoodFrame(int16_t* input) {
+    if (handled_bad_frames_ != 0) {
+      int16_t* frame_head = &hist_[kHistoryLength];
+      memcpy(input, frame_head, kReconvergenceLength * sizeof(int16_t));
+      kernels_.overlap_add(&input[kReconvergenceLength], 1.0f,
+                           &frame_head[kReconvergenceLength], 1.0f,
+                           &input[kReconvergenceLength]);
+      handled_bad_frames_ = 0;
+    }
+    memmove(hist_, &hist_[kFrameSize],
+            (kHistoryLength - kFrameSize) * sizeof(int16_t));
+    memcpy(&hist_[kHistoryLength - kFrameSize], input,
+           kFrameSize * sizeof(int16_t));
+  }
+
+  void HandleBadFrame(const int16_t* decoded) {
+    int16_t* frame_head = &hist_[kHistoryLength];
+    if (handled_bad_frames_ == 0) {
+      best_lag_ = kernels_.pattern_match(
+                      &hist_[kHistoryLength - kPlcTemplateLength], hist_) +
+                  kPlcTemplateLength;
+      int16_t* best_match = &hist_[best_lag_];
+      kernels_.overlap_add(frame_head, 1.0f, decoded, 0.9f, best_match);
+      for (int i = kOverlapAddLength; i < kFrameSize; i++) {
+        frame_head[i] = static_cast<int16_t>(0.9f * best_match[i]);
+      }
+      kernels_.overlap_add(&frame_head[kFrameSize], 0.9f,
+                           &best_match[kFrameSize], 1.0f,
+                           &best_match[kFrameSize]);
+      memmove(&frame_head[kFrameSize + kOverlapAddLength],
+              &best_match[kFrameSize + kOverlapAddLength],
+              kReconvergenceLength * sizeof(int16_t));
+    } else {
+      memmove(frame_head, &hist_[best_lag_],
+              (kFrameSize + kReconvergenceLength + kOverlapAddLength) *
+                  sizeof(int16_t));
+    }
+    handled_bad_frames_++;
+    memmove(hist_, &hist_[kFrameSize],
+            (kHistoryLength + kReconvergenceLength + kOverlapAddLength) *
+                sizeof(int16_t));
+  }
+
+ private:
+  const PlcKernels& kernels_;
+  int16_t hist_[kHistoryLength + kFrameSize + kReconvergenceLength +
+                kOverlapAddLength] = {};
+  int best_lag_ = 0;
+  int handled_bad_frames_ = 0;
+};
+
+// range(0) is the index of the implementation in
+// get_supported_plc_implementations(), range(1) the LossPattern
+void BM_MsbcPlc(State& state) {
+  auto implementations = get_supported_plc_implementations();
+  if (state.range(0) >= static_cast<int64_t>(implementations.size())) {
+    state.SkipWithError("Not supported by this CPU");
+    return;
+  }
+  const PlcKernels& kernels = get_plc_kernels(implementations[state.range(0)]);
+  auto lost = MakeLossPattern(static_cast<LossPattern>(state.range(1)));
+
+  // A voiced sound at 16 kHz
+  std::vector<int16_t> signal(kNumFrames * kFrameSize);
+  for (size_t i = 0; i < signal.size(); i++) {
+    signal[i] = static_cast<int16_t>(8000 * sinf(i * 0.09f) +
+                                     3000 * sinf(i * 0.31f));
+  }
+  int16_t decoded[kFrameSize] = {};
+  int16_t frame[kFrameSize];
+
+  int num_lost = 0;
+  for (auto _ : state) {
+    Plc plc(kernels);
+    for (int i = 0; i < kNumFrames; i++) {
+      if (lost[i]) {
+        plc.HandleBadFrame(decoded);
+      } else {
+        memcpy(frame, &signal[i * kFrameSize], sizeof(frame));
+        plc.HandleGoodFrame(frame);
+      }
+    }
+    benchmark::DoNotOptimize(frame);
+  }
+  for (bool frame_lost : lost) {
+    num_lost += frame_lost;
+  }
+  state.SetItemsProcessed(static_cast<int_fast64_t>(state.iterations()) *
+                          kNumFrames);
+  state.counters["lost_frames"] = num_lost;
+}
+BENCHMARK(BM_MsbcPlc)
+    ->ArgNames({"impl", "pattern"})
+    ->ArgsProduct({{0, 1, 2}, {kRandom10Percent, kBursts, kAlternate}});
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  ::benchmark::RunSpecifiedBenchmarks();
+}
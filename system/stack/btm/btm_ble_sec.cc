@@ -118,6 +118,7 @@ void BTM_SecAddBleDevice(const RawAddress& bd_addr, tBT_DEVICE_TYPE dev_type,
                p_dev_rec->device_type, p_info->results.ble_addr_type);
     p_info->results.device_type = p_dev_rec->device_type;
   }
+  btm_dev_invalidate_lookup_cache();
 }
 
 /*******************************************************************************
@@ -500,6 +501,7 @@ void BTM_ReadDevInfo(const RawAddress& remote_bda, tBT_DEVICE_TYPE* p_dev_type,
     /* new inquiry result, merge device type in security device record */
     if (p_inq_info) {
       p_dev_rec->device_type |= p_inq_info->results.device_type;
+      btm_dev_invalidate_lookup_cache();
       if (is_ble_addr_type_known(p_inq_info->results.ble_addr_type))
         p_dev_rec->ble.SetAddressType(p_inq_info->results.ble_addr_type);
       else
@@ -921,6 +923,7 @@ void btm_sec_save_le_key(const RawAddress& bd_addr, tBTM_LE_KEY_TYPE key_type,
             p_keys->pid_key.identity_addr_type);
         /* update device record address as identity address */
         p_rec->bd_addr = p_keys->pid_key.identity_addr;
+        btm_dev_invalidate_lookup_cache();
         /* combine DUMO device security record if needed */
         btm_consolidate_dev(p_rec);
         break;
@@ -1534,6 +1537,7 @@ void btm_ble_connected(const RawAddress& bda, uint16_t handle, uint8_t enc_mode,
   p_dev_rec->ble.pseudo_addr = bda;
   p_dev_rec->ble_hci_handle = handle;
   p_dev_rec->device_type |= BT_DEVICE_TYPE_BLE;
+  btm_dev_invalidate_lookup_cache();
   p_dev_rec->role_central = (role == HCI_ROLE_CENTRAL) ? true : false;
   p_dev_rec->can_read_discoverable = can_read_discoverable_characteristics;
 
@@ -1664,6 +1668,7 @@ tBTM_STATUS btm_proc_smp_cback(tSMP_EVT event, const RawAddress& bd_addr,
                   "resetting the LK flags");
               p_dev_rec->sec_rec.sec_flags &= ~(BTM_SEC_LE_LINK_KEY_KNOWN);
               p_dev_rec->sec_rec.ble_keys.key_type = BTM_LE_KEY_NONE;
+              btm_dev_invalidate_lookup_cache();
             }
           }
           tBTM_BD_NAME remote_name = {};
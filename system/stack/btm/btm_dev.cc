@@ -29,13 +29,18 @@
 #include <android_bluetooth_flags.h>
 #include <bluetooth/log.h>
 
+#include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "btm_api.h"
 #include "btm_int_types.h"
 #include "btm_sec_api.h"
 #include "btm_sec_cb.h"
 #include "common/init_flags.h"
+#include "common/time_util.h"
+#include "crypto_toolbox/rpa_resolver.h"
 #include "hci/controller_interface.h"
 #include "internal_include/bt_target.h"
 #include "l2c_api.h"
@@ -60,14 +65,122 @@ namespace {
 
 constexpr char kBtmLogTag[] = "BOND";
 
-}
+/* Upper bound of remembered resolvable private address lookups */
+constexpr size_t kRpaCacheMaxEntries = 256;
+
+/* Peers rotate their resolvable private address every 15 minutes by default,
+ * after which a cached resolution result is not going to be asked for again */
+constexpr uint64_t kRpaCacheTimeoutMs = 15 * 60 * 1000;
+
+/* Lookup acceleration for btm_find_dev().
+ *
+ * Identity and pseudo addresses are served from a hash index over the
+ * |bd_addr| and |ble.pseudo_addr| fields of every record. Resolvable private
+ * addresses are served from a bounded cache of previous resolution results,
+ * positive and negative, so a lookup of an already seen RPA does not run one
+ * AES-128 per bonded IRK again.
+ *
+ * The IRKs of the LE records are kept in an RpaResolver for
+ * btm_dev_resolve_rpa(), with their key schedules expanded.
+ *
+ * All are rebuilt lazily from |btm_sec_cb.sec_dev_rec|, which stays the
+ * source of truth. They are dropped whenever records are added or removed,
+ * and whenever an address or IRK of a record changes.
+ */
+struct DevRecLookupCache {
+  struct RpaEntry {
+    tBTM_SEC_DEV_REC* p_dev_rec;
+    uint64_t timestamp_ms;
+  };
+
+  const list_t* cached_list{nullptr};
+  size_t cached_list_length{0};
+  bool index_valid{false};
+  std::unordered_map<RawAddress, tBTM_SEC_DEV_REC*> index;
+  std::unordered_map<RawAddress, RpaEntry> rpa_cache;
+  bool resolver_valid{false};
+  /* Record of each IRK of |resolver|, in list order */
+  std::vector<tBTM_SEC_DEV_REC*> resolver_records;
+  crypto_toolbox::RpaResolver resolver;
+
+  void Clear() {
+    index_valid = false;
+    index.clear();
+    rpa_cache.clear();
+    resolver_valid = false;
+    resolver_records.clear();
+  }
+
+  /* Drop everything if the record list was replaced or resized behind our
+   * back, which also protects against handing out freed records */
+  void Validate() {
+    const size_t length = list_length(btm_sec_cb.sec_dev_rec);
+    if (cached_list != btm_sec_cb.sec_dev_rec || cached_list_length != length) {
+      Clear();
+      cached_list = btm_sec_cb.sec_dev_rec;
+      cached_list_length = length;
+    }
+  }
+
+  void BuildIndex() {
+    index.clear();
+    list_node_t* end = list_end(btm_sec_cb.sec_dev_rec);
+    for (list_node_t* node = list_begin(btm_sec_cb.sec_dev_rec); node != end;
+         node = list_next(node)) {
+      tBTM_SEC_DEV_REC* p_dev_rec =
+          static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
+      // Keep the first record in list order, as a linear search would
+      index.emplace(p_dev_rec->bd_addr, p_dev_rec);
+      if (!p_dev_rec->ble.pseudo_addr.IsEmpty()) {
+        index.emplace(p_dev_rec->ble.pseudo_addr, p_dev_rec);
+      }
+    }
+    index_valid = true;
+  }
+
+  void BuildResolver() {
+    std::vector<Octet16> irks;
+    resolver_records.clear();
+    list_node_t* end = list_end(btm_sec_cb.sec_dev_rec);
+    for (list_node_t* node = list_begin(btm_sec_cb.sec_dev_rec); node != end;
+         node = list_next(node)) {
+      tBTM_SEC_DEV_REC* p_dev_rec =
+          static_cast<tBTM_SEC_DEV_REC*>(list_node(node));
+      if ((p_dev_rec->device_type & BT_DEVICE_TYPE_BLE) &&
+          (p_dev_rec->sec_rec.ble_keys.key_type & BTM_LE_KEY_PID)) {
+        irks.push_back(p_dev_rec->sec_rec.ble_keys.irk);
+        resolver_records.push_back(p_dev_rec);
+      }
+    }
+    resolver.SetIrks(irks);
+    resolver_valid = true;
+  }
+};
+
+DevRecLookupCache dev_rec_lookup_cache;
+
+}  // namespace
 
 static void wipe_secrets_and_remove(tBTM_SEC_DEV_REC* p_dev_rec) {
   p_dev_rec->sec_rec.link_key.fill(0);
   memset(&p_dev_rec->sec_rec.ble_keys, 0, sizeof(tBTM_SEC_BLE_KEYS));
+  btm_dev_invalidate_lookup_cache();
   list_remove(btm_sec_cb.sec_dev_rec, p_dev_rec);
 }
 
+/*******************************************************************************
+ *
+ * Function         btm_dev_invalidate_lookup_cache
+ *
+ * Description      Drop the address index and the RPA resolution cache used by
+ *                  btm_find_dev(). Must be called whenever the address, IRK or
+ *                  device type of a record in the device database changes.
+ *
+ * Returns          none
+ *
+ ******************************************************************************/
+void btm_dev_invalidate_lookup_cache() { dev_rec_lookup_cache.Clear(); }
+
 /*******************************************************************************
  *
  * Function         BTM_SecAddDevice
@@ -158,6 +271,7 @@ bool BTM_SecAddDevice(const RawAddress& bd_addr, DEV_CLASS dev_class,
 
   p_dev_rec->sec_rec.rmt_io_caps = BTM_IO_CAP_OUT;
   p_dev_rec->device_type |= BT_DEVICE_TYPE_BREDR;
+  btm_dev_invalidate_lookup_cache();
 
   return true;
 }
@@ -300,6 +414,7 @@ tBTM_SEC_DEV_REC* btm_sec_alloc_dev(const RawAddress& bd_addr) {
   memset(&p_dev_rec->conn_params, 0xff, sizeof(tBTM_LE_CONN_PRAMS));
 
   p_dev_rec->bd_addr = bd_addr;
+  btm_dev_invalidate_lookup_cache();
 
   p_dev_rec->ble_hci_handle = BTM_GetHCIConnHandle(bd_addr, BT_TRANSPORT_LE);
   p_dev_rec->hci_handle = BTM_GetHCIConnHandle(bd_addr, BT_TRANSPORT_BR_EDR);
@@ -407,11 +522,62 @@ static bool is_address_equal(void* data, void* context) {
 tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr) {
   if (btm_sec_cb.sec_dev_rec == nullptr) return nullptr;
 
+  DevRecLookupCache& cache = dev_rec_lookup_cache;
+  cache.Validate();
+
+  /* Only a resolvable private address may match a record through its IRK, any
+   * other address can only match the identity or pseudo address directly */
+  if (!BTM_BLE_IS_RESOLVE_BDA(bd_addr)) {
+    if (!cache.index_valid) cache.BuildIndex();
+    auto it = cache.index.find(bd_addr);
+    return (it == cache.index.end()) ? nullptr : it->second;
+  }
+
+  const uint64_t now_ms = bluetooth::common::time_get_os_boottime_ms();
+  auto it = cache.rpa_cache.find(bd_addr);
+  if (it != cache.rpa_cache.end()) {
+    if (now_ms - it->second.timestamp_ms < kRpaCacheTimeoutMs) {
+      return it->second.p_dev_rec;
+    }
+    cache.rpa_cache.erase(it);
+  }
+
+  tBTM_SEC_DEV_REC* p_dev_rec = nullptr;
   list_node_t* n =
       list_foreach(btm_sec_cb.sec_dev_rec, is_address_equal, (void*)&bd_addr);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  if (n) p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
 
-  return NULL;
+  if (cache.rpa_cache.size() >= kRpaCacheMaxEntries) {
+    cache.rpa_cache.clear();
+  }
+  cache.rpa_cache[bd_addr] = {
+      .p_dev_rec = p_dev_rec,
+      .timestamp_ms = now_ms,
+  };
+  return p_dev_rec;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_dev_resolve_rpa
+ *
+ * Description      Look for the first LE record in the device database whose
+ *                  IRK resolves |rpa|
+ *
+ * Returns          Pointer to the record or NULL
+ *
+ ******************************************************************************/
+tBTM_SEC_DEV_REC* btm_dev_resolve_rpa(const RawAddress& rpa) {
+  if (btm_sec_cb.sec_dev_rec == nullptr) return nullptr;
+
+  DevRecLookupCache& cache = dev_rec_lookup_cache;
+  cache.Validate();
+  if (!cache.resolver_valid) cache.BuildResolver();
+
+  int match = cache.resolver.Resolve(rpa.address);
+  return (match == crypto_toolbox::RpaResolver::kNoMatch)
+             ? nullptr
+             : cache.resolver_records[match];
 }
 
 static bool has_lenc_and_address_is_equal(void* data, void* context) {
@@ -496,6 +662,8 @@ void btm_consolidate_dev(tBTM_SEC_DEV_REC* p_target_rec) {
       }
     }
   }
+
+  btm_dev_invalidate_lookup_cache();
 }
 
 static BTM_CONSOLIDATION_CB* btm_consolidate_cb = nullptr;
@@ -664,6 +832,7 @@ tBTM_SEC_DEV_REC* btm_sec_allocate_dev_rec(void) {
   p_dev_rec =
       static_cast<tBTM_SEC_DEV_REC*>(osi_calloc(sizeof(tBTM_SEC_DEV_REC)));
   list_append(btm_sec_cb.sec_dev_rec, p_dev_rec);
+  btm_dev_invalidate_lookup_cache();
 
   // Initialize defaults
   p_dev_rec->sec_rec.sec_flags = BTM_SEC_IN_USE;
@@ -106,6 +106,32 @@ tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t handle);
  ******************************************************************************/
 tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr);
 
+/*******************************************************************************
+ *
+ * Function         btm_dev_resolve_rpa
+ *
+ * Description      Look for the first LE record in the device database whose
+ *                  IRK resolves |rpa|
+ *
+ * Returns          Pointer to the record or NULL
+ *
+ ******************************************************************************/
+tBTM_SEC_DEV_REC* btm_dev_resolve_rpa(const RawAddress& rpa);
+
+/*******************************************************************************
+ *
+ * Function         btm_dev_invalidate_lookup_cache
+ *
+ * Description      Drop the address index and the RPA resolution caches used by
+ *                  btm_find_dev() and btm_dev_resolve_rpa(). Must be called
+ *                  whenever the address, IRK or device type of a record in the
+ *                  device database changes.
+ *
+ * Returns          none
+ *
+ ******************************************************************************/
+void btm_dev_invalidate_lookup_cache();
+
 /*******************************************************************************
  *
  * Function         btm_find_dev_with_lenc
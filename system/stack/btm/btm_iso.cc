@@ -156,6 +156,11 @@ void IsoManager::Dump(int fd) {
   if (pimpl_->IsRunning()) pimpl_->Dump(fd);
 }
 
+void IsoManager::SetTxClockForTest(uint64_t (*clock_us)()) {
+  pimpl_->iso_impl_->tx_clock_us_ =
+      clock_us ? clock_us : bluetooth::common::time_get_os_boottime_us;
+}
+
 IsoManager::~IsoManager() = default;
 
 }  // namespace hci
@@ -17,10 +17,12 @@
 
 #pragma once
 
+#include <array>
 #include <list>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <tuple>
 
 #include "base/functional/bind.h"
 #include "base/functional/callback.h"
@@ -56,6 +58,20 @@ static constexpr uint8_t kStateFlagIsBroadcast = 0x10;
 
 constexpr char kBtmLogTag[] = "ISO";
 
+/* SDUs waiting for controller credits, per CIS or BIS. An SDU not sent within
+ * kIsoTxDeadlineSduIntervals SDU intervals is stale and dropped.
+ */
+static constexpr size_t kIsoTxQueueMaxSdus = 4;
+static constexpr uint32_t kIsoTxDeadlineSduIntervals = 2;
+static constexpr uint32_t kIsoTxDefaultSduIntervalUs = 10000;
+
+/* Upper bounds of the transmit latency histogram buckets, the last bucket
+ * counts everything above.
+ */
+static constexpr std::array<uint32_t, 5> kIsoTxLatencyBucketsUs = {
+    1000, 2000, 5000, 10000, 20000};
+static constexpr size_t kIsoTxDropRunBuckets = 4;
+
 struct iso_sync_info {
   uint16_t seq_nb;
 };
@@ -83,8 +99,79 @@ struct iso_base {
     uint64_t evt_last_lost_us = 0;
   };
 
+  struct tx_stats {
+    size_t sdu_count = 0;
+    size_t overflow_count = 0;
+    size_t expired_count = 0;
+    size_t oversize_count = 0;
+    uint64_t max_latency_us = 0;
+    std::array<size_t, kIsoTxLatencyBucketsUs.size() + 1> latency_histogram{};
+    /* Runs of consecutive dropped SDUs, by length: 1, 2, 3 and more */
+    std::array<size_t, kIsoTxDropRunBuckets> drop_run_histogram{};
+    size_t drop_run = 0;
+  };
+
+  struct tx_sdu {
+    BT_HDR* packet;
+    uint64_t queued_us;
+    uint64_t deadline_us;
+    /* Orders the SDUs with the same deadline */
+    uint64_t tx_seq;
+  };
+
+  /* Ring of the SDUs waiting for credits, the slots live with the stream so
+   * that queueing does not allocate.
+   */
+  struct tx_queue {
+    std::array<tx_sdu, kIsoTxQueueMaxSdus> slots;
+    size_t head = 0;
+    size_t size = 0;
+
+    bool empty() const { return size == 0; }
+    bool full() const { return size == slots.size(); }
+    const tx_sdu& front() const { return slots[head]; }
+
+    void push_back(const tx_sdu& sdu) {
+      slots[(head + size) % slots.size()] = sdu;
+      size++;
+    }
+
+    tx_sdu pop_front() {
+      tx_sdu sdu = slots[head];
+      head = (head + 1) % slots.size();
+      size--;
+      return sdu;
+    }
+  };
+
+  ~iso_base() { flush_tx_queue(); }
+
+  void flush_tx_queue() {
+    while (!tx_q.empty()) osi_free(tx_q.pop_front().packet);
+  }
+
+  void record_tx_drop() { tx_st.drop_run++; }
+
+  void record_tx_sent(uint64_t latency_us) {
+    size_t bucket = 0;
+    while (bucket < kIsoTxLatencyBucketsUs.size() &&
+           latency_us >= kIsoTxLatencyBucketsUs[bucket])
+      bucket++;
+    tx_st.latency_histogram[bucket]++;
+    tx_st.max_latency_us = std::max(tx_st.max_latency_us, latency_us);
+
+    if (tx_st.drop_run > 0) {
+      tx_st.drop_run_histogram[std::min(tx_st.drop_run,
+                                        kIsoTxDropRunBuckets) -
+                               1]++;
+      tx_st.drop_run = 0;
+    }
+  }
+
   credits_stats cr_stats;
   event_stats evt_stats;
+  tx_stats tx_st;
+  tx_queue tx_q;
 };
 
 typedef iso_base iso_cis;
@@ -554,27 +641,99 @@ struct iso_impl {
     uint16_t seq_nb = iso->sync_info.seq_nb;
     iso->sync_info.seq_nb = (seq_nb + 1) & 0xffff;
 
-    if (iso_credits_ == 0 || data_len > iso_buffer_size_) {
-      iso->cr_stats.credits_underflow_bytes += data_len;
-      iso->cr_stats.credits_underflow_count++;
-      iso->cr_stats.credits_last_underflow_us =
-          bluetooth::common::time_get_os_boottime_us();
+    if (data_len > iso_buffer_size_) {
+      iso->tx_st.oversize_count++;
+      iso->record_tx_drop();
 
       log::warn(
-          ", dropping ISO packet, len: {}, iso credits: {}, iso handle: {}",
-          static_cast<int>(data_len), static_cast<int>(iso_credits_),
+          ", dropping ISO packet, len: {}, buffer size: {}, iso handle: {}",
+          static_cast<int>(data_len), static_cast<int>(iso_buffer_size_),
           loghex(iso_handle));
       return;
     }
 
-    iso_credits_--;
-    iso->used_credits++;
+    uint64_t now_us = tx_clock_us_();
+    if (iso_credits_ == 0) {
+      iso->cr_stats.credits_underflow_bytes += data_len;
+      iso->cr_stats.credits_underflow_count++;
+      iso->cr_stats.credits_last_underflow_us = now_us;
+    }
 
     BT_HDR* packet = prepare_hci_packet(iso_handle, seq_nb, data_len);
     memcpy(packet->data + kIsoHeaderWithoutTsLen, data, data_len);
-    auto hci = bluetooth::shim::hci_layer_get_interface();
     packet->event = MSG_STACK_TO_HC_HCI_ISO | 0x0001;
-    hci->transmit_downward(packet, iso_buffer_size_);
+
+    /* Keep the most recent SDUs when the queue is full */
+    if (iso->tx_q.full()) {
+      osi_free(iso->tx_q.pop_front().packet);
+      iso->tx_st.overflow_count++;
+      iso->record_tx_drop();
+
+      log::warn(
+          ", dropping ISO packet, queue full, iso credits: {}, iso handle: {}",
+          static_cast<int>(iso_credits_), loghex(iso_handle));
+    }
+
+    uint32_t sdu_itv = iso->sdu_itv ? iso->sdu_itv : kIsoTxDefaultSduIntervalUs;
+    iso->tx_q.push_back({.packet = packet,
+                         .queued_us = now_us,
+                         .deadline_us =
+                             now_us + kIsoTxDeadlineSduIntervals * sdu_itv,
+                         .tx_seq = tx_seq_++});
+    iso->tx_st.sdu_count++;
+
+    send_queued_iso_data(now_us);
+  }
+
+  /* Drops the queued SDUs past their deadline, then sends the others, earliest
+   * deadline first across all the CISes and BISes, as long as there are
+   * credits.
+   */
+  void send_queued_iso_data(uint64_t now_us) {
+    for (auto* map : {&conn_hdl_to_cis_map_, &conn_hdl_to_bis_map_}) {
+      for (auto& iso_pair : *map) {
+        iso_base* iso = iso_pair.second.get();
+        while (!iso->tx_q.empty() && iso->tx_q.front().deadline_us < now_us) {
+          osi_free(iso->tx_q.pop_front().packet);
+          iso->tx_st.expired_count++;
+          iso->record_tx_drop();
+
+          log::warn(", dropping ISO packet, deadline expired, iso handle: {}",
+                    loghex(iso_pair.first));
+        }
+      }
+    }
+
+    while (iso_credits_ > 0) {
+      iso_base* next = nullptr;
+      for (auto* map : {&conn_hdl_to_cis_map_, &conn_hdl_to_bis_map_}) {
+        for (auto& iso_pair : *map) {
+          iso_base* iso = iso_pair.second.get();
+          if (iso->tx_q.empty()) continue;
+
+          const auto& sdu = iso->tx_q.front();
+          if (next == nullptr ||
+              std::tie(sdu.deadline_us, sdu.tx_seq) <
+                  std::tie(next->tx_q.front().deadline_us,
+                           next->tx_q.front().tx_seq))
+            next = iso;
+        }
+      }
+      if (next == nullptr) break;
+
+      auto sdu = next->tx_q.pop_front();
+      next->record_tx_sent(now_us - sdu.queued_us);
+
+      iso_credits_--;
+      next->used_credits++;
+
+      auto hci = bluetooth::shim::hci_layer_get_interface();
+      hci->transmit_downward(sdu.packet, iso_buffer_size_);
+    }
+  }
+
+  void send_queued_iso_data() {
+    send_queued_iso_data(tx_clock_us_());
   }
 
   void process_cis_est_pkt(uint8_t len, uint8_t* data) {
@@ -647,9 +806,11 @@ struct iso_impl {
       cig_callbacks_->OnCisEvent(kIsoEventCisDisconnected, &evt);
       cis->state_flags &= ~kStateFlagIsConnected;
 
-      /* return used credits */
+      /* return used credits, and give them to the other streams */
+      cis->flush_tx_queue();
       iso_credits_ += cis->used_credits;
       cis->used_credits = 0;
+      send_queued_iso_data();
 
       /* Data path is considered still valid, but can be reconfigured only once
        * CIS is reestablished.
@@ -684,6 +845,8 @@ struct iso_impl {
         continue;
       }
     }
+
+    send_queued_iso_data();
   }
 
   void handle_gd_num_completed_pkts(uint16_t handle, uint16_t credits) {
@@ -691,6 +854,7 @@ struct iso_impl {
     if (iter != conn_hdl_to_cis_map_.end()) {
       iter->second->used_credits -= credits;
       iso_credits_ += credits;
+      send_queued_iso_data();
       return;
     }
 
@@ -699,6 +863,8 @@ struct iso_impl {
       iter->second->used_credits -= credits;
       iso_credits_ += credits;
     }
+
+    send_queued_iso_data();
   }
 
   void process_create_big_cmpl_pkt(uint8_t len, uint8_t* data) {
@@ -935,6 +1101,35 @@ struct iso_impl {
              : 0llu));
   }
 
+  static void dump_tx_stats(int fd, const iso_base& iso) {
+    const auto& stats = iso.tx_st;
+
+    dprintf(fd, "        Transmit Queue Stats:\n");
+    dprintf(fd, "          Queued SDUs (now): %zu\n", iso.tx_q.size);
+    dprintf(fd, "          SDUs (count): %zu\n", stats.sdu_count);
+    dprintf(fd, "          Dropped, queue full (count): %zu\n",
+            stats.overflow_count);
+    dprintf(fd, "          Dropped, deadline expired (count): %zu\n",
+            stats.expired_count);
+    dprintf(fd, "          Dropped, oversized (count): %zu\n",
+            stats.oversize_count);
+    dprintf(fd, "          Max latency (us): %llu\n",
+            (unsigned long long)stats.max_latency_us);
+
+    dprintf(fd, "          Latency histogram (us):");
+    for (size_t i = 0; i < kIsoTxLatencyBucketsUs.size(); i++)
+      dprintf(fd, " <%u: %zu,", kIsoTxLatencyBucketsUs[i],
+              stats.latency_histogram[i]);
+    dprintf(fd, " >=%u: %zu\n", kIsoTxLatencyBucketsUs.back(),
+            stats.latency_histogram.back());
+
+    dprintf(fd, "          Consecutive drops histogram:");
+    for (size_t i = 0; i < kIsoTxDropRunBuckets - 1; i++)
+      dprintf(fd, " %zu: %zu,", i + 1, stats.drop_run_histogram[i]);
+    dprintf(fd, " >=%zu: %zu\n", kIsoTxDropRunBuckets,
+            stats.drop_run_histogram.back());
+  }
+
   static void dump_event_stats(int fd, const iso_base::event_stats& stats) {
     uint64_t now_us = bluetooth::common::time_get_os_boottime_us();
 
@@ -966,6 +1161,7 @@ struct iso_impl {
       dprintf(fd, "        State Flags: 0x%02hx\n",
               cis_pair.second->state_flags.load());
       dump_credits_stats(fd, cis_pair.second->cr_stats);
+      dump_tx_stats(fd, *cis_pair.second);
       dump_event_stats(fd, cis_pair.second->evt_stats);
     }
     dprintf(fd, "    BISes:\n");
@@ -978,6 +1174,7 @@ struct iso_impl {
       dprintf(fd, "        State Flags: 0x%02hx\n",
               cis_pair.second->state_flags.load());
       dump_credits_stats(fd, cis_pair.second->cr_stats);
+      dump_tx_stats(fd, *cis_pair.second);
       dump_event_stats(fd, cis_pair.second->evt_stats);
     }
     dprintf(fd, "  ----------------\n ");
@@ -989,6 +1186,9 @@ struct iso_impl {
 
   std::atomic_uint16_t iso_credits_;
   uint16_t iso_buffer_size_;
+  uint64_t tx_seq_ = 0;
+  /* Stamps the queued SDUs and checks their deadlines */
+  uint64_t (*tx_clock_us_)() = bluetooth::common::time_get_os_boottime_us;
   uint32_t last_big_create_req_sdu_itv_;
 
   CigCallbacks* cig_callbacks_ = nullptr;
@@ -22,7 +22,6 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
-#include <cfloat>
 #include <memory>
 
 #include "btif/include/core_callbacks.h"
@@ -30,6 +29,7 @@
 #include "os/log.h"
 #include "osi/include/allocator.h"
 #include "stack/btm/btm_sco.h"
+#include "stack/btm/btm_sco_plc_kernels.h"
 #include "udrv/include/uipc.h"
 
 #define SCO_DATA_READ_POLL_MS 10
@@ -166,12 +166,9 @@ static const uint8_t btm_msbc_zero_packet[] = {
     /* End of Audio Samples */
     0x00 /* A padding byte defined by mSBC */};
 
-/* Raised Cosine table for OLA */
-static const float rcos[BTM_PLC_OLAL] = {
-    0.99148655f, 0.96623611f, 0.92510857f, 0.86950446f,
-    0.80131732f, 0.72286918f, 0.63683150f, 0.54613418f,
-    0.45386582f, 0.36316850f, 0.27713082f, 0.19868268f,
-    0.13049554f, 0.07489143f, 0.03376389f, 0.00851345f};
+static_assert(BTM_PLC_TL == kPlcTemplateLength);
+static_assert(BTM_PLC_WL == kPlcWindowLength);
+static_assert(BTM_PLC_OLAL == kPlcOverlapAddLength);
 
 static int16_t f_to_s16(float input) {
   return input > INT16_MAX   ? INT16_MAX
@@ -237,35 +234,12 @@ struct tBTM_MSBC_PLC {
 
   void overlap_add(int16_t* output, float scaler_d, const int16_t* desc,
                    float scaler_a, const int16_t* asc) {
-    for (int i = 0; i < BTM_PLC_OLAL; i++) {
-      output[i] = f_to_s16(scaler_d * desc[i] * rcos[i] +
-                           scaler_a * asc[i] * rcos[BTM_PLC_OLAL - 1 - i]);
-    }
-  }
-
-  float cross_correlation(int16_t* x, int16_t* y) {
-    float sum = 0, x2 = 0, y2 = 0;
-
-    for (int i = 0; i < BTM_PLC_TL; i++) {
-      sum += ((float)x[i]) * y[i];
-      x2 += ((float)x[i]) * x[i];
-      y2 += ((float)y[i]) * y[i];
-    }
-    return sum / sqrtf(x2 * y2);
+    get_plc_kernels().overlap_add(output, scaler_d, desc, scaler_a, asc);
   }
 
   int pattern_match(int16_t* hist) {
-    int best = 0;
-    float cn, max_cn = FLT_MIN;
-
-    for (int i = 0; i < BTM_PLC_WL; i++) {
-      cn = cross_correlation(&hist[BTM_PLC_HL - BTM_PLC_TL], &hist[i]);
-      if (cn > max_cn) {
-        best = i;
-        max_cn = cn;
-      }
-    }
-    return best;
+    return get_plc_kernels().pattern_match(&hist[BTM_PLC_HL - BTM_PLC_TL],
+                                           hist);
   }
 
   float amplitude_match(int16_t* x, int16_t* y) {
@@ -0,0 +1,327 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stack/btm/btm_sco_plc_kernels.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <cfloat>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BTM_PLC_X86
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define BTM_PLC_NEON
+#endif
+
+namespace bluetooth::audio::sco::wbs {
+namespace {
+
+constexpr int kWindowSamples = kPlcWindowLength + kPlcTemplateLength - 1;
+
+/* Raised Cosine table for OLA */
+constexpr float rcos[kPlcOverlapAddLength] = {
+    0.99148655f, 0.96623611f, 0.92510857f, 0.86950446f,
+    0.80131732f, 0.72286918f, 0.63683150f, 0.54613418f,
+    0.45386582f, 0.36316850f, 0.27713082f, 0.19868268f,
+    0.13049554f, 0.07489143f, 0.03376389f, 0.00851345f};
+
+/* rcos in reverse order, so that both fades are read forward */
+constexpr float rcos_reversed[kPlcOverlapAddLength] = {
+    0.00851345f, 0.03376389f, 0.07489143f, 0.13049554f,
+    0.19868268f, 0.27713082f, 0.36316850f, 0.45386582f,
+    0.54613418f, 0.63683150f, 0.72286918f, 0.80131732f,
+    0.86950446f, 0.92510857f, 0.96623611f, 0.99148655f};
+
+int16_t f_to_s16(float input) {
+  return input > INT16_MAX   ? INT16_MAX
+         : input < INT16_MIN ? INT16_MIN
+                             : (int16_t)input;
+}
+
+/* Every implementation computes the terms of a correlation in the same order,
+ * one lag per SIMD lane, so that they all pick the same lag. */
+float template_energy(const float* x) {
+  float x2 = 0;
+  for (int k = 0; k < kPlcTemplateLength; k++) {
+    x2 += x[k] * x[k];
+  }
+  return x2;
+}
+
+/* Square roots and divisions are correctly rounded, so normalizing the
+ * correlations in SIMD lanes does not change them either. */
+int select_best_lag(const float* cns) {
+  int best = 0;
+  float max_cn = FLT_MIN;
+  for (int i = 0; i < kPlcWindowLength; i++) {
+    float cn = cns[i];
+    if (cn > max_cn) {
+      best = i;
+      max_cn = cn;
+    }
+  }
+  return best;
+}
+
+void to_float(const int16_t* input, int len, float* output) {
+  for (int i = 0; i < len; i++) {
+    output[i] = input[i];
+  }
+}
+
+int pattern_match_scalar(const int16_t* templ, const int16_t* window) {
+  float x[kPlcTemplateLength];
+  float y[kWindowSamples];
+  float sums[kPlcWindowLength];
+  float y2s[kPlcWindowLength];
+  float cns[kPlcWindowLength];
+  to_float(templ, kPlcTemplateLength, x);
+  to_float(window, kWindowSamples, y);
+  float x2 = template_energy(x);
+
+  for (int i = 0; i < kPlcWindowLength; i++) {
+    float sum = 0, y2 = 0;
+    for (int k = 0; k < kPlcTemplateLength; k++) {
+      sum += x[k] * y[i + k];
+      y2 += y[i + k] * y[i + k];
+    }
+    sums[i] = sum;
+    y2s[i] = y2;
+  }
+  for (int i = 0; i < kPlcWindowLength; i++) {
+    cns[i] = sums[i] / sqrtf(x2 * y2s[i]);
+  }
+  return select_best_lag(cns);
+}
+
+void overlap_add_scalar(int16_t* output, float scaler_d, const int16_t* desc,
+                        float scaler_a, const int16_t* asc) {
+  int16_t result[kPlcOverlapAddLength];
+  for (int i = 0; i < kPlcOverlapAddLength; i++) {
+    result[i] = f_to_s16(scaler_d * desc[i] * rcos[i] +
+                         scaler_a * asc[i] * rcos_reversed[i]);
+  }
+  memcpy(output, result, sizeof(result));
+}
+
+#if defined(BTM_PLC_X86)
+
+int pattern_match_sse2(const int16_t* templ, const int16_t* window) {
+  float x[kPlcTemplateLength];
+  float y[kWindowSamples];
+  alignas(16) float cns[kPlcWindowLength];
+  to_float(templ, kPlcTemplateLength, x);
+  to_float(window, kWindowSamples, y);
+  const __m128 x2 = _mm_set1_ps(template_energy(x));
+
+  for (int i = 0; i < kPlcWindowLength; i += 4) {
+    __m128 sum = _mm_setzero_ps();
+    __m128 y2 = _mm_setzero_ps();
+    for (int k = 0; k < kPlcTemplateLength; k++) {
+      __m128 yk = _mm_loadu_ps(&y[i + k]);
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(x[k]), yk));
+      y2 = _mm_add_ps(y2, _mm_mul_ps(yk, yk));
+    }
+    _mm_store_ps(&cns[i],
+                 _mm_div_ps(sum, _mm_sqrt_ps(_mm_mul_ps(x2, y2))));
+  }
+  return select_best_lag(cns);
+}
+
+__m128 load_s16_sse2(const int16_t* input) {
+  __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(input));
+  return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+}
+
+void overlap_add_sse2(int16_t* output, float scaler_d, const int16_t* desc,
+                      float scaler_a, const int16_t* asc) {
+  const __m128 sd = _mm_set1_ps(scaler_d);
+  const __m128 sa = _mm_set1_ps(scaler_a);
+  const __m128 max = _mm_set1_ps(INT16_MAX);
+  const __m128 min = _mm_set1_ps(INT16_MIN);
+  __m128i result[kPlcOverlapAddLength / 8];
+  for (int i = 0; i < kPlcOverlapAddLength; i += 8) {
+    __m128i half[2];
+    for (int j = 0; j < 2; j++) {
+      int n = i + 4 * j;
+      __m128 d = _mm_mul_ps(_mm_mul_ps(sd, load_s16_sse2(&desc[n])),
+                            _mm_loadu_ps(&rcos[n]));
+      __m128 a = _mm_mul_ps(_mm_mul_ps(sa, load_s16_sse2(&asc[n])),
+                            _mm_loadu_ps(&rcos_reversed[n]));
+      half[j] = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_add_ps(d, a), min),
+                                            max));
+    }
+    result[i / 8] = _mm_packs_epi32(half[0], half[1]);
+  }
+  memcpy(output, result, sizeof(result));
+}
+
+__attribute__((target("avx2"))) int pattern_match_avx2(const int16_t* templ,
+                                                       const int16_t* window) {
+  float x[kPlcTemplateLength];
+  float y[kWindowSamples];
+  alignas(32) float cns[kPlcWindowLength];
+  to_float(templ, kPlcTemplateLength, x);
+  to_float(window, kWindowSamples, y);
+  const __m256 x2 = _mm256_set1_ps(template_energy(x));
+
+  for (int i = 0; i < kPlcWindowLength; i += 8) {
+    __m256 sum = _mm256_setzero_ps();
+    __m256 y2 = _mm256_setzero_ps();
+    for (int k = 0; k < kPlcTemplateLength; k++) {
+      __m256 yk = _mm256_loadu_ps(&y[i + k]);
+      sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(x[k]), yk));
+      y2 = _mm256_add_ps(y2, _mm256_mul_ps(yk, yk));
+    }
+    _mm256_store_ps(&cns[i], _mm256_div_ps(
+                                 sum, _mm256_sqrt_ps(_mm256_mul_ps(x2, y2))));
+  }
+  return select_best_lag(cns);
+}
+
+__attribute__((target("avx2"))) __m256 load_s16_avx2(const int16_t* input) {
+  return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(input))));
+}
+
+__attribute__((target("avx2"))) void overlap_add_avx2(int16_t* output,
+                                                      float scaler_d,
+                                                      const int16_t* desc,
+                                                      float scaler_a,
+                                                      const int16_t* asc) {
+  const __m256 sd = _mm256_set1_ps(scaler_d);
+  const __m256 sa = _mm256_set1_ps(scaler_a);
+  const __m256 max = _mm256_set1_ps(INT16_MAX);
+  const __m256 min = _mm256_set1_ps(INT16_MIN);
+  __m256i half[2];
+  for (int j = 0; j < 2; j++) {
+    int n = 8 * j;
+    __m256 d = _mm256_mul_ps(_mm256_mul_ps(sd, load_s16_avx2(&desc[n])),
+                             _mm256_loadu_ps(&rcos[n]));
+    __m256 a = _mm256_mul_ps(_mm256_mul_ps(sa, load_s16_avx2(&asc[n])),
+                             _mm256_loadu_ps(&rcos_reversed[n]));
+    half[j] = _mm256_cvttps_epi32(
+        _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(d, a), min), max));
+  }
+  // _mm256_packs_epi32 interleaves the 128 bit lanes of its inputs
+  __m256i result = _mm256_permute4x64_epi64(
+      _mm256_packs_epi32(half[0], half[1]), 0xd8);
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(output), result);
+}
+
+static_assert(kPlcOverlapAddLength == 16,
+              "overlap_add_avx2 handles exactly 16 samples");
+
+#elif defined(BTM_PLC_NEON)
+
+int pattern_match_neon(const int16_t* templ, const int16_t* window) {
+  float x[kPlcTemplateLength];
+  float y[kWindowSamples];
+  float cns[kPlcWindowLength];
+  to_float(templ, kPlcTemplateLength, x);
+  to_float(window, kWindowSamples, y);
+  const float32x4_t x2 = vdupq_n_f32(template_energy(x));
+
+  for (int i = 0; i < kPlcWindowLength; i += 4) {
+    float32x4_t sum = vdupq_n_f32(0);
+    float32x4_t y2 = vdupq_n_f32(0);
+    for (int k = 0; k < kPlcTemplateLength; k++) {
+      float32x4_t yk = vld1q_f32(&y[i + k]);
+      // Separate multiplies and adds round like the scalar code
+      sum = vaddq_f32(sum, vmulq_n_f32(yk, x[k]));
+      y2 = vaddq_f32(y2, vmulq_f32(yk, yk));
+    }
+    vst1q_f32(&cns[i], vdivq_f32(sum, vsqrtq_f32(vmulq_f32(x2, y2))));
+  }
+  return select_best_lag(cns);
+}
+
+float32x4_t load_s16_neon(const int16_t* input) {
+  return vcvtq_f32_s32(vmovl_s16(vld1_s16(input)));
+}
+
+void overlap_add_neon(int16_t* output, float scaler_d, const int16_t* desc,
+                      float scaler_a, const int16_t* asc) {
+  const float32x4_t max = vdupq_n_f32(INT16_MAX);
+  const float32x4_t min = vdupq_n_f32(INT16_MIN);
+  int16_t result[kPlcOverlapAddLength];
+  for (int i = 0; i < kPlcOverlapAddLength; i += 4) {
+    float32x4_t d = vmulq_f32(vmulq_n_f32(load_s16_neon(&desc[i]), scaler_d),
+                              vld1q_f32(&rcos[i]));
+    float32x4_t a = vmulq_f32(vmulq_n_f32(load_s16_neon(&asc[i]), scaler_a),
+                              vld1q_f32(&rcos_reversed[i]));
+    float32x4_t sum = vminq_f32(vmaxq_f32(vaddq_f32(d, a), min), max);
+    vst1_s16(&result[i], vqmovn_s32(vcvtq_s32_f32(sum)));
+  }
+  memcpy(output, result, sizeof(result));
+}
+
+#endif
+
+constexpr PlcKernels kScalarKernels = {PlcImplementation::SCALAR,
+                                       pattern_match_scalar,
+                                       overlap_add_scalar};
+#if defined(BTM_PLC_X86)
+constexpr PlcKernels kSse2Kernels = {PlcImplementation::SSE2,
+                                     pattern_match_sse2, overlap_add_sse2};
+constexpr PlcKernels kAvx2Kernels = {PlcImplementation::AVX2,
+                                     pattern_match_avx2, overlap_add_avx2};
+#elif defined(BTM_PLC_NEON)
+constexpr PlcKernels kNeonKernels = {PlcImplementation::NEON,
+                                     pattern_match_neon, overlap_add_neon};
+#endif
+
+}  // namespace
+
+const PlcKernels& get_plc_kernels() {
+  static const PlcKernels& kernels =
+      get_plc_kernels(get_supported_plc_implementations().back());
+  return kernels;
+}
+
+const PlcKernels& get_plc_kernels(PlcImplementation implementation) {
+  switch (implementation) {
+#if defined(BTM_PLC_X86)
+    case PlcImplementation::SSE2:
+      return kSse2Kernels;
+    case PlcImplementation::AVX2:
+      return kAvx2Kernels;
+#elif defined(BTM_PLC_NEON)
+    case PlcImplementation::NEON:
+      return kNeonKernels;
+#endif
+    default:
+      return kScalarKernels;
+  }
+}
+
+std::vector<PlcImplementation> get_supported_plc_implementations() {
+  std::vector<PlcImplementation> implementations = {PlcImplementation::SCALAR};
+#if defined(BTM_PLC_X86)
+  implementations.push_back(PlcImplementation::SSE2);
+  if (__builtin_cpu_supports("avx2")) {
+    implementations.push_back(PlcImplementation::AVX2);
+  }
+#elif defined(BTM_PLC_NEON)
+  implementations.push_back(PlcImplementation::NEON);
+#endif
+  return implementations;
+}
+
+}  // namespace bluetooth::audio::sco::wbs
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+/* Signal processing kernels of the mSBC packet loss concealment in
+ * btm_sco_hci.cc, with SIMD implementations selected at runtime. */
+namespace bluetooth::audio::sco::wbs {
+
+/* Lengths in samples of the PLC template, of the window it is matched
+ * against and of the overlap-add. */
+constexpr int kPlcTemplateLength = 64;
+constexpr int kPlcWindowLength = 256;
+constexpr int kPlcOverlapAddLength = 16;
+
+enum class PlcImplementation { SCALAR, SSE2, AVX2, NEON };
+
+struct PlcKernels {
+  PlcImplementation implementation;
+
+  /* Finds the segment of the history best matching a template.
+   * Args:
+   *    templ - kPlcTemplateLength samples to match.
+   *    window - kPlcWindowLength + kPlcTemplateLength - 1 samples to search.
+   * Returns:
+   *    The lag in [0, kPlcWindowLength) of the segment of |window| with the
+   *    highest normalized cross correlation with |templ|, the first one if
+   *    several are equal.
+   */
+  int (*pattern_match)(const int16_t* templ, const int16_t* window);
+
+  /* Glues two signals together over kPlcOverlapAddLength samples, fading
+   * out |desc| scaled by |scaler_d| and fading in |asc| scaled by
+   * |scaler_a| with a raised cosine. |output| may alias either input. */
+  void (*overlap_add)(int16_t* output, float scaler_d, const int16_t* desc,
+                      float scaler_a, const int16_t* asc);
+};
+
+/* Returns the fastest kernels supported by the CPU. */
+const PlcKernels& get_plc_kernels();
+
+/* Returns the kernels of |implementation|, which must be supported by the
+ * CPU. */
+const PlcKernels& get_plc_kernels(PlcImplementation implementation);
+
+/* Returns the implementations supported by the CPU, SCALAR first. */
+std::vector<PlcImplementation> get_supported_plc_implementations();
+
+}  // namespace bluetooth::audio::sco::wbs
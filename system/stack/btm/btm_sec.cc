@@ -3395,6 +3395,7 @@ void btm_sec_encrypt_change(uint16_t handle, tHCI_STATUS status,
         status == HCI_ERR_ENCRY_MODE_NOT_ACCEPTABLE) {
       p_dev_rec->sec_rec.sec_flags &= ~(BTM_SEC_LE_LINK_KEY_KNOWN);
       p_dev_rec->sec_rec.ble_keys.key_type = BTM_LE_KEY_NONE;
+      btm_dev_invalidate_lookup_cache();
     }
     p_dev_rec->sec_rec.sec_status = status;
     btm_ble_link_encrypted(p_dev_rec->ble.pseudo_addr, encr_enable);
@@ -5158,6 +5159,7 @@ static uint16_t btm_sec_set_serv_level4_flags(uint16_t cur_security,
 void btm_sec_clear_ble_keys(tBTM_SEC_DEV_REC* p_dev_rec) {
   log::verbose("Clearing BLE Keys");
   memset(&p_dev_rec->sec_rec.ble_keys, 0, sizeof(tBTM_SEC_BLE_KEYS));
+  btm_dev_invalidate_lookup_cache();
 
   btm_ble_resolving_list_remove_dev(p_dev_rec);
 }
@@ -325,6 +325,7 @@ tGATT_STATUS GATTS_AddService(tGATT_IF gatt_if, btgatt_db_element_t* service,
     elem.sdp_handle = 0;
   }
 
+  gatt_cb.srv_handle_index->Add(rit);
   gatt_update_last_srv_info();
 
   log::verbose("allocated el s_hdl={}, e_hdl={}, type={}, sdp_hdl={}",
@@ -425,6 +426,7 @@ void GATTS_StopService(uint16_t service_handle) {
     get_legacy_stack_sdp_api()->handle.SDP_DeleteRecord(it->sdp_handle);
   }
 
+  gatt_cb.srv_handle_index->Remove(*it);
   gatt_cb.srv_list_info->erase(it);
   gatt_update_last_srv_info();
 }
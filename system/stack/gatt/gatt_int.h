@@ -23,8 +23,10 @@
 #include <base/strings/stringprintf.h>
 #include <bluetooth/log.h>
 
+#include <array>
 #include <deque>
 #include <list>
+#include <memory>
 #include <unordered_set>
 #include <vector>
 
@@ -289,6 +291,71 @@ typedef struct {
   bool is_primary;
 } tGATT_SRV_LIST_ELEM;
 
+/* Maps every handle of the started services to its service and attribute, so
+ * that server requests are dispatched without scanning the service list and
+ * the attribute lists.
+ *
+ * The 16 bit handle space is split in pages of 256 handles, which are only
+ * allocated while a service covers them.
+ */
+class GattServerHandleIndex {
+ public:
+  using SrvIterator = std::list<tGATT_SRV_LIST_ELEM>::iterator;
+
+  struct Entry {
+    bool in_use = false;
+    SrvIterator srv;
+    /* nullptr for a handle of the service range without attribute */
+    tGATT_ATTR* attr = nullptr;
+  };
+
+  /* The service must stay in its list, and its attributes in place, until it
+   * is removed */
+  void Add(SrvIterator srv) {
+    for (uint32_t handle = srv->s_hdl; handle <= srv->e_hdl; handle++) {
+      std::unique_ptr<Page>& page = pages_[handle >> kPageBits];
+      if (page == nullptr) page = std::make_unique<Page>();
+      Entry& entry = page->entries[handle & kPageMask];
+      if (!entry.in_use) page->used++;
+      entry = {.in_use = true, .srv = srv, .attr = nullptr};
+    }
+    for (tGATT_ATTR& attr : srv->p_db->attr_list) {
+      if (attr.handle < srv->s_hdl || attr.handle > srv->e_hdl) continue;
+      pages_[attr.handle >> kPageBits]->entries[attr.handle & kPageMask].attr =
+          &attr;
+    }
+  }
+
+  void Remove(const tGATT_SRV_LIST_ELEM& srv) {
+    for (uint32_t handle = srv.s_hdl; handle <= srv.e_hdl; handle++) {
+      std::unique_ptr<Page>& page = pages_[handle >> kPageBits];
+      if (page == nullptr) continue;
+      Entry& entry = page->entries[handle & kPageMask];
+      if (!entry.in_use || &*entry.srv != &srv) continue;
+      entry = {};
+      if (--page->used == 0) page.reset();
+    }
+  }
+
+  const Entry* Find(uint16_t handle) const {
+    const Page* page = pages_[handle >> kPageBits].get();
+    if (page == nullptr) return nullptr;
+    const Entry& entry = page->entries[handle & kPageMask];
+    return entry.in_use ? &entry : nullptr;
+  }
+
+ private:
+  static constexpr unsigned kPageBits = 8;
+  static constexpr unsigned kPageMask = (1 << kPageBits) - 1;
+
+  struct Page {
+    std::array<Entry, 1 << kPageBits> entries;
+    size_t used = 0;
+  };
+
+  std::array<std::unique_ptr<Page>, 1 << (16 - kPageBits)> pages_;
+};
+
 typedef struct {
   std::deque<tGATT_CLCB*> pending_enc_clcb; /* pending encryption channel q */
   tGATT_SEC_ACTION sec_act;
@@ -411,6 +478,7 @@ typedef struct {
   tGATT_IF gatt_if;
   std::list<tGATT_HDL_LIST_ELEM>* hdl_list_info;
   std::list<tGATT_SRV_LIST_ELEM>* srv_list_info;
+  GattServerHandleIndex* srv_handle_index; /* handles of srv_list_info */
 
   fixed_queue_t* srv_chg_clt_q; /* service change clients queue */
   tGATT_REG cl_rcb[GATT_MAX_APPS];
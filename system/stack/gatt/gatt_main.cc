@@ -152,6 +152,7 @@ void gatt_init(void) {
 
   gatt_cb.hdl_list_info = new std::list<tGATT_HDL_LIST_ELEM>();
   gatt_cb.srv_list_info = new std::list<tGATT_SRV_LIST_ELEM>();
+  gatt_cb.srv_handle_index = new GattServerHandleIndex();
   gatt_profile_db_init();
 
   EattExtension::GetInstance()->Start();
@@ -196,6 +197,8 @@ void gatt_free(void) {
   gatt_cb.hdl_list_info->clear();
   delete gatt_cb.hdl_list_info;
   gatt_cb.hdl_list_info = nullptr;
+  delete gatt_cb.srv_handle_index;
+  gatt_cb.srv_handle_index = nullptr;
   gatt_cb.srv_list_info->clear();
   delete gatt_cb.srv_list_info;
   gatt_cb.srv_list_info = nullptr;
@@ -817,15 +817,12 @@ void  gatt_ind_ack_timeout(void* data) {
  ******************************************************************************/
 std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
     uint16_t handle) {
-  auto it = gatt_cb.srv_list_info->begin();
-
-  for (; it != gatt_cb.srv_list_info->end(); it++) {
-    if (it->s_hdl <= handle && it->e_hdl >= handle) {
-      return it;
-    }
+  const GattServerHandleIndex::Entry* entry =
+      gatt_cb.srv_handle_index->Find(handle);
+  if (entry == nullptr) {
+    return gatt_cb.srv_list_info->end();
   }
-
-  return it;
+  return entry->srv;
 }
 
 /*******************************************************************************
@@ -246,6 +246,14 @@ class IsoManager {
    */
   void Dump(int fd);
 
+  /**
+   * Replaces the clock used for the deadlines of the SDUs waiting for credits
+   *
+   * @param clock_us returns the time in microseconds, nullptr restores the
+   * boot time clock
+   */
+  void SetTxClockForTest(uint64_t (*clock_us)());
+
  private:
   struct impl;
   std::unique_ptr<impl> pimpl_;
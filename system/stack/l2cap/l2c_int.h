@@ -50,6 +50,11 @@
 constexpr uint16_t L2CAP_CREDIT_BASED_MIN_MTU = 64;
 constexpr uint16_t L2CAP_CREDIT_BASED_MIN_MPS = 64;
 
+/* Share of the controller ACL buffers of links set to L2CAP_PRIORITY_HIGH,
+ * relative to normal links, when the weighted ACL scheduler is enabled */
+constexpr uint8_t L2CAP_HIGH_PRIORITY_ACL_WEIGHT = 4;
+constexpr uint8_t L2CAP_NORMAL_PRIORITY_ACL_WEIGHT = 1;
+
 /*
  * Timeout values (in milliseconds).
  */
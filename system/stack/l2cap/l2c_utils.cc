@@ -32,6 +32,7 @@
 #include "hal/snoop_logger.h"
 #include "hci/controller_interface.h"
 #include "internal_include/bt_target.h"
+#include "main/shim/acl_api.h"
 #include "main/shim/entry.h"
 #include "os/log.h"
 #include "osi/include/allocator.h"
@@ -2395,6 +2396,10 @@ bool l2cu_set_acl_priority(const RawAddress& bd_addr, tL2CAP_PRIORITY priority,
   if (p_lcb->acl_priority != priority) {
     p_lcb->acl_priority = priority;
     l2c_link_adjust_allocation();
+    bluetooth::shim::ACL_SetLinkWeight(
+        p_lcb->Handle(), (priority == L2CAP_PRIORITY_HIGH)
+                             ? L2CAP_HIGH_PRIORITY_ACL_WEIGHT
+                             : L2CAP_NORMAL_PRIORITY_ACL_WEIGHT);
   }
   return (true);
 }
@@ -2217,6 +2217,7 @@ void smp_br_process_link_key(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
   if (p_dev_rec) {
     log::verbose("dev_type={}", p_dev_rec->device_type);
     p_dev_rec->device_type |= BT_DEVICE_TYPE_BLE;
+    btm_dev_invalidate_lookup_cache();
   } else {
     log::error("failed to find Security Record");
   }
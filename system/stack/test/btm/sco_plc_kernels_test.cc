@@ -0,0 +1,139 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stack/btm/btm_sco_plc_kernels.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+using bluetooth::audio::sco::wbs::get_plc_kernels;
+using bluetooth::audio::sco::wbs::get_supported_plc_implementations;
+using bluetooth::audio::sco::wbs::kPlcOverlapAddLength;
+using bluetooth::audio::sco::wbs::kPlcTemplateLength;
+using bluetooth::audio::sco::wbs::kPlcWindowLength;
+using bluetooth::audio::sco::wbs::PlcImplementation;
+using bluetooth::audio::sco::wbs::PlcKernels;
+
+constexpr int kWindowSamples = kPlcWindowLength + kPlcTemplateLength - 1;
+
+// Speech-like signal: a few tones and some noise
+std::vector<int16_t> MakeSignal(std::mt19937& rng, int len, float amplitude) {
+  std::uniform_real_distribution<float> phase(0, 2 * M_PI);
+  std::normal_distribution<float> noise(0, amplitude / 20);
+  float p0 = phase(rng), p1 = phase(rng), p2 = phase(rng);
+  std::vector<int16_t> signal(len);
+  for (int i = 0; i < len; i++) {
+    float v = amplitude * (0.5f * sinf(p0 + i * 0.11f) +
+                           0.3f * sinf(p1 + i * 0.37f) +
+                           0.2f * sinf(p2 + i * 0.05f)) +
+              noise(rng);
+    signal[i] = static_cast<int16_t>(std::fmax(-32768, std::fmin(32767, v)));
+  }
+  return signal;
+}
+
+class ScoPlcKernelsTest : public ::testing::TestWithParam<PlcImplementation> {
+ protected:
+  const PlcKernels& kernels_ = get_plc_kernels(GetParam());
+  const PlcKernels& scalar_ = get_plc_kernels(PlcImplementation::SCALAR);
+  std::mt19937 rng_{1234};
+};
+
+TEST_P(ScoPlcKernelsTest, pattern_match_same_lag_as_scalar) {
+  ASSERT_EQ(kernels_.implementation, GetParam());
+  for (int i = 0; i < 200; i++) {
+    auto window = MakeSignal(rng_, kWindowSamples, 100.0f + 150 * i);
+    auto templ = MakeSignal(rng_, kPlcTemplateLength, 100.0f + 150 * i);
+    EXPECT_EQ(kernels_.pattern_match(templ.data(), window.data()),
+              scalar_.pattern_match(templ.data(), window.data()));
+  }
+}
+
+TEST_P(ScoPlcKernelsTest, pattern_match_finds_copy_of_template) {
+  for (int lag : {0, 1, 7, 100, kPlcWindowLength - 1}) {
+    auto window = MakeSignal(rng_, kWindowSamples, 3000.0f);
+    std::normal_distribution<float> noise(0, 3000.0f);
+    std::vector<int16_t> templ(kPlcTemplateLength);
+    for (auto& sample : templ) {
+      sample = static_cast<int16_t>(noise(rng_));
+    }
+    std::copy(templ.begin(), templ.end(), window.begin() + lag);
+    EXPECT_EQ(kernels_.pattern_match(templ.data(), window.data()), lag);
+  }
+}
+
+TEST_P(ScoPlcKernelsTest, pattern_match_silence) {
+  std::vector<int16_t> window(kWindowSamples, 0);
+  std::vector<int16_t> templ(kPlcTemplateLength, 0);
+  EXPECT_EQ(kernels_.pattern_match(templ.data(), window.data()), 0);
+}
+
+TEST_P(ScoPlcKernelsTest, overlap_add_same_as_scalar) {
+  std::uniform_int_distribution<int> sample(-32768, 32767);
+  for (float scaler : {0.75f, 1.0f, 1.2f}) {
+    for (int i = 0; i < 100; i++) {
+      int16_t desc[kPlcOverlapAddLength], asc[kPlcOverlapAddLength];
+      for (int j = 0; j < kPlcOverlapAddLength; j++) {
+        desc[j] = sample(rng_);
+        asc[j] = sample(rng_);
+      }
+      int16_t expected[kPlcOverlapAddLength], output[kPlcOverlapAddLength];
+      scalar_.overlap_add(expected, 1.0f, desc, scaler, asc);
+      kernels_.overlap_add(output, 1.0f, desc, scaler, asc);
+      for (int j = 0; j < kPlcOverlapAddLength; j++) {
+        EXPECT_NEAR(output[j], expected[j], 1) << "at index " << j;
+      }
+    }
+  }
+}
+
+TEST_P(ScoPlcKernelsTest, overlap_add_in_place) {
+  int16_t desc[kPlcOverlapAddLength], asc[kPlcOverlapAddLength];
+  for (int j = 0; j < kPlcOverlapAddLength; j++) {
+    desc[j] = 1000;
+    asc[j] = -1000 * j;
+  }
+  int16_t expected[kPlcOverlapAddLength];
+  scalar_.overlap_add(expected, 1.0f, desc, 1.0f, asc);
+  kernels_.overlap_add(asc, 1.0f, desc, 1.0f, asc);
+  for (int j = 0; j < kPlcOverlapAddLength; j++) {
+    EXPECT_NEAR(asc[j], expected[j], 1) << "at index " << j;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    ScoPlcKernels, ScoPlcKernelsTest,
+    ::testing::ValuesIn(get_supported_plc_implementations()),
+    [](const ::testing::TestParamInfo<PlcImplementation>& info) {
+      switch (info.param) {
+        case PlcImplementation::SCALAR:
+          return "scalar";
+        case PlcImplementation::SSE2:
+          return "sse2";
+        case PlcImplementation::AVX2:
+          return "avx2";
+        case PlcImplementation::NEON:
+          return "neon";
+      }
+      return "unknown";
+    });
+
+}  // namespace
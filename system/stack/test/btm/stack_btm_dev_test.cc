@@ -18,11 +18,32 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <cstring>
+#include <vector>
+
+#include "crypto_toolbox/crypto_toolbox.h"
 #include "stack/btm/btm_dev.h"
+#include "stack/btm/btm_int_types.h"
 #include "stack/btm/btm_sec_cb.h"
+#include "stack/btm/neighbor_inquiry.h"
+#include "stack/include/btm_api.h"
+#include "stack/include/btm_ble_api.h"
+#include "stack/include/inq_hci_link_interface.h"
 #include "test/common/mock_functions.h"
 #include "test/mock/mock_main_shim_entry.h"
 
+namespace bluetooth {
+namespace testing {
+namespace legacy {
+
+void wipe_secrets_and_remove(tBTM_SEC_DEV_REC* p_dev_rec);
+
+}  // namespace legacy
+}  // namespace testing
+}  // namespace bluetooth
+
+using bluetooth::testing::legacy::wipe_secrets_and_remove;
+
 class StackBtmTest : public testing::Test {
  public:
  protected:
@@ -48,3 +69,152 @@ TEST_F(StackBtmDevTest, btm_sec_allocate_dev_rec__with_list) {
   ASSERT_NE(nullptr, btm_sec_allocate_dev_rec());
   ::btm_sec_cb.Free();
 }
+
+namespace {
+
+Octet16 make_irk(uint8_t seed) {
+  Octet16 irk{};
+  for (size_t i = 0; i < irk.size(); i++) irk[i] = seed + i;
+  return irk;
+}
+
+/* Build a resolvable private address for |irk| from the 22 bit |prand| */
+RawAddress make_rpa(const Octet16& irk, uint32_t prand) {
+  RawAddress rpa;
+  rpa.address[0] = ((prand >> 16) & 0x3f) | 0x40;
+  rpa.address[1] = (prand >> 8) & 0xff;
+  rpa.address[2] = prand & 0xff;
+
+  Octet16 r{};
+  r[0] = rpa.address[2];
+  r[1] = rpa.address[1];
+  r[2] = rpa.address[0];
+  Octet16 hash = crypto_toolbox::aes_128(irk, r);
+  rpa.address[5] = hash[0];
+  rpa.address[4] = hash[1];
+  rpa.address[3] = hash[2];
+  return rpa;
+}
+
+tBTM_SEC_DEV_REC* make_bonded_le_device(uint16_t index) {
+  tBTM_SEC_DEV_REC* p_dev_rec = btm_sec_allocate_dev_rec();
+  p_dev_rec->bd_addr =
+      RawAddress({0x00, 0x11, 0x22, 0x33, static_cast<uint8_t>(index >> 8),
+                  static_cast<uint8_t>(index)});
+  p_dev_rec->device_type = BT_DEVICE_TYPE_BLE;
+  p_dev_rec->sec_rec.ble_keys.key_type = BTM_LE_KEY_PID;
+  p_dev_rec->sec_rec.ble_keys.irk = make_irk(static_cast<uint8_t>(index));
+  return p_dev_rec;
+}
+
+}  // namespace
+
+TEST_F(StackBtmDevTest, btm_find_dev__identity_address) {
+  ::btm_sec_cb.Init(BTM_SEC_MODE_SC);
+  std::vector<tBTM_SEC_DEV_REC*> records;
+  for (uint16_t i = 0; i < 10; i++) records.push_back(make_bonded_le_device(i));
+
+  for (uint16_t i = 0; i < 10; i++) {
+    ASSERT_EQ(records[i], btm_find_dev(records[i]->bd_addr));
+  }
+  ASSERT_EQ(nullptr,
+            btm_find_dev(RawAddress({0x00, 0x11, 0x22, 0x33, 0xff, 0xff})));
+
+  // Direct field updates are picked up once the index is invalidated
+  const RawAddress pseudo_addr({0x00, 0xaa, 0xbb, 0xcc, 0xdd, 0xee});
+  records[3]->ble.pseudo_addr = pseudo_addr;
+  btm_dev_invalidate_lookup_cache();
+  ASSERT_EQ(records[3], btm_find_dev(pseudo_addr));
+
+  ::btm_sec_cb.Free();
+}
+
+TEST_F(StackBtmDevTest, btm_find_dev__resolvable_private_address) {
+  ::btm_sec_cb.Init(BTM_SEC_MODE_SC);
+  std::vector<tBTM_SEC_DEV_REC*> records;
+  for (uint16_t i = 0; i < 10; i++) records.push_back(make_bonded_le_device(i));
+
+  const RawAddress rpa = make_rpa(records[7]->sec_rec.ble_keys.irk, 0x123456);
+  ASSERT_EQ(records[7], btm_find_dev(rpa));
+  // Served from the resolution cache
+  ASSERT_EQ(records[7], btm_find_dev(rpa));
+
+  const RawAddress unknown_rpa = make_rpa(make_irk(0xf0), 0x123456);
+  ASSERT_EQ(nullptr, btm_find_dev(unknown_rpa));
+  ASSERT_EQ(nullptr, btm_find_dev(unknown_rpa));
+
+  // A negative result is dropped once a matching IRK is learned
+  records[2]->sec_rec.ble_keys.irk = make_irk(0xf0);
+  btm_dev_invalidate_lookup_cache();
+  ASSERT_EQ(records[2], btm_find_dev(unknown_rpa));
+
+  // Removing a record must not leave it behind in the cache
+  wipe_secrets_and_remove(records[7]);
+  ASSERT_EQ(nullptr, btm_find_dev(rpa));
+
+  ::btm_sec_cb.Free();
+}
+
+TEST_F(StackBtmDevTest, btm_dev_resolve_rpa) {
+  ::btm_sec_cb.Init(BTM_SEC_MODE_SC);
+  std::vector<tBTM_SEC_DEV_REC*> records;
+  for (uint16_t i = 0; i < 10; i++) records.push_back(make_bonded_le_device(i));
+
+  const RawAddress rpa = make_rpa(records[5]->sec_rec.ble_keys.irk, 0x123456);
+  ASSERT_EQ(records[5], btm_dev_resolve_rpa(rpa));
+  ASSERT_EQ(records[5], btm_dev_resolve_rpa(rpa));
+
+  // Only LE records with an IRK take part
+  records[5]->sec_rec.ble_keys.key_type = 0;
+  btm_dev_invalidate_lookup_cache();
+  ASSERT_EQ(nullptr, btm_dev_resolve_rpa(rpa));
+
+  // The first record in list order wins
+  records[8]->sec_rec.ble_keys.irk = records[5]->sec_rec.ble_keys.irk;
+  records[9]->sec_rec.ble_keys.irk = records[5]->sec_rec.ble_keys.irk;
+  btm_dev_invalidate_lookup_cache();
+  ASSERT_EQ(records[8], btm_dev_resolve_rpa(rpa));
+
+  wipe_secrets_and_remove(records[8]);
+  ASSERT_EQ(records[9], btm_dev_resolve_rpa(rpa));
+
+  ::btm_sec_cb.Free();
+}
+
+TEST_F(StackBtmDevTest, btm_find_dev__device_type_merged_from_inquiry) {
+  ::btm_sec_cb.Init(BTM_SEC_MODE_SC);
+  std::vector<tBTM_SEC_DEV_REC*> records;
+  for (uint16_t i = 0; i < 10; i++) records.push_back(make_bonded_le_device(i));
+
+  // Bonded over BR/EDR, with the IRK distributed through cross transport key
+  // derivation
+  records[4]->device_type = BT_DEVICE_TYPE_BREDR;
+  btm_dev_invalidate_lookup_cache();
+
+  const RawAddress rpa = make_rpa(records[4]->sec_rec.ble_keys.irk, 0x123456);
+  const RawAddress other_rpa = make_rpa(records[6]->sec_rec.ble_keys.irk, 1);
+  ASSERT_EQ(records[4], btm_find_dev(records[4]->bd_addr));
+  ASSERT_EQ(records[6], btm_find_dev(other_rpa));
+  ASSERT_EQ(nullptr, btm_find_dev(rpa));
+  ASSERT_EQ(nullptr, btm_dev_resolve_rpa(rpa));
+
+  // The device is then seen advertising
+  tINQ_DB_ENT* p_ent = btm_inq_db_new(records[4]->bd_addr, true);
+  ASSERT_NE(nullptr, p_ent);
+  p_ent->inq_info.results.device_type = BT_DEVICE_TYPE_BLE;
+  p_ent->inq_info.results.ble_addr_type = BLE_ADDR_PUBLIC;
+
+  tBT_DEVICE_TYPE dev_type;
+  tBLE_ADDR_TYPE addr_type;
+  BTM_ReadDevInfo(records[4]->bd_addr, &dev_type, &addr_type);
+  ASSERT_EQ(BT_DEVICE_TYPE_DUMO, records[4]->device_type);
+
+  // The negative results cached before the merge are gone
+  ASSERT_EQ(records[4], btm_find_dev(rpa));
+  ASSERT_EQ(records[4], btm_dev_resolve_rpa(rpa));
+  ASSERT_EQ(records[4], btm_find_dev(records[4]->bd_addr));
+  ASSERT_EQ(records[6], btm_find_dev(other_rpa));
+
+  BTM_ClearInqDb(nullptr);
+  ::btm_sec_cb.Free();
+}
@@ -25,6 +25,7 @@
 #include "mock_hcic_layer.h"
 #include "osi/include/allocator.h"
 #include "stack/btm/btm_dev.h"
+#include "stack/btm/btm_iso_impl.h"
 #include "stack/include/bt_hdr.h"
 #include "stack/include/bt_types.h"
 #include "stack/include/hci_error_code.h"
@@ -32,6 +33,8 @@
 #include "test/mock/mock_main_shim_hci_layer.h"
 
 using bluetooth::hci::IsoManager;
+using bluetooth::hci::iso_manager::kIsoTxDeadlineSduIntervals;
+using bluetooth::hci::iso_manager::kIsoTxQueueMaxSdus;
 using testing::_;
 using testing::AnyNumber;
 using testing::AtLeast;
@@ -45,6 +48,10 @@ using testing::Test;
 // for function pointer testing purpose
 bool IsIsoActive = false;
 
+// Clock of the ISO transmit queues, only moves when a test advances it
+static uint64_t fake_tx_clock_us = 0;
+static uint64_t FakeTxClockUs() { return fake_tx_clock_us; }
+
 tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t handle) { return nullptr; }
 void BTM_LogHistory(const std::string& tag, const RawAddress& bd_addr,
                     const std::string& msg, const std::string& extra) {}
@@ -174,6 +181,8 @@ class IsoManagerTest : public Test {
     manager_instance_->RegisterCigCallbacks(cig_callbacks_.get());
     manager_instance_->RegisterBigCallbacks(big_callbacks_.get());
     manager_instance_->RegisterOnIsoTrafficActiveCallback(iso_active_callback);
+    fake_tx_clock_us = 1000000;
+    manager_instance_->SetTxClockForTest(FakeTxClockUs);
 
     // Default mock SetCigParams action
     volatile_test_cig_create_cmpl_evt_ = kDefaultCigParamsEvt;
@@ -2185,6 +2194,15 @@ TEST_F(IsoManagerTest, SendIsoDataBigValid) {
   }
 }
 
+static void ReturnIsoCredits(uint16_t handle, uint16_t num_credits) {
+  uint8_t mock_rsp[5];
+  uint8_t* p = mock_rsp;
+  UINT8_TO_STREAM(p, 1);
+  UINT16_TO_STREAM(p, handle);
+  UINT16_TO_STREAM(p, num_credits);
+  IsoManager::GetInstance()->HandleNumComplDataPkts(mock_rsp, sizeof(mock_rsp));
+}
+
 TEST_F(IsoManagerTest, SendIsoDataNoCredits) {
   uint8_t num_buffers = controller_interface_.GetIsoBufferCount();
   std::vector<uint8_t> data_vec(108, 0);
@@ -2204,8 +2222,8 @@ TEST_F(IsoManagerTest, SendIsoDataNoCredits) {
       kDefaultIsoDataPathParams);
 
   /* Try sending twice as much data as we can ignoring the credit limits and
-   * expect the redundant packets to be ignored and not propagated down to the
-   * HCI.
+   * expect the redundant packets to be queued and not propagated down to the
+   * HCI, the oldest being dropped once the queue is full.
    */
   EXPECT_CALL(iso_interface_, HciSend).Times(num_buffers).RetiresOnSaturation();
   for (uint8_t i = 0; i < (2 * num_buffers); i++) {
@@ -2214,13 +2232,14 @@ TEST_F(IsoManagerTest, SendIsoDataNoCredits) {
         data_vec.size());
   }
 
-  // Return all credits for this one handle
-  uint8_t mock_rsp[5];
-  uint8_t* p = mock_rsp;
-  UINT8_TO_STREAM(p, 1);
-  UINT16_TO_STREAM(p, volatile_test_cig_create_cmpl_evt_.conn_handles[0]);
-  UINT16_TO_STREAM(p, num_buffers);
-  IsoManager::GetInstance()->HandleNumComplDataPkts(mock_rsp, sizeof(mock_rsp));
+  // Return all credits for this one handle, the queued packets go down
+  EXPECT_CALL(iso_interface_, HciSend)
+      .Times(kIsoTxQueueMaxSdus)
+      .RetiresOnSaturation();
+  ReturnIsoCredits(volatile_test_cig_create_cmpl_evt_.conn_handles[0],
+                   num_buffers);
+  ReturnIsoCredits(volatile_test_cig_create_cmpl_evt_.conn_handles[0],
+                   kIsoTxQueueMaxSdus);
 
   // Check on BIG
   IsoManager::GetInstance()->CreateBig(volatile_test_big_params_evt_.big_id,
@@ -2229,7 +2248,7 @@ TEST_F(IsoManagerTest, SendIsoDataNoCredits) {
       volatile_test_big_params_evt_.conn_handles[0], kDefaultIsoDataPathParams);
 
   /* Try sending twice as much data as we can ignoring the credit limits and
-   * expect the redundant packets to be ignored and not propagated down to the
+   * expect the redundant packets to be queued and not propagated down to the
    * HCI.
    */
   EXPECT_CALL(iso_interface_, HciSend).Times(num_buffers);
@@ -2259,7 +2278,7 @@ TEST_F(IsoManagerTest, SendIsoDataCreditsReturned) {
       kDefaultIsoDataPathParams);
 
   /* Try sending twice as much data as we can, ignoring the credits limit and
-   * expect the redundant packets to be ignored and not propagated down to the
+   * expect the redundant packets to be queued and not propagated down to the
    * HCI.
    */
   EXPECT_CALL(iso_interface_, HciSend).Times(num_buffers).RetiresOnSaturation();
@@ -2269,16 +2288,17 @@ TEST_F(IsoManagerTest, SendIsoDataCreditsReturned) {
         data_vec.size());
   }
 
-  // Return all credits for this one handle
-  uint8_t mock_rsp[5];
-  uint8_t* p = mock_rsp;
-  UINT8_TO_STREAM(p, 1);
-  UINT16_TO_STREAM(p, volatile_test_cig_create_cmpl_evt_.conn_handles[0]);
-  UINT16_TO_STREAM(p, num_buffers);
-  IsoManager::GetInstance()->HandleNumComplDataPkts(mock_rsp, sizeof(mock_rsp));
+  // Return all credits for this one handle, the queued packets go down
+  EXPECT_CALL(iso_interface_, HciSend)
+      .Times(kIsoTxQueueMaxSdus)
+      .RetiresOnSaturation();
+  ReturnIsoCredits(volatile_test_cig_create_cmpl_evt_.conn_handles[0],
+                   num_buffers);
 
-  // Expect some more events go down the HCI
-  EXPECT_CALL(iso_interface_, HciSend).Times(num_buffers).RetiresOnSaturation();
+  // Expect some more events go down the HCI, with the credits left
+  EXPECT_CALL(iso_interface_, HciSend)
+      .Times(num_buffers - kIsoTxQueueMaxSdus)
+      .RetiresOnSaturation();
   for (uint8_t i = 0; i < (2 * num_buffers); i++) {
     IsoManager::GetInstance()->SendIsoData(
         volatile_test_cig_create_cmpl_evt_.conn_handles[0], data_vec.data(),
@@ -2286,11 +2306,13 @@ TEST_F(IsoManagerTest, SendIsoDataCreditsReturned) {
   }
 
   // Return all credits for this one handle
-  p = mock_rsp;
-  UINT8_TO_STREAM(p, 1);
-  UINT16_TO_STREAM(p, volatile_test_cig_create_cmpl_evt_.conn_handles[0]);
-  UINT16_TO_STREAM(p, num_buffers);
-  IsoManager::GetInstance()->HandleNumComplDataPkts(mock_rsp, sizeof(mock_rsp));
+  EXPECT_CALL(iso_interface_, HciSend)
+      .Times(kIsoTxQueueMaxSdus)
+      .RetiresOnSaturation();
+  ReturnIsoCredits(volatile_test_cig_create_cmpl_evt_.conn_handles[0],
+                   num_buffers);
+  ReturnIsoCredits(volatile_test_cig_create_cmpl_evt_.conn_handles[0],
+                   kIsoTxQueueMaxSdus);
 
   // Check on BIG
   IsoManager::GetInstance()->CreateBig(volatile_test_big_params_evt_.big_id,
@@ -2299,7 +2321,7 @@ TEST_F(IsoManagerTest, SendIsoDataCreditsReturned) {
       volatile_test_big_params_evt_.conn_handles[0], kDefaultIsoDataPathParams);
 
   /* Try sending twice as much data as we can, ignoring the credits limit and
-   * expect the redundant packets to be ignored and not propagated down to the
+   * expect the redundant packets to be queued and not propagated down to the
    * HCI.
    */
   EXPECT_CALL(iso_interface_, HciSend).Times(num_buffers).RetiresOnSaturation();
@@ -2309,15 +2331,16 @@ TEST_F(IsoManagerTest, SendIsoDataCreditsReturned) {
         data_vec.size());
   }
 
-  // Return all credits for this one handle
-  p = mock_rsp;
-  UINT8_TO_STREAM(p, 1);
-  UINT16_TO_STREAM(p, volatile_test_big_params_evt_.conn_handles[0]);
-  UINT16_TO_STREAM(p, num_buffers);
-  IsoManager::GetInstance()->HandleNumComplDataPkts(mock_rsp, sizeof(mock_rsp));
+  // Return all credits for this one handle, the queued packets go down
+  EXPECT_CALL(iso_interface_, HciSend)
+      .Times(kIsoTxQueueMaxSdus)
+      .RetiresOnSaturation();
+  ReturnIsoCredits(volatile_test_big_params_evt_.conn_handles[0], num_buffers);
 
-  // Expect some more events go down the HCI
-  EXPECT_CALL(iso_interface_, HciSend).Times(num_buffers).RetiresOnSaturation();
+  // Expect some more events go down the HCI, with the credits left
+  EXPECT_CALL(iso_interface_, HciSend)
+      .Times(num_buffers - kIsoTxQueueMaxSdus)
+      .RetiresOnSaturation();
   for (uint8_t i = 0; i < (2 * num_buffers); i++) {
     IsoManager::GetInstance()->SendIsoData(
         volatile_test_big_params_evt_.conn_handles[0], data_vec.data(),
@@ -2325,6 +2348,89 @@ TEST_F(IsoManagerTest, SendIsoDataCreditsReturned) {
   }
 }
 
+TEST_F(IsoManagerTest, SendIsoDataQueuedEarliestDeadlineFirst) {
+  uint8_t num_buffers = controller_interface_.GetIsoBufferCount();
+  std::vector<uint8_t> data_vec(108, 0);
+
+  IsoManager::GetInstance()->CreateCig(
+      volatile_test_cig_create_cmpl_evt_.cig_id, kDefaultCigParams);
+
+  bluetooth::hci::iso_manager::cis_establish_params params;
+  for (auto& handle : volatile_test_cig_create_cmpl_evt_.conn_handles) {
+    params.conn_pairs.push_back({handle, 1});
+  }
+  IsoManager::GetInstance()->EstablishCis(params);
+
+  for (auto& handle : volatile_test_cig_create_cmpl_evt_.conn_handles) {
+    IsoManager::GetInstance()->SetupIsoDataPath(handle,
+                                                kDefaultIsoDataPathParams);
+  }
+
+  auto handle_0 = volatile_test_cig_create_cmpl_evt_.conn_handles[0];
+  auto handle_1 = volatile_test_cig_create_cmpl_evt_.conn_handles[1];
+
+  // Use all the credits on the first CIS
+  EXPECT_CALL(iso_interface_, HciSend).Times(num_buffers).RetiresOnSaturation();
+  for (uint8_t i = 0; i < num_buffers; i++) {
+    IsoManager::GetInstance()->SendIsoData(handle_0, data_vec.data(),
+                                           data_vec.size());
+  }
+
+  // Queue on the second CIS, then on the first one
+  EXPECT_CALL(iso_interface_, HciSend).Times(0);
+  IsoManager::GetInstance()->SendIsoData(handle_1, data_vec.data(),
+                                         data_vec.size());
+  IsoManager::GetInstance()->SendIsoData(handle_0, data_vec.data(),
+                                         data_vec.size());
+  testing::Mock::VerifyAndClearExpectations(&iso_interface_);
+
+  // The packet queued first has the earliest deadline, and goes first
+  std::vector<uint16_t> sent_handles;
+  EXPECT_CALL(iso_interface_, HciSend)
+      .Times(2)
+      .WillRepeatedly([&sent_handles](BT_HDR* p_msg) {
+        uint8_t* p = p_msg->data;
+        uint16_t msg_handle;
+        STREAM_TO_UINT16(msg_handle, p);
+        sent_handles.push_back(msg_handle);
+      });
+  ReturnIsoCredits(handle_0, 1);
+  ASSERT_EQ(sent_handles, std::vector<uint16_t>({handle_1}));
+  ReturnIsoCredits(handle_0, 1);
+  ASSERT_EQ(sent_handles, std::vector<uint16_t>({handle_1, handle_0}));
+}
+
+TEST_F(IsoManagerTest, SendIsoDataQueuedExpired) {
+  uint8_t num_buffers = controller_interface_.GetIsoBufferCount();
+  std::vector<uint8_t> data_vec(108, 0);
+
+  IsoManager::GetInstance()->CreateBig(volatile_test_big_params_evt_.big_id,
+                                       kDefaultBigParams);
+  auto handle = volatile_test_big_params_evt_.conn_handles[0];
+  IsoManager::GetInstance()->SetupIsoDataPath(handle,
+                                              kDefaultIsoDataPathParams);
+
+  EXPECT_CALL(iso_interface_, HciSend).Times(num_buffers).RetiresOnSaturation();
+  for (uint8_t i = 0; i < num_buffers + 2; i++) {
+    IsoManager::GetInstance()->SendIsoData(handle, data_vec.data(),
+                                           data_vec.size());
+  }
+
+  /* Let the queued packets get older than their deadline, they are dropped
+   * instead of being sent late.
+   */
+  fake_tx_clock_us +=
+      kIsoTxDeadlineSduIntervals * kDefaultBigParams.sdu_itv + 1;
+
+  EXPECT_CALL(iso_interface_, HciSend).Times(0);
+  ReturnIsoCredits(handle, num_buffers);
+  testing::Mock::VerifyAndClearExpectations(&iso_interface_);
+
+  EXPECT_CALL(iso_interface_, HciSend).Times(1);
+  IsoManager::GetInstance()->SendIsoData(handle, data_vec.data(),
+                                         data_vec.size());
+}
+
 TEST_F(IsoManagerTest, SendIsoDataCreditsReturnedByDisconnection) {
   uint8_t num_buffers = controller_interface_.GetIsoBufferCount();
   std::vector<uint8_t> data_vec(108, 0);
@@ -23,6 +23,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "common/strings.h"
 #include "osi/include/allocator.h"
@@ -169,6 +170,61 @@ TEST_F(StackGattTest, GATT_Register_Deregister) {
   gatt_free();
 }
 
+TEST_F(StackGattTest, GATTS_AddService_StopService_handle_index) {
+  gatt_init();
+
+  tGATT_IF gatt_if = GATT_Register(bluetooth::Uuid::GetRandom(), "name",
+                                   &gatt_callbacks, false);
+  btgatt_db_element_t service[] = {
+      {
+          .uuid = bluetooth::Uuid::From16Bit(0x180d),
+          .type = BTGATT_DB_PRIMARY_SERVICE,
+      },
+      {
+          .uuid = bluetooth::Uuid::From16Bit(0x2a37),
+          .type = BTGATT_DB_CHARACTERISTIC,
+          .properties = GATT_CHAR_PROP_BIT_READ,
+          .permissions = GATT_PERM_READ,
+      },
+      {
+          .uuid = bluetooth::Uuid::From16Bit(GATT_UUID_CHAR_CLIENT_CONFIG),
+          .type = BTGATT_DB_DESCRIPTOR,
+          .permissions = GATT_PERM_READ | GATT_PERM_WRITE,
+      },
+  };
+  ASSERT_EQ(GATT_SERVICE_STARTED, GATTS_AddService(gatt_if, service, 3));
+
+  uint16_t s_hdl = service[0].attribute_handle;
+  // Service, characteristic declaration and value, descriptor
+  std::vector<uint16_t> handles = {s_hdl, static_cast<uint16_t>(s_hdl + 1),
+                                   service[1].attribute_handle,
+                                   service[2].attribute_handle};
+  for (uint16_t handle : handles) {
+    auto it = gatt_sr_find_i_rcb_by_handle(handle);
+    ASSERT_NE(gatt_cb.srv_list_info->end(), it);
+    ASSERT_EQ(s_hdl, it->s_hdl);
+    const GattServerHandleIndex::Entry* entry =
+        gatt_cb.srv_handle_index->Find(handle);
+    ASSERT_NE(nullptr, entry);
+    ASSERT_NE(nullptr, entry->attr);
+    ASSERT_EQ(handle, entry->attr->handle);
+  }
+
+  GATTS_StopService(s_hdl);
+  for (uint16_t handle : handles) {
+    ASSERT_EQ(gatt_cb.srv_list_info->end(),
+              gatt_sr_find_i_rcb_by_handle(handle));
+    ASSERT_EQ(nullptr, gatt_cb.srv_handle_index->Find(handle));
+  }
+
+  // The profile services of gatt_init() are still indexed
+  ASSERT_NE(gatt_cb.srv_list_info->end(),
+            gatt_sr_find_i_rcb_by_handle(gatt_cb.handle_of_database_hash));
+
+  GATT_Deregister(gatt_if);
+  gatt_free();
+}
+
 TEST_F_WITH_FLAGS(StackGattTest, gatt_status_text,
                   REQUIRES_FLAGS_ENABLED(ACONFIG_FLAG(TEST_BT,
                                                       enumerate_gatt_errors))) {
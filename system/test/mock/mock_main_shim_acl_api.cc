@@ -105,5 +105,9 @@ void bluetooth::shim::ACL_LeSubrateRequest(uint16_t /* hci_handle */,
                                            uint16_t /* sup_tout */) {
   inc_func_call_count(__func__);
 }
+void bluetooth::shim::ACL_SetLinkWeight(uint16_t /* hci_handle */,
+                                        uint8_t /* weight */) {
+  inc_func_call_count(__func__);
+}
 
 void bluetooth::shim::ACL_Shutdown() { inc_func_call_count(__func__); }
@@ -16,7 +16,7 @@
 
 /*
  * Generated mock file from original source file
- *   Functions generated:6
+ *   Functions generated:8
  *
  *  mockcify.pl ver 0.3.0
  */
@@ -48,6 +48,8 @@ namespace mock {
 namespace osi_allocator {
 
 // Function state capture and return values, if needed
+struct osi_allocator_debug_dump osi_allocator_debug_dump;
+struct osi_allocator_get_pool_stats osi_allocator_get_pool_stats;
 struct osi_calloc osi_calloc;
 struct osi_free osi_free;
 struct osi_free_and_reset osi_free_and_reset;
@@ -60,6 +62,16 @@ struct osi_strndup osi_strndup;
 }  // namespace test
 
 // Mocked functions, if any
+void osi_allocator_debug_dump(int fd) {
+  inc_func_call_count(__func__);
+  test::mock::osi_allocator::osi_allocator_debug_dump(fd);
+}
+size_t osi_allocator_get_pool_stats(osi_allocator_pool_stats_t* stats,
+                                    size_t max_pools) {
+  inc_func_call_count(__func__);
+  return test::mock::osi_allocator::osi_allocator_get_pool_stats(stats,
+                                                                 max_pools);
+}
 void* osi_calloc(size_t size) {
   inc_func_call_count(__func__);
   return test::mock::osi_allocator::osi_calloc(size);
@@ -16,7 +16,7 @@
 
 /*
  * Generated mock file from original source file
- *   Functions generated:6
+ *   Functions generated:8
  *
  *  mockcify.pl ver 0.3.0
  */
@@ -28,6 +28,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "osi/include/allocator.h"
+
 // Mocked compile conditionals, if any
 
 namespace test {
@@ -35,6 +37,29 @@ namespace mock {
 namespace osi_allocator {
 
 // Shared state between mocked functions and tests
+// Name: osi_allocator_debug_dump
+// Params: int fd
+// Return: void
+struct osi_allocator_debug_dump {
+  std::function<void(int fd)> body{[](int /* fd */) {}};
+  void operator()(int fd) { body(fd); };
+};
+extern struct osi_allocator_debug_dump osi_allocator_debug_dump;
+
+// Name: osi_allocator_get_pool_stats
+// Params: osi_allocator_pool_stats_t* stats, size_t max_pools
+// Return: size_t
+struct osi_allocator_get_pool_stats {
+  size_t return_value{0};
+  std::function<size_t(osi_allocator_pool_stats_t* stats, size_t max_pools)>
+      body{[this](osi_allocator_pool_stats_t* /* stats */,
+                  size_t /* max_pools */) { return return_value; }};
+  size_t operator()(osi_allocator_pool_stats_t* stats, size_t max_pools) {
+    return body(stats, max_pools);
+  };
+};
+extern struct osi_allocator_get_pool_stats osi_allocator_get_pool_stats;
+
 // Name: osi_calloc
 // Params: size_t size
 // Return: void*
@@ -74,6 +74,11 @@ tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr) {
   inc_func_call_count(__func__);
   return test::mock::stack_btm_dev::btm_find_dev.body(bd_addr);
 }
+tBTM_SEC_DEV_REC* btm_dev_resolve_rpa(const RawAddress& /* rpa */) {
+  inc_func_call_count(__func__);
+  return nullptr;
+}
+void btm_dev_invalidate_lookup_cache() { inc_func_call_count(__func__); }
 tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t /* handle */) {
   inc_func_call_count(__func__);
   return nullptr;
@@ -65,6 +65,7 @@ void IsoManager::HandleHciEvent(uint8_t /* sub_code */, uint8_t* /* params */,
 void IsoManager::Start() {}
 void IsoManager::Stop() {}
 void IsoManager::Dump(int /* fd */) {}
+void IsoManager::SetTxClockForTest(uint64_t (* /* clock_us */)()) {}
 
 }  // namespace hci
 }  // namespace bluetooth